@@ -24,12 +24,19 @@
 #define CMD_BME280                  0x05
 #define CMD_RTC                     0x09
 #define CMD_ADC                     0x02 
+#define CMD_LINK                    0x0A
 #define RTC_SET                     0x00
 #define RTC_READ                    0x01
 #define SERIAL_READ                 0x00
 #define FW_HW_VERSION_READ          0x01
 #define FW_BUILD_READ               0x02
 #define PRODUCTION_DATE_READ        0x03
+#define LINK_BAUD_SET               0x00
+#define LINK_BAUD_READ              0x01
+
+#define LINK_REPLY_MS               100
+#define LINK_CONFIRM_MS             1000    /* controller falls back after this */
+#define LINK_KEEPALIVE_MS           10000   /* controller falls back after 30 s idle */
 
 typedef struct {
     uint8_t year, month, day;
@@ -63,6 +70,11 @@ static bme_data_t   g_bme;
 static stm32_data_t g_stm32_data;
 static char ip_address[16] = "0.0.0.0";
 
+/* Fastest first; the controller refuses rates its USART clock can't hit */
+static const uint32_t link_bauds[] = { 3000000, 2000000, 1000000, 500000, 250000 };
+static uint32_t link_baud = UART_BAUD;
+static volatile uint8_t wait_link = 0;
+
 static volatile uint8_t wait_rtc = 0;
 static volatile uint8_t wait_bme = 0;
 static volatile uint8_t wait_serial = 0;
@@ -108,6 +120,72 @@ static void uart_send(uint8_t cmd, uint8_t param,
     uart_write_blocking(UART_PORT, frame, FRAME_LEN);
 }
 
+static inline uint8_t frame_crc_ok(const volatile uint8_t *f) {
+    uint8_t tmp[15];
+    for (int i = 0; i < 15; i++) tmp[i] = f[i];
+    return (crc8_atm(tmp, 15) == f[15]);
+}
+
+static void stm32_link_baud_read(void) {
+    uart_send(CMD_LINK, LINK_BAUD_READ, NULL, 0);
+    wait_link = 1;
+}
+
+/* Blocking, for the handshake only: next CRC-good frame answering cmd/param. */
+static uint8_t stm32_wait_reply(uint8_t cmd, uint8_t param, uint32_t timeout_ms)
+{
+    absolute_time_t until = make_timeout_time_ms(timeout_ms);
+
+    while (!time_reached(until)) {
+        if (!rx_ready) continue;
+        rx_ready = 0;
+        if (frame_crc_ok(rx_frame) && rx_frame[2] == cmd && rx_frame[3] == param)
+            return 1;
+    }
+    return 0;
+}
+
+static void link_set_baud(uint32_t baud)
+{
+    uart_bus_set_baud(UART_PORT, baud);
+    rx_idx = 0;
+    link_baud = baud;
+}
+
+/*
+ * Raise the link rate: set-baud is answered at the current rate, then both ends
+ * switch and a read at the new rate confirms it. If that read goes unanswered
+ * the controller returns to UART_BAUD after LINK_CONFIRM_MS, so we do the same
+ * and try the next rate.
+ */
+static void stm32_negotiate_baud(void)
+{
+    for (size_t i = 0; i < sizeof(link_bauds) / sizeof(link_bauds[0]); i++) {
+        uint32_t baud = link_bauds[i];
+        uint8_t p[4] = {
+            (uint8_t)(baud >> 24), (uint8_t)(baud >> 16),
+            (uint8_t)(baud >> 8),  (uint8_t)baud
+        };
+
+        uart_send(CMD_LINK, LINK_BAUD_SET, p, 4);
+        if (!stm32_wait_reply(CMD_LINK, LINK_BAUD_SET, LINK_REPLY_MS) || rx_frame[1] != STATUS_OK)
+            continue;
+
+        link_set_baud(baud);
+        for (int tries = 0; tries < 3; tries++) {
+            uart_send(CMD_LINK, LINK_BAUD_READ, NULL, 0);
+            if (stm32_wait_reply(CMD_LINK, LINK_BAUD_READ, LINK_REPLY_MS) && rx_frame[1] == STATUS_OK) {
+                printf("UART link at %lu baud\n", (unsigned long)baud);
+                return;
+            }
+        }
+
+        link_set_baud(UART_BAUD);
+        sleep_ms(LINK_CONFIRM_MS);
+    }
+    printf("UART link at %lu baud\n", (unsigned long)link_baud);
+}
+
 static void stm32_read_serial(void) {
     uart_send(CMD_SERIAL, SERIAL_READ, NULL, 0);
     wait_serial = 1;
@@ -218,12 +296,6 @@ static void get_ip_address(void)
     }
 }
 
-static inline uint8_t frame_crc_ok(const volatile uint8_t *f) {
-    uint8_t tmp[15];
-    for (int i = 0; i < 15; i++) tmp[i] = f[i];
-    return (crc8_atm(tmp, 15) == f[15]);
-}
-
 int main(void)
 {
     stdio_init_all();
@@ -248,7 +320,11 @@ int main(void)
 
     mqtt_init(NULL);
 
+    /* Last, so the Wi-Fi and NTP waits don't run into the controller's idle fallback */
+    stm32_negotiate_baud();
+
     absolute_time_t next = make_timeout_time_ms(5000);
+    absolute_time_t keepalive = make_timeout_time_ms(LINK_KEEPALIVE_MS);
 
     while (1) {
 
@@ -260,6 +336,10 @@ int main(void)
                 continue;
             }
 
+            if (wait_link && rx_frame[2] == CMD_LINK && rx_frame[3] == LINK_BAUD_READ) {
+                wait_link = 0;
+            }
+
             if (wait_rtc && rx_frame[2] == CMD_RTC && rx_frame[3] == RTC_READ && parse_rtc(rx_frame, &g_time)) {
                 wait_rtc = 0;
 
@@ -355,6 +435,20 @@ int main(void)
             }
         }
 
+        /* Above UART_BAUD: keep the controller from falling back, and notice if it did */
+        if (link_baud != UART_BAUD && time_reached(keepalive)) {
+            keepalive = make_timeout_time_ms(LINK_KEEPALIVE_MS);
+            if (wait_link) {
+                wait_link = 0;
+                printf("UART link lost at %lu baud\n", (unsigned long)link_baud);
+                link_set_baud(UART_BAUD);
+                sleep_ms(LINK_CONFIRM_MS);
+                stm32_negotiate_baud();
+            } else {
+                stm32_link_baud_read();
+            }
+        }
+
         if (time_reached(next)) {
             next = make_timeout_time_ms(60000);
             stm32_rtc_read();
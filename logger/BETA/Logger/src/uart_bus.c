@@ -9,4 +9,10 @@ void uart_bus_init(uart_inst_t *uart, uint tx_pin, uint rx_pin, uint baudrate )
     uart_set_hw_flow(uart, false, false);
     uart_set_format(uart, 8, 1, UART_PARITY_NONE);
     uart_set_fifo_enabled(uart, false);
-}
\ No newline at end of file
+}
+
+/* Lets the last byte at the old rate leave the shift register first; returns the rate actually set. */
+uint uart_bus_set_baud(uart_inst_t *uart, uint baudrate) {
+    uart_tx_wait_blocking(uart);
+    return uart_set_baudrate(uart, baudrate);
+}
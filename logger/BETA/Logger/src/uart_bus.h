@@ -4,5 +4,6 @@
 #include "hardware/uart.h"
 
 void uart_bus_init(uart_inst_t *uart, uint tx_pin, uint rx_pin, uint baudrate);
+uint uart_bus_set_baud(uart_inst_t *uart, uint baudrate);
 
 #endif
\ No newline at end of file
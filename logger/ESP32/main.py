@@ -65,6 +65,9 @@ def main():
         time.sleep(4)
 
         stm32.req_ping()
+        for baud in (3_000_000, 2_000_000, 1_000_000):
+            if stm32.req_link_baud(baud):
+                break
         program.set_time()
         time.sleep(0.1)
         control_date = stm32.req_rtc_read()
@@ -350,14 +350,25 @@ class Program:
         try:
             if self.stm32.req_get_input_states(0x03):
                 self.set_time()
-                serial = self.stm32.req_serial()
-                fw, hw = self.stm32.req_fw_hw_version()
-                build_data = self.stm32.req_build_date()
-                prod_date = self.stm32.req_prod_date()
-                v0, v1 = self.stm32.req_adc()
-                t, h = self.stm32.req_sht40()
-                tb, hb, pb = self.stm32.req_bme280()
-                date = self.stm32.req_rtc_read()
+                st = self.stm32.req_status_batch()
+                if st:
+                    serial = st["serial"]
+                    fw, hw = st["fw_hw"]
+                    build_data = st["build_date"]
+                    prod_date = st["prod_date"]
+                    v0, v1 = st["adc"]
+                    t, h = st["sht40"]
+                    tb, hb, pb = st["bme280"]
+                    date = st["rtc"]
+                else:
+                    serial = self.stm32.req_serial()
+                    fw, hw = self.stm32.req_fw_hw_version()
+                    build_data = self.stm32.req_build_date()
+                    prod_date = self.stm32.req_prod_date()
+                    v0, v1 = self.stm32.req_adc()
+                    t, h = self.stm32.req_sht40()
+                    tb, hb, pb = self.stm32.req_bme280()
+                    date = self.stm32.req_rtc_read()
 
                 v0_voltage = self.stm32.adc_to_voltage(v0)
                 v1_voltage = self.stm32.adc_to_voltage(v1)
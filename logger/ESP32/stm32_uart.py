@@ -5,11 +5,17 @@ DEV_ADDR = 0xB2
 FRAME_LEN_APP = 24
 STATUS_OK = 0x40
 STATUS_ERR = 0x7F
+CMD_BATCH = 0x08
+CMD_LINK = 0x0A
+BAUD_DEFAULT = 115200
+LINK_CONFIRM_MS = 1000
 
 
 class STM32UART:
     def __init__(self, uart_device: UART):
         self.uart = uart_device
+        self.baud = BAUD_DEFAULT
+        self.link_target = 0
 
     def crc8_atm(self, data: bytes) -> int:
         crc = 0x00
@@ -81,6 +87,168 @@ class STM32UART:
             return data
         return None
 
+    def _set_baud(self, baud: int):
+        self.uart.flush()
+        self.uart.init(baudrate=baud)
+        self.baud = baud
+
+    def _exchange(self, loop, frame: bytes) -> bytes | None:
+        """One request; if it goes unanswered above BAUD_DEFAULT the controller has
+        fallen back, so retry at BAUD_DEFAULT and negotiate the rate again."""
+        resp = loop(frame)
+        if resp or self.baud == BAUD_DEFAULT:
+            return resp
+        self._set_baud(BAUD_DEFAULT)
+        resp = loop(frame)
+        if resp and self.link_target:
+            self.req_link_baud(self.link_target)
+        return resp
+
+    def req_link_baud(self, baud: int) -> bool:
+        """Raise the link rate (0x0A00), confirmed with a read at the new rate (0x0A01).
+
+        The controller answers at the old rate and switches once the answer is out.
+        If nothing good arrives within LINK_CONFIRM_MS it returns to 115200, and so
+        do we. It also falls back after 30 s without traffic; _exchange notices
+        the silence and brings the link back up.
+        """
+        resp = self.uart_loop_application(
+            self.uart_message_application(CMD_LINK, 0x00, baud.to_bytes(4, "big"))
+        )
+        parsed = self.parse_resp(resp)
+        if not parsed or parsed[1] != STATUS_OK:
+            return False
+
+        self._set_baud(baud)
+        for _ in range(3):
+            resp = self.uart_loop_application(self.uart_message_application(CMD_LINK, 0x01))
+            parsed = self.parse_resp(resp)
+            if parsed and parsed[1] == STATUS_OK:
+                self.link_target = baud
+                return True
+
+        self._set_baud(BAUD_DEFAULT)
+        time.sleep_ms(LINK_CONFIRM_MS)
+        return False
+
+    def uart_loop_batch(self, frame: bytes) -> bytes | None:
+        self._flush_rx()
+        self.uart.write(frame)
+        t0 = time.ticks_ms()
+        while time.ticks_diff(time.ticks_ms(), t0) < 1500:
+            b = self.uart.read(1)
+            if not b:
+                time.sleep_ms(2)
+                continue
+            if b[0] != DEV_ADDR:
+                continue
+
+            head = self.read_exact(4, 1200)
+            if head is None:
+                return None
+            rest = self.read_exact(head[3] + 1, 1200)
+            if rest is None:
+                return None
+
+            data = bytes([DEV_ADDR]) + head + rest
+            if self.crc8_atm(data[:-1]) != data[-1]:
+                continue
+            return data
+        return None
+
+    def req_batch(self, requests):
+        """Run several (cmd, param, payload) requests in one round trip.
+
+        Returns a list of (status, cmd, param, payload) in request order, or None
+        if the controller did not answer (e.g. firmware without batch support).
+        A shorter list means the controller stopped early.
+        """
+        body = bytearray([len(requests)])
+        for cmd, param, payload in requests:
+            body += bytes([cmd & 0xFF, param & 0xFF]) + payload
+        if len(body) > FRAME_LEN_APP - 5:
+            return None
+
+        frame = self.uart_message_application(CMD_BATCH, 0x00, body)
+        resp = self._exchange(self.uart_loop_batch, frame)
+        if not resp or resp[2] != CMD_BATCH:
+            return None
+
+        body = resp[5:-1]
+        done = body[0]
+        out = []
+        i = 1
+        for _ in range(done):
+            if i + 4 > len(body):
+                return None
+            n = body[i + 3]
+            out.append((body[i], body[i + 1], body[i + 2], body[i + 4 : i + 4 + n]))
+            i += 4 + n
+        return out
+
+    def req_status_batch(self):
+        """Serial, versions, dates, ADC, SHT40, BME280 and RTC in one round trip.
+
+        Returns a dict with the same values the single req_* calls produce, or
+        None so the caller can fall back to them.
+        """
+        res = self.req_batch(
+            [
+                (0x01, 0x00, b""),
+                (0x01, 0x01, b""),
+                (0x01, 0x02, b""),
+                (0x01, 0x03, b""),
+                (0x02, 0x00, b""),
+                (0x03, 0x00, b"\x00"),  # flags 0: cached sample
+                (0x03, 0x01, b"\x00"),
+                (0x06, 0x00, b""),
+            ]
+        )
+        if not res or len(res) != 8:
+            return None
+        p = {(c, a): (st, pl) for st, c, a, pl in res}
+
+        def ok(key, n):
+            st, pl = p.get(key, (STATUS_ERR, b""))
+            return pl if st == STATUS_OK and len(pl) >= n else None
+
+        out = {}
+        v = ok((0x01, 0x00), 4)
+        out["serial"] = self.u32_from_be(v, 0) if v else 0
+        v = ok((0x01, 0x01), 5)
+        out["fw_hw"] = [f"{v[0]}.{v[1]}.{v[2]}", f"{v[3]}.{v[4]}"] if v else ["", ""]
+        v = ok((0x01, 0x02), 10)
+        out["build_date"] = bytes(v[:10]).split(b"\x00")[0].decode("ascii") if v else ""
+        v = ok((0x01, 0x03), 10)
+        out["prod_date"] = bytes(v[:10]).split(b"\x00")[0].decode("ascii") if v else ""
+        v = ok((0x02, 0x00), 4)
+        out["adc"] = [self.u16_from_be(v, 0), self.u16_from_be(v, 2)] if v else [0, 0]
+        v = ok((0x03, 0x00), 4)
+        out["sht40"] = (
+            [self.i16_from_be(v, 0) / 100.0, self.u16_from_be(v, 2) / 100.0]
+            if v
+            else [0.0, 0.0]
+        )
+        v = ok((0x03, 0x01), 12)
+        out["bme280"] = (
+            [
+                self.i32_from_be(v, 0) / 100.0,
+                self.u32_from_be(v, 4) / 1024.0,
+                self.u32_from_be(v, 8) / 25600.0,
+            ]
+            if v
+            else [0.0, 0.0, 0.0]
+        )
+        v = ok((0x06, 0x00), 7)
+        out["rtc"] = (
+            "20{:02d}-{:02d}-{:02d}T{:02d}:{:02d}:{:02d}Z".format(
+                v[0], v[1], v[2], v[4], v[5], v[6]
+            )
+            if v
+            else ""
+        )
+        return out
+
     def parse_resp(self, resp: bytes):
         if not resp or len(resp) != FRAME_LEN_APP:
             return None
@@ -127,9 +295,8 @@ class STM32UART:
         return vadc * (r_top + r_bottom) / r_bottom
 
     def _send_cmd(self, cmd, param=0, payload=b"", check_status=True):
-        resp = self.uart_loop_application(
-            self.uart_message_application(cmd, param, payload)
-        )
+        frame = self.uart_message_application(cmd, param, payload)
+        resp = self._exchange(self.uart_loop_application, frame)
         parsed = self.parse_resp(resp)
         if not parsed:
             return None
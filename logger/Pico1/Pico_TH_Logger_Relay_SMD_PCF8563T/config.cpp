@@ -1,27 +1,61 @@
 #include "config.hpp"
-#include "main.hpp"
+#include "config_schema.hpp"
 
 #include <cstdint>
 #include <cstring>
 #include <cstddef>
 
+#include "pico/flash.h"
+#include "pico/stdlib.h"
 #include "hardware/flash.h"
-#include "hardware/sync.h"
 #include "hardware/regs/addressmap.h"
 
 #ifndef PICO_FLASH_SIZE_BYTES
 #define PICO_FLASH_SIZE_BYTES (2u * 1024u * 1024u)
 #endif
 
-static_assert(sizeof(Config) <= FLASH_PAGE_SIZE,
-              "Config size must fit into a single flash page");
-
 static constexpr uint32_t CONFIG_MAGIC   = 0x434F4E46u;
-static constexpr uint16_t CONFIG_VERSION = 4;
+static constexpr uint16_t CONFIG_VERSION = 6;
+
+/**
+ * Journal record header. A record is the header followed by a full Config image,
+ * padded with 0xFF to whole flash pages (JOURNAL_RECORD_SIZE). crc covers the
+ * header fields before it plus len payload bytes; a torn or partially programmed
+ * record therefore never validates.
+ */
+struct JournalHeader {
+    uint32_t magic;
+    uint32_t seq;
+    uint16_t len;
+    uint16_t version;
+    uint32_t crc;
+};
+
+static constexpr uint32_t JOURNAL_MAGIC       = 0x434A4E4Cu;
+static constexpr uint32_t JOURNAL_SECTORS     = 4;
+static constexpr size_t   JOURNAL_RECORD_SIZE =
+    ((sizeof(JournalHeader) + sizeof(Config) + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE) * FLASH_PAGE_SIZE;
+static constexpr uint32_t JOURNAL_SLOTS_PER_SECTOR = FLASH_SECTOR_SIZE / JOURNAL_RECORD_SIZE;
+static constexpr uint32_t JOURNAL_SLOTS       = JOURNAL_SECTORS * JOURNAL_SLOTS_PER_SECTOR;
+
+static_assert(JOURNAL_RECORD_SIZE <= FLASH_SECTOR_SIZE,
+              "Config journal record must fit into one flash sector");
+static_assert(JOURNAL_SECTORS >= 2,
+              "Config journal needs a spare sector to keep the latest record while erasing");
 
 static Config       g_config{};
 static ConfigSource g_last_source = ConfigSource::Unknown;
 
+static constexpr uint32_t CONFIG_FLASH_SAFE_TIMEOUT_MS = 100;
+static constexpr uint32_t CONFIG_COMMIT_HOLDOFF_MS     = 2000;
+
+static bool     g_commit_pending = false;
+static uint32_t g_commit_due_ms  = 0;
+
+static bool     g_journal_scanned = false;
+static uint32_t g_journal_next_slot = 0;
+static uint32_t g_journal_next_seq  = 1;
+
 struct ConfigV3 {
     uint32_t magic;
     uint16_t version;
@@ -46,6 +80,55 @@ struct ConfigV3 {
 
 static_assert(sizeof(ConfigV3) <= FLASH_PAGE_SIZE, "v3 config must fit flash page");
 
+struct ConfigV4 {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t logger_id;
+    uint32_t sensor_id;
+    char     server_ip[64];
+    uint16_t server_port;
+    uint8_t  temperature;
+    uint8_t  humidity;
+    uint8_t  pressure;
+    uint8_t  sht;
+    uint8_t  clock_enabled;
+    uint8_t  set_time_enabled;
+    uint8_t  wifi_enabled;
+    uint8_t  logging_enabled;
+    char     wifi_ssid[33];
+    char     wifi_password[65];
+    uint32_t post_time_ms;
+    uint32_t crc32;
+};
+
+static_assert(sizeof(ConfigV4) <= FLASH_PAGE_SIZE, "v4 config must fit flash page");
+
+struct ConfigV5 {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t logger_id;
+    uint32_t sensor_id;
+    char     server_ip[64];
+    uint16_t server_port;
+    uint8_t  temperature;
+    uint8_t  humidity;
+    uint8_t  pressure;
+    uint8_t  sht;
+    uint8_t  clock_enabled;
+    uint8_t  set_time_enabled;
+    uint8_t  wifi_enabled;
+    uint8_t  logging_enabled;
+    char     wifi_ssid[33];
+    char     wifi_password[65];
+    uint32_t post_time_ms;
+    char     ntp_servers[CONFIG_NTP_SERVERS][64];
+    uint32_t crc32;
+};
+
+static_assert(sizeof(ConfigV5) <= FLASH_SECTOR_SIZE, "v5 config must fit flash sector");
+
 /**
  * @brief Computes/updates a CRC-32 (IEEE 802.3) checksum over a byte buffer.
  *
@@ -76,7 +159,7 @@ static uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t len) {
 }
 
 /**
- * Compute the v4 CRC-32 over a Config instance.
+ * Compute the v6 CRC-32 over a Config instance.
  *
  * The checksum covers the raw bytes from the 'version' member (inclusive)
  * up to the 'crc32' member (exclusive). The 'crc32' field itself is not
@@ -93,13 +176,49 @@ static uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t len) {
  * @param cfg The configuration instance to checksum.
  * @return The 32-bit CRC of the specified slice of cfg.
  */
-static uint32_t calc_crc32_v4(const Config& cfg) {
+static uint32_t calc_crc32_v6(const Config& cfg) {
     const uint8_t* base = reinterpret_cast<const uint8_t*>(&cfg);
     const size_t start = offsetof(Config, version);
     const size_t end   = offsetof(Config, crc32);
     return crc32_update(0, base + start, end - start);
 }
 
+/**
+ * @brief Calculates a CRC-32 checksum for a ConfigV5 instance.
+ *
+ * Same coverage rule as calc_crc32_v6(): bytes from ConfigV5::version (inclusive)
+ * up to ConfigV5::crc32 (exclusive). Used only to validate version 5 images
+ * before migrating them.
+ *
+ * @param cfg Reference to the legacy configuration instance to checksum.
+ * @return 32-bit CRC-32 value of the selected fields.
+ * @see crc32_update, ConfigV5
+ */
+static uint32_t calc_crc32_v5(const ConfigV5& cfg) {
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(&cfg);
+    const size_t start = offsetof(ConfigV5, version);
+    const size_t end   = offsetof(ConfigV5, crc32);
+    return crc32_update(0, base + start, end - start);
+}
+
+/**
+ * @brief Calculates a CRC-32 checksum for a ConfigV4 instance.
+ *
+ * Same coverage rule as calc_crc32_v6(): bytes from ConfigV4::version (inclusive)
+ * up to ConfigV4::crc32 (exclusive). Used only to validate images written by
+ * firmware with configuration format version 4 before migrating them.
+ *
+ * @param cfg Reference to the legacy configuration instance to checksum.
+ * @return 32-bit CRC-32 value of the selected fields.
+ * @see crc32_update, ConfigV4
+ */
+static uint32_t calc_crc32_v4(const ConfigV4& cfg) {
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(&cfg);
+    const size_t start = offsetof(ConfigV4, version);
+    const size_t end   = offsetof(ConfigV4, crc32);
+    return crc32_update(0, base + start, end - start);
+}
+
 /**
  * @brief Calculates a CRC-32 checksum for a ConfigV3 instance.
  *
@@ -124,42 +243,254 @@ static uint32_t calc_crc32_v3(const ConfigV3& cfg) {
     return crc32_update(0, base + start, end - start);
 }
 
+/**
+ * @brief Migrate a legacy configuration image into g_config.
+ *
+ * Copies every CONFIG_FIELDS entry whose member exists in the legacy layout
+ * (config_fields_migrate()); fields introduced later (e.g. ntp_servers, the Wi-Fi
+ * reconnect cache) keep their factory values. Strings are truncated to the current
+ * buffer sizes and always null-terminated.
+ *
+ * @tparam Legacy ConfigV3, ConfigV4 or ConfigV5.
+ * @param old Validated legacy configuration image.
+ */
+template <typename Legacy>
+static void migrate_legacy(const Legacy& old) {
+    std::memset(&g_config, 0, sizeof(g_config));
+    config_fields_migrate(g_config, old);
+    g_config.magic   = CONFIG_MAGIC;
+    g_config.version = CONFIG_VERSION;
+    g_config.crc32   = calc_crc32_v6(g_config);
+}
+
 /**
  * @brief Compute the start offset of the last flash sector.
  *
  * @details Returns the byte offset (relative to the XIP flash base) that marks
- * the beginning of the final erase sector in on-board flash. This is typically
- * used to reserve a dedicated region for persistent data (e.g., configuration
- * or logs) that does not overlap with application code.
+ * the beginning of the final erase sector in on-board flash. Firmware before the
+ * config journal stored a single Config image at this offset; it is only read as
+ * a fallback (see config_load()) and is erased once the journal wraps into it.
+ *
+ * @return uint32_t Byte offset from XIP_BASE to the start of the last flash sector.
+ */
+static uint32_t get_storage_offset() {
+    return PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE;
+}
+
+/**
+ * @brief Compute the flash offset of a journal slot.
+ *
+ * @details The journal occupies the last JOURNAL_SECTORS erase sectors of on-board
+ * flash. Each sector holds JOURNAL_SLOTS_PER_SECTOR records; records never straddle
+ * a sector boundary.
  *
  * Assumptions:
  * - PICO_FLASH_SIZE_BYTES and FLASH_SECTOR_SIZE accurately describe the device.
- * - The final sector is reserved and not used by the program image or filesystem.
+ * - The journal sectors are reserved and not used by the program image or filesystem.
  *
- * Characteristics:
- * - The returned offset is sector-aligned.
- * - No side effects; thread-safe.
+ * @param slot Slot index, 0..JOURNAL_SLOTS-1.
+ * @return uint32_t Byte offset from XIP_BASE to the start of the slot (page aligned).
+ */
+static uint32_t journal_slot_offset(uint32_t slot) {
+    const uint32_t base = PICO_FLASH_SIZE_BYTES - JOURNAL_SECTORS * FLASH_SECTOR_SIZE;
+    return base + (slot / JOURNAL_SLOTS_PER_SECTOR) * FLASH_SECTOR_SIZE
+                + (slot % JOURNAL_SLOTS_PER_SECTOR) * JOURNAL_RECORD_SIZE;
+}
+
+/**
+ * @brief Compute the CRC-32 of a journal record.
  *
- * @return uint32_t Byte offset from XIP_BASE to the start of the last flash sector.
+ * @param hdr     Record header (crc field excluded from the checksum).
+ * @param payload Pointer to hdr.len payload bytes.
+ * @return CRC-32 over the header fields before crc and the payload.
  */
-static uint32_t get_storage_offset() {
-    return PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE;
+static uint32_t journal_crc(const JournalHeader& hdr, const uint8_t* payload) {
+    uint32_t crc = crc32_update(0, reinterpret_cast<const uint8_t*>(&hdr), offsetof(JournalHeader, crc));
+    return crc32_update(crc, payload, hdr.len);
+}
+
+/**
+ * @brief Read and validate the record in a journal slot.
+ *
+ * @param slot Slot index.
+ * @param hdr  Receives the record header.
+ * @param out  Receives the Config payload (only if the record is valid).
+ * @return true if the slot holds a complete current-version record with a valid CRC.
+ */
+static bool journal_read_slot(uint32_t slot, JournalHeader& hdr, Config& out) {
+    const uint8_t* flash_ptr = reinterpret_cast<const uint8_t*>(XIP_BASE + journal_slot_offset(slot));
+    std::memcpy(&hdr, flash_ptr, sizeof(JournalHeader));
+    if (hdr.magic != JOURNAL_MAGIC || hdr.len != sizeof(Config) || hdr.version != CONFIG_VERSION) {
+        return false;
+    }
+    if (journal_crc(hdr, flash_ptr + sizeof(JournalHeader)) != hdr.crc) {
+        return false;
+    }
+    std::memcpy(&out, flash_ptr + sizeof(JournalHeader), sizeof(Config));
+    return out.magic == CONFIG_MAGIC && calc_crc32_v6(out) == out.crc32;
+}
+
+/**
+ * @brief Check whether a journal slot is erased (all bytes 0xFF).
+ *
+ * @param slot Slot index.
+ * @return true if the slot can be programmed without an erase.
+ */
+static bool journal_slot_blank(uint32_t slot) {
+    const uint8_t* flash_ptr = reinterpret_cast<const uint8_t*>(XIP_BASE + journal_slot_offset(slot));
+    for (size_t i = 0; i < JOURNAL_RECORD_SIZE; ++i) {
+        if (flash_ptr[i] != 0xFF) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Scan the journal for the newest valid record and the next write slot.
+ *
+ * Every slot is examined; the valid record with the highest sequence number wins.
+ * The write position becomes the slot following it (or slot 0 for an empty
+ * journal), and the next sequence number continues from it. Invalid records (torn
+ * writes, older formats) are simply skipped.
+ *
+ * @param latest Receives the newest valid Config, if any.
+ * @return true if a valid record was found.
+ *
+ * @post g_journal_next_slot and g_journal_next_seq are initialized.
+ */
+static bool journal_scan(Config& latest) {
+    bool found = false;
+    uint32_t best_seq = 0;
+    uint32_t best_slot = 0;
+
+    for (uint32_t slot = 0; slot < JOURNAL_SLOTS; ++slot) {
+        JournalHeader hdr{};
+        Config cfg{};
+        if (!journal_read_slot(slot, hdr, cfg)) continue;
+        if (!found || (int32_t)(hdr.seq - best_seq) > 0) {
+            found = true;
+            best_seq = hdr.seq;
+            best_slot = slot;
+            latest = cfg;
+        }
+    }
+
+    g_journal_next_slot = found ? (best_slot + 1) % JOURNAL_SLOTS : 0;
+    g_journal_next_seq  = found ? best_seq + 1 : 1;
+    g_journal_scanned   = true;
+    return found;
+}
+
+struct FlashOp {
+    uint32_t       offset;
+    const uint8_t* data;    // nullptr: erase one sector
+    size_t         len;
+};
+
+/**
+ * @brief flash_safe_execute() callback performing one erase or program operation.
+ *
+ * @param param Pointer to a FlashOp.
+ */
+static void flash_op_cb(void* param) {
+    const FlashOp* op = static_cast<const FlashOp*>(param);
+    if (op->data) {
+        flash_range_program(op->offset, op->data, op->len);
+    } else {
+        flash_range_erase(op->offset, FLASH_SECTOR_SIZE);
+    }
+}
+
+/**
+ * @brief Run a flash erase/program through flash_safe_execute().
+ *
+ * flash_safe_execute() disables interrupts on this core and, if the other core
+ * is running, parks it in RAM (multicore lockout) so neither core touches XIP
+ * while the flash is busy. The SDK flash routines themselves run from RAM.
+ *
+ * @return true if the operation was executed; false if the other core could not
+ *         be paused within CONFIG_FLASH_SAFE_TIMEOUT_MS.
+ */
+static bool flash_op(uint32_t offset, const uint8_t* data, size_t len) {
+    FlashOp op{offset, data, len};
+    return flash_safe_execute(flash_op_cb, &op, CONFIG_FLASH_SAFE_TIMEOUT_MS) == PICO_OK;
+}
+
+/**
+ * @brief Append a configuration image to the journal and verify it.
+ *
+ * Process:
+ * - Uses the slot after the newest record. When that slot starts a sector, the
+ *   sector is erased first; this is the only erase and it discards only records
+ *   already superseded by newer ones in the previous sectors (the journal is a
+ *   ring, so erasing the oldest sector is its garbage collection). A slot in the
+ *   middle of a sector that is not blank (e.g. a torn write before a reset) is
+ *   skipped.
+ * - Programs one JOURNAL_RECORD_SIZE record (header + cfg, padded with 0xFF). The
+ *   erase and the program are separate flash_op() calls, so interrupts are off only
+ *   for the duration of each one.
+ * - Reads the record back and validates it.
+ *
+ * The write position advances even on failure, so a retry uses a fresh slot.
+ *
+ * @param cfg Fully populated image (magic, version and crc32 already set).
+ * @return true if the record was written and verified; false otherwise.
+ *
+ * Notes:
+ * - Not reentrant; do not call concurrently from multiple contexts.
+ * - Power loss during a write leaves the previous record as the newest valid one.
+ */
+static bool write_config(const Config& cfg) {
+    if (!g_journal_scanned) {
+        Config ignored{};
+        (void)journal_scan(ignored);
+    }
+
+    uint32_t slot = g_journal_next_slot;
+    for (uint32_t tries = 0; tries < JOURNAL_SLOTS_PER_SECTOR; ++tries) {
+        if (slot % JOURNAL_SLOTS_PER_SECTOR == 0 || journal_slot_blank(slot)) break;
+        slot = (slot + 1) % JOURNAL_SLOTS;
+    }
+    const uint32_t offset = journal_slot_offset(slot);
+
+    alignas(FLASH_PAGE_SIZE) static uint8_t record[JOURNAL_RECORD_SIZE];
+    std::memset(record, 0xFF, sizeof(record));
+    JournalHeader hdr{};
+    hdr.magic   = JOURNAL_MAGIC;
+    hdr.seq     = g_journal_next_seq;
+    hdr.len     = sizeof(Config);
+    hdr.version = CONFIG_VERSION;
+    hdr.crc     = journal_crc(hdr, reinterpret_cast<const uint8_t*>(&cfg));
+    std::memcpy(record, &hdr, sizeof(hdr));
+    std::memcpy(record + sizeof(hdr), &cfg, sizeof(Config));
+
+    if (slot % JOURNAL_SLOTS_PER_SECTOR == 0 && !flash_op(offset, nullptr, 0)) {
+        return false;
+    }
+
+    g_journal_next_slot = (slot + 1) % JOURNAL_SLOTS;
+    g_journal_next_seq++;
+    if (!flash_op(offset, record, JOURNAL_RECORD_SIZE)) {
+        return false;
+    }
+
+    JournalHeader verify_hdr{};
+    Config verify{};
+    return journal_read_slot(slot, verify_hdr, verify) &&
+           verify_hdr.seq == hdr.seq &&
+           verify.crc32 == cfg.crc32;
 }
 
 /**
  * @brief Initialize the global configuration with compile-time default values.
  *
  * This function resets and populates the global configuration structure (g_config)
- * with factory/default settings derived from compile-time constants. It:
+ * with factory/default settings. It:
  * - Zero-initializes the entire structure to ensure deterministic state.
  * - Sets compatibility fields: CONFIG_MAGIC and CONFIG_VERSION (reserved is cleared).
- * - Assigns device identifiers: LOGGER_ID and SENSOR_ID.
- * - Configures server endpoint: SERVER_IP (null-terminated within buffer) and SERVER_PORT.
- * - Enables/disables sensor features: TEMPERATURE, HUMIDITY, PRESSURE, SHT.
- * - Configures clock behavior: CLOCK and SET_TIME.
- * - Enables Wi‑Fi: WIFI_ENABLE and sets WIFI_SSID/WIFI_PASSWORD (null-terminated within buffers).
- * - Sets posting interval: POST_TIME (milliseconds).
- * - Finalizes the structure integrity by computing and storing CRC32 via calc_crc32_v4.
+ * - Applies the default of every CONFIG_FIELDS entry (config_fields_set_defaults()),
+ *   i.e. the compile-time constants from main.hpp (LOGGER_ID, SERVER_IP, WIFI_SSID,
+ *   POST_TIME, NTP_SERVER_1..3, ...); the Wi-Fi reconnect cache starts empty.
+ * - Finalizes the structure integrity by computing and storing CRC32 via calc_crc32_v6.
  *
  * Notes:
  * - String fields are cleared and then copied with truncation-safe semantics; values longer
@@ -172,13 +503,10 @@ static uint32_t get_storage_offset() {
  * Thread-safety:
  * - Not thread-safe; synchronize external access if g_config may be used concurrently.
  *
- * Preconditions:
- * - Compile-time constants/macros (e.g., CONFIG_MAGIC, SERVER_IP, WIFI_SSID) are defined and valid.
- *
  * Postconditions:
  * - g_config contains a consistent, default configuration with a valid crc32 field.
  *
- * @see calc_crc32_v4
+ * @see calc_crc32_v6, config_schema.hpp
  */
 void config_set_defaults() {
     std::memset(&g_config, 0, sizeof(g_config));
@@ -187,45 +515,26 @@ void config_set_defaults() {
     g_config.version  = CONFIG_VERSION;
     g_config.reserved = 0;
 
-    g_config.logger_id   = LOGGER_ID;
-    g_config.sensor_id   = SENSOR_ID;
-
-    std::memset(g_config.server_ip, 0, sizeof(g_config.server_ip));
-    std::strncpy(g_config.server_ip, SERVER_IP, sizeof(g_config.server_ip) - 1);
-    g_config.server_port = SERVER_PORT;
-
-    g_config.temperature     = TEMPERATURE;
-    g_config.humidity        = HUMIDITY;
-    g_config.pressure        = PRESSURE;
-    g_config.sht             = SHT;
-    g_config.clock_enabled   = CLOCK;
-    g_config.set_time_enabled= SET_TIME;
-    g_config.wifi_enabled    = WIFI_ENABLE;
-    g_config.logging_enabled = LOGGING_ENABLE;
-
-    std::memset(g_config.wifi_ssid,     0, sizeof(g_config.wifi_ssid));
-    std::memset(g_config.wifi_password, 0, sizeof(g_config.wifi_password));
-    std::strncpy(g_config.wifi_ssid,     WIFI_SSID,     sizeof(g_config.wifi_ssid) - 1);
-    std::strncpy(g_config.wifi_password, WIFI_PASSWORD, sizeof(g_config.wifi_password) - 1);
-
-    g_config.post_time_ms = POST_TIME;
-    g_config.crc32 = calc_crc32_v4(g_config);
+    config_fields_set_defaults(g_config);
+
+    g_config.crc32 = calc_crc32_v6(g_config);
 }
 
 /**
  * @brief Load configuration from flash into the runtime configuration.
  *
  * @details
- * - Reads a header from the flash region at the offset returned by get_storage_offset().
- * - Validates the magic value (CONFIG_MAGIC). If it does not match, returns false.
- * - If the version matches CONFIG_VERSION:
- *   - Reads the current Config, validates its CRC32 via calc_crc32_v4, and on success
- *     copies it into g_config.
- * - If the version is 3:
- *   - Reads legacy ConfigV3, validates its CRC32 via calc_crc32_v3.
- *   - On success, calls config_set_defaults(), migrates compatible fields to g_config,
- *     updates g_config.version to CONFIG_VERSION, recalculates CRC via calc_crc32_v4,
- *     and stores it in g_config.
+ * - Scans the config journal (journal_scan()); if it holds a valid record, the newest
+ *   one is copied into g_config.
+ * - Otherwise falls back to the single image written by firmware before the journal,
+ *   at the offset returned by get_storage_offset():
+ *   - Validates the magic value (CONFIG_MAGIC). If it does not match, returns false.
+ *   - If the version matches CONFIG_VERSION, validates its CRC32 via calc_crc32_v6.
+ *   - If the version is 5, 4 or 3, reads legacy ConfigV5 / ConfigV4 / ConfigV3, validates
+ *     its CRC32 via calc_crc32_v5 / calc_crc32_v4 / calc_crc32_v3 and migrates compatible
+ *     fields by name with migrate_legacy() (fields the legacy layout lacks keep their
+ *     defaults).
+ *   The next config_save() moves the result into the journal.
  * - Any magic/CRC failure or unsupported version results in no changes and false.
  *
  * @post On success, g_config contains the loaded or migrated configuration and
@@ -234,6 +543,13 @@ void config_set_defaults() {
  * @note This function accesses global state and is not thread-safe.
  */
 bool config_load() {
+    Config latest{};
+    if (journal_scan(latest)) {
+        g_config = latest;
+        g_last_source = ConfigSource::Loaded;
+        return true;
+    }
+
     const uint32_t offset    = get_storage_offset();
     const uint8_t* flash_ptr = reinterpret_cast<const uint8_t*>(XIP_BASE + offset);
 
@@ -252,13 +568,35 @@ bool config_load() {
     if (hdr.version == CONFIG_VERSION) {
         Config stored{};
         std::memcpy(&stored, flash_ptr, sizeof(Config));
-        const uint32_t crc = calc_crc32_v4(stored);
+        const uint32_t crc = calc_crc32_v6(stored);
         if (crc != stored.crc32) {
             return false;
         }
         g_config = stored;
         g_last_source = ConfigSource::Loaded;
         return true;
+    } else if (hdr.version == 5) {
+        ConfigV5 old{};
+        std::memcpy(&old, flash_ptr, sizeof(ConfigV5));
+        const uint32_t crc = calc_crc32_v5(old);
+        if (crc != old.crc32) {
+            return false;
+        }
+
+        migrate_legacy(old);
+        g_last_source = ConfigSource::Loaded;
+        return true;
+    } else if (hdr.version == 4) {
+        ConfigV4 old{};
+        std::memcpy(&old, flash_ptr, sizeof(ConfigV4));
+        const uint32_t crc = calc_crc32_v4(old);
+        if (crc != old.crc32) {
+            return false;
+        }
+
+        migrate_legacy(old);
+        g_last_source = ConfigSource::Loaded;
+        return true;
     } else if (hdr.version == 3) {
         ConfigV3 old{};
         std::memcpy(&old, flash_ptr, sizeof(ConfigV3));
@@ -267,29 +605,7 @@ bool config_load() {
             return false;
         }
 
-        config_set_defaults();
-        g_config.logger_id   = old.logger_id;
-        g_config.sensor_id   = old.sensor_id;
-        std::memset(g_config.server_ip, 0, sizeof(g_config.server_ip));
-        std::strncpy(g_config.server_ip, old.server_ip, sizeof(g_config.server_ip) - 1);
-        g_config.server_port = old.server_port;
-
-        g_config.temperature      = old.temperature;
-        g_config.humidity         = old.humidity;
-        g_config.pressure         = old.pressure;
-        g_config.sht              = old.sht;
-        g_config.clock_enabled    = old.clock_enabled;
-        g_config.set_time_enabled = old.set_time_enabled;
-        g_config.wifi_enabled     = old.wifi_enabled;
-        g_config.logging_enabled  = old.logging_enabled;
-
-        std::strncpy(g_config.wifi_ssid,     old.wifi_ssid,     sizeof(g_config.wifi_ssid) - 1);
-        std::strncpy(g_config.wifi_password, old.wifi_password, sizeof(g_config.wifi_password) - 1);
-
-        g_config.post_time_ms = old.post_time_ms;
-        g_config.version = CONFIG_VERSION;
-        g_config.crc32   = calc_crc32_v4(g_config);
-
+        migrate_legacy(old);
         g_last_source = ConfigSource::Loaded;
         return true;
     } else {
@@ -302,10 +618,7 @@ bool config_load() {
  *
  * Process:
  * - Sets g_config.magic and g_config.version, and computes g_config.crc32.
- * - Resolves the flash address via get_storage_offset().
- * - Disables interrupts, erases the target flash sector, and programs one page
- *   with g_config (all remaining bytes are 0xFF), then restores interrupts.
- * - Reads back from XIP and verifies magic/version/crc32 to confirm success.
+ * - Appends the image to the config journal and verifies it via write_config().
  *
  * Returns:
  * - true  if the verification succeeds.
@@ -313,40 +626,91 @@ bool config_load() {
  *
  * Side effects:
  * - Modifies g_config.{magic, version, crc32}.
- * - Erases one flash sector and programs one flash page at the computed offset.
- * - Temporarily disables interrupts during erase/program operations.
+ * - Clears any pending deferred save (config_request_save()).
+ * - Programs one journal record (JOURNAL_RECORD_SIZE bytes); erases a sector only when
+ *   the journal moves into the next one.
+ * - Temporarily disables interrupts during erase/program operations (flash_safe_execute()).
  *
  * Preconditions:
- * - get_storage_offset() points to a reserved region aligned for erase/program.
- * - sizeof(Config) <= FLASH_PAGE_SIZE and Config is trivially copyable.
- *
- * Notes:
- * - Not reentrant; do not call concurrently from multiple contexts.
- * - Power loss during erase/program may corrupt the target sector.
- * - Unused bytes in the programmed page are set to 0xFF.
+ * - Called from main-loop context, never from an IRQ or USB callback.
+ * - The last JOURNAL_SECTORS flash sectors are reserved for configuration.
+ * - Config is trivially copyable.
  */
 bool config_save() {
+    g_commit_pending = false;
     g_config.magic   = CONFIG_MAGIC;
     g_config.version = CONFIG_VERSION;
-    g_config.crc32   = calc_crc32_v4(g_config);
+    g_config.crc32   = calc_crc32_v6(g_config);
+    return write_config(g_config);
+}
 
-    const uint32_t offset = get_storage_offset();
+/**
+ * @brief Request that the current configuration be saved at the next safe point.
+ *
+ * Marks the configuration dirty; config_commit_tick() writes it once
+ * CONFIG_COMMIT_HOLDOFF_MS have passed since the last request, so bursts of
+ * changes (e.g. repeated button toggles) cost a single journal record. Safe to
+ * call from any main-loop code path, including ones that must not stall.
+ */
+void config_request_save() {
+    g_commit_pending = true;
+    g_commit_due_ms  = to_ms_since_boot(get_absolute_time()) + CONFIG_COMMIT_HOLDOFF_MS;
+}
+
+/**
+ * @brief Commit a deferred save when it is due; call regularly from the main loop.
+ *
+ * @return true if a save was attempted in this call.
+ */
+bool config_commit_tick() {
+    if (!g_commit_pending) return false;
+    if ((int32_t)(to_ms_since_boot(get_absolute_time()) - g_commit_due_ms) < 0) return false;
+    (void)config_save();
+    return true;
+}
 
-    uint32_t ints = save_and_disable_interrupts();
-    flash_range_erase(offset, FLASH_SECTOR_SIZE);
+/**
+ * @brief Record the last good Wi-Fi association and DHCP lease.
+ *
+ * Updates the cache fields of g_config. If they differ from the newest journal
+ * record, a new record is appended that equals it with only the cache fields
+ * replaced, so configuration edits made over the CLI but not yet saved are not
+ * persisted as a side effect. If the journal holds no valid record, the whole
+ * in-RAM configuration is saved instead.
+ *
+ * @param bssid   Access point MAC address.
+ * @param channel Wi-Fi channel (1..14).
+ * @param ip      Leased IPv4 address (network byte order).
+ * @param netmask Leased netmask (network byte order).
+ * @param gateway Leased gateway (network byte order).
+ * @return true if flash already matched or was written successfully.
+ */
+bool config_update_wifi_cache(const uint8_t bssid[6], uint8_t channel,
+                              uint32_t ip, uint32_t netmask, uint32_t gateway) {
+    std::memcpy(g_config.wifi_bssid, bssid, sizeof(g_config.wifi_bssid));
+    g_config.wifi_channel = channel;
+    g_config.wifi_ip      = ip;
+    g_config.wifi_netmask = netmask;
+    g_config.wifi_gateway = gateway;
+
+    Config stored{};
+    if (!journal_scan(stored)) {
+        return config_save();
+    }
 
-    alignas(FLASH_PAGE_SIZE) uint8_t page_buffer[FLASH_PAGE_SIZE]{};
-    std::memset(page_buffer, 0xFF, sizeof(page_buffer));
-    std::memcpy(page_buffer, &g_config, sizeof(Config));
-    flash_range_program(offset, page_buffer, FLASH_PAGE_SIZE);
-    restore_interrupts(ints);
+    if (std::memcmp(stored.wifi_bssid, bssid, sizeof(stored.wifi_bssid)) == 0 &&
+        stored.wifi_channel == channel && stored.wifi_ip == ip &&
+        stored.wifi_netmask == netmask && stored.wifi_gateway == gateway) {
+        return true;
+    }
 
-    Config verify{};
-    const uint8_t* flash_ptr = reinterpret_cast<const uint8_t*>(XIP_BASE + offset);
-    std::memcpy(&verify, flash_ptr, sizeof(Config));
-    return (verify.magic == g_config.magic) &&
-           (verify.version == g_config.version) &&
-           (verify.crc32 == g_config.crc32);
+    std::memcpy(stored.wifi_bssid, bssid, sizeof(stored.wifi_bssid));
+    stored.wifi_channel = channel;
+    stored.wifi_ip      = ip;
+    stored.wifi_netmask = netmask;
+    stored.wifi_gateway = gateway;
+    stored.crc32 = calc_crc32_v6(stored);
+    return write_config(stored);
 }
 
 /**
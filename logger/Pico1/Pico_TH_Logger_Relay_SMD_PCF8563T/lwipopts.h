@@ -14,33 +14,75 @@
 #ifndef LWIP_SOCKET
 #define LWIP_SOCKET                 0
 #endif
-#if PICO_CYW43_ARCH_POLL
-#define MEM_LIBC_MALLOC             1
-#else
-// MEM_LIBC_MALLOC is incompatible with non polling versions
-#define MEM_LIBC_MALLOC             0
+// Memory profile, chosen at build time with -DLOGGER_NET_PROFILE=<name> (CMakeLists.txt).
+// Peaks to size them against come from the "netstats" command of a LOGGER_NET_STATS build.
+//  - default:   the original pico_w example sizing (large windows, 24 RX pbufs).
+//  - keepalive: one long-lived connection carrying small single-sample requests;
+//               two-segment windows, few RX pbufs.
+//  - batch:     queued samples uploaded in multi-kilobyte bodies; a send buffer
+//               large enough to keep a batch in flight and a heap to copy it into.
+#define LOGGER_NET_PROFILE_DEFAULT      0
+#define LOGGER_NET_PROFILE_KEEPALIVE    1
+#define LOGGER_NET_PROFILE_BATCH        2
+#ifndef LOGGER_NET_PROFILE
+#define LOGGER_NET_PROFILE              LOGGER_NET_PROFILE_DEFAULT
 #endif
-#define MEM_ALIGNMENT               4
+
+#if LOGGER_NET_PROFILE == LOGGER_NET_PROFILE_KEEPALIVE
+#define LOGGER_NET_PROFILE_NAME     "keepalive"
+#define MEM_SIZE                    6000
+#define MEMP_NUM_TCP_SEG            16
+#define PBUF_POOL_SIZE              8
+#define TCP_WND                     (2 * TCP_MSS)
+#define TCP_SND_BUF                 (2 * TCP_MSS)
+#elif LOGGER_NET_PROFILE == LOGGER_NET_PROFILE_BATCH
+#define LOGGER_NET_PROFILE_NAME     "batch"
+#define MEM_SIZE                    12000
+#define MEMP_NUM_TCP_SEG            32
+#define PBUF_POOL_SIZE              12
+#define TCP_WND                     (4 * TCP_MSS)
+#define TCP_SND_BUF                 (6 * TCP_MSS)
+#else
+#define LOGGER_NET_PROFILE_NAME     "default"
 #define MEM_SIZE                    4000
 #define MEMP_NUM_TCP_SEG            32
-#define MEMP_NUM_ARP_QUEUE          10
 #define PBUF_POOL_SIZE              24
+#define TCP_WND                     (8 * TCP_MSS)
+#define TCP_SND_BUF                 (8 * TCP_MSS)
+#endif
+
+// Instrumentation build (-DLOGGER_NET_STATS=ON): lwIP keeps heap, pool and protocol
+// counters, read by the "netstats" command (net_stats.hpp).
+#ifndef LOGGER_NET_STATS
+#define LOGGER_NET_STATS            0
+#endif
+
+// lwIP's own static heap (MEM_SIZE bytes) instead of malloc: the firmware does not use
+// the C heap after start-up (see mem_pool.hpp). MEM_LIBC_MALLOC is also incompatible
+// with non polling versions.
+#define MEM_LIBC_MALLOC             0
+#define MEM_ALIGNMENT               4
+#define MEMP_NUM_ARP_QUEUE          10
 #define LWIP_ARP                    1
 #define LWIP_ETHERNET               1
 #define LWIP_ICMP                   1
 #define LWIP_RAW                    1
-#define TCP_WND                     (8 * TCP_MSS)
 #define TCP_MSS                     1460
-#define TCP_SND_BUF                 (8 * TCP_MSS)
 #define TCP_SND_QUEUELEN            ((4 * (TCP_SND_BUF) + (TCP_MSS - 1)) / (TCP_MSS))
 #define LWIP_NETIF_STATUS_CALLBACK  1
 #define LWIP_NETIF_LINK_CALLBACK    1
 #define LWIP_NETIF_HOSTNAME         1
 #define LWIP_NETCONN                0
+#if LOGGER_NET_STATS
+#define MEM_STATS                   1
+#define MEMP_STATS                  1
+#define LINK_STATS                  1
+#else
 #define MEM_STATS                   0
-#define SYS_STATS                   0
 #define MEMP_STATS                  0
 #define LINK_STATS                  0
+#endif
+#define SYS_STATS                   0
 // #define ETH_PAD_SIZE                2
 #define LWIP_CHKSUM_ALGORITHM       3
 #define LWIP_DHCP                   1
@@ -53,17 +95,13 @@
 #define DHCP_DOES_ARP_CHECK         0
 #define LWIP_DHCP_DOES_ACD_CHECK    0
 #define LWIP_HAVE_CUSTOM_CONFIG 1
-#define SNTP_SET_SYSTEM_TIME(sec) sntp_set_system_time(sec)
-void sntp_set_system_time(uint32_t sec);
-#define SNTP_UPDATE_DELAY 3600000
-#define SNTP_SUPPORT                1
-#define LWIP_SNTP                   1
-#define SNTP_MAX_SERVERS            1
 #define MEMP_NUM_SYS_TIMEOUT 10
 
+#if LOGGER_NET_STATS || !defined(NDEBUG)
+#define LWIP_STATS                  1
+#endif
 #ifndef NDEBUG
 #define LWIP_DEBUG                  1
-#define LWIP_STATS                  1
 #define LWIP_STATS_DISPLAY          1
 #endif
 
@@ -2,17 +2,25 @@
 #include "hardware/pwm.h"
 #include "hardware/rtc.h"
 #include "pico/cyw43_arch.h"
+#include "pico/rand.h"
 extern "C" {
-    #include "lwip/apps/sntp.h"
-    #include "lwip/dns.h"
-    #include "lwip/ip_addr.h"
     #include "lwip/timeouts.h"
+    #include "lwip/netif.h"
+    #include "lwip/dhcp.h"
 }
 #include <time.h>
 #include <math.h>
+#include <string.h>
 #include "program_main.hpp"
 #include "lcd_1602_i2c.hpp"
 #include "rtc_clock.hpp"
+#include "clock_discipline.hpp"
+#include "ntp_client.hpp"
+#include "binary_link.hpp"
+#include "stream.hpp"
+#include "buttons.hpp"
+#include "mem_pool.hpp"
+#include "circuit_breaker.hpp"
 #include "main.hpp"
 #include "config.hpp"
 
@@ -29,25 +37,34 @@ extern volatile bool device_reset_flag;
 #define SWITCH_1    21
 #define SWITCH_2    20
 
-using namespace std;
+#define BUTTON_BACKLIGHT    0       // SWITCH_1: click toggles backlight, hold resets
+#define BUTTON_LOGGING      1       // SWITCH_2: hold toggles logging
+#define HOLD_RESET_MS       10000
+#define HOLD_LOGGING_MS     3000
+
+static StaticSlot<BME280> s_bme280("bme280");
+static StaticSlot<TCP>    s_tcp("tcp");
 
-volatile bool time_synced = false;
-static volatile bool dns_resolved = false;
-static ip_addr_t resolved_ip;
+#define WIFI_CONNECT_TIMEOUT_MS  30000u
+#define WIFI_RETRY_MS            30000u
+#define WIFI_FAST_JOIN_TIMEOUT_MS 3000u
+#define QUEUE_FLUSH_BATCH        4
+#define UPLOAD_JITTER_MAX_MS     15000u
+
+using namespace std;
 
 /**
  * @brief Convert discrete RTC date/time fields to a Unix timestamp.
  *
  * Constructs a std::tm from the provided calendar fields and converts it to a
- * time_t via mktime.
+ * time_t via clock_rtc_local_to_epoch().
  *
  * Important:
  * - The provided fields are interpreted as a local-time calendar according to
- *   the C library timezone settings. The resulting time_t represents seconds
- *   since the Unix epoch (UTC). If your RTC stores UTC, ensure TZ is set to
- *   "UTC" or consider using timegm (if available) for a UTC-based conversion.
- * - The tm structure is zero-initialized, so tm_isdst == 0 (DST not in effect).
- *   If you want the library to determine DST automatically, set tm_isdst to -1.
+ *   the C library timezone settings (TZ, set in main()). The resulting time_t
+ *   represents seconds since the Unix epoch (UTC).
+ * - DST is decided by the library (tm_isdst = -1), so summer time RTC values are
+ *   not read one hour late.
  *
  * @param y  Full year (e.g., 2025). Must be >= 1900.
  * @param m  Month in the range [1, 12].
@@ -69,36 +86,78 @@ time_t ProgramMain::make_time_utc_from_rtc_fields(uint16_t y, uint16_t m, uint16
     lt.tm_hour = (int)hh;
     lt.tm_min  = (int)mm;
     lt.tm_sec  = (int)ss;
-    return mktime(&lt);
+    return clock_rtc_local_to_epoch(&lt, 0.0);
 }
 
 /**
- * @brief DNS resolution callback invoked when a hostname lookup completes.
+ * @brief Convert raw RTC fields into a drift-corrected Unix timestamp.
  *
- * This function is called asynchronously by the DNS resolver when the address
- * for a requested hostname is available or when resolution fails.
+ * The fields (as filled by pcf8563t_read_time(): [0]=sec, [1]=min, [2]=hour,
+ * [3]=day, [4]=weekday, [5]=month, [6]=year) are converted with
+ * make_time_utc_from_rtc_fields() and then passed through the clock discipline
+ * model, which removes the estimated crystal drift and slews any residual
+ * correction instead of stepping it.
  *
- * Behavior:
- * - On success (ipaddr != nullptr), copies the resolved address into the
- *   global resolved_ip and sets dns_resolved to true.
- * - On failure or pending state (ipaddr == nullptr), leaves globals unchanged.
+ * @param rtc_fields Pointer to the 7-element RTC field array.
+ * @return Disciplined Unix timestamp; equal to the plain RTC time until the
+ *         first network time sync has been recorded.
  *
- * Threading:
- * - Typically executed in the network stack's context (e.g., lwIP TCP/IP thread).
- *   Avoid blocking operations or long-running work here.
+ * @see clock_discipline_apply()
+ */
+time_t ProgramMain::disciplined_epoch(const uint16_t *rtc_fields) {
+    time_t rtc_epoch = make_time_utc_from_rtc_fields(
+        rtc_fields[6], rtc_fields[5], rtc_fields[3],
+        rtc_fields[2], rtc_fields[1], rtc_fields[0]);
+    return clock_discipline_apply(rtc_epoch);
+}
+
+/**
+ * @brief Arm the deadline for the next network time synchronization.
  *
- * Notes:
- * - The ipaddr pointer is only valid during the callback. Copying it (as done here)
- *   is required if it will be used later.
+ * Callers pass the drift model interval (clock_discipline_next_sync_ms()) after
+ * a successful round, the SNTP client backoff (ntp_client_retry_ms()) after a
+ * failed one, and 0 to request a sync as soon as possible (e.g. after the
+ * Wi-Fi link came up). A deadline of 0 means "not scheduled", so it is nudged to 1.
  *
- * @param name   The hostname that was queried.
- * @param ipaddr Pointer to the resolved IP address on success; nullptr otherwise.
- * @param arg    User-supplied argument passed through the DNS API (unused).
+ * @param delay_ms Delay from now until the next round may start.
  */
-static void dns_callback(const char*, const ip_addr_t* ipaddr, void*) {
-    if (ipaddr) {
-        resolved_ip = *ipaddr;
-        dns_resolved = true;
+void ProgramMain::schedule_time_sync(uint32_t delay_ms) {
+    next_time_sync_ms = now_ms() + delay_ms;
+    if (next_time_sync_ms == 0) next_time_sync_ms = 1;
+}
+
+/**
+ * @brief Periodic handler driving background network time synchronization.
+ *
+ * Call regularly from the main loop. Never blocks:
+ * - Advances a running SNTP round via ntp_client_poll(). When the round ends,
+ *   a selected answer is applied through apply_network_time() and the next round
+ *   is scheduled from the drift model; a failed round is retried with backoff.
+ * - Otherwise, once the deadline has passed, starts a new round through
+ *   synchronize_time().
+ *
+ * Does nothing while the Wi-Fi link is not up or before the first sync has been
+ * scheduled by wifi_tick() on link-up. Uses wrap-safe signed comparison
+ * of the millisecond tick.
+ */
+void ProgramMain::time_sync_tick() {
+    if (!is_wifi_up() || next_time_sync_ms == 0) return;
+
+    NtpStatus st = ntp_client_poll();
+    if (st == NtpStatus::Busy) return;
+    if (st == NtpStatus::Synced) {
+        apply_network_time(ntp_client_time_now());
+        schedule_time_sync(clock_discipline_next_sync_ms());
+        return;
+    }
+    if (st == NtpStatus::Failed) {
+        schedule_time_sync(ntp_client_retry_ms());
+        return;
+    }
+
+    if ((int32_t)(now_ms() - next_time_sync_ms) < 0) return;
+    if (!synchronize_time()) {
+        schedule_time_sync(ntp_client_retry_ms());
     }
 }
 
@@ -159,73 +218,26 @@ void ProgramMain::set_pwm_duty(uint gpio, uint16_t duty) {
 }
 
 /**
- * @brief Resolves an NTP server and synchronizes the system time via SNTP.
- *
- * This function:
- * - Resets synchronization state and clears any previously resolved IP.
- * - Sets the local timezone to CET/CEST ("CET-1CEST,M3.5.0/2,M10.5.0/3") and applies it with tzset().
- * - Resolves the hostname "tempus1.gum.gov.pl" using lwIP DNS, polling cyw43_arch_poll() and
- *   sys_check_timeouts() while waiting (up to ~10 seconds).
- * - Configures lwIP SNTP in poll mode, sets the resolved server, and starts SNTP.
- * - Polls for time synchronization, periodically calling cyw43_arch_poll() and sys_check_timeouts()
- *   (up to ~9 seconds). On success, stops SNTP and returns true.
- * - Stops SNTP and returns false on DNS failure/timeout or SNTP synchronization timeout.
+ * @brief Starts a background SNTP round against all configured NTP servers.
+ *
+ * Starts a round in the SNTP client (ntp_client_start()), which resolves and queries every entry
+ * of Config::ntp_servers in parallel and returns immediately. The local timezone (TZ) is set once
+ * in main() before the heap is locked; setenv/tzset allocate and must not run here.
+ *
+ * The result is collected later by time_sync_tick() via ntp_client_poll(); nothing here waits on
+ * DNS or on server replies.
  *
  * Preconditions:
  * - Wi-Fi/cyw43 and lwIP stacks are initialized and operational.
- * - DNS and SNTP callbacks update the internal flags (e.g., dns_resolved, time_synced) appropriately.
  *
  * Side effects:
- * - Modifies environment variable TZ and calls tzset().
- * - Initiates DNS and SNTP network traffic; updates the system clock on success.
- * - Updates internal synchronization state flags.
+ * - Initiates DNS and SNTP network traffic.
  *
- * Timing:
- * - Worst-case blocking time is approximately 19 seconds (DNS ~10s + SNTP ~9s), with cooperative
- *   polling of cyw43_arch_poll() and sys_check_timeouts().
- *
- * @return true if time synchronization completes successfully within the timeouts; false otherwise.
+ * @return true if a round is running; false if no NTP server is configured or the
+ *         UDP PCB could not be allocated.
  */
 bool ProgramMain::synchronize_time() {
-    time_synced = false;
-    dns_resolved = false;
-    ip_addr_set_zero(&resolved_ip); 
-    
-    setenv("TZ", "CET-1CEST,M3.5.0/2,M10.5.0/3", 1);
-    tzset();
-
-    err_t err = dns_gethostbyname("tempus1.gum.gov.pl", &resolved_ip, dns_callback, NULL);
-    if (err == ERR_OK) {
-        dns_resolved = true;
-    } else if (err == ERR_INPROGRESS) {
-        for (int i = 0; i < 100 && !dns_resolved; i++) {
-            cyw43_arch_poll();
-            sys_check_timeouts();
-            sleep_ms(100);
-        }
-    } else {
-        return false;
-    }
-
-    if (!dns_resolved) {
-        return false;
-    }
-
-    sntp_setoperatingmode(SNTP_OPMODE_POLL);
-    sntp_setserver(0, &resolved_ip);
-    sntp_init();
-
-    for (int i = 0; i < 30; ++i) {
-        cyw43_arch_poll();
-        sys_check_timeouts();
-        if (time_synced) {
-            sntp_stop();
-            return true;
-        }
-        sleep_ms(300);
-    }
-    sntp_stop();
-    return false;
+    return ntp_client_start();
 }
 
 /**
@@ -242,9 +254,9 @@ bool ProgramMain::synchronize_time() {
  *  5. Initialize relay GPIOs as outputs and ensure they start in the OFF (low) state.
  *  6. Initialize LCD, kick/extend backlight timer, clear display, and print a startup banner.
  *  7. Load configuration flags (e.g., logging_enabled).
- *  8. Dynamically allocate and configure the environmental sensor (BME280 in forced mode).
- *     (Current conditional branches allocate the same sensor; structure suggests future sensor variants.)
- *  9. Conditionally allocate a TCP networking object if Wi-Fi is enabled in configuration.
+ *  8. Construct the environmental sensor (BME280 in forced mode) in its static slot.
+ *     (Current conditional branches construct the same sensor; structure suggests future sensor variants.)
+ *  9. Conditionally construct the TCP networking object (static slot) if Wi-Fi is enabled in configuration.
  * 10. Initialize the real-time clock: external PCF8563T if enabled, otherwise fall back to internal RTC.
  * 11. Set RGB LED to green to indicate successful initialization.
  *
@@ -252,13 +264,13 @@ bool ProgramMain::synchronize_time() {
  *  - Configures multiple GPIO pins (direction, function, pull-ups, output levels).
  *  - Starts and configures PWM slices.
  *  - Claims and configures the I2C bus at 400 kHz.
- *  - Allocates heap objects (BME280, optionally TCP) without ownership transfer; no deletion here.
+ *  - Constructs BME280 and, optionally, TCP in static storage (StaticSlot, mem_pool.hpp); no heap use.
  *  - Modifies global/application state: logging_enabled and internal peripheral singletons.
  *  - Produces visible (LCD text, LED color) and potential audible (buzzer PWM ready) effects.
  *
  * Memory management notes:
- *  - Uses dynamic allocation (new BME280 / new TCP). If re-invoked, this may leak unless prior instances are deleted.
- *  - Consider converting these to smart pointers or singleton patterns if multiple calls are possible or for safer teardown.
+ *  - BME280 and TCP live in StaticSlot storage; a repeated call destroys the previous instance
+ *    before constructing the new one, so nothing leaks.
  *
  * Error handling:
  *  - Assumes all hardware initialization calls succeed; no explicit error checks or fallbacks implemented.
@@ -277,10 +289,9 @@ bool ProgramMain::synchronize_time() {
  *  - LED indicates success (green) unless later overridden.
  *  - Environmental sensor and (optionally) networking stack are ready for first use.
  *
- * @warning Calling this function more than once without cleanup may cause resource leaks or reconfiguration hazards.
+ * @warning Calling this function more than once may cause reconfiguration hazards.
  * @todo Add error checking (return status or exceptions) for sensor / RTC init.
  * @todo Differentiate sensor initialization branches if additional sensor types are introduced.
- * @todo Provide a matching deinit() to release dynamically allocated resources.
  * @todo Abstract hardware setup into smaller testable units.
  *
  * @return void
@@ -309,14 +320,8 @@ void ProgramMain::init_equipment() {
     gpio_pull_up(I2C_SCL);
     bi_decl(bi_2pins_with_func(I2C_SDA, I2C_SCL, GPIO_FUNC_I2C));
 
-    gpio_init(SWITCH_1);
-    gpio_init(SWITCH_2);
-
-    gpio_set_dir(SWITCH_1, GPIO_IN);
-    gpio_set_dir(SWITCH_2, GPIO_IN);
-
-    gpio_pull_up(SWITCH_1);
-    gpio_pull_up(SWITCH_2);
+    buttons_add(BUTTON_BACKLIGHT, SWITCH_1, HOLD_RESET_MS);
+    buttons_add(BUTTON_LOGGING, SWITCH_2, HOLD_LOGGING_MS);
 
     gpio_init(RELAY_1);
     gpio_init(RELAY_2);
@@ -340,17 +345,17 @@ void ProgramMain::init_equipment() {
     logging_enabled = (config_get().logging_enabled != 0);
 
     if  (config_get().sht == 30){
-        myBME280 = new BME280(BME280::MODE::MODE_FORCED);
+        myBME280 = s_bme280.emplace(BME280::MODE::MODE_FORCED);
     }
     else if (config_get().sht == 40){
-        myBME280 = new BME280(BME280::MODE::MODE_FORCED);
+        myBME280 = s_bme280.emplace(BME280::MODE::MODE_FORCED);
     }
     else {
-        myBME280 = new BME280(BME280::MODE::MODE_FORCED);
+        myBME280 = s_bme280.emplace(BME280::MODE::MODE_FORCED);
     }
 
     if(config_get().wifi_enabled == 1){
-        myTCP = new TCP();
+        myTCP = s_tcp.emplace();
     }
         
     if (config_get().clock_enabled == 1) {
@@ -364,49 +369,47 @@ void ProgramMain::init_equipment() {
 }
 
 /**
- * @brief Initializes the Wi‑Fi subsystem and attempts to connect to the configured network.
+ * @brief Initializes the Wi‑Fi subsystem and starts connecting to the configured network.
  *
  * Uses configuration values (wifi_enabled, wifi_ssid, wifi_password) to decide whether to
- * initialize the CYW43 stack and connect in station mode. The RGB LED and LCD are used to
- * provide user feedback during the process:
+ * initialize the CYW43 stack and join in station mode. The join itself runs in the background;
+ * this function does not wait for association, DHCP or time synchronization, so the sensors,
+ * RTC, LCD and relays are already live while the link comes up. Progress is tracked by
+ * wifi_tick(). The RGB LED and LCD provide user feedback:
  * - LED white: initialization/connection in progress
  * - LED red: error during initialization or connection (LCD shows an error message)
- * - LED green: connected successfully
+ * - LED green: link up (set by wifi_tick())
  *
  * Behavior:
  * - If Wi‑Fi is disabled in configuration, the function returns immediately with WIFI_OK
  *   without initializing the Wi‑Fi stack.
  * - Initializes the CYW43 architecture; on failure, disables Wi‑Fi, reports an error, and returns WIFI_INIT_FAIL.
- * - Enables station mode and attempts a WPA2 AES‑PSK connection using the configured SSID/password,
- *   with a 30‑second timeout; on failure, disables Wi‑Fi, reports an error, and returns WIFI_CONN_FAIL.
- * - On success, synchronizes system time and returns WIFI_OK.
+ * - Enables station mode, preloads the cached DHCP lease (preload_wifi_lease()) and starts a
+ *   WPA2 AES‑PSK join using the configured SSID/password via start_wifi_join(), beginning with
+ *   a targeted join to the cached access point when one is known. If the join cannot even be
+ *   started, WIFI_CONN_FAIL is returned and wifi_tick() retries later; Wi‑Fi stays enabled.
  *
  * Side effects:
- * - Modifies the global Wi‑Fi enabled state (disables on failure).
- * - Updates the RGB LED color for status indication.
- * - Writes status/error messages to the LCD.
- * - Calls synchronize_time() on successful connection.
+ * - Modifies the global Wi‑Fi enabled state (disables on init failure).
+ * - Creates the TCP helper on first use.
+ * - Updates the RGB LED color for status indication and writes errors to the LCD.
  *
  * Timing:
- * - Potentially blocking for up to ~30 seconds during the connection attempt.
- *
- * Preconditions:
- * - Valid hardware setup for CYW43, LCD, and RGB LED.
- * - Configuration should contain the desired SSID and password; empty credentials will likely cause connection failure.
+ * - Returns after CYW43 firmware initialization; no network waits.
  *
  * @return uint8_t
- * @retval WIFI_OK          Wi‑Fi disabled by config or connected successfully and time synchronized.
+ * @retval WIFI_OK          Wi‑Fi disabled by config or join started.
  * @retval WIFI_INIT_FAIL   CYW43 initialization failed; Wi‑Fi disabled and error indicated.
- * @retval WIFI_CONN_FAIL   Connection attempt failed or timed out; Wi‑Fi disabled and error indicated.
+ * @retval WIFI_CONN_FAIL   Join could not be started; a background retry is scheduled.
  */
 uint8_t ProgramMain::init_wifi() {
     set_wifi_enabled(config_get().wifi_enabled);
     if (!is_wifi_enabled()) {
         return WIFI_OK;
     }
-    const auto &cfg = config_get();
-    const char *SSID = cfg.wifi_ssid[0] ? cfg.wifi_ssid : "";
-    const char *PASSWORD = cfg.wifi_password[0] ? cfg.wifi_password : "";
+    if (!myTCP) {
+        myTCP = s_tcp.emplace();
+    }
 
     set_rgb_color(255, 255, 255);
     if (cyw43_arch_init()) {
@@ -418,76 +421,262 @@ uint8_t ProgramMain::init_wifi() {
     }
 
     cyw43_arch_enable_sta_mode();
-    if (cyw43_arch_wifi_connect_timeout_ms(SSID, PASSWORD, CYW43_AUTH_WPA2_AES_PSK, 30000)) {
-        lcd_set_cursor(0, 0);
-        lcd_string("WiFi conn error \n");
-        set_rgb_color(255, 0, 0);
-        set_wifi_enabled(false);
-        return WIFI_CONN_FAIL;
-    }
-    sleep_ms(2000);
-    set_rgb_color(0, 255, 0);
-    synchronize_time();
-    return WIFI_OK;
+    preload_wifi_lease();
+    wifi_stage = first_wifi_stage();
+    return start_wifi_join();
 }
 
 /**
- * @brief Reinitializes and reconnects the Wi‑Fi interface using stored configuration.
- *
- * This function applies the current configuration (SSID, password, Wi‑Fi enable flag),
- * fully tears down and reinitializes the CYW43 Wi‑Fi stack, and attempts to connect
- * in STA mode with WPA2 AES-PSK authentication. Visual status is indicated via RGB LED:
+ * @brief Reconnects the Wi‑Fi interface using stored configuration and starts a new join.
+ *
+ * This function applies the current configuration (SSID, password, Wi‑Fi enable flag)
+ * and starts an asynchronous join in STA mode with WPA2 AES-PSK authentication. If the
+ * stack is running, the join starts at first_wifi_stage() without tearing CYW43 down;
+ * wifi_tick() escalates to a full re-initialization only if the cheaper stages fail.
+ * If Wi‑Fi was off, the stack is fully reinitialized right away. The link state is then
+ * followed by wifi_tick(), which also schedules a time sync once the link is up. Visual
+ * status is indicated via RGB LED:
  * - White: reconnect in progress
  * - Red: failure (initialization or connection)
- * - Green: connected successfully
+ * - Green: link up (set by wifi_tick())
  *
- * On successful connection, SNTP is restarted via synchronize_time() to refresh the RTC.
  * If Wi‑Fi is disabled in the configuration, the function is a no‑op and returns success.
  *
  * Side effects:
- * - Stops SNTP before reconnect and resynchronizes time after success.
- * - Deinitializes and reinitializes the Wi‑Fi stack, dropping any existing network state.
- * - Blocks the calling thread until the attempt completes or times out (≈30s plus init).
+ * - On the WifiStage::Reinit path: stops the SNTP client, deinitializes and reinitializes
+ *   the Wi‑Fi stack, dropping any existing network state.
  * - Changes the RGB LED color to reflect progress/result.
  *
  * @return uint8_t
- * - WIFI_OK          on success or when Wi‑Fi is disabled by configuration
- * - WIFI_INIT_FAIL   if the CYW43 stack fails to initialize
- * - WIFI_CONN_FAIL   if association/authentication fails or times out
+ * - WIFI_OK          join started, or Wi‑Fi is disabled by configuration
+ * - WIFI_INIT_FAIL   if the CYW43 stack fails to initialize (Wi‑Fi is disabled)
+ * - WIFI_CONN_FAIL   if the join could not be started (retried in the background)
  *
  * @note Requires valid configuration returned by config_get().
- * @warning Existing sockets/connections will be invalidated due to stack reinit.
- * @see config_get(), set_wifi_enabled(), cyw43_arch_init(), cyw43_arch_wifi_connect_timeout_ms(), sntp_stop(), synchronize_time()
+ * @warning Existing sockets/connections will be invalidated by a stack reinit.
+ * @see config_get(), set_wifi_enabled(), cyw43_arch_init(), start_wifi_join(), wifi_tick(), ntp_client_stop()
  */
 uint8_t ProgramMain::reconnect_wifi() {
     set_wifi_enabled(config_get().wifi_enabled);
     if (!is_wifi_enabled()) {
         return WIFI_OK;
     }
+    if (!myTCP) {
+        myTCP = s_tcp.emplace();
+    }
+
+    set_rgb_color(255, 255, 255);
+    wifi_stage = (wifi_state == WifiState::Off) ? WifiStage::Reinit : first_wifi_stage();
+    return start_wifi_join();
+}
+
+/**
+ * @brief Start an asynchronous WPA2 join for the current wifi_stage.
+ *
+ * Stages:
+ * - WifiStage::Fast: joins the cached BSSID on the cached channel (no scan), with a
+ *   deadline of WIFI_FAST_JOIN_TIMEOUT_MS.
+ * - WifiStage::Join: regular scanning join, deadline WIFI_CONNECT_TIMEOUT_MS.
+ * - WifiStage::Reinit: stops the SNTP client, deinitializes and reinitializes CYW43,
+ *   preloads the cached lease, then joins like WifiStage::Join.
+ *
+ * On success the link state becomes WifiState::Connecting. If the driver refuses to
+ * start a Fast or Join attempt, the deadline is set to now so wifi_tick() escalates to
+ * the next stage; if it refuses after a reinit, the state becomes WifiState::Retry, an
+ * error is shown and another attempt is made after WIFI_RETRY_MS. If CYW43 cannot be
+ * reinitialized, Wi‑Fi is disabled.
+ *
+ * @pre CYW43 is initialized and in STA mode (except for WifiStage::Reinit).
+ * @return WIFI_OK if the join was started, WIFI_INIT_FAIL if the reinit failed,
+ *         WIFI_CONN_FAIL otherwise.
+ */
+uint8_t ProgramMain::start_wifi_join() {
     const auto &cfg = config_get();
     const char *SSID = cfg.wifi_ssid[0] ? cfg.wifi_ssid : "";
     const char *PASSWORD = cfg.wifi_password[0] ? cfg.wifi_password : "";
 
-    set_rgb_color(255, 255, 255);
-
-    sntp_stop();
+    if (wifi_stage == WifiStage::Reinit) {
+        ntp_client_stop();
+        cyw43_arch_deinit();
+        wifi_state = WifiState::Off;
+        sleep_ms(100);
+        if (cyw43_arch_init()) {
+            lcd_set_cursor(0, 0);
+            lcd_string("WiFi init error \n");
+            set_rgb_color(255, 0, 0);
+            set_wifi_enabled(false);
+            return WIFI_INIT_FAIL;
+        }
+        cyw43_arch_enable_sta_mode();
+        preload_wifi_lease();
+    } else if (wifi_state != WifiState::Off) {
+        cyw43_wifi_leave(&cyw43_state, CYW43_ITF_STA);
+    }
 
-    cyw43_arch_deinit();
-    sleep_ms(100);
-    if (cyw43_arch_init()) {
-        set_rgb_color(255, 0, 0);
-        return WIFI_INIT_FAIL;
+    int err;
+    uint32_t timeout_ms = WIFI_CONNECT_TIMEOUT_MS;
+    if (wifi_stage == WifiStage::Fast) {
+        err = cyw43_wifi_join(&cyw43_state, strlen(SSID), (const uint8_t *)SSID,
+                              strlen(PASSWORD), (const uint8_t *)PASSWORD,
+                              CYW43_AUTH_WPA2_AES_PSK, cfg.wifi_bssid, cfg.wifi_channel);
+        timeout_ms = WIFI_FAST_JOIN_TIMEOUT_MS;
+    } else {
+        err = cyw43_arch_wifi_connect_async(SSID, PASSWORD, CYW43_AUTH_WPA2_AES_PSK);
     }
-    cyw43_arch_enable_sta_mode();
-    if (cyw43_arch_wifi_connect_timeout_ms(SSID, PASSWORD, CYW43_AUTH_WPA2_AES_PSK, 30000)) {
+
+    if (err) {
+        if (wifi_stage != WifiStage::Reinit) {
+            wifi_state = WifiState::Connecting;
+            wifi_deadline_ms = now_ms();
+            return WIFI_CONN_FAIL;
+        }
+        lcd_set_cursor(0, 0);
+        lcd_string("WiFi conn error \n");
         set_rgb_color(255, 0, 0);
+        wifi_state = WifiState::Retry;
+        wifi_deadline_ms = now_ms() + WIFI_RETRY_MS;
         return WIFI_CONN_FAIL;
     }
-    set_rgb_color(0, 255, 0);
-    synchronize_time();
+    wifi_state = WifiState::Connecting;
+    wifi_deadline_ms = now_ms() + timeout_ms;
     return WIFI_OK;
 }
 
+/**
+ * @brief Select the first reconnect stage.
+ *
+ * @return WifiStage::Fast if a previous association is cached (Config::wifi_channel
+ *         is set and Config::wifi_bssid is not all zero), WifiStage::Join otherwise.
+ */
+WifiStage ProgramMain::first_wifi_stage() {
+    const auto &cfg = config_get();
+    if (cfg.wifi_channel == 0) return WifiStage::Join;
+    for (uint8_t b : cfg.wifi_bssid) {
+        if (b) return WifiStage::Fast;
+    }
+    return WifiStage::Join;
+}
+
+/**
+ * @brief Assign the cached DHCP lease to the STA interface before joining.
+ *
+ * With an address already configured, cyw43_tcpip_link_status() reports CYW43_LINK_UP as
+ * soon as the association completes instead of after a full DHCP exchange. The DHCP client
+ * started on link-up still runs and confirms (or replaces) the lease in the background.
+ * Does nothing if no lease is cached.
+ *
+ * @pre Called right after cyw43_arch_enable_sta_mode(), before any join.
+ */
+void ProgramMain::preload_wifi_lease() {
+    const auto &cfg = config_get();
+    if (cfg.wifi_ip == 0 || cfg.wifi_channel == 0) return;
+
+    ip4_addr_t ip, mask, gw;
+    ip4_addr_set_u32(&ip, cfg.wifi_ip);
+    ip4_addr_set_u32(&mask, cfg.wifi_netmask);
+    ip4_addr_set_u32(&gw, cfg.wifi_gateway);
+    netif_set_addr(&cyw43_state.netif[CYW43_ITF_STA], &ip, &mask, &gw);
+}
+
+/**
+ * @brief Store the current association and DHCP lease as the fast reconnect cache.
+ *
+ * Reads the BSSID and channel of the joined access point from the driver and the
+ * address, netmask and gateway from the STA interface. Flash is only written when any
+ * of them changed (see config_update_wifi_cache()).
+ *
+ * @pre The link is up and DHCP has bound (dhcp_supplied_address()).
+ */
+void ProgramMain::update_wifi_cache() {
+    uint8_t bssid[6] = {0};
+    uint32_t channel_info[3] = {0};
+    if (cyw43_wifi_get_bssid(&cyw43_state, bssid) != 0) return;
+    if (cyw43_ioctl(&cyw43_state, CYW43_IOCTL_GET_CHANNEL, sizeof(channel_info),
+                    (uint8_t *)channel_info, CYW43_ITF_STA) != 0) return;
+
+    const uint32_t channel = channel_info[0];
+    if (channel == 0 || channel > 14) return;
+
+    struct netif *n = &cyw43_state.netif[CYW43_ITF_STA];
+    (void)config_update_wifi_cache(bssid, (uint8_t)channel,
+                                   ip4_addr_get_u32(netif_ip4_addr(n)),
+                                   ip4_addr_get_u32(netif_ip4_netmask(n)),
+                                   ip4_addr_get_u32(netif_ip4_gw(n)));
+}
+
+/**
+ * @brief Background Wi‑Fi link state machine; call regularly from the main loop.
+ *
+ * States (WifiState):
+ * - Connecting: waits until cyw43_tcpip_link_status() reports CYW43_LINK_UP (associated
+ *   and DHCP lease obtained). On success the link becomes Up, the LED turns green, a time
+ *   sync is scheduled immediately and an upload of the queued samples is scheduled at
+ *   this device's phase (schedule_upload()), so a site that regains power together
+ *   does not flush its backlogs in the same second. A failure status
+ *   (bad auth, no network, join failure) or the stage deadline escalates to the next
+ *   WifiStage (Fast -> Join -> Reinit); a failure after Reinit moves to Retry.
+ * - Up: watches for link loss and moves to Retry without delay when it happens. Once
+ *   DHCP has bound, the association and lease are cached via update_wifi_cache().
+ * - Retry: restarts at first_wifi_stage() via start_wifi_join() once the retry deadline
+ *   passes.
+ *
+ * While the link is up, a backlog left after a scheduled upload is drained in small
+ * batches (see flush_queue()) so it never stalls the loop for long.
+ *
+ * Never blocks. Does nothing while Wi‑Fi is disabled.
+ */
+void ProgramMain::wifi_tick() {
+    if (!is_wifi_enabled() || wifi_state == WifiState::Off) return;
+
+    const int link = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
+    const bool expired = (int32_t)(now_ms() - wifi_deadline_ms) >= 0;
+
+    switch (wifi_state) {
+    case WifiState::Connecting:
+        if (link == CYW43_LINK_UP) {
+            wifi_state = WifiState::Up;
+            set_rgb_color(0, 255, 0);
+            schedule_time_sync(0);
+            schedule_upload();
+            wifi_cache_pending = true;
+        } else if (link < 0 || expired) {
+            if (wifi_stage != WifiStage::Reinit) {
+                wifi_stage = (WifiStage)((uint8_t)wifi_stage + 1);
+                (void)start_wifi_join();
+                break;
+            }
+            lcd_set_cursor(0, 0);
+            lcd_string("WiFi conn error \n");
+            set_rgb_color(255, 0, 0);
+            wifi_state = WifiState::Retry;
+            wifi_deadline_ms = now_ms() + WIFI_RETRY_MS;
+        }
+        break;
+    case WifiState::Up:
+        if (link != CYW43_LINK_UP) {
+            wifi_state = WifiState::Retry;
+            wifi_deadline_ms = now_ms();
+            break;
+        }
+        if (wifi_cache_pending && dhcp_supplied_address(&cyw43_state.netif[CYW43_ITF_STA])) {
+            wifi_cache_pending = false;
+            update_wifi_cache();
+        }
+        if (queue_flush_pending) {
+            flush_queue();
+        }
+        break;
+    case WifiState::Retry:
+        if (expired) {
+            wifi_stage = first_wifi_stage();
+            (void)start_wifi_join();
+        }
+        break;
+    default:
+        break;
+    }
+}
+
 /**
  * @brief Sets the RGB LED color by updating PWM duty cycles for each channel.
  *
@@ -542,7 +731,7 @@ void ProgramMain::set_rgb_color(uint8_t red, uint8_t green, uint8_t blue) {
  * - Temperature: > 27 °C → RELAY_1=ON, RELAY_2=OFF; < 20 °C → RELAY_1=OFF, RELAY_2=ON; otherwise both OFF.
  * - Humidity: > 70 %RH → RELAY_3=ON, RELAY_4=OFF; < 30 %RH → RELAY_3=OFF, RELAY_4=ON; otherwise both OFF.
  *
- * Error reporting (when Wi‑Fi is enabled):
+ * Error reporting (log_error(): only while the link is up and the upload circuit is closed):
  * - Time read failure: "Time could not be readed." with source "PCF8563" if clock is enabled, otherwise "RTC".
  * - Sensor validation failure: "Sensor error" / "Values out of range".
  *
@@ -570,11 +759,7 @@ void ProgramMain::display_measurement() {
     }
 
     if (!time_ok) {
-        if (is_wifi_enabled()) {
-            if(!myTCP->send_error_log("Time could not be readed.", config_get().clock_enabled ? "PCF8563" : "RTC")){
-                printf("Time error");
-            }
-        }
+        log_error("Time could not be readed.", config_get().clock_enabled ? "PCF8563" : "RTC");
         return;
     }
 
@@ -582,19 +767,24 @@ void ProgramMain::display_measurement() {
         
     if (values.temperature < -100 || values.temperature > 100 ||
         values.humidity < 0 || values.humidity > 100) {
-        if (is_wifi_enabled()) {
-            if(!myTCP->send_error_log("Sensor error", "Values out of range")){
-                printf("Sensor error");
-            }    
-        }
+        log_error("Sensor error", "Values out of range");
         return;
     }
 
     char line1[17];
     char line2[17];
 
-    snprintf(line1, sizeof(line1), "%04d-%02d-%02d %02d:%02d",
-             timev[6], timev[5], timev[3], timev[2], timev[1]);
+    time_t shown = disciplined_epoch(timev);
+    binary_link_publish_sample({shown, values.temperature, values.humidity, values.pressure});
+
+    struct tm *lt = localtime(&shown);
+    if (lt) {
+        snprintf(line1, sizeof(line1), "%04d-%02d-%02d %02d:%02d",
+                 lt->tm_year + 1900, lt->tm_mon + 1, lt->tm_mday, lt->tm_hour, lt->tm_min);
+    } else {
+        snprintf(line1, sizeof(line1), "%04d-%02d-%02d %02d:%02d",
+                 timev[6], timev[5], timev[3], timev[2], timev[1]);
+    }
 
     if (option == 0) {
         if (is_logging_enabled()) set_rgb_color(0, 255, 0);
@@ -655,41 +845,23 @@ void ProgramMain::display_measurement() {
 }   
 
 /**
- * Sends a single sensor sample (timestamp, temperature, humidity, pressure) to the backend.
+ * @brief Takes one timestamped sensor sample for upload.
  *
  * Preconditions:
- * - Wi‑Fi must be enabled (is_wifi_enabled()).
- * - myTCP (transport/client) and myBME280 (sensor) are initialized and ready.
+ * - myBME280 (sensor) is initialized and ready.
  * - If config_get().clock_enabled == 1, a PCF8563T RTC must be present and readable.
  *
  * Behavior:
- * - If Wi‑Fi is disabled, returns immediately.
  * - Attempts to read time from the RTC when enabled; on failure (or when clock is disabled),
- *   logs an error ("PCF8563" if enabled, otherwise "RTC") and returns.
- * - Constructs a UTC timestamp string:
- *   - Preferred: ISO‑8601 "YYYY-MM-DDThh:mm:ssZ" using gmtime().
- *   - Fallback: "YYYY-MM-DD hh:mm:ss" formatted from raw RTC fields if gmtime() fails.
+ *   logs an error ("PCF8563" if enabled, otherwise "RTC") if the link is up and returns false.
+ * - Converts the RTC reading into a disciplined Unix timestamp (disciplined_epoch()).
  * - Measures BME280 values; validates temperature ∈ [-100, 100] and humidity ∈ [0, 100].
- *   On invalid range, logs an error and returns.
- * - Requests an authorization token; on failure, logs an error and returns.
- * - Posts the data; on failure, attempts to log an error (includes timestamp) and returns.
- * - On success, returns normally (void) with no further output.
- *
- * Side effects:
- * - Performs synchronous network I/O via myTCP (token request, data POST, error logs).
- * - Prints to console (printf) if certain error-log transmissions fail.
- *
- * Return value:
- * - void (returns early on any failure condition).
+ *   On invalid range, logs an error if the link is up and returns false.
  *
- * Notes:
- * - May block due to I/O and sensor/RTC access.
- * - Units are determined by BME280::Measurement_t (commonly °C, %RH, and Pa or hPa).
- * - Not thread-safe unless external synchronization protects shared resources (I2C, myTCP, sensor state).
+ * @param out Receives the timestamp and measured values on success.
+ * @return true if a valid sample was taken.
  */
-void ProgramMain::send_data() {
-    if (!is_logging_enabled()) return;
-    if (!is_wifi_enabled()) return;
+bool ProgramMain::take_sample(QueuedSample &out) {
     bool time_ok = false;
     uint16_t tarr[7];
     if (config_get().clock_enabled == 1) {
@@ -705,74 +877,253 @@ void ProgramMain::send_data() {
         tarr[0] = t.sec;
     }
     if (!time_ok) {
-        if(!myTCP->send_error_log("Time could not be readed.", config_get().clock_enabled ? "PCF8563" : "RTC")){
-            printf("Time error - data send");
-        }
-        return;
+        log_error("Time could not be readed.", config_get().clock_enabled ? "PCF8563" : "RTC");
+        return false;
     }
 
-    time_t epoch_utc = make_time_utc_from_rtc_fields(
-        tarr[6], tarr[5], tarr[3],
-        tarr[2], tarr[1], tarr[0]
-    );
-    struct tm *gt = gmtime(&epoch_utc);
-    char time_send[32];
-    if (gt) {
-        snprintf(time_send, sizeof(time_send),
-                 "%04d-%02d-%02dT%02d:%02d:%02dZ",
-                 gt->tm_year + 1900, gt->tm_mon + 1, gt->tm_mday,
-                 gt->tm_hour, gt->tm_min, gt->tm_sec);
-    } else {
-        snprintf(time_send, sizeof(time_send),
-                 "%04d-%02d-%02d %02d:%02d:%02d",
-                 tarr[6], tarr[5], tarr[3], tarr[2], tarr[1], tarr[0]);
-    }
+    out.epoch = disciplined_epoch(tarr);
 
     BME280::Measurement_t values = myBME280->measure();
 
     if (values.temperature < -100 || values.temperature > 100 ||
         values.humidity < 0 || values.humidity > 100) {
-        if(!myTCP->send_error_log("Invalid sensor data")){
-            printf("Invalid sensor data");
-        }
-        return;
+        log_error("Invalid sensor data");
+        return false;
     }
 
+    out.temperature = values.temperature;
+    out.humidity    = values.humidity;
+    out.pressure    = values.pressure;
+    return true;
+}
+
+/**
+ * @brief Reports an error to the backend's error log, if the backend is reachable.
+ *
+ * Skipped while the link is down or the upload circuit breaker is not closed, so a
+ * backend outage does not cost an extra blocking request per failure. The outcome is
+ * not fed to the breaker, which tracks the data endpoint only; an undelivered message
+ * is printed to the console instead.
+ *
+ * @param message Short error message.
+ * @param details Optional details; may be nullptr.
+ */
+void ProgramMain::log_error(const char* message, const char* details) {
+    if (!is_wifi_up() || circuit_breaker_state() != BreakerState::Closed) return;
+    if (myTCP->send_error_log(message, details)) return;
+    printf("%s\n", message);
+}
+
+/**
+ * @brief Uploads one sample to the backend.
+ *
+ * Formats the sample timestamp as ISO‑8601 UTC ("YYYY-MM-DDThh:mm:ssZ"), requests an
+ * authorization token and posts the data. Upload failures are only printed to the
+ * console: an error-log POST to the same backend would add another blocking request
+ * per failed attempt.
+ *
+ * The exchange runs behind the upload circuit breaker (circuit_breaker.hpp): while the
+ * circuit is open the call returns false at once without touching the network, and
+ * every attempt's outcome (with the server's Retry-After, if any) is fed back to it.
+ *
+ * @param s Sample to upload.
+ * @return true if the backend accepted the sample, or if the sample is unusable and was
+ *         discarded (its timestamp cannot be formatted); false if it should be retried
+ *         (failed, or refused by the open circuit).
+ *
+ * @pre The link is up (is_wifi_up()).
+ * @note Performs synchronous network I/O via myTCP and may block for the TCP timeouts.
+ */
+bool ProgramMain::upload_sample(const QueuedSample &s) {
+    struct tm *gt = gmtime(&s.epoch);
+    if (!gt) {
+        log_error("Invalid sample timestamp");
+        return true;
+    }
+    char time_send[32];
+    snprintf(time_send, sizeof(time_send),
+             "%04d-%02d-%02dT%02d:%02d:%02dZ",
+             gt->tm_year + 1900, gt->tm_mon + 1, gt->tm_mday,
+             gt->tm_hour, gt->tm_min, gt->tm_sec);
+
+    if (!circuit_breaker_allow(now_ms())) return false;
+
     if (!myTCP->send_token_get_request()) {
-        myTCP->send_error_log("Token fetch failed");
-        return;
-    };
+        circuit_breaker_on_failure(now_ms(), myTCP->last_retry_after_s());
+        printf("Token fetch failed\n");
+        return false;
+    }
+
+    if (!myTCP->send_data_post_request(time_send, s.temperature, s.humidity, s.pressure)) {
+        circuit_breaker_on_failure(now_ms(), myTCP->last_retry_after_s());
+        printf("Data sending error %s\n", time_send);
+        return false;
+    }
+    circuit_breaker_on_success();
+    return true;
+}
 
-    if (!myTCP->send_data_post_request(time_send, values.temperature, values.humidity, values.pressure)) {
-        if(!myTCP->send_error_log("Data sending error", time_send)){
-            printf("Data sending error");
+/**
+ * @brief Uploads queued samples, oldest first, in a bounded batch.
+ *
+ * Sends at most QUEUE_FLUSH_BATCH samples per call so wifi_tick() keeps the main loop
+ * responsive while a backlog drains. A sample is removed only after a successful upload.
+ * Flushing stops (queue_flush_pending cleared) when the queue is empty or an upload fails;
+ * the next send_data() call resumes it.
+ */
+void ProgramMain::flush_queue() {
+    QueuedSample s;
+    for (int i = 0; i < QUEUE_FLUSH_BATCH; ++i) {
+        if (!sample_queue_peek(s)) {
+            queue_flush_pending = false;
+            return;
         }
-        return;
+        if (!upload_sample(s)) {
+            queue_flush_pending = false;
+            return;
+        }
+        sample_queue_pop();
     }
+    queue_flush_pending = (sample_queue_count() > 0);
 }
 
 /**
- * @brief SNTP callback to apply newly acquired time to the system and external RTC.
+ * Takes a sensor sample (timestamp, temperature, humidity, pressure) and sends it to the backend.
  *
- * Sets a global synchronization flag and converts the provided Unix epoch seconds
- * to local time, constructing a datetime_t. If both clock_enabled and set_time_enabled
- * configuration flags are enabled, the external PCF8563T real-time clock is updated
- * over I2C.
+ * Behavior:
+ * - Returns immediately if logging or Wi‑Fi is disabled.
+ * - Takes the sample with take_sample(); returns if no valid sample is available.
+ * - The sample is queued (sample_queue_push()) on the exact post tick, and the upload is
+ *   scheduled at this device's phase in the post period (schedule_upload(), run by
+ *   upload_tick()), so a fleet that shares a post period does not hit the backend in
+ *   the same second. The queue keeps chronological order; a sample is only removed
+ *   after a successful upload.
+ * - While the link is down the scheduled upload is skipped and wifi_tick() schedules a
+ *   new one on link-up. While the upload circuit breaker is open no upload is
+ *   attempted, so during a backend outage samples only accumulate in the queue.
  *
- * @param secs Unix time in seconds since 1970-01-01 00:00:00 UTC.
+ * Side effects:
+ * - Network I/O only for error logs (log_error()) when the sample cannot be taken;
+ *   uploads run later from upload_tick().
+ *
+ * Notes:
+ * - May block due to sensor/RTC access.
+ * - Not thread-safe unless external synchronization protects shared resources (I2C, myTCP, sensor state).
+ */
+void ProgramMain::send_data() {
+    if (!is_logging_enabled()) return;
+    if (!is_wifi_enabled()) return;
+
+    QueuedSample sample;
+    if (!take_sample(sample)) return;
+
+    (void)sample_queue_push(sample);
+    schedule_upload();
+}
+
+/**
+ * @brief Deterministic per-device upload phase within one post period.
+ *
+ * Fibonacci hashing of logger_id: consecutive IDs land about 0.618 of a period
+ * apart, so any run of IDs in a fleet is spread almost evenly over the period
+ * instead of clustering the way a plain modulo of nearby IDs would.
+ *
+ * @param logger_id Configured logger ID.
+ * @param period_ms Post period in milliseconds (> 0).
+ * @return Offset in [0, period_ms).
+ */
+static uint32_t upload_phase_ms(uint32_t logger_id, uint32_t period_ms) {
+    const uint32_t h = logger_id * 2654435769u;
+    return (uint32_t)(((uint64_t)h * period_ms) >> 32);
+}
+
+/**
+ * @brief Schedule the next upload of the sample queue at this device's phase.
+ *
+ * The upload runs upload_phase_ms(logger_id) after now, moved by a random jitter of
+ * up to ±(min(period / 10, UPLOAD_JITTER_MAX_MS) / 2) and wrapped into one post
+ * period. With every device of a site booting together, the per-device phase spreads
+ * the token and data requests across the whole period and the jitter keeps devices
+ * with colliding phases from staying in lockstep. An upload that is already
+ * scheduled is kept, so repeated calls never postpone it.
+ *
+ * Sampling is unaffected: send_data() takes and queues its sample on the exact post
+ * tick; only the network transfer is shifted.
+ */
+void ProgramMain::schedule_upload() {
+    if (upload_pending) return;
+    const auto &cfg = config_get();
+    const uint32_t period = cfg.post_time_ms < 1000u ? 1000u : cfg.post_time_ms;
+    uint32_t jitter = period / 10u;
+    if (jitter > UPLOAD_JITTER_MAX_MS) jitter = UPLOAD_JITTER_MAX_MS;
+
+    const uint64_t delay = (uint64_t)upload_phase_ms(cfg.logger_id, period) + period
+                         - jitter / 2u + get_rand_32() % (jitter + 1u);
+    upload_due_ms = now_ms() + (uint32_t)(delay % period);
+    upload_pending = true;
+}
+
+/**
+ * @brief Start the scheduled upload once it is due; call regularly from the main loop.
+ *
+ * Uploads the oldest queued samples through flush_queue(); a remaining backlog is
+ * drained in batches by wifi_tick(). If the link is down when the upload falls due,
+ * nothing is sent and wifi_tick() schedules a new upload on link-up. Never blocks
+ * beyond the upload itself.
+ */
+void ProgramMain::upload_tick() {
+    if (!upload_pending || (int32_t)(now_ms() - upload_due_ms) < 0) return;
+    upload_pending = false;
+    if (!is_wifi_up()) return;
+    flush_queue();
+}
+
+/**
+ * @brief Feed the network time selected by the SNTP client into the RTC drift model.
+ *
+ * Reads the PCF8563T at the same instant and records the RTC-versus-network
+ * offset with clock_discipline_on_sync(). The RTC
+ * is only rewritten when the model reports that it has drifted by at least
+ * CLOCK_RTC_STEP_S (or when no RTC reading is available); the applied delta is
+ * reported back so the model's raw timeline stays continuous. Logged timestamps
+ * go through the model and are slewed, so they never jump on a sync.
+ *
+ * @param net_epoch Unix time in seconds since 1970-01-01 00:00:00 UTC, with fraction,
+ *                  as extrapolated to the current instant by ntp_client_time_now().
  *
  * @pre I2C interface and the PCF8563T driver are initialized. The system time zone
- *      is configured if local time conversion is desired.
- * @post The global time_synced flag is set to true. The PCF8563T RTC may be updated.
+ *      is configured, since RTC fields are stored as local time.
+ * @post The PCF8563T RTC may be updated.
  *
  * @note Conversion uses localtime(), which applies the current time zone and DST.
  *       Ensure the day-of-week mapping used by pcf8563t_set_time() matches tm_wday.
  *
- * @see pcf8563t_set_time(), config_get()
+ * @see clock_discipline_on_sync(), clock_discipline_rtc_stepped(), pcf8563t_set_time()
  */
-extern "C" void sntp_set_system_time(uint32_t secs) {
-    time_synced = true;
-    time_t rawtime = secs;
+void ProgramMain::apply_network_time(double net_epoch) {
+    time_t rawtime = (time_t)llround(net_epoch);
+
+    time_t rtc_epoch = 0;
+    bool rtc_ok = false;
+    bool step = true;
+    if (config_get().clock_enabled == 1) {
+        uint16_t f[7];
+        if (pcf8563t_read_time(I2C_PORT, f)) {
+            struct tm lt = {};
+            lt.tm_year = (int)f[6] - 1900;
+            lt.tm_mon  = (int)f[5] - 1;
+            lt.tm_mday = (int)f[3];
+            lt.tm_hour = (int)f[2];
+            lt.tm_min  = (int)f[1];
+            lt.tm_sec  = (int)f[0];
+            /* Resolve the repeated autumn hour against network time, not as an RTC error */
+            rtc_epoch = clock_rtc_local_to_epoch(&lt, net_epoch);
+            rtc_ok = (rtc_epoch != (time_t)-1);
+        }
+        if (rtc_ok) step = clock_discipline_on_sync(rtc_epoch, net_epoch);
+    }
+    if (!step) return;
+
     struct tm *lt = localtime(&rawtime);
     datetime_t dt = {
         .year  = (int16_t)(lt->tm_year + 1900),
@@ -784,57 +1135,41 @@ extern "C" void sntp_set_system_time(uint32_t secs) {
         .sec   = (int8_t)(lt->tm_sec),
     };
     if (config_get().clock_enabled == 1 && config_get().set_time_enabled == 1) {
-        pcf8563t_set_time(I2C_PORT, dt.sec, dt.min, dt.hour, dt.dotw, dt.day, dt.month, dt.year);
+        if (pcf8563t_set_time(I2C_PORT, dt.sec, dt.min, dt.hour, dt.dotw, dt.day, dt.month, dt.year) && rtc_ok) {
+            clock_discipline_rtc_stepped((int32_t)(rawtime - rtc_epoch));
+        }
     }else if (config_get().clock_enabled == 0 && config_get().set_time_enabled == 1) {
         rtc_set_datetime(&dt);
     }
 }
 
 /**
- * @brief Polls the two front-panel buttons, applying debounce and long-press logic.
+ * @brief Handles queued front-panel button events (see buttons.hpp).
  *
- * This method should be called periodically (e.g. in the main loop) to update
- * internal button state machines for SWITCH_1 (btn21) and SWITCH_2 (btn20).
- * Buttons are treated as active-low (a logical 0 from gpio_get() indicates pressed).
+ * The buttons are debounced and timed in IRQ context; this method only drains
+ * the event queue, so it costs nothing when no button was touched and still
+ * sees every press made while the main loop was blocked. Buttons are active-low.
  *
  * Behavior:
- *   - Debounce: Both buttons use a 50 ms debounce window to filter mechanical chatter.
- *
- *   Button 1 (SWITCH_1 / "btn21"):
- *     - Short press (press and release before 10 s):
+ *   Button 1 (SWITCH_1, BUTTON_BACKLIGHT):
+ *     - Click (Release without a preceding LongPress):
  *         Toggles the LCD backlight. When turning it on, a backlight timeout
- *         (e.g. 30 s) is (re)armed via backlight_kick(); when turning it off the
+ *         (30 s) is (re)armed via backlight_kick(); when turning it off the
  *         deadline is cleared.
- *     - Long press (>= 10 000 ms):
- *         Triggers a device reset request by setting device_reset_flag = true.
- *         The long-press action fires only once per press cycle (guarded by
- *         btn21_long_fired).
+ *     - LongPress (>= HOLD_RESET_MS = 10 000 ms):
+ *         Requests a device reset (device_reset_flag = true).
  *
- *   Button 2 (SWITCH_2 / "btn20"):
- *     - Long press (>= 3 000 ms):
+ *   Button 2 (SWITCH_2, BUTTON_LOGGING):
+ *     - LongPress (>= HOLD_LOGGING_MS = 3 000 ms):
  *         Toggles the persistent logging_enabled state:
  *           * Updates in-memory flag (logging_enabled).
- *           * Writes the updated configuration (config_mut() + config_save()).
+ *           * Updates the configuration (config_mut()) and requests a deferred save
+ *             (config_request_save(); repeated toggles coalesce into one flash write).
  *           * Sets the RGB LED to white (as feedback).
  *           * Updates the first two LCD lines with a status message:
  *               "Logging enabled "  or
  *               "Logging disabled"
- *         The long-press action executes only once per continuous press
- *         (guarded by btn20_long_fired).
- *     - Short press / release:
- *         Currently no action besides clearing the pressed state.
- *
- * Internal State Tracking (per button):
- *   - prev level (btn20_prev / btn21_prev) to detect edges.
- *   - last_ms timestamp for debounce gating.
- *   - press_start timestamp to measure hold duration.
- *   - pressed flag indicating an active press cycle.
- *   - long_fired flag preventing repeated long-press actions.
- *
- * Timing Constants:
- *   - DEBOUNCE_MS = 50 ms
- *   - HOLD20_MS   = 3000 ms (logging toggle threshold)
- *   - HOLD21_MS   = 10000 ms (reset trigger threshold)
+ *     - Click: no action.
  *
  * Side Effects:
  *   - May toggle LCD backlight and related timeout state.
@@ -844,85 +1179,34 @@ extern "C" void sntp_set_system_time(uint32_t secs) {
  *   - Changes RGB LED color.
  *
  * Concurrency / Usage Notes:
- *   - Must be called frequently enough (<< smallest hold threshold) for accurate
- *     long-press detection (e.g. every few milliseconds).
- *   - Assumes monotonic millisecond tick from now_ms().
- *   - Not thread-safe; intended for single-threaded / main-loop invocation.
+ *   - Call from the main loop; not thread-safe.
  *
  * @return void
  */
 void ProgramMain::poll_buttons() {
-    constexpr uint32_t DEBOUNCE_MS = 50;
-    constexpr uint32_t HOLD20_MS   = 3000;
-    constexpr uint32_t HOLD21_MS   = 10000;
-
-    const uint32_t tms = now_ms();
-
-    bool b21 = gpio_get(SWITCH_1);
-    if (!b21) { 
-        if (btn21_prev && (tms - btn21_last_ms) > DEBOUNCE_MS) {
-            btn21_pressed     = true;
-            btn21_press_start = tms;
-            btn21_long_fired  = false;
-            btn21_last_ms     = tms;
-        }
-        if (btn21_pressed && !btn21_long_fired && (tms - btn21_press_start) >= HOLD21_MS) {
-            btn21_long_fired = true;
-            device_reset_flag = true;
-        }
-    } else {
-        if (!btn21_prev && (tms - btn21_last_ms) > DEBOUNCE_MS) {
-            if (btn21_pressed && !btn21_long_fired) {
+    ButtonEvent ev;
+    while (buttons_next_event(ev)) {
+        if (ev.button == BUTTON_BACKLIGHT) {
+            if (ev.type == ButtonEventType::LongPress) {
+                device_reset_flag = true;
+            } else if (ev.type == ButtonEventType::Release && !ev.after_long) {
                 bool on = lcd_get_backlight();
                 lcd_set_backlight(!on);
                 if (!on) backlight_kick(30000);
                 else     backlight_deadline_ms = 0;
             }
-            btn21_pressed = false;
-            btn21_last_ms = tms;
-        }
-    }
-    btn21_prev = b21;
-
-    bool b20 = gpio_get(SWITCH_2);
-    if (!b20) {
-        if (btn20_prev && (tms - btn20_last_ms) > DEBOUNCE_MS) {
-            btn20_pressed     = true;
-            btn20_press_start = tms;
-            btn20_long_fired  = false;
-            btn20_last_ms     = tms;
-        }
-        if (btn20_pressed && !btn20_long_fired && (tms - btn20_press_start) >= HOLD20_MS) {
-            btn20_long_fired = true;
-            if(!logging_enabled){
-                logging_enabled = true;
-                auto &cfg = config_mut();
-                cfg.logging_enabled = 1;
-                config_save();
-                set_rgb_color(255, 255, 255);
-                lcd_set_cursor(0, 0);
-                lcd_string("Logging enabled ");
-                lcd_set_cursor(1, 0);
-                lcd_string("                ");
-            } else {
-                logging_enabled = false;
-                auto &cfg = config_mut();
-                cfg.logging_enabled = 0;
-                config_save();
-                set_rgb_color(255, 255, 255);
-                lcd_set_cursor(0, 0);
-                lcd_string("Logging disabled");
-                lcd_set_cursor(1, 0);
-                lcd_string("                ");
-            }
-        }
-    } else {
-        if (!btn20_prev && (tms - btn20_last_ms) > DEBOUNCE_MS) {
-            btn20_pressed = false;
-            btn20_last_ms = tms;
+        } else if (ev.button == BUTTON_LOGGING && ev.type == ButtonEventType::LongPress) {
+            logging_enabled = !logging_enabled;
+            auto &cfg = config_mut();
+            cfg.logging_enabled = logging_enabled ? 1 : 0;
+            config_request_save();
+            set_rgb_color(255, 255, 255);
+            lcd_set_cursor(0, 0);
+            lcd_string(logging_enabled ? "Logging enabled " : "Logging disabled");
+            lcd_set_cursor(1, 0);
+            lcd_string("                ");
         }
     }
-    btn20_prev = b20;
 }
 
 /**
@@ -1000,3 +1284,43 @@ void ProgramMain::backlight_autoff_tick() {
         backlight_deadline_ms = 0;
     }
 }
+
+/**
+ * @brief Service the live sample stream (see stream.hpp).
+ *
+ * - Applies pending "stream on/off" requests: on start the BME280 is switched to
+ *   normal mode with the standby time that best matches the requested rate, and
+ *   the rate is clamped to what one conversion cycle allows; on stop it returns
+ *   to forced mode for the regular once-per-second readings.
+ * - When a sample is due, reads the latest conversion in a single I2C burst
+ *   (BME280::read_fixed()) and hands it to stream_push(). Never waits on USB.
+ *
+ * Call from the main loop on every pass.
+ */
+void ProgramMain::stream_tick() {
+    if (!myBME280) return;
+
+    bool on = false;
+    uint16_t rate_hz = 0;
+    if (stream_take_request(on, rate_hz)) {
+        if (on) {
+            const uint32_t meas_us = myBME280->max_measure_time_us();
+            uint32_t max_hz = 1000000u / (meas_us + 500u);
+            if (max_hz < 1) max_hz = 1;
+            if (rate_hz > max_hz) rate_hz = (uint16_t)max_hz;
+            const uint8_t standby = myBME280->standby_for_period_us(1000000u / rate_hz);
+            myBME280->set_normal_mode(standby);
+            stream_started(rate_hz, meas_us + BME280::standby_time_us(standby));
+        } else {
+            myBME280->set_forced_mode();
+        }
+    }
+
+    const uint64_t now = time_us_64();
+    if (!stream_due(now)) return;
+
+    BME280::Raw_t raw;
+    BME280::Fixed_t val;
+    if (myBME280->read_fixed(raw, val)) stream_push(now, raw, val);
+    else stream_read_error();
+}
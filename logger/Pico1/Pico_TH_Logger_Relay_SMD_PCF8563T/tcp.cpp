@@ -1,13 +1,16 @@
 #include "pico/cyw43_arch.h"
-#include <string>
 #include <string.h>
+#include <strings.h>
 #include <stdio.h>
+#include <ctype.h>
 #include <stdlib.h>
 #include <time.h>
 
 #include "tcp.hpp"
 #include "main.hpp"
 #include "config.hpp"
+#include "mem_pool.hpp"
+#include "net_stats.hpp"
 
 extern "C" {
     #include "lwip/timeouts.h"
@@ -19,6 +22,7 @@ extern "C" {
 struct tcp_context_base_t {
     volatile bool done   = false;
     volatile bool failed = false;
+    volatile bool pcb_gone = false;     // lwIP freed the PCB (tcp_err) or a callback aborted it
     uint8_t poll_ticks   = 0;
 };
 
@@ -37,6 +41,11 @@ struct dns_wait_ctx {
     ip_addr_t addr{};
 };
 
+// Requests run one at a time, so one context of each kind is enough; an exhausted
+// pool fails the request like a failed allocation would.
+static ObjectPool<token_ctx_t, 1> s_token_ctx_pool("token_ctx");
+static ObjectPool<post_ctx_t, 1>  s_post_ctx_pool("post_ctx");
+
 
 /**
  * @brief Determine if an HTTP status line indicates a successful (2xx) response.
@@ -130,6 +139,36 @@ static bool http_has_chunked(const char* resp) {
     return false;
 }
 
+/**
+ * @brief Extract a Retry-After delay from an HTTP response header section.
+ *
+ * Scans the headers (up to the first empty line) for "Retry-After:" (case-insensitive)
+ * and parses its delta-seconds value. The HTTP-date form is not supported and reads
+ * as absent.
+ *
+ * @param resp NUL-terminated HTTP response, starting at the status line. May be nullptr.
+ * @return Delay in seconds, or 0 if the header is absent or not a number.
+ */
+static uint32_t http_retry_after(const char* resp) {
+    if (!resp) return 0;
+    const char* hdr = "Retry-After:";
+    const size_t hdr_len = strlen(hdr);
+    const char* cur = resp;
+    while (true) {
+        const char* line_end = strstr(cur, "\r\n");
+        if (!line_end || line_end == cur) break;
+        if ((size_t)(line_end - cur) > hdr_len && strncasecmp(cur, hdr, hdr_len) == 0) {
+            const char* v = cur + hdr_len;
+            while (*v == ' ' || *v == '\t') ++v;
+            if (!isdigit((unsigned char)*v)) return 0;
+            unsigned long secs = strtoul(v, nullptr, 10);
+            return secs > 0xFFFFFFFFul ? 0xFFFFFFFFu : (uint32_t)secs;
+        }
+        cur = line_end + 2;
+    }
+    return 0;
+}
+
 /**
  * @brief Closes a TCP connection gracefully when possible, otherwise aborts it.
  *
@@ -143,12 +182,15 @@ static bool http_has_chunked(const char* resp) {
  *            graceful close fails, the connection is aborted (RST).
  *
  * @note After this call, the PCB is no longer valid and must not be used.
+ * @note The callback argument is cleared first: a gracefully closed PCB lingers and
+ *       may still see callbacks, and the request context goes back to its pool.
  * @note Aborting sends an RST to the peer and immediately frees PCB resources.
  * @note Must be called from the appropriate lwIP TCP context (e.g., within TCP
  *       callbacks or with the core lock held, depending on your lwIP threading model).
  */
 static void tcp_close_or_abort(struct tcp_pcb* pcb, bool ok) {
     if (!pcb) return;
+    tcp_arg(pcb, nullptr);
     if (ok) {
         if (tcp_close(pcb) != ERR_OK) tcp_abort(pcb);
     } else {
@@ -157,6 +199,33 @@ static void tcp_close_or_abort(struct tcp_pcb* pcb, bool ok) {
 }
 
 
+/**
+ * @brief Drive lwIP until a request completes or its deadline passes.
+ *
+ * Polls the CYW43 driver and lwIP timers every 5 ms. While the PCB is alive its
+ * retransmission counter is sampled for the "netstats" report; a request that
+ * runs out of time is counted there as a timeout and marked failed.
+ *
+ * @param pcb        Connection the request runs on.
+ * @param ctx        Request context; done/failed/pcb_gone are set by the callbacks.
+ * @param timeout_ms Deadline in milliseconds.
+ */
+static void tcp_wait_done(struct tcp_pcb* pcb, tcp_context_base_t* ctx, uint32_t timeout_ms) {
+    uint8_t nrtx_seen = 0;
+    absolute_time_t deadline = make_timeout_time_ms(timeout_ms);
+    while (!time_reached(deadline) && !ctx->done) {
+        cyw43_arch_poll();
+        sys_check_timeouts();
+        if (!ctx->pcb_gone) net_stats_track_rexmit(pcb->nrtx, nrtx_seen);
+        sleep_ms(5);
+    }
+    if (!ctx->done) {
+        ctx->failed = true;
+        net_stats_note_timeout();
+    }
+}
+
+
 /**
  * @brief DNS lookup completion callback (lwIP-style).
  *
@@ -333,16 +402,17 @@ bool TCP::send_token_get_request() {
     }
 
     recv_len = 0;
+    retry_after_s = 0;
     memset(recv_buffer, 0, sizeof(recv_buffer));
     memset(received_token, 0, sizeof(received_token));
 
-    token_ctx_t *ctx = (token_ctx_t*)calloc(1, sizeof(token_ctx_t));
+    token_ctx_t *ctx = s_token_ctx_pool.acquire();
     if (!ctx) return false;
     ctx->self = this;
 
     struct tcp_pcb* pcb = tcp_new();
     if (!pcb) {
-        free(ctx);
+        s_token_ctx_pool.release(ctx);
         return false;
     }
 
@@ -350,7 +420,7 @@ bool TCP::send_token_get_request() {
 
     tcp_err(pcb, [](void *arg, err_t) {
         auto *c = static_cast<token_ctx_t*>(arg);
-        if (c) { c->failed = true; c->done = true; }
+        if (c) { c->failed = true; c->done = true; c->pcb_gone = true; }
     });
 
     tcp_recv(pcb, [](void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err) -> err_t {
@@ -363,7 +433,7 @@ bool TCP::send_token_get_request() {
 
         if (err != ERR_OK) {
             if (p) pbuf_free(p);
-            c->failed = true; c->done = true;
+            c->failed = true; c->done = true; c->pcb_gone = true;
             tcp_abort(pcb);
             return ERR_ABRT;
         }
@@ -415,7 +485,7 @@ bool TCP::send_token_get_request() {
         auto *c = static_cast<token_ctx_t*>(arg);
         if (!c) return ERR_OK;
         if (++c->poll_ticks > 20) { 
-            c->failed = true; c->done = true;
+            c->failed = true; c->done = true; c->pcb_gone = true;
             tcp_abort(pcb);
             return ERR_ABRT;
         }
@@ -428,36 +498,32 @@ bool TCP::send_token_get_request() {
             if (!c || err != ERR_OK) return err;
 
             const auto &cfg2 = config_get();
-            char host_line[64];
-            snprintf(host_line, sizeof(host_line), "%s", cfg2.server_ip);
-
-            std::string req = std::string("GET " TOKEN_PATH " HTTP/1.1\r\n")
-                            + "Host: " + host_line + "\r\n"
-                            + "User-Agent: pico-logger/1.0\r\n"
-                            + "Connection: close\r\n\r\n";
-
-            err_t w = tcp_write(pcb, req.c_str(), (u16_t)req.size(), TCP_WRITE_FLAG_COPY);
+            char req[192];
+            int n = snprintf(req, sizeof(req),
+                "GET " TOKEN_PATH " HTTP/1.1\r\n"
+                "Host: %.63s\r\n"
+                "User-Agent: pico-logger/1.0\r\n"
+                "Connection: close\r\n\r\n",
+                cfg2.server_ip);
+            if (n < 0 || n >= (int)sizeof(req)) return ERR_BUF;
+
+            err_t w = tcp_write(pcb, req, (u16_t)n, TCP_WRITE_FLAG_COPY);
             if (w != ERR_OK) return w;
             return tcp_output(pcb);
         });
 
     if (result != ERR_OK) {
         tcp_abort(pcb);
-        free(ctx);
+        s_token_ctx_pool.release(ctx);
         return false;
     }
 
-    absolute_time_t deadline = make_timeout_time_ms(8000);
-    while (!time_reached(deadline) && !ctx->done) {
-        cyw43_arch_poll();
-        sys_check_timeouts();
-        sleep_ms(5);
-    }
-
-    tcp_close_or_abort(pcb, !ctx->failed);
+    tcp_wait_done(pcb, ctx, 8000);
+    if (!ctx->pcb_gone) tcp_close_or_abort(pcb, !ctx->failed);
 
     bool ok = strlen(received_token) > 0 && !ctx->failed;
-    free(ctx);
+    if (!ok) retry_after_s = http_retry_after(recv_buffer);
+    s_token_ctx_pool.release(ctx);
     return ok;
 }
 
@@ -538,6 +604,7 @@ err_t TCP::tcp_connected_callback(void *arg, struct tcp_pcb *pcb, err_t err) {
  */
 bool TCP::send_data_post_request(const char* timestamp, float temp, float hum, float pressure) {
     const auto &cfg = config_get();
+    retry_after_s = 0;
 
     char json_body[512];
     snprintf(json_body, sizeof(json_body),
@@ -551,7 +618,7 @@ bool TCP::send_data_post_request(const char* timestamp, float temp, float hum, f
         timestamp ? timestamp : "", pressure, cfg.logger_id, cfg.sensor_id
     );
 
-    post_ctx_t* ctx = (post_ctx_t*)calloc(1, sizeof(post_ctx_t));
+    post_ctx_t* ctx = s_post_ctx_pool.acquire();
     if (!ctx) return false;
 
     const char* host_header = cfg.server_ip;
@@ -572,13 +639,13 @@ bool TCP::send_data_post_request(const char* timestamp, float temp, float hum, f
 
     ip_addr_t server_ip;
     if (!resolve_host_blocking(cfg.server_ip, &server_ip, 5000)) {
-        free(ctx);
+        s_post_ctx_pool.release(ctx);
         return false;
     }
 
     struct tcp_pcb* pcb = tcp_new();
     if (!pcb) {
-        free(ctx);
+        s_post_ctx_pool.release(ctx);
         return false;
     }
 
@@ -586,7 +653,7 @@ bool TCP::send_data_post_request(const char* timestamp, float temp, float hum, f
 
     tcp_err(pcb, [](void *arg, err_t) {
         auto *c = static_cast<post_ctx_t*>(arg);
-        if (c) { c->failed = true; c->done = true; }
+        if (c) { c->failed = true; c->done = true; c->pcb_gone = true; }
     });
 
     tcp_recv(pcb, [](void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err) -> err_t {
@@ -599,7 +666,7 @@ bool TCP::send_data_post_request(const char* timestamp, float temp, float hum, f
 
         if (err != ERR_OK) {
             if (p) pbuf_free(p);
-            c->failed = true; c->done = true;
+            c->failed = true; c->done = true; c->pcb_gone = true;
             tcp_abort(pcb);
             return ERR_ABRT;
         }
@@ -637,7 +704,7 @@ bool TCP::send_data_post_request(const char* timestamp, float temp, float hum, f
         auto *c = static_cast<post_ctx_t*>(arg);
         if (!c) return ERR_OK;
         if (++c->poll_ticks > 20) {
-            c->failed = true; c->done = true;
+            c->failed = true; c->done = true; c->pcb_gone = true;
             tcp_abort(pcb);
             return ERR_ABRT;
         }
@@ -647,21 +714,19 @@ bool TCP::send_data_post_request(const char* timestamp, float temp, float hum, f
     err_t result = tcp_connect(pcb, &server_ip, cfg.server_port, tcp_connected_callback);
     if (result != ERR_OK) {
         tcp_abort(pcb);
-        free(ctx);
+        s_post_ctx_pool.release(ctx);
         return false;
     }
 
-    absolute_time_t deadline = make_timeout_time_ms(8000);
-    while (!time_reached(deadline) && !ctx->done) {
-        cyw43_arch_poll();
-        sys_check_timeouts();
-        sleep_ms(5);
-    }
-
-    tcp_close_or_abort(pcb, !ctx->failed);
+    tcp_wait_done(pcb, ctx, 8000);
+    if (!ctx->pcb_gone) tcp_close_or_abort(pcb, !ctx->failed);
 
     bool ok = !ctx->failed;
-    free(ctx);
+    if (!ok) {
+        ctx->response[ctx->response_len] = '\0';
+        retry_after_s = http_retry_after(ctx->response);
+    }
+    s_post_ctx_pool.release(ctx);
     return ok;
 }
 
@@ -716,7 +781,7 @@ bool TCP::send_error_log(const char* message, const char* details) {
         details ? details : ""
     );
 
-    post_ctx_t* ctx = (post_ctx_t*)calloc(1, sizeof(post_ctx_t));
+    post_ctx_t* ctx = s_post_ctx_pool.acquire();
     if (!ctx) return false;
 
     const char* host_header = cfg.server_ip;
@@ -736,13 +801,13 @@ bool TCP::send_error_log(const char* message, const char* details) {
 
     ip_addr_t server_ip;
     if (!resolve_host_blocking(cfg.server_ip, &server_ip, 5000)) {
-        free(ctx);
+        s_post_ctx_pool.release(ctx);
         return false;
     }
 
     struct tcp_pcb* pcb = tcp_new();
     if (!pcb) {
-        free(ctx);
+        s_post_ctx_pool.release(ctx);
         return false;
     }
 
@@ -750,7 +815,7 @@ bool TCP::send_error_log(const char* message, const char* details) {
 
     tcp_err(pcb, [](void *arg, err_t) {
         auto *c = static_cast<post_ctx_t*>(arg);
-        if (c) { c->failed = true; c->done = true; }
+        if (c) { c->failed = true; c->done = true; c->pcb_gone = true; }
     });
 
     tcp_recv(pcb, [](void* arg, struct tcp_pcb* pcb, struct pbuf* p, err_t err) -> err_t {
@@ -763,7 +828,7 @@ bool TCP::send_error_log(const char* message, const char* details) {
 
         if (err != ERR_OK) {
             if (p) pbuf_free(p);
-            c->failed = true; c->done = true;
+            c->failed = true; c->done = true; c->pcb_gone = true;
             tcp_abort(pcb);
             return ERR_ABRT;
         }
@@ -799,7 +864,7 @@ bool TCP::send_error_log(const char* message, const char* details) {
         auto *c = static_cast<post_ctx_t*>(arg);
         if (!c) return ERR_OK;
         if (++c->poll_ticks > 20) {
-            c->failed = true; c->done = true;
+            c->failed = true; c->done = true; c->pcb_gone = true;
             tcp_abort(pcb);
             return ERR_ABRT;
         }
@@ -817,20 +882,14 @@ bool TCP::send_error_log(const char* message, const char* details) {
 
     if (result != ERR_OK) {
         tcp_abort(pcb);
-        free(ctx);
+        s_post_ctx_pool.release(ctx);
         return false;
     }
 
-    absolute_time_t deadline = make_timeout_time_ms(8000);
-    while (!time_reached(deadline) && !ctx->done) {
-        cyw43_arch_poll();
-        sys_check_timeouts();
-        sleep_ms(5);
-    }
-
-    tcp_close_or_abort(pcb, !ctx->failed);
+    tcp_wait_done(pcb, ctx, 8000);
+    if (!ctx->pcb_gone) tcp_close_or_abort(pcb, !ctx->failed);
 
     bool ok = !ctx->failed;
-    free(ctx);
+    s_post_ctx_pool.release(ctx);
     return ok;
 }
\ No newline at end of file
@@ -0,0 +1,130 @@
+/**
+ * @file test_binary_link.cpp
+ * @brief Host test for the binary CDC protocol (binary_link.cpp).
+ *
+ * Builds binary_link.cpp, config_schema.cpp and sample_queue.cpp for the host
+ * with in-memory stand-ins for the CDC TX ring and the config store, feeds
+ * request frames through binary_link_rx() and checks the replies.
+ *
+ *   make -C test
+ */
+#include <cstdio>
+#include <cstring>
+
+#include "../binary_link.hpp"
+#include "../com.hpp"
+#include "../config.hpp"
+#include "../config_schema.hpp"
+
+volatile bool wifi_apply_flag = false;
+
+static Config   s_cfg;
+static uint8_t  s_tx[4096];
+static size_t   s_tx_len = 0;
+
+bool com_write(const void* data, size_t len) {
+    if (s_tx_len + len > sizeof(s_tx)) return false;
+    std::memcpy(&s_tx[s_tx_len], data, len);
+    s_tx_len += len;
+    return true;
+}
+
+const Config& config_get() { return s_cfg; }
+Config&       config_mut() { return s_cfg; }
+static bool    s_save_ok = true;
+bool          config_save() { return s_save_ok; }
+
+static int s_failed = 0;
+
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            std::printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            s_failed++;                                                 \
+        }                                                               \
+    } while (0)
+
+static uint16_t crc16(const uint8_t* p, size_t n) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < n; ++i) {
+        crc ^= (uint16_t)p[i] << 8;
+        for (int k = 0; k < 8; ++k) crc = (crc & 0x8000u) ? (uint16_t)((crc << 1) ^ 0x1021u) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+static void send_request(FrameType type, uint8_t seq, const uint8_t* payload, uint16_t len) {
+    uint8_t f[512];
+    f[0] = BINARY_LINK_SOF;
+    f[1] = (uint8_t)type;
+    f[2] = seq;
+    f[3] = (uint8_t)len;
+    f[4] = (uint8_t)(len >> 8);
+    std::memcpy(&f[5], payload, len);
+    const uint16_t crc = crc16(&f[1], 4u + len);
+    f[5 + len] = (uint8_t)crc;
+    f[6 + len] = (uint8_t)(crc >> 8);
+    s_tx_len = 0;
+    binary_link_rx(f, 7u + len);
+}
+
+/** @brief ConfigWrite of one text block; returns the Ack status byte, or -1. */
+static int config_write(const char* lines, uint8_t flags = 0) {
+    uint8_t p[256];
+    p[0] = flags;
+    const size_t n = std::strlen(lines);
+    std::memcpy(&p[1], lines, n);
+    send_request(FrameType::ConfigWrite, 7, p, (uint16_t)(n + 1));
+    if (s_tx_len != 10 || s_tx[1] != (uint8_t)FrameType::Ack || s_tx[2] != 7) return -1;
+    return s_tx[5];
+}
+
+int main() {
+    binary_link_enter();
+    CHECK(binary_link_active());
+    CHECK(s_tx_len == 20 && s_tx[1] == (uint8_t)FrameType::Hello);
+
+    CHECK(config_write("logger_id=42\n") == (int)FieldSetResult::Ok);
+    CHECK(s_cfg.logger_id == 42);
+
+    /* Keys are case-insensitive, as on the CLI */
+    CHECK(config_write("Logger_ID=43\nSENSOR_ID=9\n") == (int)FieldSetResult::Ok);
+    CHECK(s_cfg.logger_id == 43);
+    CHECK(s_cfg.sensor_id == 9);
+
+    /* All or nothing: an unknown key leaves the config untouched */
+    CHECK(config_write("logger_id=44\nno_such_key=1\n") == (int)FieldSetResult::BadValue);
+    CHECK(s_cfg.logger_id == 43);
+
+    /* sht only takes the listed sensor models, not everything in 0..40 */
+    CHECK(config_write("sht=17\n") == (int)FieldSetResult::OutOfRange);
+    CHECK(config_write("sht=30\n") == (int)FieldSetResult::Ok);
+    CHECK(s_cfg.sht == 30);
+
+    /* CRLF line endings are tolerated, as on the CLI */
+    CHECK(config_write("logger_id=45\r\nsensor_id=10\r\n") == (int)FieldSetResult::Ok);
+    CHECK(s_cfg.logger_id == 45);
+    CHECK(s_cfg.sensor_id == 10);
+
+    /* A failed save is NAKed and leaves the previous config in place */
+    s_save_ok = false;
+    send_request(FrameType::ConfigWrite, 8, reinterpret_cast<const uint8_t*>("\x01logger_id=46\n"), 14);
+    CHECK(s_tx_len == 8 && s_tx[1] == (uint8_t)FrameType::Nak && s_tx[5] == (uint8_t)BinaryNak::SaveFailed);
+    CHECK(s_cfg.logger_id == 45);
+    s_save_ok = true;
+    CHECK(config_write("logger_id=46\n", 0x01) == (int)FieldSetResult::Ok);
+    CHECK(s_cfg.logger_id == 46);
+
+    /* Corrupted CRC is NAKed */
+    const uint8_t bad[] = { BINARY_LINK_SOF, (uint8_t)FrameType::Ping, 3, 0, 0, 0x00, 0x00 };
+    s_tx_len = 0;
+    binary_link_rx(bad, sizeof(bad));
+    CHECK(s_tx_len == 8 && s_tx[1] == (uint8_t)FrameType::Nak && s_tx[5] == (uint8_t)BinaryNak::BadCrc);
+
+    if (s_failed) {
+        std::printf("%d check(s) failed\n", s_failed);
+        return 1;
+    }
+    std::printf("binary_link: all checks passed\n");
+    return 0;
+}
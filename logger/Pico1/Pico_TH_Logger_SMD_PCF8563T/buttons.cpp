@@ -0,0 +1,146 @@
+#include "buttons.hpp"
+
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+
+struct ButtonState {
+    bool       used;
+    bool       pressed;
+    bool       long_fired;
+    uint       gpio;
+    uint32_t   long_press_ms;
+    alarm_id_t debounce_alarm;
+    alarm_id_t long_alarm;
+};
+
+static ButtonState s_buttons[BUTTON_COUNT];
+
+static ButtonEvent       s_queue[BUTTON_EVENT_QUEUE_LEN];
+static volatile uint8_t  s_q_head = 0;
+static volatile uint8_t  s_q_tail = 0;
+static volatile uint32_t s_dropped = 0;
+
+/**
+ * @brief Append an event to the queue (IRQ context, single producer).
+ *
+ * Drops and counts the event if the queue is full.
+ */
+static void __not_in_flash_func(post_event)(uint8_t index, ButtonEventType type, bool after_long) {
+    const uint8_t next = (uint8_t)((s_q_head + 1) % BUTTON_EVENT_QUEUE_LEN);
+    if (next == s_q_tail) {
+        s_dropped = s_dropped + 1;
+        return;
+    }
+    s_queue[s_q_head] = { index, type, after_long, to_ms_since_boot(get_absolute_time()) };
+    __dmb();
+    s_q_head = next;
+}
+
+/**
+ * @brief Long-press alarm: posts LongPress if the button is still held.
+ */
+static int64_t __not_in_flash_func(long_press_alarm)(alarm_id_t, void *user_data) {
+    const uint8_t index = (uint8_t)(uintptr_t)user_data;
+    ButtonState &b = s_buttons[index];
+    b.long_alarm = 0;
+    if (b.pressed && !b.long_fired) {
+        b.long_fired = true;
+        post_event(index, ButtonEventType::LongPress, true);
+    }
+    return 0;
+}
+
+/**
+ * @brief Debounce alarm: the pin has been quiet for BUTTON_DEBOUNCE_MS.
+ *
+ * Compares the settled level with the last stable state and, on a change,
+ * posts Press (and arms the long-press alarm) or Release.
+ */
+static int64_t __not_in_flash_func(debounce_alarm)(alarm_id_t, void *user_data) {
+    const uint8_t index = (uint8_t)(uintptr_t)user_data;
+    ButtonState &b = s_buttons[index];
+    b.debounce_alarm = 0;
+
+    const bool down = !gpio_get(b.gpio);
+    if (down == b.pressed) return 0;
+    b.pressed = down;
+
+    if (down) {
+        b.long_fired = false;
+        post_event(index, ButtonEventType::Press, false);
+        if (b.long_press_ms) {
+            const alarm_id_t id = add_alarm_in_ms(b.long_press_ms, long_press_alarm, user_data, true);
+            b.long_alarm = id > 0 ? id : 0;
+        }
+    } else {
+        if (b.long_alarm) cancel_alarm(b.long_alarm);
+        b.long_alarm = 0;
+        post_event(index, ButtonEventType::Release, b.long_fired);
+    }
+    return 0;
+}
+
+/**
+ * @brief GPIO edge interrupt: restart the debounce window of the button on that pin.
+ */
+static void __not_in_flash_func(button_gpio_irq)(uint gpio, uint32_t) {
+    for (uint8_t i = 0; i < BUTTON_COUNT; ++i) {
+        ButtonState &b = s_buttons[i];
+        if (!b.used || b.gpio != gpio) continue;
+        if (b.debounce_alarm) cancel_alarm(b.debounce_alarm);
+        const alarm_id_t id = add_alarm_in_ms(BUTTON_DEBOUNCE_MS, debounce_alarm,
+                                              (void *)(uintptr_t)i, true);
+        b.debounce_alarm = id > 0 ? id : 0;
+        return;
+    }
+}
+
+/**
+ * @brief Configure a button pin (input, pull-up, both-edge IRQ) and start tracking it.
+ *
+ * The initial level is taken as the stable state, so a button held during boot
+ * produces no Press until it is released and pressed again.
+ *
+ * @param index         Slot 0..BUTTON_COUNT-1, reported in ButtonEvent::button.
+ * @param gpio          Pin number.
+ * @param long_press_ms Hold time for LongPress; 0 disables it.
+ * @return false if index is out of range.
+ */
+bool buttons_add(uint8_t index, uint gpio, uint32_t long_press_ms) {
+    if (index >= BUTTON_COUNT) return false;
+
+    gpio_init(gpio);
+    gpio_set_dir(gpio, GPIO_IN);
+    gpio_pull_up(gpio);
+    sleep_us(10);
+
+    ButtonState &b = s_buttons[index];
+    b.gpio = gpio;
+    b.long_press_ms = long_press_ms;
+    b.pressed = !gpio_get(gpio);
+    b.long_fired = b.pressed;
+    b.debounce_alarm = 0;
+    b.long_alarm = 0;
+    b.used = true;
+
+    gpio_set_irq_enabled_with_callback(gpio, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true, &button_gpio_irq);
+    return true;
+}
+
+/**
+ * @brief Take the oldest pending event.
+ *
+ * @param out Receives the event.
+ * @return false if no event is pending.
+ */
+bool buttons_next_event(ButtonEvent &out) {
+    const uint8_t tail = s_q_tail;
+    if (tail == s_q_head) return false;
+    __dmb();
+    out = s_queue[tail];
+    s_q_tail = (uint8_t)((tail + 1) % BUTTON_EVENT_QUEUE_LEN);
+    return true;
+}
+
+/** @return Events dropped because the queue was full. */
+uint32_t buttons_dropped_events() { return s_dropped; }
@@ -0,0 +1,50 @@
+/**
+ * @file circuit_breaker.hpp
+ * @brief Circuit breaker with exponential backoff in front of the backend uploads.
+ *
+ * Every upload (token fetch + POST) can block the main loop for several seconds
+ * when the backend is unreachable. The breaker stops the firmware from repeating
+ * that on every post tick during an outage:
+ * - Closed:   requests go through. CIRCUIT_BREAKER_THRESHOLD consecutive failures
+ *             open the circuit.
+ * - Open:     requests are refused without touching the network until the backoff
+ *             has elapsed; the caller keeps its samples in sample_queue meanwhile.
+ * - HalfOpen: after the backoff exactly one probe request is let through. Success
+ *             closes the circuit (and the queued backlog drains); failure opens it
+ *             again with twice the backoff.
+ *
+ * Backoff:
+ * - CIRCUIT_BREAKER_BASE_MS doubled per consecutive trip, capped at
+ *   CIRCUIT_BREAKER_MAX_MS, with "equal jitter": the actual wait is uniformly
+ *   distributed in [d/2, d], so a fleet that lost the backend together does not
+ *   come back in lockstep.
+ * - A Retry-After (delta-seconds) from the server is honoured: the wait is never
+ *   shorter than what the server asked for (capped at CIRCUIT_BREAKER_MAX_MS).
+ *
+ * Thread-safety:
+ * - Not thread-safe; use from the main loop only.
+ */
+#pragma once
+#ifndef __CIRCUIT_BREAKER_HPP__
+#define __CIRCUIT_BREAKER_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CIRCUIT_BREAKER_THRESHOLD   3
+#define CIRCUIT_BREAKER_BASE_MS     30000u
+#define CIRCUIT_BREAKER_MAX_MS      (30u * 60u * 1000u)
+
+enum class BreakerState : uint8_t {
+    Closed   = 0,
+    Open     = 1,
+    HalfOpen = 2,
+};
+
+bool         circuit_breaker_allow(uint32_t now_ms);
+void         circuit_breaker_on_success();
+void         circuit_breaker_on_failure(uint32_t now_ms, uint32_t retry_after_s);
+BreakerState circuit_breaker_state();
+void         circuit_breaker_status_line(char* out, size_t len, uint32_t now_ms);
+
+#endif /* __CIRCUIT_BREAKER_HPP__ */
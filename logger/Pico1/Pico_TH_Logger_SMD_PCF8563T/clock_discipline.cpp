@@ -0,0 +1,250 @@
+#include "clock_discipline.hpp"
+
+#include <math.h>
+
+#include "pico/stdlib.h"
+
+/**
+ * Minimum span (seconds of raw RTC time) between the oldest and newest sample
+ * before a frequency error is fitted. The RTC has a 1 s resolution, so shorter
+ * baselines would turn quantization noise into hundreds of ppm of fake drift.
+ */
+static constexpr double CLOCK_MIN_FIT_SPAN_S = 6.0 * 3600.0;
+
+/** Sanity bound for the fitted frequency error (fraction, i.e. 500 ppm). */
+static constexpr double CLOCK_MAX_FREQ_ERR   = 500e-6;
+
+struct ClockSample {
+    double raw;
+    double offset;
+};
+
+static ClockSample s_samples[CLOCK_MAX_SAMPLES];
+static uint8_t     s_count = 0;
+static uint8_t     s_head  = 0;
+
+static int64_t  s_step_total   = 0;
+static double   s_fit_offset   = 0.0;
+static double   s_fit_freq     = 0.0;
+static double   s_fit_ref      = 0.0;
+static bool     s_valid        = false;
+
+static double   s_applied      = 0.0;
+static uint64_t s_last_apply_us = 0;
+static uint32_t s_interval_ms  = CLOCK_SYNC_MIN_MS;
+
+static double   s_sync_net     = 0.0;
+static uint64_t s_sync_us      = 0;
+
+/**
+ * @brief Predict the network-minus-raw offset for a given raw RTC time.
+ *
+ * Evaluates the linear drift model offset(raw) = a + f * (raw - ref), where a is
+ * the mean offset of the retained samples, f the fitted fractional frequency
+ * error and ref the mean raw time of the samples.
+ *
+ * @param raw Raw (step-compensated) RTC time in seconds since the epoch.
+ * @return Predicted offset in seconds to add to raw to obtain network time.
+ */
+static double predict_offset(double raw) {
+    return s_fit_offset + s_fit_freq * (raw - s_fit_ref);
+}
+
+/**
+ * @brief Refit the drift model over the retained samples.
+ *
+ * Uses an ordinary least-squares line through (raw, offset) pairs. The slope is
+ * only accepted when the samples span at least CLOCK_MIN_FIT_SPAN_S; otherwise
+ * the previously fitted frequency error is kept and only the offset is updated.
+ * The slope is clamped to +/- CLOCK_MAX_FREQ_ERR to reject outliers.
+ */
+static void refit() {
+    double mean_raw = 0.0, mean_off = 0.0;
+    double min_raw = s_samples[0].raw, max_raw = s_samples[0].raw;
+    for (uint8_t i = 0; i < s_count; ++i) {
+        mean_raw += s_samples[i].raw;
+        mean_off += s_samples[i].offset;
+        if (s_samples[i].raw < min_raw) min_raw = s_samples[i].raw;
+        if (s_samples[i].raw > max_raw) max_raw = s_samples[i].raw;
+    }
+    mean_raw /= s_count;
+    mean_off /= s_count;
+
+    double freq = s_fit_freq;
+    if (s_count >= 2 && (max_raw - min_raw) >= CLOCK_MIN_FIT_SPAN_S) {
+        double sxx = 0.0, sxy = 0.0;
+        for (uint8_t i = 0; i < s_count; ++i) {
+            double dx = s_samples[i].raw - mean_raw;
+            sxx += dx * dx;
+            sxy += dx * (s_samples[i].offset - mean_off);
+        }
+        if (sxx > 0.0) freq = sxy / sxx;
+        if (freq >  CLOCK_MAX_FREQ_ERR) freq =  CLOCK_MAX_FREQ_ERR;
+        if (freq < -CLOCK_MAX_FREQ_ERR) freq = -CLOCK_MAX_FREQ_ERR;
+    }
+
+    s_fit_ref    = mean_raw;
+    s_fit_offset = mean_off;
+    s_fit_freq   = freq;
+}
+
+/**
+ * @brief Forget all samples and return to the unsynchronized state.
+ *
+ * After a reset clock_discipline_apply() returns RTC time unchanged and the
+ * sync interval restarts at CLOCK_SYNC_MIN_MS.
+ */
+void clock_discipline_reset() {
+    s_count = 0;
+    s_head  = 0;
+    s_step_total = 0;
+    s_fit_offset = 0.0;
+    s_fit_freq   = 0.0;
+    s_fit_ref    = 0.0;
+    s_valid      = false;
+    s_applied    = 0.0;
+    s_last_apply_us = 0;
+    s_interval_ms   = CLOCK_SYNC_MIN_MS;
+    s_sync_net      = 0.0;
+    s_sync_us       = 0;
+}
+
+/**
+ * @brief Record a network time sample and update the drift model.
+ *
+ * Behavior:
+ * - Converts the RTC reading to raw time and stores (raw, net - raw) in a ring of
+ *   CLOCK_MAX_SAMPLES entries, then refits the model.
+ * - Compares the new sample with the prediction of the previous model. When the
+ *   prediction error stays within CLOCK_SYNC_TOL_S the sync interval doubles,
+ *   otherwise it shrinks proportionally (bounded by CLOCK_SYNC_MIN_MS/MAX_MS).
+ * - On the very first sample the applied correction is set directly, because
+ *   there is no earlier timeline to stay continuous with.
+ *
+ * @param rtc_epoch RTC reading (as Unix epoch) taken when the network reply arrived.
+ * @param net_epoch Network time in seconds since the epoch (fractional part allowed).
+ * @return true if the RTC is at least CLOCK_RTC_STEP_S away from network time and
+ *         should be rewritten; disciplined timestamps stay continuous either way.
+ */
+bool clock_discipline_on_sync(time_t rtc_epoch, double net_epoch) {
+    const double raw    = (double)((int64_t)rtc_epoch - s_step_total);
+    const double offset = net_epoch - raw;
+
+    if (s_valid) {
+        double err = fabs(offset - predict_offset(raw));
+        uint64_t next = s_interval_ms;
+        if (err <= CLOCK_SYNC_TOL_S) {
+            next *= 2u;
+        } else {
+            next = (uint64_t)((double)next * (CLOCK_SYNC_TOL_S / err));
+        }
+        if (next < CLOCK_SYNC_MIN_MS) next = CLOCK_SYNC_MIN_MS;
+        if (next > CLOCK_SYNC_MAX_MS) next = CLOCK_SYNC_MAX_MS;
+        s_interval_ms = (uint32_t)next;
+    }
+
+    s_sync_net = net_epoch;
+    s_sync_us  = time_us_64();
+
+    s_samples[s_head] = { raw, offset };
+    s_head = (uint8_t)((s_head + 1) % CLOCK_MAX_SAMPLES);
+    if (s_count < CLOCK_MAX_SAMPLES) s_count++;
+    refit();
+
+    if (!s_valid) {
+        s_applied = predict_offset(raw);
+        s_last_apply_us = time_us_64();
+        s_valid = true;
+    }
+
+    return fabs(net_epoch - (double)rtc_epoch) >= CLOCK_RTC_STEP_S;
+}
+
+/**
+ * @brief Inform the model that the RTC has been rewritten.
+ *
+ * Must be called after a successful RTC write that followed a true result from
+ * clock_discipline_on_sync(), so raw time stays continuous across the step.
+ *
+ * @param delta_s New RTC time minus old RTC time, in whole seconds.
+ */
+void clock_discipline_rtc_stepped(int32_t delta_s) {
+    s_step_total += delta_s;
+}
+
+/**
+ * @brief Convert an RTC reading into a disciplined Unix timestamp.
+ *
+ * The applied correction moves toward the model prediction by at most
+ * CLOCK_SLEW_MAX_PPM of the elapsed monotonic time, so consecutive timestamps
+ * never jump. Errors larger than CLOCK_STEP_LIMIT_S (e.g. after a long outage
+ * with a badly drifting crystal) are applied at once.
+ *
+ * @param rtc_epoch RTC reading as a Unix epoch.
+ * @return Disciplined epoch, or rtc_epoch unchanged before the first sync.
+ */
+time_t clock_discipline_apply(time_t rtc_epoch) {
+    if (!s_valid) return rtc_epoch;
+
+    const double raw    = (double)((int64_t)rtc_epoch - s_step_total);
+    const double target = predict_offset(raw);
+    const uint64_t now_us = time_us_64();
+    const double elapsed_s = (double)(now_us - s_last_apply_us) / 1e6;
+    s_last_apply_us = now_us;
+
+    double diff = target - s_applied;
+    if (fabs(diff) > CLOCK_STEP_LIMIT_S) {
+        s_applied = target;
+    } else {
+        double max_step = elapsed_s * CLOCK_SLEW_MAX_PPM * 1e-6;
+        if (diff >  max_step) diff =  max_step;
+        if (diff < -max_step) diff = -max_step;
+        s_applied += diff;
+    }
+    return (time_t)llround(raw + s_applied);
+}
+
+/** @return true once at least one network time sample has been recorded. */
+bool clock_discipline_valid() { return s_valid; }
+
+/**
+ * @brief Estimated RTC frequency error.
+ * @return Drift in ppm; positive values mean the RTC runs fast.
+ */
+float clock_discipline_ppm() { return (float)(-s_fit_freq * 1e6); }
+
+/** @return Delay in milliseconds until the next network time sync is due. */
+uint32_t clock_discipline_next_sync_ms() { return s_interval_ms; }
+
+/**
+ * @brief Convert RTC wall-clock fields (local time, CET/CEST) to a Unix epoch.
+ *
+ * mktime() runs with tm_isdst = -1 so the C library decides whether daylight
+ * saving applies; a zeroed tm_isdst would read every summer time RTC value as
+ * standard time, one hour late. In the hour repeated at the end of DST the
+ * fields are ambiguous: when near_epoch is given, the standard or daylight
+ * reading closest to it is used, so a network sync in that hour never sees a
+ * DST offset as RTC error (a step or drift). Without near_epoch the last
+ * network sync plus the monotonic time since then is used, once there is one.
+ *
+ * @param fields     RTC date/time; tm_isdst and tm_wday are ignored. Not modified.
+ * @param near_epoch Reference time (e.g. the network time being compared), or 0.
+ * @return Seconds since the epoch, or (time_t)-1 on failure.
+ */
+time_t clock_rtc_local_to_epoch(const struct tm* fields, double near_epoch) {
+    struct tm t = *fields;
+    t.tm_isdst = -1;
+    time_t best = mktime(&t);
+    if (near_epoch <= 0.0 && s_valid) near_epoch = s_sync_net + (double)(time_us_64() - s_sync_us) / 1e6;
+    if (near_epoch <= 0.0) return best;
+
+    for (int dst = 0; dst <= 1; ++dst) {
+        t = *fields;
+        t.tm_isdst = dst;
+        const time_t e = mktime(&t);
+        /* A wrong DST guess is normalized to another hour; skip it */
+        if (e == (time_t)-1 || t.tm_isdst != dst || t.tm_hour != fields->tm_hour) continue;
+        if (best == (time_t)-1 || fabs((double)e - near_epoch) < fabs((double)best - near_epoch)) best = e;
+    }
+    return best;
+}
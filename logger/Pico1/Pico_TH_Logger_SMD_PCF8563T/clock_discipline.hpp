@@ -0,0 +1,63 @@
+/**
+ * @file clock_discipline.hpp
+ * @brief Drift model for the PCF8563T RTC disciplined against network time.
+ *
+ * The PCF8563T crystal drifts freely between network time synchronizations.
+ * Instead of hard-setting the RTC on every SNTP reply (which makes logged
+ * timestamps jump), this module records the RTC-versus-network offset at each
+ * sync and fits a linear model (offset + frequency error in ppm) over the most
+ * recent samples.
+ *
+ * Time bases:
+ * - rtc epoch : seconds read from the PCF8563T and converted to a Unix epoch.
+ * - raw epoch : rtc epoch minus all RTC steps applied so far. This is the free
+ *               running oscillator time and stays continuous when the RTC is set.
+ * - disciplined epoch : raw epoch plus the applied correction. The applied
+ *               correction slews toward the model prediction at a bounded rate,
+ *               so timestamps never jump once the first sync has been taken.
+ *
+ * Usage Pattern:
+ * 1. On every network time sample call clock_discipline_on_sync() with the RTC
+ *    reading taken at the same instant. If it returns true the caller should
+ *    write the network time into the RTC and report the applied delta through
+ *    clock_discipline_rtc_stepped().
+ * 2. Convert every RTC reading through clock_discipline_apply() before it is
+ *    displayed or uploaded.
+ * 3. Schedule the next synchronization after clock_discipline_next_sync_ms().
+ *
+ * Tuning:
+ * - CLOCK_SLEW_MAX_PPM   : maximum rate at which the applied correction may change.
+ * - CLOCK_STEP_LIMIT_S   : correction errors larger than this are stepped, not slewed.
+ * - CLOCK_RTC_STEP_S     : RTC is rewritten only when it is this far from network time.
+ * - CLOCK_SYNC_TOL_S     : prediction error tolerated before the sync interval shrinks.
+ * - CLOCK_SYNC_MIN_MS / CLOCK_SYNC_MAX_MS : bounds of the adaptive sync interval.
+ *
+ * Thread-safety:
+ * - Not thread-safe; call from the main loop / network callback context only.
+ */
+#pragma once
+#ifndef __CLOCK_DISCIPLINE_HPP__
+#define __CLOCK_DISCIPLINE_HPP__
+
+#include <stdint.h>
+#include <time.h>
+
+#define CLOCK_SLEW_MAX_PPM      5000.0
+#define CLOCK_STEP_LIMIT_S      120.0
+#define CLOCK_RTC_STEP_S        2.0
+#define CLOCK_SYNC_TOL_S        1.0
+#define CLOCK_SYNC_MIN_MS       (60u * 60u * 1000u)
+#define CLOCK_SYNC_MAX_MS       (24u * 60u * 60u * 1000u)
+#define CLOCK_MAX_SAMPLES       8
+
+void     clock_discipline_reset();
+bool     clock_discipline_on_sync(time_t rtc_epoch, double net_epoch);
+void     clock_discipline_rtc_stepped(int32_t delta_s);
+time_t   clock_discipline_apply(time_t rtc_epoch);
+bool     clock_discipline_valid();
+float    clock_discipline_ppm();
+uint32_t clock_discipline_next_sync_ms();
+
+time_t   clock_rtc_local_to_epoch(const struct tm* fields, double near_epoch);
+
+#endif /* __CLOCK_DISCIPLINE_HPP__ */
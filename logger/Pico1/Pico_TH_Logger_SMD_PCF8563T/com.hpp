@@ -4,7 +4,18 @@
  *
  * Declares the non-blocking poll routine for the communication layer,
  * a query for whether the initial "ready" banner has been transmitted,
- * and the TinyUSB CDC receive callback.
+ * the TinyUSB CDC receive callback, and the CDC output queue.
+ *
+ * Output:
+ * - All console output goes through a COM_TX_RING_SIZE byte ring that com_poll()
+ *   drains into the TinyUSB FIFO as endpoint space becomes free; writers never wait
+ *   for the host. A write that does not fit is dropped whole and counted
+ *   (com_tx_dropped_lines() / com_tx_dropped_bytes()), and a "TX_DROPPED <n>" line
+ *   marks the gap in the stream.
+ * - com_write_str() queues text from other modules; com_write() queues raw bytes
+ *   (binary frames, see binary_link.hpp) whole or not at all; com_tx_free() lets
+ *   producers that must not lose data (stream.hpp) wait for room; com_tx_flush() waits
+ *   (bounded) for the queue to empty, for use right before a reboot.
  *
  * Include this header in application code integrating with TinyUSB.
  * Unless noted otherwise, functions are intended to be called from the main loop.
@@ -30,7 +41,7 @@
  * @brief TinyUSB CDC receive callback.
  *
  * Invoked by TinyUSB when new data is available on a CDC interface.
- * Keep the implementation short; defer heavy processing to com_poll().
+ * Only flags pending input (RAM-resident); parsing runs in com_poll().
  *
  * @param itf CDC interface number that received data.
  * @warning Typically called from TinyUSB context (ISR or TinyUSB task, depending on configuration);
@@ -44,8 +55,16 @@
 #include <cstddef>
 #include <cstdint>
 
-void com_poll();
-bool com_ready_banner_sent();
+#define COM_TX_RING_SIZE    4096u
+
+void     com_poll();
+bool     com_ready_banner_sent();
+void     com_write_str(const char* s);
+bool     com_write(const void* data, size_t len);
+size_t   com_tx_free();
+void     com_tx_flush(uint32_t timeout_ms);
+uint32_t com_tx_dropped_lines();
+uint32_t com_tx_dropped_bytes();
 
 extern "C" void tud_cdc_rx_cb(uint8_t);
 
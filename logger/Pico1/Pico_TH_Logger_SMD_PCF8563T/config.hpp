@@ -36,9 +36,34 @@
  * Timing:
  * - post_time_ms: Interval (milliseconds) between successive data posts / uploads.
  *
+ * Time Synchronization:
+ * - ntp_servers[CONFIG_NTP_SERVERS][64]: Null-terminated NTP server hostnames or IPs, queried
+ *   in parallel by the SNTP client (empty entries are skipped). Typically one local on-site
+ *   server plus public fallbacks.
+ *
+ * Wi-Fi Fast Reconnect Cache (written by the firmware, not by the user):
+ * - wifi_bssid[6], wifi_channel: Access point and channel of the last successful association;
+ *   used for a targeted join that skips the scan. wifi_channel == 0 means "no cache".
+ * - wifi_ip, wifi_netmask, wifi_gateway: Last DHCP lease (IPv4, network byte order), applied
+ *   to the interface on a cold start so the link is usable while DHCP confirms it.
+ *
  * Integrity:
  * - crc32: 32-bit CRC over the preceding bytes of the structure for corruption detection.
  *
+ * Storage (config journal):
+ * - The last four flash sectors form an append-only ring of records. Each save programs one
+ *   new record (header with magic, sequence number, length and CRC, followed by the full Config
+ *   image) into the next free page-aligned slot; nothing is rewritten in place.
+ * - A sector is erased only when the write position enters it. Since every record is a full
+ *   snapshot, the sector being erased holds only superseded records, which makes the erase the
+ *   garbage collection step and leaves the newest record intact.
+ * - Flash operations run through flash_safe_execute(), which keeps the other core out of XIP.
+ *   config_save() must only be called from main-loop context (not from IRQs or USB callbacks);
+ *   code that must not stall uses config_request_save() instead.
+ * - Loading picks the valid record with the highest sequence number, so a save interrupted by
+ *   a reset falls back to the previous one. Images written by older firmware (a single Config at
+ *   the start of the last sector) are still read and migrated when the journal is empty.
+ *
  * API Functions:
  * - config_init(): Initialize configuration subsystem; typically loads from storage, or sets defaults if invalid.
  * - config_load(): Attempt to load configuration from persistent storage. Returns true on success.
@@ -46,6 +71,10 @@
  * - config_set_defaults(): Populate the in-memory configuration with safe factory defaults (does not auto-save unless policy dictates).
  * - config_get(): Obtain a const reference to the active configuration (read-only access).
  * - config_mut(): Obtain a mutable reference to the active configuration (callers must invoke config_save() after modifications to persist).
+ * - config_request_save(): Mark the configuration dirty; config_commit_tick() (main loop) saves
+ *   it after a short hold-off, coalescing bursts of changes into one flash write.
+ * - config_update_wifi_cache(): Update the Wi-Fi fast reconnect cache in RAM and in flash without
+ *   persisting any other pending (unsaved) edits; writes flash only if the cache changed.
  *
  * ConfigSource Enumeration:
  * - Unknown: The origin of the current configuration cannot be determined (e.g. before init).
@@ -69,6 +98,8 @@
  *
  * Extensibility Guidelines:
  * - When adding new fields, increment version and preserve ordering to avoid breaking existing images.
+ * - Describe every user-visible field in CONFIG_FIELDS (config_schema.hpp); CLI parsing, show
+ *   output, defaults and migration from older layouts are generated from that table.
  * - Keep alignment predictable; if changing layout, consider forward/backward migration strategies.
  *
  * Safety:
@@ -81,6 +112,7 @@
 
 #include <stdint.h>
 
+#define CONFIG_NTP_SERVERS  3
 
 struct Config {
     uint32_t magic;
@@ -105,6 +137,17 @@ struct Config {
     char     wifi_ssid[33];
     char     wifi_password[65];
     uint32_t post_time_ms;
+
+    // Time synchronization
+    char     ntp_servers[CONFIG_NTP_SERVERS][64];
+
+    // Wi-Fi fast reconnect cache
+    uint8_t  wifi_bssid[6];
+    uint8_t  wifi_channel;
+    uint8_t  wifi_cache_reserved;
+    uint32_t wifi_ip;
+    uint32_t wifi_netmask;
+    uint32_t wifi_gateway;
     uint32_t crc32;
 };
 
@@ -112,6 +155,10 @@ void        config_init();
 bool        config_load();
 bool        config_save();
 void        config_set_defaults();
+void        config_request_save();
+bool        config_commit_tick();
+bool        config_update_wifi_cache(const uint8_t bssid[6], uint8_t channel,
+                                     uint32_t ip, uint32_t netmask, uint32_t gateway);
 
 const Config& config_get();
 Config&       config_mut();
@@ -0,0 +1,82 @@
+#include "mem_pool.hpp"
+
+#include <malloc.h>
+
+#include "pico/stdlib.h"
+
+static MemPoolInfo* s_pools[MEM_POOL_MAX];
+static size_t       s_pool_count = 0;
+
+static volatile bool s_heap_locked = false;
+static volatile bool s_heap_bypass = false;
+
+/**
+ * @brief Add a pool to the "mem" report.
+ *
+ * Called from the ObjectPool / StaticSlot constructors during static
+ * initialization; the registry itself is constant-initialized, so the order of
+ * translation units does not matter. Pools beyond MEM_POOL_MAX still work but
+ * are not reported.
+ *
+ * @param info Pool statistics (must outlive the program).
+ */
+void mem_pool_register(MemPoolInfo* info) {
+    if (s_pool_count < MEM_POOL_MAX) s_pools[s_pool_count++] = info;
+}
+
+/** @return Number of registered pools. */
+size_t mem_pool_count() { return s_pool_count; }
+
+/**
+ * @param index 0..mem_pool_count()-1, in registration order.
+ * @return Pool statistics, or nullptr if index is out of range.
+ */
+const MemPoolInfo* mem_pool_at(size_t index) {
+    return index < s_pool_count ? s_pools[index] : nullptr;
+}
+
+/**
+ * @brief Mark the end of start-up; with LOGGER_HEAP_GUARD any later heap call panics.
+ */
+void mem_heap_lock() { s_heap_locked = true; }
+
+/** @return true if this is a LOGGER_HEAP_GUARD build. */
+bool mem_heap_guarded() {
+#if LOGGER_HEAP_GUARD
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Report newlib heap usage (bytes obtained from sbrk and bytes in use).
+ *
+ * mallinfo() takes the malloc lock itself, so the guard is bypassed for the call.
+ *
+ * @param arena_bytes Receives the total heap size obtained so far.
+ * @param used_bytes  Receives the bytes currently allocated.
+ * @return true (kept as a status for symmetry with the other query functions).
+ */
+bool mem_heap_stats(uint32_t& arena_bytes, uint32_t& used_bytes) {
+    s_heap_bypass = true;
+    const struct mallinfo mi = mallinfo();
+    s_heap_bypass = false;
+    arena_bytes = (uint32_t)mi.arena;
+    used_bytes = (uint32_t)mi.uordblks;
+    return true;
+}
+
+#if LOGGER_HEAP_GUARD
+/**
+ * @brief newlib malloc lock hook: every malloc/free/realloc passes through here.
+ *
+ * Overrides the (no-op) newlib default; panics once mem_heap_lock() was called.
+ */
+extern "C" void __malloc_lock(struct _reent*) {
+    if (s_heap_locked && !s_heap_bypass) panic("heap use after init");
+}
+
+/** @brief Counterpart of __malloc_lock(); nothing to release. */
+extern "C" void __malloc_unlock(struct _reent*) {}
+#endif
@@ -0,0 +1,41 @@
+/**
+ * @file net_stats.hpp
+ * @brief Network memory and protocol statistics for the "netstats" console command.
+ *
+ * Two sources are reported:
+ * - lwIP's own counters (lwip_stats): the MEM_SIZE heap, every memp pool (used,
+ *   high-water mark, allocation failures), link, TCP and UDP packet and error
+ *   counters. They exist only in the instrumentation build (CMake option
+ *   LOGGER_NET_STATS=ON, which turns on MEM_STATS / MEMP_STATS / LINK_STATS in
+ *   lwipopts.h); otherwise the report says stats=0 and skips them.
+ * - Counters kept by the firmware in every build: TCP retransmissions seen on the
+ *   client connections (tcp.cpp samples pcb->nrtx while it waits for a reply) and
+ *   requests that hit their deadline.
+ *
+ * The first report line also shows the memory profile the image was built with
+ * (LOGGER_NET_PROFILE, see lwipopts.h) and its key sizes, so a capture of
+ * "netstats" after a soak run is enough to right-size MEM_SIZE, PBUF_POOL_SIZE
+ * and TCP_SND_BUF against the measured peaks.
+ *
+ * Output format (one record per line, terminated by NETSTATS_END):
+ *   NET profile=<name> stats=<0|1> mem_size=.. pbuf_pool=.. snd_buf=.. wnd=.. tcp_seg=.. rexmit=.. timeouts=..
+ *   LWIP_MEM used=.. peak=.. avail=.. err=..
+ *   MEMP name=<pool> used=.. peak=.. avail=.. err=..
+ *   LINK|TCP|UDP xmit=.. recv=.. drop=.. memerr=.. rterr=.. err=..
+ *
+ * Thread-safety:
+ * - Not thread-safe; use from the main loop only (lwIP runs in poll mode there).
+ */
+#pragma once
+#ifndef __NET_STATS_HPP__
+#define __NET_STATS_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+
+void net_stats_track_rexmit(uint8_t nrtx, uint8_t& seen);
+void net_stats_note_timeout();
+void net_stats_report(void (*emit)(const char* line));
+void net_stats_reset();
+
+#endif /* __NET_STATS_HPP__ */
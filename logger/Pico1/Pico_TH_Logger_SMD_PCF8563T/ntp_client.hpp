@@ -0,0 +1,61 @@
+/**
+ * @file ntp_client.hpp
+ * @brief Non-blocking multi-server SNTP client built on the lwIP raw UDP API.
+ *
+ * Replaces the lwIP SNTP app (single server, blocking wait in the caller). Each
+ * synchronization round queries every NTP server configured in Config::ntp_servers
+ * in parallel (typically a local on-site server plus public fallbacks), collects
+ * the replies within NTP_ROUND_TIMEOUT_MS and selects one answer.
+ *
+ * Selection:
+ * - Replies are validated (server mode, leap indicator not "unsynchronized",
+ *   stratum 1..15, originate timestamp echoing our request).
+ * - Round-trip time is computed as (t4 - t1) - (T3 - T2), using the monotonic
+ *   microsecond timer for the client side, and the network time at arrival as
+ *   T3 + RTT / 2.
+ * - An answer is consistent if it agrees within NTP_AGREE_S with at least half
+ *   of all answers (itself included). Among consistent answers the lowest RTT wins.
+ *
+ * Background retry:
+ * - Consecutive failed rounds are counted; ntp_client_retry_ms() returns an
+ *   exponentially growing delay between NTP_RETRY_MIN_MS and NTP_RETRY_MAX_MS.
+ *
+ * Usage Pattern:
+ * 1. Start a round with ntp_client_start() once the network is up.
+ * 2. Call ntp_client_poll() from the main loop; it returns NtpStatus::Synced or
+ *    NtpStatus::Failed exactly once when the round finishes.
+ * 3. After Synced, read the selected time with ntp_client_time_now().
+ * 4. Call ntp_client_stop() before cyw43_arch_deinit(); lwIP is re-initialized on
+ *    the next cyw43_arch_init() and the UDP PCB would otherwise dangle.
+ *
+ * Thread-safety:
+ * - Not thread-safe; call from the main loop (cyw43 poll mode) only.
+ */
+#pragma once
+#ifndef __NTP_CLIENT_HPP__
+#define __NTP_CLIENT_HPP__
+
+#include <stdint.h>
+
+#define NTP_ROUND_TIMEOUT_MS    5000u
+#define NTP_AGREE_S             0.5
+#define NTP_RETRY_MIN_MS        (15u * 1000u)
+#define NTP_RETRY_MAX_MS        (30u * 60u * 1000u)
+
+enum class NtpStatus : uint8_t {
+    Idle   = 0,
+    Busy   = 1,
+    Synced = 2,
+    Failed = 3,
+};
+
+bool      ntp_client_start();
+NtpStatus ntp_client_poll();
+void      ntp_client_stop();
+bool      ntp_client_busy();
+double    ntp_client_time_now();
+uint32_t  ntp_client_rtt_ms();
+int       ntp_client_server();
+uint32_t  ntp_client_retry_ms();
+
+#endif /* __NTP_CLIENT_HPP__ */
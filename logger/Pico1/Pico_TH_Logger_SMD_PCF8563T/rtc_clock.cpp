@@ -53,35 +53,27 @@ static inline uint8_t bcd2dec(uint8_t val) { return ((val >> 4) * 10) + (val & 0
 /**
  * @brief Portable equivalent of timegm: convert a UTC broken-down time to time_t.
  *
- * Temporarily sets the process time zone to UTC ("TZ=UTC0"), calls mktime(3) to
- * interpret the provided struct tm as UTC, then restores the original time zone.
+ * Pure arithmetic (days-from-civil on the proleptic Gregorian calendar), so unlike
+ * the previous TZ=UTC0 + mktime(3) approach it neither touches the TZ environment
+ * variable nor allocates memory (setenv/tzset reallocate the zone strings).
+ * Fields are not normalized; tm_mon must be 0..11.
  *
- * @param t Pointer to a struct tm representing a UTC time. The structure may be
- *          normalized/modified by mktime (e.g., fields adjusted, tm_isdst set).
+ * @param t Pointer to a struct tm representing a UTC time. Not modified.
  *
- * @return Seconds since the Unix epoch (UTC) on success; (time_t)-1 on failure
- *         if the time cannot be represented.
+ * @return Seconds since the Unix epoch (UTC).
  *
- * @note Not thread-safe or async-signal-safe: it modifies process-global state
- *       (the TZ environment variable) and calls tzset(3). Prefer native timegm(3)
- *       where available. The argument must not be null.
+ * @note Reentrant. The argument must not be null.
  */
 static time_t timegm_compat(struct tm* t) {
-    const char* old_tz = getenv("TZ");
-    if (old_tz) old_tz = strdup(old_tz);
-
-    setenv("TZ", "UTC0", 1);
-    tzset();
-    time_t epoch = mktime(t);
-
-    if (old_tz) {
-        setenv("TZ", old_tz, 1);
-        free((void*)old_tz);
-    } else {
-        unsetenv("TZ");
-    }
-    tzset();
-    return epoch;
+    int64_t y = (int64_t)t->tm_year + 1900;
+    const int64_t m = t->tm_mon + 1;
+    y -= (m <= 2);
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const int64_t yoe = y - era * 400;
+    const int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + t->tm_mday - 1;
+    const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    const int64_t days = era * 146097 + doe - 719468;
+    return (time_t)(days * 86400 + t->tm_hour * 3600 + t->tm_min * 60 + t->tm_sec);
 }
 
 /**
@@ -425,7 +417,7 @@ bool pcf8563t_set_time_epoch(i2c_inst_t* i2c, time_t epoch_utc, bool as_local) {
  * @param out_epoch_utc     Output pointer that receives the resulting Unix epoch (UTC).
  *                          Must not be null. Updated only on success.
  * @param fields_are_local  If true, interpret the RTC fields as local time and convert
- *                          using mktime() (affected by the process time zone/DST settings).
+ *                          using mktime() with tm_isdst = -1 (the process time zone decides DST).
  *                          If false, interpret the RTC fields as UTC and convert using
  *                          timegm_compat(). In both cases, the returned epoch is UTC.
  *
@@ -467,6 +459,7 @@ bool pcf8563t_read_time_epoch(i2c_inst_t* i2c, time_t* out_epoch_utc, bool field
     tmv.tm_min  = (int)t[1];
     tmv.tm_sec  = (int)t[0];
     tmv.tm_wday = (int)t[4];
+    tmv.tm_isdst = -1;
 
     time_t epoch = fields_are_local ? mktime(&tmv) : timegm_compat(&tmv);
     if (epoch == (time_t)-1) return false;
@@ -0,0 +1,64 @@
+#include "sample_queue.hpp"
+
+static QueuedSample s_ring[SAMPLE_QUEUE_LEN];
+static uint16_t     s_head    = 0;
+static uint16_t     s_count   = 0;
+static uint32_t     s_dropped = 0;
+
+/**
+ * @brief Append a sample, overwriting the oldest one when the queue is full.
+ *
+ * @param s Sample to store (copied).
+ * @return true if stored without loss; false if the oldest sample was dropped
+ *         to make room.
+ */
+bool sample_queue_push(const QueuedSample &s) {
+    bool lossless = true;
+    if (s_count == SAMPLE_QUEUE_LEN) {
+        s_head = (uint16_t)((s_head + 1) % SAMPLE_QUEUE_LEN);
+        s_count--;
+        s_dropped++;
+        lossless = false;
+    }
+    s_ring[(s_head + s_count) % SAMPLE_QUEUE_LEN] = s;
+    s_count++;
+    return lossless;
+}
+
+/**
+ * @brief Copy the oldest queued sample without removing it.
+ *
+ * @param out Receives the sample.
+ * @return true if a sample was available; false if the queue is empty.
+ */
+bool sample_queue_peek(QueuedSample &out) {
+    if (s_count == 0) return false;
+    out = s_ring[s_head];
+    return true;
+}
+
+/**
+ * @brief Copy a queued sample without removing it.
+ *
+ * @param index 0 = oldest, sample_queue_count() - 1 = newest.
+ * @param out   Receives the sample.
+ * @return true if index is within the queue.
+ */
+bool sample_queue_at(uint16_t index, QueuedSample &out) {
+    if (index >= s_count) return false;
+    out = s_ring[(s_head + index) % SAMPLE_QUEUE_LEN];
+    return true;
+}
+
+/** @brief Remove the oldest queued sample (no-op when empty). */
+void sample_queue_pop() {
+    if (s_count == 0) return;
+    s_head = (uint16_t)((s_head + 1) % SAMPLE_QUEUE_LEN);
+    s_count--;
+}
+
+/** @return Number of samples currently queued. */
+uint16_t sample_queue_count() { return s_count; }
+
+/** @return Total number of samples overwritten because the queue was full. */
+uint32_t sample_queue_dropped() { return s_dropped; }
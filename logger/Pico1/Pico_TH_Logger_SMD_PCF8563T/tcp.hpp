@@ -125,6 +125,13 @@
  * @return true if a valid token is available after the call; false otherwise.
  */
  
+/**
+ * @brief Retry-After of the last failed token fetch or data POST.
+ *
+ * @return Seconds the server asked the client to wait (delta-seconds form), or 0
+ *         if the last request succeeded or the response carried no Retry-After.
+ */
+ 
 /**
  * @brief Invalidate and clear the cached token and its expiration time.
  *
@@ -147,6 +154,7 @@ private:
     size_t recv_len = 0;
     char   received_token[256] = {0};
     uint32_t token_expire_epoch = 0;
+    uint32_t retry_after_s = 0;
 
     static err_t tcp_connected_callback(void *, struct tcp_pcb *, err_t);
     bool resolve_host_blocking(const char* host_or_ip, ip_addr_t* out, uint32_t timeout_ms);
@@ -159,6 +167,7 @@ public:
     const char* get_token();
     bool ensure_token(uint32_t ttl_sec = 50);
     void invalidate_token() { received_token[0] = '\0'; token_expire_epoch = 0; }
+    uint32_t last_retry_after_s() const { return retry_after_s; }
 };
 
 #endif /* __TCP__ */
\ No newline at end of file
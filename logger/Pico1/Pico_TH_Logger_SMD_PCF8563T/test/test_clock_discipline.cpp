@@ -0,0 +1,111 @@
+/**
+ * @file test_clock_discipline.cpp
+ * @brief Host test for the RTC drift model across CET/CEST changes.
+ *
+ * The PCF8563T keeps local wall-clock time. Hourly syncs are simulated over
+ * both DST transitions of 2025, once with a perfect RTC and once with an RTC
+ * running 20 ppm fast; the model must never see the DST hour as a step or as
+ * drift.
+ *
+ *   make -C test
+ */
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include "../clock_discipline.hpp"
+
+uint64_t host_time_us = 0;
+
+static int s_failed = 0;
+
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            std::printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            s_failed++;                                                 \
+        }                                                               \
+    } while (0)
+
+/** @brief What the RTC shows at true time t when it has gained rtc_gain_s. */
+static struct tm rtc_fields(time_t t, double rtc_gain_s) {
+    time_t shown = t + (time_t)std::floor(rtc_gain_s);
+    struct tm lt = *localtime(&shown);
+    lt.tm_isdst = 0;    /* the PCF8563T has no DST flag */
+    return lt;
+}
+
+/**
+ * @brief Syncs every `every` hours over [start, start + hours); the RTC is stepped like apply_network_time().
+ * @return Largest |RTC step| seen, in seconds.
+ */
+static int64_t run(time_t start, int hours, int every, double ppm) {
+    clock_discipline_reset();
+    double gain = 0.0;
+    int64_t max_step = 0;
+
+    for (int h = 0; h < hours; h += every) {
+        const time_t t = start + (time_t)h * 3600;
+        host_time_us = (uint64_t)t * 1000000u;
+        if (h) gain += 3600.0 * every * ppm * 1e-6;
+
+        const struct tm f = rtc_fields(t, gain);
+        const time_t rtc_epoch = clock_rtc_local_to_epoch(&f, (double)t);
+        CHECK(rtc_epoch != (time_t)-1);
+        CHECK(std::llabs((long long)(rtc_epoch - t - (time_t)std::floor(gain))) == 0);
+
+        if (clock_discipline_on_sync(rtc_epoch, (double)t)) {
+            const int64_t step = (int64_t)(t - rtc_epoch);
+            if (std::llabs(step) > max_step) max_step = std::llabs(step);
+            clock_discipline_rtc_stepped((int32_t)step);
+            gain = 0.0;
+        }
+
+        /* Samples between syncs come out on the network timeline */
+        const struct tm later = rtc_fields(t + 1800, gain);
+        host_time_us += 1800u * 1000000u;
+        const time_t d = clock_discipline_apply(clock_rtc_local_to_epoch(&later, 0.0));
+        CHECK(std::llabs((long long)(d - (t + 1800))) <= 2);
+    }
+    return max_step;
+}
+
+int main() {
+    setenv("TZ", "CET-1CEST,M3.5.0/2,M10.5.0/3", 1);
+    tzset();
+
+    /* 2025-03-30 01:00 UTC: 02:00 CET jumps to 03:00 CEST */
+    const time_t spring = 1743296400;
+    /* 2025-10-26 01:00 UTC: 03:00 CEST falls back to 02:00 CET */
+    const time_t autumn = 1761440400;
+
+    /* Fields alone: summer time is not read as standard time */
+    struct tm f = rtc_fields(spring + 3600, 0.0);
+    CHECK(clock_rtc_local_to_epoch(&f, 0.0) == spring + 3600);
+
+    /* Repeated 02:30: the network time picks the right one */
+    f = rtc_fields(autumn - 1800, 0.0);
+    CHECK(f.tm_hour == 2 && f.tm_min == 30);
+    CHECK(clock_rtc_local_to_epoch(&f, (double)(autumn - 1800)) == autumn - 1800);
+    f = rtc_fields(autumn + 1800, 0.0);
+    CHECK(f.tm_hour == 2 && f.tm_min == 30);
+    CHECK(clock_rtc_local_to_epoch(&f, (double)(autumn + 1800)) == autumn + 1800);
+
+    /* Perfect RTC: no step and no drift across either change */
+    CHECK(run(spring - 24 * 3600, 48, 1, 0.0) == 0);
+    CHECK(std::fabs(clock_discipline_ppm()) < 0.5f);
+    CHECK(run(autumn - 24 * 3600, 48, 1, 0.0) == 0);
+    CHECK(std::fabs(clock_discipline_ppm()) < 0.5f);
+
+    /* 20 ppm fast, synced every 5 h for a week: only small steps, and the fitted drift is the crystal's */
+    CHECK(run(autumn - 84 * 3600, 168, 5, 20.0) <= 3);
+    CHECK(std::fabs(clock_discipline_ppm() - 20.0f) < 5.0f);
+
+    if (s_failed) {
+        std::printf("%d check(s) failed\n", s_failed);
+        return 1;
+    }
+    std::printf("clock_discipline: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,328 @@
+#include "binary_link.hpp"
+
+#include <cctype>
+#include <cstring>
+
+#include "com.hpp"
+#include "config.hpp"
+#include "config_schema.hpp"
+
+extern volatile bool wifi_apply_flag;
+
+enum class RxState : uint8_t {
+    Sof     = 0,
+    Header  = 1,
+    Payload = 2,
+    Crc     = 3,
+};
+
+static bool     s_active = false;
+static bool     s_streaming = false;
+static uint32_t s_tx_dropped = 0;
+
+static RxState  s_rx_state = RxState::Sof;
+static uint8_t  s_rx_hdr[4];
+static size_t   s_rx_pos = 0;
+static uint16_t s_rx_len = 0;
+static uint8_t  s_rx_crc[2];
+static uint8_t  s_rx_payload[BINARY_LINK_MAX_PAYLOAD];
+static uint8_t  s_tx_frame[BINARY_LINK_MAX_PAYLOAD + 7];
+
+/**
+ * @brief CRC-16/CCITT-FALSE update (poly 0x1021, no reflection).
+ *
+ * @param crc  Running value (0xFFFF to start).
+ * @param data Input bytes.
+ * @param len  Number of bytes.
+ * @return Updated CRC.
+ */
+static uint16_t crc16_update(uint16_t crc, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int k = 0; k < 8; ++k) {
+            crc = (crc & 0x8000u) ? (uint16_t)((crc << 1) ^ 0x1021u) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void put_u16(uint8_t* p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static void put_u32(uint8_t* p, uint32_t v) { for (int i = 0; i < 4; ++i) p[i] = (uint8_t)(v >> (8 * i)); }
+
+/**
+ * @brief Frame and queue one message on the CDC TX ring.
+ *
+ * The frame is queued whole or not at all (com_write()); a frame that does not
+ * fit is counted in binary_link_tx_dropped().
+ *
+ * @return true if the frame was queued.
+ */
+static bool send_frame(FrameType type, uint8_t seq, const uint8_t* payload, uint16_t len) {
+    if (len > BINARY_LINK_MAX_PAYLOAD) return false;
+    uint8_t* f = s_tx_frame;
+    f[0] = BINARY_LINK_SOF;
+    f[1] = (uint8_t)type;
+    f[2] = seq;
+    put_u16(&f[3], len);
+    if (len) std::memcpy(&f[5], payload, len);
+    put_u16(&f[5 + len], crc16_update(0xFFFF, &f[1], 4u + len));
+    if (!com_write(f, 7u + len)) {
+        s_tx_dropped++;
+        return false;
+    }
+    return true;
+}
+
+static void send_nak(uint8_t seq, BinaryNak reason) {
+    const uint8_t r = (uint8_t)reason;
+    send_frame(FrameType::Nak, seq, &r, 1);
+}
+
+/** @brief Serialize a sample in the Sample/HistoryData layout (20 bytes). */
+static size_t pack_sample(uint8_t* p, const QueuedSample& s) {
+    const int64_t epoch = (int64_t)s.epoch;
+    std::memcpy(p, &epoch, 8);
+    std::memcpy(p + 8, &s.temperature, 4);
+    std::memcpy(p + 12, &s.humidity, 4);
+    std::memcpy(p + 16, &s.pressure, 4);
+    return 20;
+}
+
+/** @brief ConfigRead: every schema field as "key=value\n" in one frame. */
+static void handle_config_read(uint8_t seq) {
+    static uint8_t out[BINARY_LINK_MAX_PAYLOAD];
+    size_t used = 0;
+    const Config& cfg = config_get();
+    for (size_t i = 0; i < config_field_count(); ++i) {
+        int m = config_field_format(cfg, *config_field_at(i), (char*)out + used, sizeof(out) - used);
+        if (m < 0 || (size_t)m >= sizeof(out) - used) {
+            send_nak(seq, BinaryNak::TooLong);
+            return;
+        }
+        used += (size_t)m;
+    }
+    send_frame(FrameType::ConfigData, seq, out, (uint16_t)used);
+}
+
+/**
+ * @brief ConfigWrite: apply "key=value" lines to a copy, commit only if all succeed.
+ *
+ * Keys are matched case-insensitively and a trailing '\r' is dropped, as on the
+ * CLI "set" command.
+ *
+ * Reply: Ack with status (FieldSetResult, or BadValue for an unknown key or a
+ * malformed line) and the index of the failing line. If the save to flash
+ * fails, the previous config is restored and Nak(SaveFailed) is sent instead.
+ */
+static void handle_config_write(uint8_t seq, const uint8_t* p, uint16_t len) {
+    if (len < 1) {
+        send_nak(seq, BinaryNak::BadPayload);
+        return;
+    }
+    const bool save = (p[0] & 0x01) != 0;
+
+    static Config work;
+    work = config_get();
+    bool wifi_apply = false;
+    uint16_t line_no = 0;
+    FieldSetResult status = FieldSetResult::Ok;
+
+    size_t pos = 1;
+    while (pos < len && status == FieldSetResult::Ok) {
+        size_t end = pos;
+        while (end < len && p[end] != '\n') ++end;
+        char line[160];
+        size_t n = end - pos;
+        if (n > 0 && p[pos + n - 1] == '\r') --n;
+        if (n > 0) {
+            if (n >= sizeof(line)) {
+                status = FieldSetResult::BadValue;
+                break;
+            }
+            std::memcpy(line, p + pos, n);
+            line[n] = '\0';
+            char* eq = std::strchr(line, '=');
+            const ConfigField* field = nullptr;
+            if (eq) {
+                *eq = '\0';
+                for (char* k = line; *k; ++k) *k = (char)tolower((unsigned char)*k);
+                field = config_field_find(line);
+            }
+            if (!field || eq[1] == '\0') {
+                status = FieldSetResult::BadValue;
+                break;
+            }
+            status = config_field_set(work, *field, eq + 1);
+            if (field->flags & CFG_F_WIFI_APPLY) wifi_apply = true;
+            if (status != FieldSetResult::Ok) break;
+            ++line_no;
+        }
+        pos = end + 1;
+    }
+
+    if (status == FieldSetResult::Ok) {
+        static Config prev;
+        prev = config_get();
+        config_mut() = work;
+        if (save && !config_save()) {
+            config_mut() = prev;
+            send_nak(seq, BinaryNak::SaveFailed);
+            return;
+        }
+        if (wifi_apply) wifi_apply_flag = true;
+    }
+
+    uint8_t reply[3];
+    reply[0] = (uint8_t)status;
+    put_u16(&reply[1], line_no);
+    send_frame(FrameType::Ack, seq, reply, sizeof(reply));
+}
+
+/** @brief HistoryRead: the pending-upload queue in as few frames as possible. */
+static void handle_history_read(uint8_t seq) {
+    static uint8_t out[BINARY_LINK_MAX_PAYLOAD];
+    const uint16_t total = sample_queue_count();
+    const uint16_t per_frame = (uint16_t)((sizeof(out) - 4) / 20);
+    uint16_t index = 0;
+    do {
+        put_u16(&out[0], total);
+        put_u16(&out[2], index);
+        size_t used = 4;
+        for (uint16_t k = 0; k < per_frame && index < total; ++k, ++index) {
+            QueuedSample s;
+            if (!sample_queue_at(index, s)) break;
+            used += pack_sample(&out[used], s);
+        }
+        if (!send_frame(FrameType::HistoryData, seq, out, (uint16_t)used)) break;
+    } while (index < total);
+}
+
+/** @brief Dispatch one validated request frame. */
+static void handle_frame(FrameType type, uint8_t seq, const uint8_t* p, uint16_t len) {
+    switch (type) {
+    case FrameType::Ping:
+        send_frame(FrameType::Ack, seq, p, len);
+        break;
+    case FrameType::Bye:
+        send_frame(FrameType::Ack, seq, nullptr, 0);
+        binary_link_reset();
+        break;
+    case FrameType::ConfigRead:
+        handle_config_read(seq);
+        break;
+    case FrameType::ConfigWrite:
+        handle_config_write(seq, p, len);
+        break;
+    case FrameType::StreamCtl:
+        if (len < 1) { send_nak(seq, BinaryNak::BadPayload); break; }
+        s_streaming = p[0] != 0;
+        send_frame(FrameType::Ack, seq, p, 1);
+        break;
+    case FrameType::HistoryRead:
+        handle_history_read(seq);
+        break;
+    default:
+        send_nak(seq, BinaryNak::UnknownType);
+        break;
+    }
+}
+
+/**
+ * @brief Switch the port into binary mode and announce it with a Hello frame.
+ *
+ * Called by the console when it has received BINARY_LINK_PREAMBLE.
+ */
+void binary_link_enter() {
+    s_active = true;
+    s_streaming = false;
+    s_rx_state = RxState::Sof;
+
+    const Config& cfg = config_get();
+    uint8_t hello[13];
+    hello[0] = BINARY_LINK_VERSION;
+    put_u16(&hello[1], (uint16_t)BINARY_LINK_MAX_PAYLOAD);
+    put_u16(&hello[3], cfg.version);
+    put_u32(&hello[5], cfg.logger_id);
+    put_u32(&hello[9], cfg.sensor_id);
+    send_frame(FrameType::Hello, 0, hello, sizeof(hello));
+}
+
+/** @brief Leave binary mode (Bye or host disconnect); streaming stops. */
+void binary_link_reset() {
+    s_active = false;
+    s_streaming = false;
+    s_rx_state = RxState::Sof;
+}
+
+/** @return true while the port is in binary mode. */
+bool binary_link_active() { return s_active; }
+
+/**
+ * @brief Feed received bytes to the frame parser.
+ *
+ * Complete frames with a valid CRC are handled immediately; bytes outside a
+ * frame are ignored until the next start-of-frame byte.
+ *
+ * @param data Received bytes.
+ * @param len  Number of bytes.
+ */
+void binary_link_rx(const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len && s_active; ++i) {
+        const uint8_t b = data[i];
+        switch (s_rx_state) {
+        case RxState::Sof:
+            if (b == BINARY_LINK_SOF) {
+                s_rx_state = RxState::Header;
+                s_rx_pos = 0;
+            }
+            break;
+        case RxState::Header:
+            s_rx_hdr[s_rx_pos++] = b;
+            if (s_rx_pos == sizeof(s_rx_hdr)) {
+                s_rx_len = (uint16_t)(s_rx_hdr[2] | (s_rx_hdr[3] << 8));
+                s_rx_pos = 0;
+                if (s_rx_len > BINARY_LINK_MAX_PAYLOAD) {
+                    send_nak(s_rx_hdr[1], BinaryNak::TooLong);
+                    s_rx_state = RxState::Sof;
+                } else {
+                    s_rx_state = s_rx_len ? RxState::Payload : RxState::Crc;
+                }
+            }
+            break;
+        case RxState::Payload:
+            s_rx_payload[s_rx_pos++] = b;
+            if (s_rx_pos == s_rx_len) {
+                s_rx_pos = 0;
+                s_rx_state = RxState::Crc;
+            }
+            break;
+        case RxState::Crc:
+            s_rx_crc[s_rx_pos++] = b;
+            if (s_rx_pos == sizeof(s_rx_crc)) {
+                s_rx_state = RxState::Sof;
+                uint16_t crc = crc16_update(0xFFFF, s_rx_hdr, sizeof(s_rx_hdr));
+                crc = crc16_update(crc, s_rx_payload, s_rx_len);
+                if (crc != (uint16_t)(s_rx_crc[0] | (s_rx_crc[1] << 8))) {
+                    send_nak(s_rx_hdr[1], BinaryNak::BadCrc);
+                } else {
+                    handle_frame((FrameType)s_rx_hdr[0], s_rx_hdr[1], s_rx_payload, s_rx_len);
+                }
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Push a measurement to the host if streaming is enabled.
+ *
+ * @param s Validated sample (epoch, temperature, humidity, pressure).
+ */
+void binary_link_publish_sample(const QueuedSample& s) {
+    if (!s_active || !s_streaming) return;
+    uint8_t p[20];
+    send_frame(FrameType::Sample, 0, p, (uint16_t)pack_sample(p, s));
+}
+
+/** @return Number of frames dropped because the CDC TX ring was full. */
+uint32_t binary_link_tx_dropped() { return s_tx_dropped; }
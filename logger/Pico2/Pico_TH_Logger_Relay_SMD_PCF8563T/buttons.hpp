@@ -0,0 +1,57 @@
+/**
+ * @file buttons.hpp
+ * @brief Interrupt-driven front-panel buttons with alarm-based debounce.
+ *
+ * Buttons are active-low inputs with internal pull-ups. Instead of sampling the
+ * pins on every main-loop pass, each pin raises a GPIO edge interrupt that
+ * (re)arms a one-shot hardware alarm BUTTON_DEBOUNCE_MS ahead. When the alarm
+ * fires and the level differs from the last stable state, the state machine
+ * advances and posts an event:
+ * - Press:     stable low level reached.
+ * - LongPress: still pressed long_press_ms after Press (a second alarm; at most
+ *              once per press).
+ * - Release:   stable high level reached; after_long tells whether LongPress was
+ *              posted for this press, so the consumer can tell a click from the
+ *              end of a hold.
+ *
+ * Events carry the time they happened and wait in a BUTTON_EVENT_QUEUE_LEN entry
+ * queue until the main loop drains it with buttons_next_event(), so presses are
+ * timed correctly and never lost while the loop is blocked (e.g. during an
+ * upload). If the queue overflows, new events are dropped and counted.
+ *
+ * Thread-safety:
+ * - The state machine runs in GPIO / timer IRQ context (both default priority,
+ *   so they never preempt each other); the queue is single-producer,
+ *   single-consumer and needs no locks.
+ * - buttons_add() and buttons_next_event() are for the main loop only.
+ */
+#pragma once
+#ifndef __BUTTONS_HPP__
+#define __BUTTONS_HPP__
+
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+
+#define BUTTON_COUNT            2
+#define BUTTON_DEBOUNCE_MS      50
+#define BUTTON_EVENT_QUEUE_LEN  16
+
+enum class ButtonEventType : uint8_t {
+    Press     = 0,
+    LongPress = 1,
+    Release   = 2,
+};
+
+struct ButtonEvent {
+    uint8_t         button;
+    ButtonEventType type;
+    bool            after_long;
+    uint32_t        at_ms;
+};
+
+bool     buttons_add(uint8_t index, uint gpio, uint32_t long_press_ms);
+bool     buttons_next_event(ButtonEvent &out);
+uint32_t buttons_dropped_events();
+
+#endif /* __BUTTONS_HPP__ */
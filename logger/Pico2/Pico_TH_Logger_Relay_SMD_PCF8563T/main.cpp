@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <cstring>
 #include <cctype>
+#include <cstdlib>
+#include <ctime>
 #include "pico/stdlib.h"
 #include "hardware/timer.h"
 #include "hardware/watchdog.h"
@@ -12,6 +14,8 @@ extern "C" {
 #include "program_main.hpp"
 #include "config.hpp"
 #include "com.hpp"
+#include "ntp_client.hpp"
+#include "mem_pool.hpp"
 
 volatile bool update_screen_flag   = false;
 volatile bool post_flag            = false;
@@ -29,24 +33,37 @@ static repeating_timer_t post_timer;
 /**
  * @brief Application entry point for the Pico-based logger.
  *
- * Responsibilities:
- *  - Initialize standard IO and introduce a startup delay to allow USB enumeration.
+ * Responsibilities (staged boot, nothing waits on the network):
+ *  - Initialize standard IO. USB enumeration completes in the background through tud_task().
+ *  - Set the local timezone (CET/CEST) once: RTC fields are kept in local time, and every
+ *    RTC-to-epoch conversion (display, queued samples) needs it before the first time sync.
+ *    setenv/tzset allocate, so this must also happen before mem_heap_lock().
  *  - Load persisted configuration (config_init).
  *  - Initialize hardware abstractions and peripherals (ProgramMain::init_equipment).
- *  - Initialize (and optionally enable) Wi-Fi subsystem (ProgramMain::init_wifi).
  *  - Set up:
  *      - A repeating screen update timer (1s period).
  *      - A configurable data post timer (rearm_post_timer, period driven by config).
+ *  - Take the first reading right away: display_measurement() updates the LCD and drives the
+ *    relays, and a first sample is requested (post_flag) and queued until the link is up.
+ *  - Start Wi-Fi in the background (ProgramMain::init_wifi only starts the join); association,
+ *    DHCP and time sync are advanced by wifi_tick() and time_sync_tick().
+ *  - Lock the heap (mem_heap_lock): from here on nothing may allocate; a LOGGER_HEAP_GUARD
+ *    build panics on any later malloc/free.
  *  - Enter the cooperative main loop that:
  *      - Services TinyUSB tasks (tud_task) and network/CYW43 timeouts (sys_check_timeouts / cyw43_arch_poll).
  *      - Polls communication channels (com_poll) and UI inputs (poll_buttons).
+ *      - Reads the sensor for an active USB live stream (stream_tick).
  *      - Manages LCD backlight auto-off logic (backlight_autoff_tick).
+ *      - Advances the background Wi-Fi link state and drains queued samples (wifi_tick).
+ *      - Re-synchronizes network time on the drift-model schedule (time_sync_tick).
+ *      - Uploads queued samples at this device's phase in the post period (upload_tick).
+ *      - Commits deferred configuration saves at a safe point (config_commit_tick).
  *      - Reacts to asynchronous flags raised by ISRs or other subsystems:
- *          * device_reset_flag: Cleanly deinitialize Wi-Fi, flush USB CDC, then trigger watchdog reboot.
+ *          * device_reset_flag: Cleanly deinitialize Wi-Fi, flush queued USB CDC output (com_tx_flush), then trigger watchdog reboot.
  *          * wifi_apply_flag: Attempt to reconnect Wi-Fi using possibly updated credentials.
  *          * wifi_reconnect_flag: Conditionally enable/disable Wi-Fi per current configuration, with user feedback.
  *          * update_screen_flag: Refresh displayed measurement data.
- *          * post_flag: Transmit collected sensor/logging data (send_data).
+ *          * post_flag: Take and queue a sample on the exact post tick and schedule its upload (send_data).
  *      - Periodically (every ~1s) re-evaluates configuration changes affecting the post timer interval and rearms it.
  *  - Uses minimal sleep (sleep_ms(1)) to yield CPU while maintaining responsive polling semantics.
  *
@@ -67,17 +84,25 @@ static repeating_timer_t post_timer;
  */
 int main() {
     stdio_init_all();
-    sleep_ms(2000);
+
+    setenv("TZ", "CET-1CEST,M3.5.0/2,M10.5.0/3", 1);
+    tzset();
 
     config_init();
 
     ProgramMain program_main;
     program_main.init_equipment();
-    program_main.init_wifi();
 
     add_repeating_timer_ms(1000, screen_update_callback, NULL, &screen_timer);
     rearm_post_timer();
 
+    program_main.display_measurement();
+    post_flag = true;
+
+    program_main.init_wifi();
+
+    mem_heap_lock();
+
     absolute_time_t next_check = get_absolute_time();
 
     while (true) {
@@ -85,16 +110,21 @@ int main() {
         sys_check_timeouts();
 
         com_poll();
+        program_main.stream_tick();
 
         program_main.poll_buttons();
         program_main.backlight_autoff_tick();
+        program_main.wifi_tick();
+        program_main.time_sync_tick();
+        program_main.upload_tick();
+        config_commit_tick();
 
         if (device_reset_flag) {
             device_reset_flag = false;
 
             cyw43_arch_deinit();
 
-            tud_cdc_write_flush();
+            com_tx_flush(100);
             sleep_ms(50);
 
             watchdog_reboot(0, 0, 0);
@@ -118,9 +148,9 @@ int main() {
                 (void)program_main.reconnect_wifi();
             } else {
                 program_main.set_wifi_enabled(false);
+                ntp_client_stop();
                 cyw43_arch_deinit();
-                tud_cdc_write_str("WIFI_DISABLED\n");
-                tud_cdc_write_flush();
+                com_write_str("WIFI_DISABLED\n");
             }
         }
 
@@ -184,7 +214,8 @@ static void rearm_post_timer() {
  * Timer callback that requests a screen refresh by setting a shared update flag.
  *
  * This function is designed to run in the repeating timer (IRQ) context and must remain
- * short and non-blocking. The main/application loop should poll the flag and perform the
+ * short and non-blocking. It is placed in RAM (__not_in_flash_func) so a timer tick
+ * never waits on an XIP cache miss. The main/application loop should poll the flag and perform the
  * actual screen update outside of interrupt context.
  *
  * Thread-safety: The update flag should be declared volatile or otherwise synchronized,
@@ -193,7 +224,7 @@ static void rearm_post_timer() {
  * @param rt Pointer to the repeating timer that invoked this callback (unused).
  * @return true to keep the repeating timer running; returning false would stop it.
  */
-static bool screen_update_callback(repeating_timer_t *) {
+static bool __not_in_flash_func(screen_update_callback)(repeating_timer_t *) {
     update_screen_flag = true;
     return true;
 }
@@ -202,14 +233,14 @@ static bool screen_update_callback(repeating_timer_t *) {
  * Repeating timer callback that signals a pending POST operation by setting a global flag.
  *
  * This function is intended to run in the timer's interrupt/alarm context; it must remain
- * fast and non-blocking. The global post_flag is set so that the main/application loop can
+ * fast and non-blocking. Placed in RAM (__not_in_flash_func) like screen_update_callback(). The global post_flag is set so that the main/application loop can
  * perform the actual work outside the interrupt context.
  *
  * @note The shared flag should be safe for concurrent access (e.g., declared volatile or atomic).
  * @return true to keep the repeating timer active (the callback will continue to be invoked);
  *         returning false would stop further callbacks.
  */
-static bool post_request_callback(repeating_timer_t *) {
+static bool __not_in_flash_func(post_request_callback)(repeating_timer_t *) {
     post_flag = true;
     return true;
 }
\ No newline at end of file
@@ -36,6 +36,10 @@
  * - WIFI_PASSWORD: (const char*) WPA/WPA2 passphrase for the specified SSID (plaintext).
  *                  NOTE: Consider refactoring for secure storage (e.g., flash partition, secure element).
  *
+ * SECTION: Time Synchronization
+ * - NTP_SERVER_1..3 : (const char*) Default NTP servers (hostname or IP), queried in parallel.
+ *                     Put an on-site server first; an empty string disables a slot.
+ *
  * SECTION: Telemetry Timing
  * - POST_TIME : (unsigned long, ms) Minimum interval between successive telemetry POST operations.
  *               Constraint: Must be >= 1000 ms at runtime (code should validate and clamp if necessary).
@@ -93,6 +97,11 @@
 #define WIFI_SSID       "TP-Link_0A7B"
 #define WIFI_PASSWORD   "12345678"
 
+// === Time sync ===
+#define NTP_SERVER_1    "tempus1.gum.gov.pl"
+#define NTP_SERVER_2    "tempus2.gum.gov.pl"
+#define NTP_SERVER_3    "pool.ntp.org"
+
 // === Telemetry ===
 #define POST_TIME       600000  // ms (min. 1000 in runtime)
 
@@ -0,0 +1,148 @@
+/**
+ * @file mem_pool.hpp
+ * @brief Fixed-capacity object pools, statically placed singletons and the heap guard.
+ *
+ * The firmware does not use the heap after start-up. Objects that used to be
+ * new'd or calloc'd live in storage reserved at link time instead:
+ * - ObjectPool<T, N>: N slots for short-lived objects (e.g. the per-request TCP
+ *   contexts); acquire() placement-constructs, release() destroys. An empty pool
+ *   makes acquire() return nullptr, which callers already treat like a failed
+ *   allocation.
+ * - StaticSlot<T>: one placement-constructed instance (drivers such as BME280
+ *   and TCP); emplace() destroys the previous instance first.
+ *
+ * Every pool and slot registers a MemPoolInfo with capacity, current use, the
+ * high-water mark and the number of failed acquisitions; the "mem" console
+ * command prints them.
+ *
+ * Heap guard (build option LOGGER_HEAP_GUARD):
+ * - After mem_heap_lock() (called once start-up is complete) any malloc, free or
+ *   realloc panics with "heap use after init", so a residual allocation shows
+ *   up on the first run instead of as fragmentation after months of uptime.
+ * - Implemented through newlib's __malloc_lock() hook, which every heap call
+ *   takes, so allocations from libc internals are caught as well.
+ *
+ * Thread-safety:
+ * - Not thread-safe; use from the main loop only.
+ */
+#pragma once
+#ifndef __MEM_POOL_HPP__
+#define __MEM_POOL_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include <utility>
+
+#define MEM_POOL_MAX    8
+
+struct MemPoolInfo {
+    const char* name;
+    uint16_t    object_size;
+    uint16_t    capacity;
+    uint16_t    in_use;
+    uint16_t    high_water;
+    uint32_t    failures;
+};
+
+void               mem_pool_register(MemPoolInfo* info);
+size_t             mem_pool_count();
+const MemPoolInfo* mem_pool_at(size_t index);
+
+void mem_heap_lock();
+bool mem_heap_guarded();
+bool mem_heap_stats(uint32_t& arena_bytes, uint32_t& used_bytes);
+
+/**
+ * @brief Fixed-capacity pool of T in static storage.
+ *
+ * @tparam T Object type.
+ * @tparam N Number of slots.
+ */
+template <typename T, uint16_t N>
+class ObjectPool {
+public:
+    explicit ObjectPool(const char* name) : info_{name, (uint16_t)sizeof(T), N, 0, 0, 0} {
+        mem_pool_register(&info_);
+    }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    /**
+     * @brief Construct a T in a free slot.
+     * @return The object, or nullptr if all slots are in use (counted as a failure).
+     */
+    template <typename... Args>
+    T* acquire(Args&&... args) {
+        for (uint16_t i = 0; i < N; ++i) {
+            if (used_[i]) continue;
+            used_[i] = true;
+            if (++info_.in_use > info_.high_water) info_.high_water = info_.in_use;
+            return new (&slots_[i]) T(std::forward<Args>(args)...);
+        }
+        info_.failures++;
+        return nullptr;
+    }
+
+    /** @brief Destroy an object from acquire() and free its slot (nullptr is ignored). */
+    void release(T* obj) {
+        if (!obj) return;
+        const size_t i = (size_t)(reinterpret_cast<Slot*>(obj) - slots_);
+        if (i >= N || !used_[i]) return;
+        obj->~T();
+        used_[i] = false;
+        info_.in_use--;
+    }
+
+private:
+    struct alignas(T) Slot { unsigned char bytes[sizeof(T)]; };
+
+    Slot        slots_[N];
+    bool        used_[N] = {};
+    MemPoolInfo info_;
+};
+
+/**
+ * @brief One statically placed instance of T (replaces a long-lived new T).
+ *
+ * @tparam T Object type.
+ */
+template <typename T>
+class StaticSlot {
+public:
+    explicit StaticSlot(const char* name) : info_{name, (uint16_t)sizeof(T), 1, 0, 0, 0} {
+        mem_pool_register(&info_);
+    }
+
+    StaticSlot(const StaticSlot&) = delete;
+    StaticSlot& operator=(const StaticSlot&) = delete;
+
+    /** @brief Construct the instance, destroying a previous one first. */
+    template <typename... Args>
+    T* emplace(Args&&... args) {
+        reset();
+        T* obj = new (&slot_) T(std::forward<Args>(args)...);
+        info_.in_use = 1;
+        info_.high_water = 1;
+        return obj;
+    }
+
+    /** @brief Destroy the instance if there is one. */
+    void reset() {
+        if (!info_.in_use) return;
+        get()->~T();
+        info_.in_use = 0;
+    }
+
+    /** @return The instance, or nullptr before emplace(). */
+    T* get() { return info_.in_use ? reinterpret_cast<T*>(&slot_) : nullptr; }
+
+private:
+    struct alignas(T) Slot { unsigned char bytes[sizeof(T)]; };
+
+    Slot        slot_;
+    MemPoolInfo info_;
+};
+
+#endif /* __MEM_POOL_HPP__ */
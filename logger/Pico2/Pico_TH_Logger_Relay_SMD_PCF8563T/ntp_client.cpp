@@ -0,0 +1,321 @@
+#include "ntp_client.hpp"
+
+#include <string.h>
+#include <math.h>
+
+#include "pico/stdlib.h"
+extern "C" {
+    #include "lwip/udp.h"
+    #include "lwip/dns.h"
+    #include "lwip/pbuf.h"
+    #include "lwip/ip_addr.h"
+}
+
+#include "config.hpp"
+
+#define NTP_PORT            123
+#define NTP_PACKET_LEN      48
+#define NTP_UNIX_OFFSET     2208988800ull
+
+enum NtpSlotState : uint8_t {
+    SLOT_EMPTY     = 0,
+    SLOT_RESOLVING = 1,
+    SLOT_SENT      = 2,
+    SLOT_DONE      = 3,
+    SLOT_FAILED    = 4,
+};
+
+struct NtpSlot {
+    uint8_t   state;
+    ip_addr_t addr;
+    uint64_t  t1_us;
+    uint32_t  nonce;
+    uint64_t  t4_us;
+    double    net_at_t4;
+    double    rtt_s;
+};
+
+static NtpSlot         s_slots[CONFIG_NTP_SERVERS];
+static struct udp_pcb* s_pcb      = nullptr;
+static uint8_t         s_round    = 0;
+static bool            s_busy     = false;
+static uint64_t        s_deadline_us = 0;
+static uint8_t         s_failures = 0;
+
+static int8_t   s_best      = -1;
+static double   s_best_net  = 0.0;
+static uint64_t s_best_us   = 0;
+static double   s_best_rtt  = 0.0;
+
+/**
+ * @brief Read a 64-bit NTP timestamp from a packet and convert it to Unix seconds.
+ *
+ * Handles NTP era rollover (2036): seconds values with the top bit clear are
+ * taken to belong to era 1.
+ *
+ * @param p Pointer to the 8 big-endian timestamp bytes.
+ * @return Unix time in seconds including the fractional part; 0.0 for a zero timestamp.
+ */
+static double ntp_ts_to_unix(const uint8_t *p) {
+    uint64_t sec  = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    uint32_t frac = ((uint32_t)p[4] << 24) | ((uint32_t)p[5] << 16) | ((uint32_t)p[6] << 8) | p[7];
+    if (sec == 0 && frac == 0) return 0.0;
+    if (sec < 0x80000000ull) sec += 0x100000000ull;
+    return (double)(sec - NTP_UNIX_OFFSET) + (double)frac / 4294967296.0;
+}
+
+/**
+ * @brief Send an SNTP client request to the resolved address of a slot.
+ *
+ * The transmit timestamp field carries a per-request nonce instead of a real
+ * time (the client has no absolute clock yet); servers echo it back in the
+ * originate field, which is used to match and authenticate the reply.
+ *
+ * @param idx Slot index.
+ */
+static void ntp_send_request(uint8_t idx) {
+    NtpSlot &s = s_slots[idx];
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, NTP_PACKET_LEN, PBUF_RAM);
+    if (!p) {
+        s.state = SLOT_FAILED;
+        return;
+    }
+    uint8_t *b = (uint8_t *)p->payload;
+    memset(b, 0, NTP_PACKET_LEN);
+    b[0] = 0x23;                                  // LI=0, VN=4, Mode=3 (client)
+
+    s.t1_us = time_us_64();
+    s.nonce = (uint32_t)s.t1_us ^ ((uint32_t)s_round << 24) ^ (0x9E3779B9u * (idx + 1u));
+    b[44] = (uint8_t)(s.nonce >> 24);
+    b[45] = (uint8_t)(s.nonce >> 16);
+    b[46] = (uint8_t)(s.nonce >> 8);
+    b[47] = (uint8_t)(s.nonce);
+
+    err_t err = udp_sendto(s_pcb, p, &s.addr, NTP_PORT);
+    pbuf_free(p);
+    s.state = (err == ERR_OK) ? SLOT_SENT : SLOT_FAILED;
+}
+
+/**
+ * @brief lwIP UDP receive callback for SNTP replies.
+ *
+ * Matches the reply to an outstanding slot by source address and nonce,
+ * validates it and records the round-trip time and the network time at arrival.
+ * Anything unexpected is dropped silently.
+ */
+static void ntp_recv(void *, struct udp_pcb *, struct pbuf *p, const ip_addr_t *addr, u16_t port) {
+    const uint64_t t4_us = time_us_64();
+    uint8_t b[NTP_PACKET_LEN];
+    bool ok = (port == NTP_PORT) && (p->tot_len >= NTP_PACKET_LEN) &&
+              (pbuf_copy_partial(p, b, NTP_PACKET_LEN, 0) == NTP_PACKET_LEN);
+    pbuf_free(p);
+    if (!ok || !s_busy) return;
+
+    const uint32_t origin = ((uint32_t)b[28] << 24) | ((uint32_t)b[29] << 16) | ((uint32_t)b[30] << 8) | b[31];
+    for (uint8_t i = 0; i < CONFIG_NTP_SERVERS; ++i) {
+        NtpSlot &s = s_slots[i];
+        if (s.state != SLOT_SENT || !ip_addr_cmp(&s.addr, addr) || origin != s.nonce) continue;
+
+        const uint8_t li      = b[0] >> 6;
+        const uint8_t mode    = b[0] & 0x07;
+        const uint8_t stratum = b[1];
+        const double  t2 = ntp_ts_to_unix(&b[32]);
+        const double  t3 = ntp_ts_to_unix(&b[40]);
+        if (li == 3 || mode != 4 || stratum == 0 || stratum > 15 || t3 == 0.0) {
+            s.state = SLOT_FAILED;
+            return;
+        }
+
+        double rtt = (double)(t4_us - s.t1_us) / 1e6 - (t3 - t2);
+        if (rtt < 0.0) rtt = 0.0;
+        s.rtt_s     = rtt;
+        s.t4_us     = t4_us;
+        s.net_at_t4 = t3 + rtt / 2.0;
+        s.state     = SLOT_DONE;
+        return;
+    }
+}
+
+/**
+ * @brief DNS completion callback for one server slot.
+ *
+ * The callback argument encodes the round number and slot index so results of
+ * an abandoned round are ignored.
+ */
+static void ntp_dns_cb(const char *, const ip_addr_t *ipaddr, void *arg) {
+    const uintptr_t tag = (uintptr_t)arg;
+    const uint8_t round = (uint8_t)(tag >> 4);
+    const uint8_t idx   = (uint8_t)(tag & 0x0F);
+    if (!s_busy || round != s_round || idx >= CONFIG_NTP_SERVERS) return;
+    if (s_slots[idx].state != SLOT_RESOLVING) return;
+
+    if (ipaddr) {
+        s_slots[idx].addr = *ipaddr;
+        ntp_send_request(idx);
+    } else {
+        s_slots[idx].state = SLOT_FAILED;
+    }
+}
+
+/**
+ * @brief Pick the lowest-RTT answer that agrees with a strict majority.
+ *
+ * All answers are first extrapolated to a common monotonic instant so replies
+ * received at different moments can be compared directly. A single answer is
+ * taken as is. When the answers split without a strict majority (e.g. two that
+ * disagree) the configured on-site server (slot 0) is trusted if it answered,
+ * otherwise the round is skipped.
+ *
+ * @return Index of the selected slot, or -1 if no usable answer was received.
+ */
+static int8_t ntp_select() {
+    const uint64_t ref_us = time_us_64();
+    double  net[CONFIG_NTP_SERVERS];
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < CONFIG_NTP_SERVERS; ++i) {
+        if (s_slots[i].state != SLOT_DONE) continue;
+        net[i] = s_slots[i].net_at_t4 + (double)(ref_us - s_slots[i].t4_us) / 1e6;
+        n++;
+    }
+    if (n == 0) return -1;
+
+    int8_t best = -1;
+    for (uint8_t i = 0; i < CONFIG_NTP_SERVERS; ++i) {
+        if (s_slots[i].state != SLOT_DONE) continue;
+        uint8_t agree = 0;
+        for (uint8_t j = 0; j < CONFIG_NTP_SERVERS; ++j) {
+            if (s_slots[j].state == SLOT_DONE && fabs(net[i] - net[j]) <= NTP_AGREE_S) agree++;
+        }
+        if ((uint8_t)(agree * 2) <= n && n > 1) continue;
+        if (best < 0 || s_slots[i].rtt_s < s_slots[best].rtt_s) best = (int8_t)i;
+    }
+    if (best < 0 && s_slots[0].state == SLOT_DONE) best = 0;
+    return best;
+}
+
+/**
+ * @brief Start a synchronization round against all configured NTP servers.
+ *
+ * Creates the UDP PCB on first use, then resolves every non-empty entry of
+ * Config::ntp_servers (IP literals resolve immediately) and sends one request
+ * per server as soon as its address is known. Returns immediately.
+ *
+ * @return true if a round is running (already or newly started); false if no
+ *         server is configured or the PCB could not be allocated.
+ */
+bool ntp_client_start() {
+    if (s_busy) return true;
+
+    if (!s_pcb) {
+        s_pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+        if (!s_pcb) return false;
+        udp_recv(s_pcb, ntp_recv, nullptr);
+    }
+
+    s_round++;
+    s_busy  = true;
+    s_deadline_us = time_us_64() + (uint64_t)NTP_ROUND_TIMEOUT_MS * 1000u;
+
+    const auto &cfg = config_get();
+    bool any = false;
+    for (uint8_t i = 0; i < CONFIG_NTP_SERVERS; ++i) {
+        NtpSlot &s = s_slots[i];
+        memset(&s, 0, sizeof(s));
+        if (cfg.ntp_servers[i][0] == '\0') {
+            s.state = SLOT_EMPTY;
+            continue;
+        }
+        any = true;
+        s.state = SLOT_RESOLVING;
+        void *tag = (void *)(uintptr_t)(((uintptr_t)s_round << 4) | i);
+        err_t err = dns_gethostbyname(cfg.ntp_servers[i], &s.addr, ntp_dns_cb, tag);
+        if (err == ERR_OK) {
+            ntp_send_request(i);
+        } else if (err != ERR_INPROGRESS) {
+            s.state = SLOT_FAILED;
+        }
+    }
+
+    if (!any) {
+        s_busy = false;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Advance the current round; call regularly from the main loop.
+ *
+ * A round finishes when every slot has either answered or failed, or when
+ * NTP_ROUND_TIMEOUT_MS has elapsed. The selected answer is then latched for
+ * ntp_client_time_now() and the failure counter used for backoff is updated.
+ *
+ * @return NtpStatus::Busy while waiting, NtpStatus::Synced / NtpStatus::Failed
+ *         once when the round ends, NtpStatus::Idle otherwise.
+ */
+NtpStatus ntp_client_poll() {
+    if (!s_busy) return NtpStatus::Idle;
+
+    bool pending = false;
+    for (uint8_t i = 0; i < CONFIG_NTP_SERVERS; ++i) {
+        if (s_slots[i].state == SLOT_RESOLVING || s_slots[i].state == SLOT_SENT) pending = true;
+    }
+    if (pending && (int64_t)(time_us_64() - s_deadline_us) < 0) return NtpStatus::Busy;
+
+    s_busy = false;
+    const int8_t best = ntp_select();
+    if (best < 0) {
+        if (s_failures < 0xFF) s_failures++;
+        return NtpStatus::Failed;
+    }
+
+    s_best     = best;
+    s_best_net = s_slots[best].net_at_t4;
+    s_best_us  = s_slots[best].t4_us;
+    s_best_rtt = s_slots[best].rtt_s;
+    s_failures = 0;
+    return NtpStatus::Synced;
+}
+
+/**
+ * @brief Abort any running round and release the UDP PCB.
+ *
+ * Must be called before cyw43_arch_deinit(). Late DNS callbacks are ignored
+ * because the round counter is advanced.
+ */
+void ntp_client_stop() {
+    s_busy  = false;
+    s_round++;
+    if (s_pcb) {
+        udp_remove(s_pcb);
+        s_pcb = nullptr;
+    }
+}
+
+/** @return true while a synchronization round is in progress. */
+bool ntp_client_busy() { return s_busy; }
+
+/**
+ * @brief Network time of the last selected answer, extrapolated to now.
+ * @return Unix time in seconds (fractional part included); meaningful only after
+ *         ntp_client_poll() has returned NtpStatus::Synced at least once.
+ */
+double ntp_client_time_now() {
+    return s_best_net + (double)(time_us_64() - s_best_us) / 1e6;
+}
+
+/** @return Round-trip time of the last selected answer in milliseconds. */
+uint32_t ntp_client_rtt_ms() { return (uint32_t)lround(s_best_rtt * 1000.0); }
+
+/** @return Config::ntp_servers index of the last selected server, or -1. */
+int ntp_client_server() { return s_best; }
+
+/**
+ * @brief Delay before the next attempt after a failed round.
+ * @return NTP_RETRY_MIN_MS doubled per consecutive failure, capped at NTP_RETRY_MAX_MS.
+ */
+uint32_t ntp_client_retry_ms() {
+    uint32_t delay = NTP_RETRY_MIN_MS;
+    for (uint8_t i = 1; i < s_failures && delay < NTP_RETRY_MAX_MS; ++i) delay *= 2u;
+    return (delay > NTP_RETRY_MAX_MS) ? NTP_RETRY_MAX_MS : delay;
+}
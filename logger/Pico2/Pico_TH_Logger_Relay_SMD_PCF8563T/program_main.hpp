@@ -18,9 +18,9 @@
  *  - WIFI_INIT_FAIL / WIFI_CONN_FAIL / WIFI_OK: Status codes for Wi-Fi initialization and connection attempts.
  *
  * Button Handling:
- *  - Two buttons (on GPIO 20 & 21 implied externally) are tracked with debounced previous states,
- *    press start timestamps, and long-press one-shot flags.
- *  - Short vs long press differentiation is implemented via duration thresholds (logic in poll_buttons()).
+ *  - Two buttons are debounced and timed in IRQ context (buttons.hpp: GPIO edge interrupts
+ *    plus one-shot alarms) and delivered as Press / LongPress / Release events.
+ *  - poll_buttons() drains the event queue and maps clicks and long presses to actions.
  *
  * Backlight Control:
  *  - A deadline timestamp (backlight_deadline_ms) governs automatic shutoff.
@@ -28,7 +28,11 @@
  *
  * Time Utilities:
  *  - make_time_utc_from_rtc_fields() converts discrete RTC fields to a UTC time_t.
- *  - synchronize_time() attempts to align system time (e.g., via network or RTC source).
+ *  - synchronize_time() starts a non-blocking multi-server SNTP round (see ntp_client.hpp).
+ *  - time_sync_tick() collects SNTP results, applies them via apply_network_time() and starts
+ *    new rounds on the adaptive schedule of the clock discipline drift model
+ *    (see clock_discipline.hpp), retrying failed rounds with backoff.
+ *  - disciplined_epoch() converts raw RTC fields into a drift-corrected, slewed timestamp.
  *
  * PWM Utilities:
  *  - setup_pwm() configures a GPIO for PWM output.
@@ -36,13 +40,27 @@
  *
  * Networking:
  *  - init_wifi() performs initial Wi-Fi bring-up; reconnect_wifi() attempts recovery after drop.
+ *    Both only start an asynchronous join and return immediately.
+ *  - wifi_tick() advances the background link state (WifiState): Connecting until the link has
+ *    an IP address, Up while it stays up, Retry after a failure or link loss.
+ *  - Reconnects escalate through WifiStage: a targeted join to the cached BSSID/channel
+ *    (Config::wifi_bssid/wifi_channel, no scan), a normal scanning join, and finally a full
+ *    CYW43 re-initialization. On a cold start the cached DHCP lease is preloaded onto the
+ *    interface so the link counts as up as soon as the association completes. The cache is
+ *    refreshed (config_update_wifi_cache()) once DHCP has confirmed the lease.
  *  - Wi-Fi can be toggled at runtime (set_wifi_enabled()) allowing low-power / offline operation.
  *
  * Logging & Display:
  *  - display_measurement() renders current sensor data to the user interface.
- *  - send_data() packages and transmits readings (e.g., to a remote logging service).
+ *  - send_data() packages and transmits readings (e.g., to a remote logging service). Readings
+ *    taken while the link is not up, or whose upload failed, go to the RAM sample queue
+ *    (sample_queue.hpp) and are uploaded in order once the link is up.
  *  - set_logging_enabled() gates data transmission and possibly local record buffering.
  *
+ * Live Streaming:
+ *  - stream_tick() applies "stream on/off" requests (BME280 normal vs forced mode) and reads
+ *    the sensor at the stream rate, queuing samples for USB output (see stream.hpp).
+ *
  * RGB Control:
  *  - set_rgb_color() allows setting an RGB indicator (e.g., status / alert states).
  *
@@ -55,7 +73,7 @@
  *
  * Performance Notes:
  *  - Time comparisons rely on millisecond ticks from to_ms_since_boot(), assumed monotonic.
- *  - Avoid blocking operations inside frequently called methods (e.g., poll_buttons()).
+ *  - Avoid blocking operations inside frequently called methods (e.g., wifi_tick()).
  *
  * Extension Points:
  *  - Add new sensor types by extending init_equipment() and display_measurement().
@@ -68,19 +86,16 @@
  *
  * Invariants:
  *  - myBME280 and myTCP are nullptr until initialized.
- *  - Button state flags reflect the most recent poll cycle.
  *
  * @note This class intentionally keeps hardware abstraction minimal; consider refactoring into
  *       specialized managers (SensorManager, NetworkManager, UIManager) if complexity grows.
- *
- * @warning Ensure poll_buttons() is called at a sufficiently high frequency to guarantee
- *          accurate press duration classification (e.g., <= 10–20 ms cadence).
  */
 #ifndef __PROGRAM_MAIN_HPP__
 #define __PROGRAM_MAIN_HPP__
 
 #include "bme280.hpp"
 #include "tcp.hpp"
+#include "sample_queue.hpp"
 #include <time.h>
 
 #define I2C_PORT i2c0
@@ -91,25 +106,35 @@
 #define WIFI_CONN_FAIL  1
 #define WIFI_OK         0
 
+enum class WifiStage : uint8_t {
+    Fast   = 0,
+    Join   = 1,
+    Reinit = 2,
+};
+
+enum class WifiState : uint8_t {
+    Off        = 0,
+    Connecting = 1,
+    Up         = 2,
+    Retry      = 3,
+};
+
 class ProgramMain{
     BME280* myBME280 = nullptr;
     TCP* myTCP = nullptr;
     bool wifi_active = true;
+    WifiState wifi_state = WifiState::Off;
+    uint32_t wifi_deadline_ms = 0;
+    WifiStage wifi_stage = WifiStage::Join;
+    bool wifi_cache_pending = false;
+    bool queue_flush_pending = false;
+    bool upload_pending = false;
+    uint32_t upload_due_ms = 0;
 
     bool logging_enabled = true;
-    bool btn21_prev = true;
-    bool btn20_prev = true;
-    uint32_t btn21_last_ms = 0;
-    uint32_t btn20_last_ms = 0;
-
-    bool     btn20_pressed = false;
-    bool     btn21_pressed = false;
-    uint32_t btn20_press_start = 0;
-    uint32_t btn21_press_start = 0;
-    bool     btn20_long_fired = false;
-    bool     btn21_long_fired = false;
 
     uint32_t backlight_deadline_ms = 0;
+    uint32_t next_time_sync_ms = 0;
     inline uint32_t now_ms() { return to_ms_since_boot(get_absolute_time()); }
     void backlight_kick(uint32_t ms = 30000);
 
@@ -119,15 +144,32 @@ private:
     void setup_pwm(uint);
     void set_pwm_duty(uint, uint16_t);
     bool synchronize_time();
+    void schedule_time_sync(uint32_t delay_ms);
+    static time_t disciplined_epoch(const uint16_t *rtc_fields);
+    static void apply_network_time(double net_epoch);
+    uint8_t start_wifi_join();
+    static WifiStage first_wifi_stage();
+    static void preload_wifi_lease();
+    static void update_wifi_cache();
+    bool take_sample(QueuedSample &out);
+    void log_error(const char* message, const char* details = nullptr);
+    bool upload_sample(const QueuedSample &s);
+    void flush_queue();
+    void schedule_upload();
 
 public:
     void init_equipment();
     uint8_t init_wifi();
     uint8_t reconnect_wifi();
-    void set_wifi_enabled(bool enabled) { wifi_active = enabled; }
+    void wifi_tick();
+    void set_wifi_enabled(bool enabled) { wifi_active = enabled; if (!enabled) wifi_state = WifiState::Off; }
     bool is_wifi_enabled() const { return wifi_active; }
+    bool is_wifi_up() const { return wifi_active && wifi_state == WifiState::Up; }
     void poll_buttons();
     void backlight_autoff_tick();
+    void stream_tick();
+    void time_sync_tick();
+    void upload_tick();
     void set_logging_enabled(bool en) { logging_enabled = en; }
     bool is_logging_enabled() const { return logging_enabled; }
     void set_rgb_color(uint8_t, uint8_t, uint8_t);
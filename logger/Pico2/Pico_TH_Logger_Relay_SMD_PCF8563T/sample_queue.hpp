@@ -0,0 +1,47 @@
+/**
+ * @file sample_queue.hpp
+ * @brief RAM ring buffer of measurements waiting for upload.
+ *
+ * Samples taken while the Wi-Fi link is not up yet (e.g. right after boot, while
+ * association, DHCP and time sync proceed in the background) or whose upload
+ * failed are stored here and sent in chronological order once the link is up.
+ *
+ * Behavior:
+ * - Fixed capacity of SAMPLE_QUEUE_LEN entries, no dynamic allocation.
+ * - When full, the oldest sample is overwritten and the drop counter increments,
+ *   so the most recent data always survives an extended outage.
+ * - Contents are lost on reset (RAM only).
+ *
+ * Usage Pattern:
+ * 1. sample_queue_push() a sample that cannot be sent right now.
+ * 2. While the link is up, sample_queue_peek() the oldest entry, upload it and
+ *    sample_queue_pop() it only after the upload succeeded.
+ * 3. sample_queue_at() reads any entry without removing it (e.g. history readout).
+ *
+ * Thread-safety:
+ * - Not thread-safe; use from the main loop only.
+ */
+#pragma once
+#ifndef __SAMPLE_QUEUE_HPP__
+#define __SAMPLE_QUEUE_HPP__
+
+#include <stdint.h>
+#include <time.h>
+
+#define SAMPLE_QUEUE_LEN    64
+
+struct QueuedSample {
+    time_t epoch;
+    float  temperature;
+    float  humidity;
+    float  pressure;
+};
+
+bool     sample_queue_push(const QueuedSample &s);
+bool     sample_queue_peek(QueuedSample &out);
+void     sample_queue_pop();
+bool     sample_queue_at(uint16_t index, QueuedSample &out);
+uint16_t sample_queue_count();
+uint32_t sample_queue_dropped();
+
+#endif /* __SAMPLE_QUEUE_HPP__ */
@@ -0,0 +1,10 @@
+/* Host stand-in for pico/stdlib.h: only what the host-tested modules use. */
+#ifndef HOST_STUB_PICO_STDLIB_H
+#define HOST_STUB_PICO_STDLIB_H
+
+#include <stdint.h>
+
+extern uint64_t host_time_us;
+static inline uint64_t time_us_64(void) { return host_time_us; }
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * @file binary_link.hpp
+ * @brief Binary framed protocol over USB CDC, alongside the text CLI.
+ *
+ * The text console (com.cpp) stays the default. A host switches the port into
+ * binary mode by sending BINARY_LINK_PREAMBLE; the device answers with a Hello
+ * frame and from then on exchanges only frames until the host sends Bye or
+ * disconnects. Intended for provisioning and diagnostics tools that need bulk
+ * transfers instead of scraping "SHOW_END" / "HELP_END" markers.
+ *
+ * Frame layout (little endian):
+ *   0xA5 | type u8 | seq u8 | len u16 | payload[len] | crc16 u16
+ * - crc16 is CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) over type..payload.
+ * - Replies echo the seq of the request; unsolicited frames (Sample) use seq 0.
+ * - The receiver resynchronizes on the next 0xA5 after a CRC or length error, so
+ *   stray text (e.g. stdio printf) cannot wedge the link.
+ *
+ * Frame types (host -> device / device -> host):
+ * - Hello       (dev): protocol version u8, max payload u16, config version u16,
+ *                      logger_id u32, sensor_id u32.
+ * - Ping        (host): any payload; answered with Ack carrying the same payload.
+ * - Bye         (host): answered with Ack, then the port returns to text mode.
+ * - ConfigRead  (host): answered with ConfigData: all schema fields as
+ *                      "key=value\n" lines (same format as "show").
+ * - ConfigWrite (host): flags u8 (bit 0: save to flash) + "key=value\n" lines.
+ *                      Applied all-or-nothing; answered with Ack
+ *                      (status u8 = FieldSetResult, failing line index u16),
+ *                      or Nak(SaveFailed) if the save to flash failed.
+ * - StreamCtl   (host): enable u8; while enabled, every validated measurement is
+ *                      pushed as a Sample frame.
+ * - Sample      (dev): epoch i64, temperature f32, humidity f32, pressure f32.
+ * - HistoryRead (host): answered with one or more HistoryData frames:
+ *                      total u16, first index u16, then samples (Sample layout)
+ *                      from the pending-upload queue, oldest first.
+ * - Nak         (dev): reason u8 (BinaryNak) for a rejected request.
+ *
+ * Thread-safety:
+ * - Not thread-safe; called from com_poll() / the main loop only.
+ */
+#pragma once
+#ifndef __BINARY_LINK_HPP__
+#define __BINARY_LINK_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sample_queue.hpp"
+
+#define BINARY_LINK_PREAMBLE        "\x02PLB1"
+#define BINARY_LINK_PREAMBLE_LEN    5
+#define BINARY_LINK_SOF             0xA5
+#define BINARY_LINK_VERSION         1
+#define BINARY_LINK_MAX_PAYLOAD     2048u
+
+enum class FrameType : uint8_t {
+    Hello       = 0x01,
+    Ping        = 0x02,
+    Bye         = 0x03,
+    Ack         = 0x04,
+    Nak         = 0x05,
+    ConfigRead  = 0x10,
+    ConfigData  = 0x11,
+    ConfigWrite = 0x12,
+    StreamCtl   = 0x20,
+    Sample      = 0x21,
+    HistoryRead = 0x30,
+    HistoryData = 0x31,
+};
+
+enum class BinaryNak : uint8_t {
+    BadCrc      = 1,
+    TooLong     = 2,
+    UnknownType = 3,
+    BadPayload  = 4,
+    SaveFailed  = 5,    // ConfigWrite could not be saved; config left unchanged
+};
+
+void     binary_link_enter();
+void     binary_link_reset();
+bool     binary_link_active();
+void     binary_link_rx(const uint8_t* data, size_t len);
+void     binary_link_publish_sample(const QueuedSample& s);
+uint32_t binary_link_tx_dropped();
+
+#endif /* __BINARY_LINK_HPP__ */
@@ -82,6 +82,103 @@ BME280::Measurement_t BME280::measure() {
     return measurement;
 }
 
+/**
+ * @brief Put the sensor into normal mode for continuous conversions.
+ *
+ * The config register (0xF5) is only guaranteed to be written in sleep mode, so the
+ * sequence is: sleep, config (t_sb, IIR filter off), ctrl_hum x1, ctrl_meas with the
+ * current T/P oversampling and MODE_NORMAL. The output data rate is then
+ * 1 / (max_measure_time_us() + t_sb); measure() and read_fixed() return the latest
+ * finished conversion without triggering one.
+ *
+ * @param standby t_sb code 0..7 (0.5, 62.5, 125, 250, 500, 1000, 10, 20 ms).
+ */
+void BME280::set_normal_mode(uint8_t standby) {
+    write_register(0xF4, MODE_SLEEP);
+    write_register(0xF5, (uint8_t)((standby & 0x07) << 5));
+    write_register(0xF2, 0x01);
+    measurement_reg.mode = MODE_NORMAL;
+    mode = MODE_NORMAL;
+    write_register(0xF4, (uint8_t)measurement_reg.get());
+}
+
+/**
+ * @brief Put the sensor back to sleep and let measure() trigger forced conversions.
+ */
+void BME280::set_forced_mode() {
+    write_register(0xF4, MODE_SLEEP);
+    measurement_reg.mode = MODE_FORCED;
+    mode = MODE_FORCED;
+}
+
+/**
+ * @brief Maximum measurement time for the configured oversampling.
+ *
+ * Datasheet section 9.1: t = 1.25 + 2.3 * T_os + (2.3 * P_os + 0.575)
+ * + (2.3 * H_os + 0.575) ms, with humidity fixed at x1 by this driver.
+ *
+ * @return Microseconds.
+ */
+uint32_t BME280::max_measure_time_us() const {
+    auto os = [](unsigned code) -> uint32_t { return code ? (1u << (code - 1)) : 0u; };
+    const uint32_t t_os = os(measurement_reg.osrs_t);
+    const uint32_t p_os = os(measurement_reg.osrs_p);
+    uint32_t us = 1250 + 2300 * t_os + 2300 * 1 + 575;
+    if (p_os) us += 2300 * p_os + 575;
+    return us;
+}
+
+/**
+ * @brief Select the standby time that gives an output data period closest to, but
+ *        not longer than, period_us.
+ *
+ * @param period_us Requested period between conversions.
+ * @return t_sb code; 0 (0.5 ms) if even the shortest cycle does not fit.
+ */
+uint8_t BME280::standby_for_period_us(uint32_t period_us) const {
+    const uint32_t meas = max_measure_time_us();
+    uint8_t best = 0;
+    for (uint8_t code = 0; code < 8; ++code) {
+        const uint32_t sb = standby_time_us(code);
+        if (meas + sb <= period_us && sb > standby_time_us(best)) best = code;
+    }
+    return best;
+}
+
+/**
+ * @brief Decode a t_sb code (datasheet table 27, BME280 column).
+ *
+ * @param standby t_sb code; only the low three bits are used.
+ * @return Standby time in microseconds.
+ */
+uint32_t BME280::standby_time_us(uint8_t standby) {
+    static const uint32_t standby_us[8] = { 500, 62500, 125000, 250000, 500000, 1000000, 10000, 20000 };
+    return standby_us[standby & 0x07];
+}
+
+/**
+ * @brief Read and compensate the latest conversion for streaming.
+ *
+ * Unlike measure(), uses a single repeated-start burst without the 2 ms guard
+ * delays of read_registers(), never triggers a conversion and reports bus errors,
+ * so it can run at the sensor's output data rate from the main loop.
+ *
+ * @param[out] raw Raw ADC counts.
+ * @param[out] out Compensated integer values (see Fixed_t).
+ * @return true on success; false if the I2C transfer failed.
+ */
+bool BME280::read_fixed(Raw_t &raw, Fixed_t &out) {
+    uint8_t reg = 0xF7;
+    uint8_t rb[8];
+    if (i2c_write_blocking(i2c_default, addr, &reg, 1, true) != 1) return false;
+    if (i2c_read_blocking(i2c_default, addr, rb, sizeof(rb), false) != (int)sizeof(rb)) return false;
+    decode_raw(rb, raw);
+    out.temperature_c100 = compensate_temp(raw.temperature);
+    out.pressure_q8      = compensate_pressure(raw.pressure);
+    out.humidity_q10     = compensate_humidity(raw.humidity);
+    return true;
+}
+
 /**
  * @brief Returns the BME280 sensor chip identifier.
  *
@@ -322,7 +419,21 @@ void BME280::read_compensation_parameters() {
 void BME280::bme280_read_raw(int32_t *humidity, int32_t *pressure, int32_t *temperature) {
     uint8_t rb[8];
     read_registers(0xF7, rb, 8);
-    *pressure    = ((uint32_t)rb[0] << 12) | ((uint32_t)rb[1] << 4) | (rb[2] >> 4);
-    *temperature = ((uint32_t)rb[3] << 12) | ((uint32_t)rb[4] << 4) | (rb[5] >> 4);
-    *humidity    = ((uint32_t)rb[6] << 8)  |  (uint32_t)rb[7];
+    Raw_t raw;
+    decode_raw(rb, raw);
+    *pressure    = raw.pressure;
+    *temperature = raw.temperature;
+    *humidity    = raw.humidity;
+}
+
+/**
+ * @brief Assemble raw ADC counts from the 0xF7..0xFE register burst.
+ *
+ * @param rb  8 bytes: press_msb/lsb/xlsb, temp_msb/lsb/xlsb, hum_msb/lsb.
+ * @param raw Decoded 20-bit pressure/temperature and 16-bit humidity counts.
+ */
+void BME280::decode_raw(const uint8_t *rb, Raw_t &raw) {
+    raw.pressure    = ((uint32_t)rb[0] << 12) | ((uint32_t)rb[1] << 4) | (rb[2] >> 4);
+    raw.temperature = ((uint32_t)rb[3] << 12) | ((uint32_t)rb[4] << 4) | (rb[5] >> 4);
+    raw.humidity    = ((uint32_t)rb[6] << 8)  |  (uint32_t)rb[7];
 }
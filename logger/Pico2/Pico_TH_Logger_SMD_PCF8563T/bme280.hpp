@@ -122,6 +122,20 @@
  * - altitude: Altitude above sea level in meters, derived from pressure and SEA_LEVEL_HPA.
  */
 
+/**
+ * @struct BME280::Raw_t
+ * @brief Un-compensated ADC counts of one conversion (20-bit T/P, 16-bit H).
+ */
+
+/**
+ * @struct BME280::Fixed_t
+ * @brief Compensated values in the integer units of the Bosch formulas.
+ *
+ * - temperature_c100: 0.01 °C.
+ * - pressure_q8: Pa in Q24.8 (1/256 Pa).
+ * - humidity_q10: %RH in Q22.10 (1/1024 %RH).
+ */
+
 /**
  * @brief Construct a BME280 driver with the requested operating mode.
  *
@@ -144,6 +158,39 @@
  * @return Populated Measurement_t with temperature (°C), humidity (%RH), pressure (hPa), and altitude (m).
  */
 
+/**
+ * @brief Switch to normal mode with the given standby time (continuous conversions).
+ * @param standby t_sb code (0..7) for the config register, see standby_for_period_us().
+ */
+
+/**
+ * @brief Return to forced mode (one conversion per measure() call).
+ */
+
+/**
+ * @brief Worst-case duration of one conversion at the configured oversampling (datasheet 9.1).
+ * @return Microseconds.
+ */
+
+/**
+ * @brief Pick the longest t_sb for which one normal-mode cycle fits into a period.
+ * @param period_us Desired output data period.
+ * @return t_sb code (0..7).
+ */
+
+/**
+ * @brief Standby duration for a t_sb code.
+ * @param standby t_sb code (0..7).
+ * @return Microseconds.
+ */
+
+/**
+ * @brief Read the latest conversion in one burst, without the register access delays.
+ * @param[out] raw ADC counts.
+ * @param[out] out Compensated values.
+ * @return false if the I2C transfer failed (outputs unchanged).
+ */
+
 /**
  * @brief Read and return the BME280 chip ID.
  * @return 8-bit chip identifier (typically 0x60 for BME280).
@@ -169,6 +216,10 @@
  * @return Compensated humidity in integer form (scaled as per datasheet).
  */
 
+/**
+ * @brief Decode the 8-byte 0xF7..0xFE burst into raw ADC counts.
+ */
+
 /**
  * @brief Read raw humidity, pressure, and temperature ADC values from the sensor.
  * @param[out] humidity Pointer to receive raw humidity ADC value.
@@ -247,9 +298,27 @@ public:
         float altitude;
     } measurement{};
 
+    struct Raw_t {
+        int32_t temperature;
+        int32_t pressure;
+        int32_t humidity;
+    };
+
+    struct Fixed_t {
+        int32_t  temperature_c100;
+        uint32_t pressure_q8;
+        uint32_t humidity_q10;
+    };
+
     explicit BME280(MODE mode = MODE_NORMAL);
 
     Measurement_t measure();
+    void     set_normal_mode(uint8_t standby);
+    void     set_forced_mode();
+    uint32_t max_measure_time_us() const;
+    uint8_t  standby_for_period_us(uint32_t period_us) const;
+    static uint32_t standby_time_us(uint8_t standby);
+    bool     read_fixed(Raw_t &raw, Fixed_t &out);
     uint8_t get_chipID();
 
 private:
@@ -257,6 +326,7 @@ private:
     uint32_t compensate_pressure(int32_t adc_P);
     uint32_t compensate_humidity(int32_t adc_H);
 
+    static void decode_raw(const uint8_t *rb, Raw_t &raw);
     void     bme280_read_raw(int32_t *humidity, int32_t *pressure, int32_t *temperature);
     void     write_register(uint8_t reg, uint8_t data);
     void     read_registers(uint8_t reg, uint8_t *buf, uint16_t len);
@@ -0,0 +1,110 @@
+#include "circuit_breaker.hpp"
+
+#include <stdio.h>
+
+#include "pico/rand.h"
+
+static BreakerState s_state = BreakerState::Closed;
+static uint8_t      s_failures = 0;         // consecutive failures while closed
+static uint8_t      s_trips = 0;            // consecutive openings, drives the backoff
+static bool         s_probe_out = false;    // half-open probe not answered yet
+static uint32_t     s_open_until_ms = 0;
+static uint32_t     s_total_trips = 0;
+
+/**
+ * @brief Backoff for the current trip: base * 2^(trips-1), capped, with equal jitter.
+ */
+static uint32_t backoff_ms() {
+    uint32_t d = CIRCUIT_BREAKER_BASE_MS;
+    for (uint8_t i = 1; i < s_trips && d < CIRCUIT_BREAKER_MAX_MS; ++i) d *= 2u;
+    if (d > CIRCUIT_BREAKER_MAX_MS) d = CIRCUIT_BREAKER_MAX_MS;
+    return d / 2u + get_rand_32() % (d / 2u + 1u);
+}
+
+/** @brief Enter Open for backoff_ms(), or longer if the server asked for it. */
+static void trip(uint32_t now_ms, uint32_t retry_after_s) {
+    if (s_trips < 0xFF) s_trips++;
+    s_total_trips++;
+    uint32_t wait = backoff_ms();
+    if (retry_after_s) {
+        const uint32_t asked = retry_after_s >= CIRCUIT_BREAKER_MAX_MS / 1000u
+                                   ? CIRCUIT_BREAKER_MAX_MS : retry_after_s * 1000u;
+        if (asked > wait) wait = asked;
+    }
+    s_state = BreakerState::Open;
+    s_probe_out = false;
+    s_open_until_ms = now_ms + wait;
+}
+
+/**
+ * @brief Ask whether a backend request may be made now.
+ *
+ * Moves Open to HalfOpen once the backoff has elapsed and grants that state's
+ * single probe. A granted request must be followed by circuit_breaker_on_success()
+ * or circuit_breaker_on_failure().
+ *
+ * @param now_ms Milliseconds since boot.
+ * @return true if the request may proceed; false to buffer it locally instead.
+ */
+bool circuit_breaker_allow(uint32_t now_ms) {
+    switch (s_state) {
+    case BreakerState::Closed:
+        return true;
+    case BreakerState::Open:
+        if ((int32_t)(now_ms - s_open_until_ms) < 0) return false;
+        s_state = BreakerState::HalfOpen;
+        s_probe_out = true;
+        return true;
+    case BreakerState::HalfOpen:
+        if (s_probe_out) return false;
+        s_probe_out = true;
+        return true;
+    }
+    return false;
+}
+
+/** @brief The backend answered: close the circuit and reset the backoff. */
+void circuit_breaker_on_success() {
+    s_state = BreakerState::Closed;
+    s_failures = 0;
+    s_trips = 0;
+    s_probe_out = false;
+}
+
+/**
+ * @brief A request failed (DNS, connect, timeout or a non-2xx answer).
+ *
+ * @param now_ms        Milliseconds since boot.
+ * @param retry_after_s Retry-After from the response in seconds, 0 if none.
+ */
+void circuit_breaker_on_failure(uint32_t now_ms, uint32_t retry_after_s) {
+    if (s_state == BreakerState::HalfOpen || retry_after_s > 0) {
+        trip(now_ms, retry_after_s);
+        return;
+    }
+    if (s_state == BreakerState::Closed && ++s_failures >= CIRCUIT_BREAKER_THRESHOLD) {
+        s_failures = 0;
+        trip(now_ms, 0);
+    }
+}
+
+/** @return Current state. */
+BreakerState circuit_breaker_state() { return s_state; }
+
+/**
+ * @brief One-line status for the console.
+ *
+ * @param out    Destination buffer ('\n'-terminated line).
+ * @param len    Size of @p out.
+ * @param now_ms Milliseconds since boot.
+ */
+void circuit_breaker_status_line(char* out, size_t len, uint32_t now_ms) {
+    static const char* const names[] = { "closed", "open", "half-open" };
+    uint32_t retry_in = 0;
+    if (s_state == BreakerState::Open && (int32_t)(s_open_until_ms - now_ms) > 0) {
+        retry_in = s_open_until_ms - now_ms;
+    }
+    snprintf(out, len, "BREAKER state=%s failures=%u trips=%lu retry_in_ms=%lu\n",
+             names[(uint8_t)s_state], (unsigned)s_failures,
+             (unsigned long)s_total_trips, (unsigned long)retry_in);
+}
@@ -12,11 +12,26 @@ extern "C" {
 }
 
 #include "config.hpp"
+#include "config_schema.hpp"
+#include "binary_link.hpp"
+#include "stream.hpp"
+#include "mem_pool.hpp"
+#include "net_stats.hpp"
+#include "circuit_breaker.hpp"
 
 extern volatile bool wifi_reconnect_flag;
 extern volatile bool wifi_apply_flag;
 extern volatile bool device_reset_flag;
 static bool s_ready_banner_sent = false;
+
+static char     s_tx_ring[COM_TX_RING_SIZE];
+static uint32_t s_tx_tail = 0;
+static uint32_t s_tx_count = 0;
+static uint32_t s_tx_pending_drops = 0;
+static uint32_t s_tx_dropped_lines = 0;
+static uint32_t s_tx_dropped_bytes = 0;
+
+static volatile bool s_rx_pending = false;
 static volatile bool s_pending_show = false;
 static volatile bool s_pending_help = false;
 static char s_pending_help_args[64] = {0};
@@ -29,7 +44,12 @@ static const char* s_help_lines[] = {
     "  save | load | defaults             - persist/load/reset config",
     "  reconnect                          - reconnect Wi-Fi (if enabled)",
     "  reset                              - reboot the device",
+    "  mem                                - memory pools and heap usage",
+    "  netstats [reset]                   - lwIP memory/TCP counters, new window",
+    "  breaker                            - upload circuit breaker state",
     "  echo <text>                        - echo back text",
+    "  stream on [rate=N] [fields=a,b]    - live samples (t,h,p,rt,rh,rp|all)",
+    "  stream off | stream                - stop / show stream status",
     "  help [next|reset|all|size=N]       - paged help control",
     "",
     "Keys for set:",
@@ -37,6 +57,7 @@ static const char* s_help_lines[] = {
     "  temperature, humidity, pressure, sht",
     "  clock, set_time, wifi_enabled, logging_enabled",
     "  wifi_ssid, wifi_password",
+    "  ntp_server1, ntp_server2, ntp_server3 (host or IP, '-' = none)",
     "  post_time_ms (ms)",
     "",
     "Examples:",
@@ -48,6 +69,8 @@ static const char* s_help_lines[] = {
     "  set logging_enabled 1",
     "  set logging_enabled 0",
     "  set logger_id 42",
+    "  set ntp_server1 192.168.1.1",
+    "  stream on rate=25 fields=t,h,p,rp",
     "  save",
     "  help size=8   (set page size)",
     "  help reset    (go to the beginning)",
@@ -55,58 +78,131 @@ static const char* s_help_lines[] = {
 };
 static const size_t s_help_count = sizeof(s_help_lines)/sizeof(s_help_lines[0]);
 
+static void process_rx();
+
 /**
- * Attempts to write the entire buffer to the USB CDC interface within a 1-second timeout.
- *
- * This function performs a best-effort write of 'len' bytes from 'data' to the CDC endpoint.
- * It iteratively writes available chunks, flushing after each successful write. If no bytes
- * can be written immediately, it yields to the TinyUSB task, performs a brief sleep, and
- * retries until either all bytes are written, the device disconnects, or the 1-second
- * deadline elapses. If interrupted, a partial write may occur.
- *
- * Preconditions:
- * - TinyUSB CDC must be initialized and running.
- * - 'data' points to a valid buffer containing at least 'len' bytes.
- *
- * Behavior:
- * - Returns immediately if 'len' <= 0.
- * - Aborts early if the CDC device is not connected.
- * - May block for up to ~1 second while attempting to complete the transfer.
+ * @brief Queue bytes for transmission over USB CDC without blocking.
+ *
+ * Output is staged in a COM_TX_RING_SIZE byte ring and moved to the TinyUSB TX FIFO
+ * by tx_drain() from com_poll() as endpoint space becomes free, so a slow or stalled
+ * host never stalls the main loop.
+ *
+ * Overflow policy:
+ * - A write is stored whole or not at all, so the host never sees a truncated line.
+ * - If it does not fit, it is dropped and counted (com_tx_dropped_lines() /
+ *   com_tx_dropped_bytes()).
+ * - Before the next write that fits, a "TX_DROPPED <n>" line is queued so the host
+ *   knows n writes are missing at that point.
+ * - While the port is in binary mode (binary_link.hpp), text output is dropped
+ *   (and counted) so it cannot corrupt the frame stream.
+ *
+ * @param data Bytes to send.
+ * @param len  Number of bytes; nothing is queued if <= 0.
+ */
+static void tx_enqueue(const char* data, int len) {
+    if (len <= 0) return;
+    if (binary_link_active()) {
+        s_tx_dropped_lines++;
+        s_tx_dropped_bytes += (uint32_t)len;
+        return;
+    }
+
+    char marker[32];
+    int m = 0;
+    if (s_tx_pending_drops) {
+        m = snprintf(marker, sizeof(marker), "TX_DROPPED %u\n", (unsigned)s_tx_pending_drops);
+    }
+
+    if ((uint32_t)(m + len) > COM_TX_RING_SIZE - s_tx_count) {
+        s_tx_pending_drops++;
+        s_tx_dropped_lines++;
+        s_tx_dropped_bytes += (uint32_t)len;
+        return;
+    }
+    s_tx_pending_drops = 0;
+
+    const char* parts[2] = { marker, data };
+    const int   lens[2]  = { m, len };
+    uint32_t head = (s_tx_tail + s_tx_count) % COM_TX_RING_SIZE;
+    for (int p = 0; p < 2; ++p) {
+        for (int i = 0; i < lens[p]; ) {
+            uint32_t chunk = COM_TX_RING_SIZE - head;
+            if (chunk > (uint32_t)(lens[p] - i)) chunk = (uint32_t)(lens[p] - i);
+            memcpy(&s_tx_ring[head], parts[p] + i, chunk);
+            head = (head + chunk) % COM_TX_RING_SIZE;
+            i += (int)chunk;
+        }
+    }
+    s_tx_count += (uint32_t)(m + len);
+}
+
+/**
+ * @brief Queue raw bytes (binary frames) on the TX ring, whole or not at all.
  *
- * Side effects:
- * - Calls tud_task(), tud_cdc_write(), tud_cdc_write_flush(), and sleep_us() to service
- *   USB events and pace retries.
+ * Unlike tx_enqueue() no drop marker is inserted; the caller accounts for drops.
  *
- * @param data Pointer to the buffer to send (not null-terminated unless intended).
- * @param len  Number of bytes to send. If <= 0, the function does nothing.
+ * @return true if all len bytes were queued.
+ */
+bool com_write(const void* data, size_t len) {
+    if (len == 0) return true;
+    if (len > COM_TX_RING_SIZE - s_tx_count) return false;
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+    uint32_t head = (s_tx_tail + s_tx_count) % COM_TX_RING_SIZE;
+    for (size_t i = 0; i < len; ) {
+        uint32_t chunk = COM_TX_RING_SIZE - head;
+        if (chunk > len - i) chunk = (uint32_t)(len - i);
+        memcpy(&s_tx_ring[head], src + i, chunk);
+        head = (head + chunk) % COM_TX_RING_SIZE;
+        i += chunk;
+    }
+    s_tx_count += (uint32_t)len;
+    return true;
+}
+
+/** @return Free bytes in the TX ring (for writers that must not be dropped). */
+size_t com_tx_free() {
+    return COM_TX_RING_SIZE - s_tx_count;
+}
+
+/** @brief Queue a NUL-terminated string (see tx_enqueue()). */
+static void tx_write_str(const char* s) {
+    tx_enqueue(s, (int)strlen(s));
+}
+
+/**
+ * @brief Move queued output into the TinyUSB TX FIFO as far as space allows.
  *
- * @note The function does not report the number of bytes actually written; use only when
- *       partial writes are acceptable on timeout or disconnect.
+ * Never waits: copies at most tud_cdc_write_available() bytes per pass and
+ * flushes once if anything was written. While no host is connected, queued
+ * output is discarded (it would be stale by the time a terminal opens).
  */
-static void cdc_write_all(const char* data, int len) {
-    if (len <= 0) return;
-    int written = 0;
-    absolute_time_t deadline = make_timeout_time_ms(1000);
-    while (written < len) {
-        if (!tud_cdc_connected()) break;
-        int n = tud_cdc_write(data + written, (uint32_t)(len - written));
-        if (n > 0) {
-            written += n;
-            tud_cdc_write_flush();
-        } else {
-            tud_task();
-            tight_loop_contents();
-            sleep_us(500);
-            if (absolute_time_diff_us(get_absolute_time(), deadline) < 0) break;
-        }
+static void tx_drain() {
+    if (!tud_cdc_connected()) {
+        s_tx_tail = 0;
+        s_tx_count = 0;
+        return;
     }
+    bool wrote = false;
+    while (s_tx_count > 0) {
+        uint32_t avail = tud_cdc_write_available();
+        if (avail == 0) break;
+        uint32_t chunk = COM_TX_RING_SIZE - s_tx_tail;
+        if (chunk > s_tx_count) chunk = s_tx_count;
+        if (chunk > avail) chunk = avail;
+        uint32_t n = tud_cdc_write(&s_tx_ring[s_tx_tail], chunk);
+        if (n == 0) break;
+        s_tx_tail = (s_tx_tail + n) % COM_TX_RING_SIZE;
+        s_tx_count -= n;
+        wrote = true;
+    }
+    if (wrote) tud_cdc_write_flush();
 }
 
 /**
  * @brief Writes a formatted string to the CDC interface without appending a newline.
  *
  * Formats the message using printf-style semantics into an internal 160-byte buffer
- * and transmits the resulting bytes via the CDC transport. If the formatted output
+ * and queues the resulting bytes on the CDC TX ring (tx_enqueue()). If the formatted output
  * exceeds the buffer capacity, it is truncated to fit. If formatting fails, no data
  * is written.
  *
@@ -125,58 +221,33 @@ static void cdc_write_linef(const char* fmt, ...) {
     va_end(ap);
     if (m < 0) return;
     if (m >= (int)sizeof(line)) m = (int)sizeof(line) - 1;
-    cdc_write_all(line, m);
+    tx_enqueue(line, m);
 }
 
 /**
  * @brief Emits the current configuration as key=value lines over the CDC interface.
  *
- * Retrieves the active configuration via config_get() and the last configuration
- * source via config_last_source(), then writes each field using cdc_write_linef().
- *
- * Output format:
- * - logger_id: unsigned
- * - sensor_id: unsigned
- * - server_ip: string
- * - server_port: unsigned
- * - temperature: unsigned
- * - humidity: unsigned
- * - pressure: unsigned
- * - sht: unsigned
- * - clock: unsigned (1 if enabled, 0 otherwise)
- * - set_time: unsigned (1 if enabled, 0 otherwise)
- * - wifi_enabled: unsigned (1 if enabled, 0 otherwise)
- * - wifi_ssid: string
- * - wifi_password: string
- * - post_time_ms: unsigned
- * - config_source: string ("loaded", "defaults", or "unknown")
+ * Walks the config schema (config_schema.hpp) in CONFIG_FIELDS order and writes
+ * one line per field as formatted by config_field_format(): numbers in decimal,
+ * strings verbatim (empty if unset), wifi_bssid as xx:xx:xx:xx:xx:xx and the
+ * cached lease (wifi_ip/wifi_netmask/wifi_gateway) as dotted IPv4. Read-only
+ * fields (the Wi-Fi fast reconnect cache) are included. Finally
+ * config_source=loaded|defaults|unknown is printed.
  *
  * The sequence is terminated with the line "SHOW_END".
  *
- * Side effects:
- * - Sends multiple lines over the CDC channel; no return value.
- *
  * Notes:
- * - post_time_ms is explicitly cast to unsigned for printing.
  * - wifi_password is printed in plaintext; handle logs accordingly.
  */
 static void process_show_output() {
     const auto &cfg = config_get();
-    cdc_write_linef("logger_id=%u\n", cfg.logger_id);
-    cdc_write_linef("sensor_id=%u\n", cfg.sensor_id);
-    cdc_write_linef("server_ip=%s\n", cfg.server_ip);
-    cdc_write_linef("server_port=%u\n", cfg.server_port);
-    cdc_write_linef("temperature=%u\n", cfg.temperature);
-    cdc_write_linef("humidity=%u\n", cfg.humidity);
-    cdc_write_linef("pressure=%u\n", cfg.pressure);
-    cdc_write_linef("sht=%u\n", cfg.sht);
-    cdc_write_linef("clock=%u\n", cfg.clock_enabled);
-    cdc_write_linef("set_time=%u\n", cfg.set_time_enabled);
-    cdc_write_linef("logging_enabled=%u\n", cfg.logging_enabled);
-    cdc_write_linef("wifi_enabled=%u\n", cfg.wifi_enabled);
-    cdc_write_linef("wifi_ssid=%s\n", cfg.wifi_ssid);
-    cdc_write_linef("wifi_password=%s\n", cfg.wifi_password);
-    cdc_write_linef("post_time_ms=%u\n", (unsigned)cfg.post_time_ms);
+    char line[160];
+    for (size_t i = 0; i < config_field_count(); ++i) {
+        int m = config_field_format(cfg, *config_field_at(i), line, sizeof(line));
+        if (m < 0) continue;
+        if (m >= (int)sizeof(line)) m = (int)sizeof(line) - 1;
+        tx_enqueue(line, m);
+    }
     auto src = config_last_source();
     const char *src_s = (src == ConfigSource::Loaded) ? "loaded" : (src == ConfigSource::DefaultsSaved) ? "defaults" : "unknown";
     cdc_write_linef("config_source=%s\n", src_s);
@@ -276,8 +347,11 @@ bool com_ready_banner_sent() { return s_ready_banner_sent; }
  *
  * Behavior:
  * - Runs TinyUSB housekeeping (tud_task()) every call.
- * - When a CDC connection is established for the first time, transmits a one-time
- *   "READY v2\n" banner and flushes the TX buffer. The banner will be sent again
+ * - If tud_cdc_rx_cb() flagged new input, drains the CDC RX FIFO and parses/executes
+ *   complete command lines here (process_rx()), i.e. in main-loop context. Commands
+ *   that write flash (save, defaults) therefore never run inside a USB callback.
+ * - When a CDC connection is established for the first time, queues a one-time
+ *   "READY v2\n" banner. The banner will be sent again
  *   after any disconnect/reconnect cycle.
  * - If connected and a "show" response is pending, emits it via the module’s
  *   show-output handler and clears the pending flag.
@@ -285,6 +359,10 @@ bool com_ready_banner_sent() { return s_ready_banner_sent; }
  *   help-output handler using the stored arguments, then clears the flag and
  *   resets the argument buffer.
  *
+ * - Moves queued stream samples into the TX ring (stream_drain()).
+ * - Finally drains the TX ring into the TinyUSB FIFO as far as endpoint space allows
+ *   (tx_drain()); never waits for the host.
+ *
  * Side effects:
  * - Writes to the USB CDC interface and flushes its TX buffer when needed.
  * - Mutates module-level state flags and buffers (e.g., ready-banner latch, pending
@@ -303,13 +381,21 @@ bool com_ready_banner_sent() { return s_ready_banner_sent; }
 void com_poll() {
     tud_task();
 
+    if (s_rx_pending) {
+        s_rx_pending = false;
+        while (tud_cdc_available()) {
+            process_rx();
+        }
+    }
+
     if (!s_ready_banner_sent && tud_cdc_connected()) {
-        tud_cdc_write_str("READY v2\n");
-        tud_cdc_write_flush();
+        tx_write_str("READY v2\n");
         s_ready_banner_sent = true;
     }
     if (!tud_cdc_connected()) {
         s_ready_banner_sent = false;
+        if (binary_link_active()) binary_link_reset();
+        stream_stop();
     }
 
     if (s_pending_show && tud_cdc_connected()) {
@@ -321,10 +407,49 @@ void com_poll() {
         process_help_output(s_pending_help_args);
         s_pending_help_args[0] = '\0';
     }
+
+    stream_drain();
+    tx_drain();
 }
 
 /**
- * TinyUSB CDC receive callback.
+ * @brief Queue a string for CDC output from outside the console module.
+ *
+ * Same non-blocking path and overflow policy as console replies (tx_enqueue()).
+ *
+ * @param s NUL-terminated text.
+ */
+void com_write_str(const char* s) {
+    tx_write_str(s);
+}
+
+/**
+ * @brief Push queued output to the host, waiting at most timeout_ms.
+ *
+ * Only for paths that are about to stop servicing USB (e.g. before a reboot);
+ * the main loop relies on com_poll() instead.
+ *
+ * @param timeout_ms Upper bound on the wait.
+ */
+void com_tx_flush(uint32_t timeout_ms) {
+    const absolute_time_t deadline = make_timeout_time_ms(timeout_ms);
+    while (s_tx_count > 0 && tud_cdc_connected() &&
+           absolute_time_diff_us(get_absolute_time(), deadline) > 0) {
+        tud_task();
+        tx_drain();
+        sleep_us(200);
+    }
+    tud_cdc_write_flush();
+}
+
+/** @return Number of writes dropped because the TX ring was full. */
+uint32_t com_tx_dropped_lines() { return s_tx_dropped_lines; }
+
+/** @return Number of bytes dropped because the TX ring was full. */
+uint32_t com_tx_dropped_bytes() { return s_tx_dropped_bytes; }
+
+/**
+ * Parses console input received over CDC.
  *
  * Accumulates bytes read from the CDC interface into a line buffer, provides basic
  * line-editing (supports Backspace and DEL, ignores CR), and dispatches commands
@@ -336,7 +461,7 @@ void com_poll() {
  * - On buffer overflow (line > 127 chars), input is discarded on newline and
  *   "ERR too long" is sent.
  * - Unknown commands result in "Unknown cmd".
- * - All responses are written to CDC and flushed immediately.
+ * - All responses are queued on the CDC TX ring and sent by com_poll().
  *
  * Supported commands:
  * - show
@@ -345,25 +470,14 @@ void com_poll() {
  * - set <key>=<value>
  *   - Also accepts: set <key> <value>
  *   - Key is lowercased and trimmed; value is trimmed.
- *   - Aliases: "wifi" -> "wifi_enabled", "set" -> "set_time",
- *              "clock_enabled" -> "clock".
- *   - Recognized keys (types) and effects:
- *     - logger_id (uint32)
- *     - sensor_id (uint32)
- *     - server_ip (string; truncated to fit)
- *     - server_port (uint16)
- *     - temperature (uint8)
- *     - humidity (uint8)
- *     - pressure (uint8)
- *     - sht (uint8)
- *     - clock (uint8)
- *     - set_time (uint8)
- *     - logging_enabled (uint8)
- *     - wifi_enabled (uint8) -> also sets wifi_apply_flag = true
- *     - wifi_ssid (string; truncated to fit)
- *     - wifi_password (string; truncated to fit)
- *     - post_time_ms (uint32; clamped to minimum 1000)
- *   - Replies: "OK" on success, "ERR unknown key" otherwise.
+ *   - Keys, aliases ("wifi" -> "wifi_enabled", "set" -> "set_time",
+ *     "clock_enabled" -> "clock"), types, ranges and side effects come from the
+ *     config schema (CONFIG_FIELDS in config_schema.hpp); the key is resolved with
+ *     a constant-time perfect-hash lookup (config_field_find()) and the value is
+ *     parsed and validated by config_field_set(). Fields flagged CFG_F_WIFI_APPLY
+ *     (wifi_enabled) also set wifi_apply_flag = true.
+ *   - Replies: "OK" on success; "ERR unknown key", "ERR read-only", "ERR value"
+ *     (not a number) or "ERR range" otherwise.
  *
  * - save
  *   - Persists configuration. Replies "SAVED wifi_enabled=%u" or "SAVE_ERR".
@@ -389,6 +503,12 @@ void com_poll() {
  * - echo <text>
  *   - Echoes text back followed by newline.
  *
+ * Binary mode:
+ * - Receiving BINARY_LINK_PREAMBLE anywhere in the input switches the port to the
+ *   framed binary protocol (binary_link_enter()); the partial line is discarded and
+ *   all further input goes to binary_link_rx() until the host sends Bye or
+ *   disconnects.
+ *
  * Input handling details:
  * - Reads in chunks, accumulates into a 128-byte command buffer.
  * - Backspace (0x08) and DEL (0x7F) delete the last buffered character.
@@ -398,26 +518,44 @@ void com_poll() {
  *
  * Concurrency and side effects:
  * - Uses static state (buffer, length, overflow flag); not re-entrant.
- * - Intended to run in the TinyUSB callback context.
+ * - Runs from com_poll() in main-loop context; reads at most one 64-byte chunk per call.
  * - Mutates configuration via config_mut(), may set:
  *   - wifi_apply_flag, wifi_reconnect_flag, device_reset_flag,
  *     s_pending_show, s_pending_help, s_pending_help_args.
  *
  * Security considerations:
  * - Accepts and stores plaintext Wi-Fi credentials over CDC.
- *
- * @param itf CDC interface index provided by TinyUSB (unused).
  */
-extern "C" void tud_cdc_rx_cb(uint8_t) {
+static void process_rx() {
     static char   cmd_buf[128];
     static size_t cmd_len = 0;
     static bool   overflow = false;
 
+    static size_t preamble_pos = 0;
+
     char tmp[64];
     uint32_t n = tud_cdc_read(tmp, sizeof(tmp));
+    if (binary_link_active()) {
+        binary_link_rx(reinterpret_cast<const uint8_t*>(tmp), n);
+        return;
+    }
     for (uint32_t i = 0; i < n; ++i) {
         char ch = tmp[i];
 
+        if (ch == BINARY_LINK_PREAMBLE[preamble_pos]) {
+            if (++preamble_pos == BINARY_LINK_PREAMBLE_LEN) {
+                preamble_pos = 0;
+                cmd_len = 0;
+                overflow = false;
+                stream_stop();
+                binary_link_enter();
+                binary_link_rx(reinterpret_cast<const uint8_t*>(tmp) + i + 1, n - i - 1);
+                return;
+            }
+        } else {
+            preamble_pos = (ch == BINARY_LINK_PREAMBLE[0]) ? 1 : 0;
+        }
+
         if (ch == '\r') {
             continue;
         }
@@ -439,8 +577,7 @@ extern "C" void tud_cdc_rx_cb(uint8_t) {
         if (overflow) {
             overflow = false;
             cmd_len = 0;
-            tud_cdc_write_str("ERR too long\n");
-            tud_cdc_write_flush();
+            tx_write_str("ERR too long\n");
             continue;
         }
 
@@ -502,42 +639,26 @@ extern "C" void tud_cdc_rx_cb(uint8_t) {
             size_t i2 = 0; for (; key_raw[i2] && i2 + 1 < sizeof(key_lc); ++i2) key_lc[i2] = (char)tolower((unsigned char)key_raw[i2]);
             key_lc[i2] = '\0';
 
-            if (strcmp(key_lc, "wifi") == 0) strcpy(key_lc, "wifi_enabled");
-            else if (strcmp(key_lc, "set") == 0) strcpy(key_lc, "set_time");
-            else if (strcmp(key_lc, "clock_enabled") == 0) strcpy(key_lc, "clock");
-
             if (key_lc[0] == '\0' || val_raw[0] == '\0') {
-                tud_cdc_write_str("ERR format\n");
-                tud_cdc_write_flush();
+                tx_write_str("ERR format\n");
                 continue;
             }
 
-            auto &cfg = config_mut();
-            bool ok = true;
-
-            if      (strcmp(key_lc, "logger_id")     == 0) cfg.logger_id      = (uint32_t)strtoul(val_raw, nullptr, 10);
-            else if (strcmp(key_lc, "sensor_id")     == 0) cfg.sensor_id      = (uint32_t)strtoul(val_raw, nullptr, 10);
-            else if (strcmp(key_lc, "server_ip")     == 0) snprintf(cfg.server_ip, sizeof(cfg.server_ip), "%s", val_raw);
-            else if (strcmp(key_lc, "server_port")   == 0) cfg.server_port    = (uint16_t)strtoul(val_raw, nullptr, 10);
-            else if (strcmp(key_lc, "temperature")   == 0) cfg.temperature    = (uint8_t)strtoul(val_raw, nullptr, 10);
-            else if (strcmp(key_lc, "humidity")      == 0) cfg.humidity       = (uint8_t)strtoul(val_raw, nullptr, 10);
-            else if (strcmp(key_lc, "pressure")      == 0) cfg.pressure       = (uint8_t)strtoul(val_raw, nullptr, 10);
-            else if (strcmp(key_lc, "sht")           == 0) cfg.sht            = (uint8_t)strtoul(val_raw, nullptr, 10);
-            else if (strcmp(key_lc, "clock")         == 0) cfg.clock_enabled  = (uint8_t)strtoul(val_raw, nullptr, 10);
-            else if (strcmp(key_lc, "set_time")      == 0) cfg.set_time_enabled = (uint8_t)strtoul(val_raw, nullptr, 10);
-            else if (strcmp(key_lc, "logging_enabled") == 0) cfg.logging_enabled = (uint8_t)strtoul(val_raw, nullptr, 10);
-            else if (strcmp(key_lc, "wifi_enabled")  == 0) { cfg.wifi_enabled = (uint8_t)strtoul(val_raw, nullptr, 10); wifi_apply_flag = true; }
-            else if (strcmp(key_lc, "wifi_ssid")     == 0) snprintf(cfg.wifi_ssid, sizeof(cfg.wifi_ssid), "%s", val_raw);
-            else if (strcmp(key_lc, "wifi_password") == 0) snprintf(cfg.wifi_password, sizeof(cfg.wifi_password), "%s", val_raw);
-            else if (strcmp(key_lc, "post_time_ms")  == 0) {
-                uint32_t v = (uint32_t)strtoul(val_raw, nullptr, 10);
-                if (v < 1000) v = 1000;
-                cfg.post_time_ms = v;
+            const ConfigField *field = config_field_find(key_lc);
+            const char *reply = "ERR unknown key\n";
+            if (field) {
+                switch (config_field_set(config_mut(), *field, val_raw)) {
+                case FieldSetResult::Ok:
+                    if (field->flags & CFG_F_WIFI_APPLY) wifi_apply_flag = true;
+                    reply = "OK\n";
+                    break;
+                case FieldSetResult::ReadOnly:   reply = "ERR read-only\n"; break;
+                case FieldSetResult::BadValue:   reply = "ERR value\n";     break;
+                case FieldSetResult::OutOfRange: reply = "ERR range\n";     break;
+                }
             }
-            else ok = false;
 
-            tud_cdc_write_str(ok ? "OK\n" : "ERR unknown key\n");
-            tud_cdc_write_flush();
+            tx_write_str(reply);
         }
         else if (strcmp(cmd_kw, "save") == 0 && (*rest == '\0')) {
             bool ok = config_save();
@@ -545,9 +666,8 @@ extern "C" void tud_cdc_rx_cb(uint8_t) {
                 const auto &c = config_get();
                 cdc_write_linef("SAVED wifi_enabled=%u\n", c.wifi_enabled);
             } else {
-                tud_cdc_write_str("SAVE_ERR\n");
+                tx_write_str("SAVE_ERR\n");
             }
-            tud_cdc_write_flush();
         }
         else if (strcmp(cmd_kw, "load") == 0 && (*rest == '\0')) {
             bool ok = config_load();
@@ -556,21 +676,18 @@ extern "C" void tud_cdc_rx_cb(uint8_t) {
                 const auto &c = config_get();
                 cdc_write_linef("LOADED wifi_enabled=%u\n", c.wifi_enabled);
             } else {
-                tud_cdc_write_str("LOAD_ERR\n");
+                tx_write_str("LOAD_ERR\n");
             }
-            tud_cdc_write_flush();
         }
         else if (strcmp(cmd_kw, "defaults") == 0 && (*rest == '\0')) {
             config_set_defaults();
             bool ok = config_save();
             wifi_apply_flag = true;
-            tud_cdc_write_str(ok ? "DEFAULTS_SAVED\n" : "DEFAULTS_SET\n");
-            tud_cdc_write_flush();
+            tx_write_str(ok ? "DEFAULTS_SAVED\n" : "DEFAULTS_SET\n");
         }
         else if (strcmp(cmd_kw, "reconnect") == 0 && (*rest == '\0')) {
             wifi_reconnect_flag = true;
-            tud_cdc_write_str("RECONNECTING\n");
-            tud_cdc_write_flush();
+            tx_write_str("RECONNECTING\n");
         }
         else if (strcmp(cmd_kw, "help") == 0) {
             size_t arg_len = strlen(rest);
@@ -581,17 +698,92 @@ extern "C" void tud_cdc_rx_cb(uint8_t) {
         }
         else if (strcmp(cmd_kw, "reset") == 0 && (*rest == '\0')) {
             device_reset_flag = true;
-            tud_cdc_write_str("RESETTING\n");
-            tud_cdc_write_flush();
+            tx_write_str("RESETTING\n");
+        }
+        else if (strcmp(cmd_kw, "stream") == 0) {
+            char args[64];
+            size_t ai = 0; for (; rest[ai] && ai + 1 < sizeof(args); ++ai) args[ai] = (char)tolower((unsigned char)rest[ai]);
+            args[ai] = '\0';
+
+            if (args[0] == '\0') {
+                char line[128];
+                stream_status_line(line, sizeof(line));
+                tx_write_str(line);
+                continue;
+            }
+            if (strcmp(args, "off") == 0) {
+                if (!stream_active()) tx_write_str("STREAM_OFF\n");
+                stream_stop();
+                continue;
+            }
+
+            char *tok = strtok(args, " \t");
+            bool ok = tok && strcmp(tok, "on") == 0;
+            unsigned long rate = STREAM_DEFAULT_RATE_HZ;
+            uint8_t fields = STREAM_F_T | STREAM_F_H | STREAM_F_P;
+            while (ok && (tok = strtok(nullptr, " \t")) != nullptr) {
+                if (strncmp(tok, "rate=", 5) == 0) {
+                    char *endp = nullptr;
+                    rate = strtoul(tok + 5, &endp, 10);
+                    ok = endp && *endp == '\0' && rate >= 1 && rate <= STREAM_MAX_RATE_HZ;
+                } else if (strncmp(tok, "fields=", 7) == 0) {
+                    ok = stream_parse_fields(tok + 7, fields);
+                } else {
+                    ok = false;
+                }
+            }
+            if (!ok) {
+                tx_write_str("ERR stream args\n");
+                continue;
+            }
+            stream_start((uint16_t)rate, fields);
+        }
+        else if (strcmp(cmd_kw, "mem") == 0 && (*rest == '\0')) {
+            for (size_t i = 0; i < mem_pool_count(); ++i) {
+                const MemPoolInfo *p = mem_pool_at(i);
+                cdc_write_linef("POOL name=%s size=%u cap=%u used=%u peak=%u fail=%lu\n",
+                                p->name, p->object_size, p->capacity, p->in_use, p->high_water,
+                                (unsigned long)p->failures);
+            }
+            uint32_t arena = 0, used = 0;
+            mem_heap_stats(arena, used);
+            cdc_write_linef("HEAP arena=%lu used=%lu guard=%u\n",
+                            (unsigned long)arena, (unsigned long)used, mem_heap_guarded() ? 1u : 0u);
+            cdc_write_linef("MEM_END\n");
+        }
+        else if (strcmp(cmd_kw, "netstats") == 0) {
+            if (*rest == '\0') {
+                net_stats_report(tx_write_str);
+            } else if (strcmp(rest, "reset") == 0) {
+                net_stats_reset();
+                tx_write_str("NETSTATS_RESET\n");
+            } else {
+                tx_write_str("ERR netstats args\n");
+            }
+        }
+        else if (strcmp(cmd_kw, "breaker") == 0 && (*rest == '\0')) {
+            char line[96];
+            circuit_breaker_status_line(line, sizeof(line), to_ms_since_boot(get_absolute_time()));
+            tx_write_str(line);
         }
         else if (strcmp(cmd_kw, "echo") == 0) {
-            tud_cdc_write(rest, strlen(rest));
-            tud_cdc_write_str("\n");
-            tud_cdc_write_flush();
+            cdc_write_linef("%s\n", rest);
         }
         else {
-            tud_cdc_write_str("Unknown cmd\n");
-            tud_cdc_write_flush();
+            tx_write_str("Unknown cmd\n");
         }
     }
 }
+
+/**
+ * TinyUSB CDC receive callback.
+ *
+ * Only flags that input is pending; the bytes stay in the TinyUSB RX FIFO until
+ * com_poll() drains and parses them. Called from tud_task() in the main loop,
+ * never during a flash_safe_execute() commit, so it can stay in flash.
+ *
+ * @param itf CDC interface index provided by TinyUSB (unused).
+ */
+extern "C" void tud_cdc_rx_cb(uint8_t) {
+    s_rx_pending = true;
+}
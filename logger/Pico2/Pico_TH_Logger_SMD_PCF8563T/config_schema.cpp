@@ -0,0 +1,276 @@
+#include "config_schema.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/**
+ * @brief Default value helpers for CONFIG_FIELDS.
+ *
+ * The default column holds either a number or a string literal; these pick the
+ * matching representation and yield 0 / nullptr for the other one.
+ */
+template <typename T>
+static constexpr uint32_t field_def_num(T v) {
+    if constexpr (std::is_arithmetic_v<T>) return static_cast<uint32_t>(v);
+    else return 0;
+}
+
+template <typename T>
+static constexpr const char* field_def_str(T v) {
+    if constexpr (std::is_arithmetic_v<T>) return nullptr;
+    else return v;
+}
+
+static constexpr ConfigField s_fields[] = {
+#define X(key, member, type, min, max, def, flags)                          \
+    { #key, (uint16_t)offsetof(Config, member),                             \
+      (uint16_t)sizeof(std::declval<Config&>().member), type, flags,        \
+      (uint32_t)(min), (uint32_t)(max), field_def_num(def), field_def_str(def) },
+    CONFIG_FIELDS(X)
+#undef X
+};
+
+static constexpr size_t FIELD_COUNT = sizeof(s_fields) / sizeof(s_fields[0]);
+
+enum FieldIndex : uint8_t {
+#define X(key, ...) FIELD_##key,
+    CONFIG_FIELDS(X)
+#undef X
+};
+
+template <typename... T>
+static constexpr uint8_t enum_count(T...) { return (uint8_t)sizeof...(T); }
+
+struct FieldEnum {
+    uint8_t  field;
+    uint8_t  count;
+    uint32_t values[CONFIG_ENUM_MAX];
+};
+
+static constexpr FieldEnum s_enums[] = {
+#define E(key, ...) { FIELD_##key, enum_count(__VA_ARGS__), { __VA_ARGS__ } },
+    CONFIG_ENUMS(E)
+#undef E
+};
+
+/** @return true if v is one of the CONFIG_ENUMS values of the field at index. */
+static bool enum_allows(size_t index, uint32_t v) {
+    for (const FieldEnum& e : s_enums) {
+        if (e.field != index) continue;
+        for (uint8_t i = 0; i < e.count; ++i) {
+            if (e.values[i] == v) return true;
+        }
+        return false;
+    }
+    return false;
+}
+
+struct KeyEntry {
+    const char* name;
+    uint8_t     field;
+};
+
+static constexpr KeyEntry s_keys[] = {
+#define X(key, ...) { #key, FIELD_##key },
+    CONFIG_FIELDS(X)
+#undef X
+#define A(alias, key) { #alias, FIELD_##key },
+    CONFIG_ALIASES(A)
+#undef A
+};
+
+static constexpr size_t   KEY_COUNT   = sizeof(s_keys) / sizeof(s_keys[0]);
+static constexpr uint32_t KEY_BUCKETS = 128;
+static constexpr uint8_t  KEY_EMPTY   = 0xFF;
+
+static_assert(KEY_COUNT < KEY_EMPTY, "key index must fit into a bucket byte");
+static_assert((KEY_BUCKETS & (KEY_BUCKETS - 1)) == 0, "bucket count must be a power of two");
+
+/**
+ * @brief Seeded FNV-1a hash of a NUL-terminated key.
+ */
+static constexpr uint32_t key_hash(const char* s, uint32_t seed) {
+    uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u);
+    while (*s) {
+        h ^= (uint8_t)*s++;
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+struct KeyTable {
+    bool     valid;
+    uint32_t seed;
+    uint8_t  slot[KEY_BUCKETS];
+};
+
+/**
+ * @brief Find a seed for which every key and alias lands in its own bucket.
+ *
+ * Evaluated at compile time; the resulting table makes config_field_find() a
+ * single probe. A static_assert fails the build if no seed is found.
+ */
+static constexpr KeyTable build_key_table() {
+    for (uint32_t seed = 0; seed < 4096; ++seed) {
+        KeyTable t{true, seed, {}};
+        for (uint32_t b = 0; b < KEY_BUCKETS; ++b) t.slot[b] = KEY_EMPTY;
+        for (size_t i = 0; i < KEY_COUNT && t.valid; ++i) {
+            const uint32_t b = key_hash(s_keys[i].name, seed) & (KEY_BUCKETS - 1);
+            if (t.slot[b] != KEY_EMPTY) t.valid = false;
+            else t.slot[b] = (uint8_t)i;
+        }
+        if (t.valid) return t;
+    }
+    return KeyTable{false, 0, {}};
+}
+
+static constexpr KeyTable s_key_table = build_key_table();
+static_assert(s_key_table.valid, "no collision-free seed for the config key hash; raise KEY_BUCKETS");
+
+/**
+ * @brief Look up a field by CLI key or alias in constant time.
+ *
+ * @param key Lowercase, trimmed key.
+ * @return The field, or nullptr if the key is unknown.
+ */
+const ConfigField* config_field_find(const char* key) {
+    const uint8_t idx = s_key_table.slot[key_hash(key, s_key_table.seed) & (KEY_BUCKETS - 1)];
+    if (idx == KEY_EMPTY || strcmp(s_keys[idx].name, key) != 0) return nullptr;
+    return &s_fields[s_keys[idx].field];
+}
+
+/** @return Number of schema fields (aliases not included). */
+size_t config_field_count() { return FIELD_COUNT; }
+
+/**
+ * @param index 0..config_field_count()-1, in CONFIG_FIELDS order.
+ * @return The field, or nullptr if index is out of range.
+ */
+const ConfigField* config_field_at(size_t index) {
+    return index < FIELD_COUNT ? &s_fields[index] : nullptr;
+}
+
+/**
+ * @brief Store a numeric value into a U8/U16/U32 field.
+ */
+static void store_number(uint8_t* dst, FieldType type, uint32_t v) {
+    switch (type) {
+    case FieldType::U8:  { uint8_t  x = (uint8_t)v;  memcpy(dst, &x, sizeof(x)); break; }
+    case FieldType::U16: { uint16_t x = (uint16_t)v; memcpy(dst, &x, sizeof(x)); break; }
+    default:             memcpy(dst, &v, sizeof(v)); break;
+    }
+}
+
+/**
+ * @brief Read a numeric value from a U8/U16/U32 field.
+ */
+static uint32_t load_number(const uint8_t* src, FieldType type) {
+    switch (type) {
+    case FieldType::U8:  return *src;
+    case FieldType::U16: { uint16_t x; memcpy(&x, src, sizeof(x)); return x; }
+    default:             { uint32_t x; memcpy(&x, src, sizeof(x)); return x; }
+    }
+}
+
+/**
+ * @brief Parse, validate and store a CLI value into a field.
+ *
+ * Numeric fields accept decimal integers within [min, max]; with CFG_F_CLAMP,
+ * values outside the range are clamped instead of rejected; a CFG_F_ENUM field
+ * rejects anything not listed in CONFIG_ENUMS. String fields are
+ * truncated to fit; with CFG_F_DASH_EMPTY, "-" stores an empty string. A field
+ * with CFG_F_WIFI_IDENTITY clears the Wi-Fi reconnect cache when it is set.
+ *
+ * @param cfg   Configuration to modify.
+ * @param field Target field (from config_field_find()).
+ * @param value Trimmed, non-empty value text.
+ * @return FieldSetResult::Ok on success; ReadOnly, BadValue or OutOfRange otherwise
+ *         (cfg is unchanged on failure).
+ */
+FieldSetResult config_field_set(Config& cfg, const ConfigField& field, const char* value) {
+    if (field.flags & CFG_F_RO) return FieldSetResult::ReadOnly;
+
+    uint8_t* dst = reinterpret_cast<uint8_t*>(&cfg) + field.offset;
+
+    switch (field.type) {
+    case FieldType::U8:
+    case FieldType::U16:
+    case FieldType::U32: {
+        char* end = nullptr;
+        const unsigned long long v = strtoull(value, &end, 10);
+        if (end == value || *end != '\0' || value[0] == '-') return FieldSetResult::BadValue;
+        uint64_t x = v;
+        if (x < field.min || x > field.max) {
+            if (!(field.flags & CFG_F_CLAMP)) return FieldSetResult::OutOfRange;
+            x = (x < field.min) ? field.min : field.max;
+        }
+        if ((field.flags & CFG_F_ENUM) && !enum_allows((size_t)(&field - s_fields), (uint32_t)x)) {
+            return FieldSetResult::OutOfRange;
+        }
+        store_number(dst, field.type, (uint32_t)x);
+        break;
+    }
+    case FieldType::Str: {
+        const char* src = ((field.flags & CFG_F_DASH_EMPTY) && strcmp(value, "-") == 0) ? "" : value;
+        snprintf(reinterpret_cast<char*>(dst), field.size, "%s", src);
+        break;
+    }
+    default:
+        return FieldSetResult::ReadOnly;
+    }
+
+    if (field.flags & CFG_F_WIFI_IDENTITY) {
+        memset(cfg.wifi_bssid, 0, sizeof(cfg.wifi_bssid));
+        cfg.wifi_channel = 0;
+        cfg.wifi_ip = cfg.wifi_netmask = cfg.wifi_gateway = 0;
+    }
+    return FieldSetResult::Ok;
+}
+
+/**
+ * @brief Format a field as a "key=value" line (with trailing newline).
+ *
+ * @param cfg   Configuration to read.
+ * @param field Field to format.
+ * @param out   Output buffer.
+ * @param len   Size of out.
+ * @return snprintf() result (number of characters that would have been written).
+ */
+int config_field_format(const Config& cfg, const ConfigField& field, char* out, size_t len) {
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(&cfg) + field.offset;
+
+    switch (field.type) {
+    case FieldType::Str:
+        return snprintf(out, len, "%s=%.*s\n", field.name, (int)field.size, reinterpret_cast<const char*>(src));
+    case FieldType::Mac:
+        return snprintf(out, len, "%s=%02x:%02x:%02x:%02x:%02x:%02x\n", field.name,
+                        src[0], src[1], src[2], src[3], src[4], src[5]);
+    case FieldType::Ip4:
+        return snprintf(out, len, "%s=%u.%u.%u.%u\n", field.name, src[0], src[1], src[2], src[3]);
+    default:
+        return snprintf(out, len, "%s=%u\n", field.name, (unsigned)load_number(src, field.type));
+    }
+}
+
+/**
+ * @brief Write the factory default of every schema field into cfg.
+ *
+ * String fields are cleared and copied truncation-safely; read-only cache fields
+ * are zeroed. magic, version, reserved and crc32 are left untouched.
+ *
+ * @param cfg Configuration to fill.
+ */
+void config_fields_set_defaults(Config& cfg) {
+    for (const ConfigField& f : s_fields) {
+        uint8_t* dst = reinterpret_cast<uint8_t*>(&cfg) + f.offset;
+        if (f.type == FieldType::Str) {
+            memset(dst, 0, f.size);
+            if (f.def_str) strncpy(reinterpret_cast<char*>(dst), f.def_str, f.size - 1u);
+        } else if (f.type == FieldType::U8 || f.type == FieldType::U16 || f.type == FieldType::U32) {
+            store_number(dst, f.type, f.def_num);
+        } else {
+            memset(dst, 0, f.size);
+        }
+    }
+}
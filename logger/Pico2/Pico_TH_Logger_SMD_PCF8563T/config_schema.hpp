@@ -0,0 +1,179 @@
+/**
+ * @file config_schema.hpp
+ * @brief Compile-time description of every user-visible Config field.
+ *
+ * CONFIG_FIELDS is the single list of settings. Each entry names the CLI key, the
+ * Config member, its type, the accepted range, the factory default and behavior
+ * flags. Everything that used to repeat the field list by hand is generated from it:
+ * - CLI key lookup: a perfect hash over all keys and aliases (CONFIG_ALIASES), found
+ *   by a constexpr seed search at compile time; a lookup is one hash, one table read
+ *   and one string compare regardless of the number of fields.
+ * - Parsing and validation of "set" values (config_field_set()).
+ * - The "show" output, in table order (config_field_format()).
+ * - Factory defaults (config_fields_set_defaults()).
+ * - Migration from older flash layouts (config_fields_migrate()): every field whose
+ *   member also exists in the legacy struct is copied by name, truncated to the
+ *   current size; all others keep their defaults.
+ *
+ * Adding a setting:
+ * 1. Add the member to Config (config.hpp) and bump CONFIG_VERSION, keeping the
+ *    previous layout as a ConfigVn struct for migration.
+ * 2. Add one X(...) line to CONFIG_FIELDS.
+ *
+ * Entry format: X(key, member, type, min, max, default, flags)
+ * - key:     CLI name (identifier; also used to generate helper names).
+ * - member:  Config member expression (array elements allowed, e.g. ntp_servers[0]).
+ * - type:    FieldType (U8/U16/U32 numeric, Str null-terminated string, Mac 6 bytes,
+ *            Ip4 IPv4 address in network byte order).
+ * - min/max: Inclusive range for numeric types (ignored otherwise).
+ * - default: Factory value (number or string literal; 0 for read-only cache fields).
+ * - flags:   CFG_F_* bit set. A CFG_F_ENUM field also needs an E(...) line in
+ *            CONFIG_ENUMS listing its accepted values.
+ *
+ * Thread-safety:
+ * - The tables are immutable; the functions operate on the Config passed in.
+ */
+#pragma once
+#ifndef __CONFIG_SCHEMA_HPP__
+#define __CONFIG_SCHEMA_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include <utility>
+
+#include "config.hpp"
+#include "main.hpp"
+
+enum class FieldType : uint8_t {
+    U8  = 0,
+    U16 = 1,
+    U32 = 2,
+    Str = 3,
+    Mac = 4,
+    Ip4 = 5,
+};
+
+#define CFG_F_RO            0x01    // shown but not settable (firmware-maintained)
+#define CFG_F_WIFI_APPLY    0x02    // changing it re-applies the Wi-Fi configuration
+#define CFG_F_WIFI_IDENTITY 0x04    // changing it invalidates the Wi-Fi reconnect cache
+#define CFG_F_DASH_EMPTY    0x08    // "-" stores an empty string
+#define CFG_F_CLAMP         0x10    // out-of-range numbers are clamped instead of rejected
+#define CFG_F_ENUM          0x20    // only the values listed in CONFIG_ENUMS are accepted
+
+#define CONFIG_FIELDS(X) \
+    X(logger_id,       logger_id,        FieldType::U32, 0, UINT32_MAX, LOGGER_ID,      0)                   \
+    X(sensor_id,       sensor_id,        FieldType::U32, 0, UINT32_MAX, SENSOR_ID,      0)                   \
+    X(server_ip,       server_ip,        FieldType::Str, 0, 0,          SERVER_IP,      0)                   \
+    X(server_port,     server_port,      FieldType::U16, 0, 65535,      SERVER_PORT,    0)                   \
+    X(temperature,     temperature,      FieldType::U8,  0, 1,          TEMPERATURE,    0)                   \
+    X(humidity,        humidity,         FieldType::U8,  0, 1,          HUMIDITY,       0)                   \
+    X(pressure,        pressure,         FieldType::U8,  0, 1,          PRESSURE,       0)                   \
+    X(sht,             sht,              FieldType::U8,  0, 40,         SHT,            CFG_F_ENUM)          \
+    X(clock,           clock_enabled,    FieldType::U8,  0, 1,          CLOCK,          0)                   \
+    X(set_time,        set_time_enabled, FieldType::U8,  0, 1,          SET_TIME,       0)                   \
+    X(logging_enabled, logging_enabled,  FieldType::U8,  0, 1,          LOGGING_ENABLE, 0)                   \
+    X(wifi_enabled,    wifi_enabled,     FieldType::U8,  0, 1,          WIFI_ENABLE,    CFG_F_WIFI_APPLY)    \
+    X(wifi_ssid,       wifi_ssid,        FieldType::Str, 0, 0,          WIFI_SSID,      CFG_F_WIFI_IDENTITY) \
+    X(wifi_password,   wifi_password,    FieldType::Str, 0, 0,          WIFI_PASSWORD,  0)                   \
+    X(post_time_ms,    post_time_ms,     FieldType::U32, 1000, UINT32_MAX, POST_TIME,   CFG_F_CLAMP)         \
+    X(ntp_server1,     ntp_servers[0],   FieldType::Str, 0, 0,          NTP_SERVER_1,   CFG_F_DASH_EMPTY)    \
+    X(ntp_server2,     ntp_servers[1],   FieldType::Str, 0, 0,          NTP_SERVER_2,   CFG_F_DASH_EMPTY)    \
+    X(ntp_server3,     ntp_servers[2],   FieldType::Str, 0, 0,          NTP_SERVER_3,   CFG_F_DASH_EMPTY)    \
+    X(wifi_bssid,      wifi_bssid,       FieldType::Mac, 0, 0,          0,              CFG_F_RO)            \
+    X(wifi_channel,    wifi_channel,     FieldType::U8,  0, 14,         0,              CFG_F_RO)            \
+    X(wifi_ip,         wifi_ip,          FieldType::Ip4, 0, 0,          0,              CFG_F_RO)            \
+    X(wifi_netmask,    wifi_netmask,     FieldType::Ip4, 0, 0,          0,              CFG_F_RO)            \
+    X(wifi_gateway,    wifi_gateway,     FieldType::Ip4, 0, 0,          0,              CFG_F_RO)
+
+// A(alias, key): alternative CLI names resolved by the same perfect hash.
+#define CONFIG_ALIASES(A) \
+    A(wifi,          wifi_enabled) \
+    A(set,           set_time)     \
+    A(clock_enabled, clock)
+
+// E(key, values...): accepted values of a CFG_F_ENUM field (at most CONFIG_ENUM_MAX).
+#define CONFIG_ENUM_MAX 4
+#define CONFIG_ENUMS(E) \
+    E(sht, 0, 30, 40)
+
+static_assert(CONFIG_NTP_SERVERS == 3, "CONFIG_FIELDS lists exactly three ntp_server keys");
+
+struct ConfigField {
+    const char* name;
+    uint16_t    offset;
+    uint16_t    size;
+    FieldType   type;
+    uint8_t     flags;
+    uint32_t    min;
+    uint32_t    max;
+    uint32_t    def_num;
+    const char* def_str;
+};
+
+enum class FieldSetResult : uint8_t {
+    Ok         = 0,
+    ReadOnly   = 1,
+    BadValue   = 2,
+    OutOfRange = 3,
+};
+
+const ConfigField* config_field_find(const char* key);
+size_t             config_field_count();
+const ConfigField* config_field_at(size_t index);
+FieldSetResult     config_field_set(Config& cfg, const ConfigField& field, const char* value);
+int                config_field_format(const Config& cfg, const ConfigField& field, char* out, size_t len);
+void               config_fields_set_defaults(Config& cfg);
+
+namespace config_schema_detail {
+
+#define X(key, member, type, min, max, def, flags)                                              \
+    template <typename T, typename = void> struct has_##key : std::false_type {};                \
+    template <typename T>                                                                          \
+    struct has_##key<T, std::void_t<decltype(std::declval<T&>().member)>> : std::true_type {};
+CONFIG_FIELDS(X)
+#undef X
+
+template <size_t N, size_t M>
+inline void copy_member(char (&dst)[N], const char (&src)[M]) {
+    const size_t n = (N - 1 < M) ? N - 1 : M;
+    memset(dst, 0, N);
+    strncpy(dst, src, n);
+}
+
+template <typename T, size_t N, size_t M>
+inline void copy_member(T (&dst)[N], const T (&src)[M]) {
+    memcpy(dst, src, (N < M ? N : M) * sizeof(T));
+}
+
+template <typename D, typename S>
+inline void copy_member(D& dst, const S& src) {
+    dst = static_cast<D>(src);
+}
+
+} // namespace config_schema_detail
+
+/**
+ * @brief Copy every schema field that exists (by member name) in a legacy layout.
+ *
+ * Starts from the factory defaults, so fields added after the legacy version keep
+ * them. Strings are truncated to the current buffer size and always terminated.
+ * magic, version, reserved and crc32 are not schema fields and are left to the caller.
+ *
+ * @tparam Legacy Older Config layout (ConfigV3, ConfigV4, ...).
+ * @param dst Configuration to fill.
+ * @param old Validated legacy image.
+ */
+template <typename Legacy>
+void config_fields_migrate(Config& dst, const Legacy& old) {
+    config_fields_set_defaults(dst);
+#define X(key, member, type, min, max, def, flags)                        \
+    if constexpr (config_schema_detail::has_##key<Legacy>::value) {      \
+        config_schema_detail::copy_member(dst.member, old.member);       \
+    }
+    CONFIG_FIELDS(X)
+#undef X
+}
+
+#endif /* __CONFIG_SCHEMA_HPP__ */
@@ -0,0 +1,122 @@
+#include "net_stats.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "lwip/opt.h"
+#include "lwip/memp.h"
+#include "lwip/stats.h"
+
+static uint32_t s_rexmit = 0;
+static uint32_t s_timeouts = 0;
+
+#if MEMP_STATS
+// Same X-macro lwIP uses to build its pool table, so the names follow MEMP_MAX.
+static const char* const s_memp_names[] = {
+#define LWIP_MEMPOOL(name, num, size, desc) #name,
+#include "lwip/priv/memp_std.h"
+};
+#endif
+
+/**
+ * @brief Count retransmissions on a client connection.
+ *
+ * lwIP keeps, per PCB, the number of retransmissions of the oldest unacknowledged
+ * segment (nrtx) and clears it when new data is acknowledged. Called on every
+ * iteration of a wait loop, each increase is added to the total.
+ *
+ * @param nrtx Current pcb->nrtx.
+ * @param seen Per-connection state, 0 when the connection is opened.
+ */
+void net_stats_track_rexmit(uint8_t nrtx, uint8_t& seen) {
+    if (nrtx > seen) s_rexmit += (uint32_t)(nrtx - seen);
+    seen = nrtx;
+}
+
+/** @brief Count a request that ran into its deadline without an answer. */
+void net_stats_note_timeout() { s_timeouts++; }
+
+#if LWIP_STATS
+/** @brief Format one lwIP protocol counter block. */
+static void report_proto(void (*emit)(const char*), const char* tag, const struct stats_proto& p) {
+    char line[128];
+    snprintf(line, sizeof(line), "%s xmit=%lu recv=%lu drop=%lu memerr=%lu rterr=%lu err=%lu\n",
+             tag, (unsigned long)p.xmit, (unsigned long)p.recv, (unsigned long)p.drop,
+             (unsigned long)p.memerr, (unsigned long)p.rterr, (unsigned long)p.err);
+    emit(line);
+}
+#endif
+
+/**
+ * @brief Emit the "netstats" report, one line per call of @p emit.
+ *
+ * @param emit Line sink (each line is '\n'-terminated); the last line is NETSTATS_END.
+ */
+void net_stats_report(void (*emit)(const char* line)) {
+    char line[160];
+    snprintf(line, sizeof(line),
+             "NET profile=%s stats=%u mem_size=%u pbuf_pool=%u snd_buf=%u wnd=%u tcp_seg=%u rexmit=%lu timeouts=%lu\n",
+             LOGGER_NET_PROFILE_NAME, (unsigned)LOGGER_NET_STATS, (unsigned)MEM_SIZE,
+             (unsigned)PBUF_POOL_SIZE, (unsigned)TCP_SND_BUF, (unsigned)TCP_WND,
+             (unsigned)MEMP_NUM_TCP_SEG, (unsigned long)s_rexmit, (unsigned long)s_timeouts);
+    emit(line);
+
+#if MEM_STATS
+    snprintf(line, sizeof(line), "LWIP_MEM used=%lu peak=%lu avail=%lu err=%lu\n",
+             (unsigned long)lwip_stats.mem.used, (unsigned long)lwip_stats.mem.max,
+             (unsigned long)lwip_stats.mem.avail, (unsigned long)lwip_stats.mem.err);
+    emit(line);
+#endif
+#if MEMP_STATS
+    for (size_t i = 0; i < (size_t)MEMP_MAX; ++i) {
+        const struct stats_mem* m = lwip_stats.memp[i];
+        if (!m) continue;
+        snprintf(line, sizeof(line), "MEMP name=%s used=%lu peak=%lu avail=%lu err=%lu\n",
+                 s_memp_names[i], (unsigned long)m->used, (unsigned long)m->max,
+                 (unsigned long)m->avail, (unsigned long)m->err);
+        emit(line);
+    }
+#endif
+#if LINK_STATS
+    report_proto(emit, "LINK", lwip_stats.link);
+#endif
+#if TCP_STATS
+    report_proto(emit, "TCP", lwip_stats.tcp);
+#endif
+#if UDP_STATS
+    report_proto(emit, "UDP", lwip_stats.udp);
+#endif
+    emit("NETSTATS_END\n");
+}
+
+/**
+ * @brief Start a new measurement window.
+ *
+ * Clears the firmware counters, lwIP's error and protocol counters, and lowers
+ * every high-water mark to the current use.
+ */
+void net_stats_reset() {
+    s_rexmit = 0;
+    s_timeouts = 0;
+#if MEM_STATS
+    lwip_stats.mem.max = lwip_stats.mem.used;
+    lwip_stats.mem.err = 0;
+#endif
+#if MEMP_STATS
+    for (size_t i = 0; i < (size_t)MEMP_MAX; ++i) {
+        struct stats_mem* m = lwip_stats.memp[i];
+        if (!m) continue;
+        m->max = m->used;
+        m->err = 0;
+    }
+#endif
+#if LINK_STATS
+    memset(&lwip_stats.link, 0, sizeof(lwip_stats.link));
+#endif
+#if TCP_STATS
+    memset(&lwip_stats.tcp, 0, sizeof(lwip_stats.tcp));
+#endif
+#if UDP_STATS
+    memset(&lwip_stats.udp, 0, sizeof(lwip_stats.udp));
+#endif
+}
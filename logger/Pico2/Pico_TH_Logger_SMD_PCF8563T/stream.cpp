@@ -0,0 +1,285 @@
+#include "stream.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#include "pico/stdlib.h"
+#include "com.hpp"
+
+struct StreamSample {
+    uint32_t        seq;
+    uint64_t        t_us;
+    BME280::Raw_t   raw;
+    BME280::Fixed_t val;
+};
+
+struct StreamField {
+    const char* name;
+    const char* column;
+    uint8_t     bit;
+};
+
+static const StreamField s_field_names[] = {
+    { "t",  "t_c100", STREAM_F_T  },
+    { "h",  "h_q10",  STREAM_F_H  },
+    { "p",  "p_q8",   STREAM_F_P  },
+    { "rt", "raw_t",  STREAM_F_RT },
+    { "rh", "raw_h",  STREAM_F_RH },
+    { "rp", "raw_p",  STREAM_F_RP },
+};
+
+static bool     s_active = false;
+static bool     s_request = false;
+static uint16_t s_rate_hz = 0;
+static uint8_t  s_fields = STREAM_F_T | STREAM_F_H | STREAM_F_P;
+static uint32_t s_period_us = 0;
+static uint64_t s_next_us = 0;
+static uint64_t s_next_stat_us = 0;
+
+static StreamSample s_ring[STREAM_RING_LEN];
+static uint16_t s_head = 0;
+static uint16_t s_count = 0;
+static uint32_t s_seq = 0;
+static uint32_t s_dropped = 0;
+static uint32_t s_errors = 0;
+
+/**
+ * @brief Write the selected field names as a comma separated list.
+ *
+ * @param out     Output buffer.
+ * @param len     Size of out.
+ * @param columns true for STREAM_FMT column names, false for CLI names.
+ */
+static void format_fields(char* out, size_t len, bool columns) {
+    size_t used = 0;
+    out[0] = '\0';
+    for (const StreamField& f : s_field_names) {
+        if (!(s_fields & f.bit)) continue;
+        int m = snprintf(out + used, len - used, "%s%s", used ? "," : "", columns ? f.column : f.name);
+        if (m < 0 || (size_t)m >= len - used) break;
+        used += (size_t)m;
+    }
+}
+
+/**
+ * @brief Parse a "t,h,p,rt,rh,rp" or "all" list into STREAM_F_* bits.
+ *
+ * @param list Comma separated, lowercase field names.
+ * @param mask Receives the bit set on success.
+ * @return false on an unknown name or an empty list.
+ */
+bool stream_parse_fields(const char* list, uint8_t& mask) {
+    if (strcmp(list, "all") == 0) {
+        mask = STREAM_F_ALL;
+        return true;
+    }
+    uint8_t bits = 0;
+    const char* p = list;
+    while (*p) {
+        const char* end = strchr(p, ',');
+        const size_t n = end ? (size_t)(end - p) : strlen(p);
+        bool found = false;
+        for (const StreamField& f : s_field_names) {
+            if (strlen(f.name) == n && strncmp(f.name, p, n) == 0) {
+                bits |= f.bit;
+                found = true;
+                break;
+            }
+        }
+        if (!found) return false;
+        p += n;
+        if (*p == ',') ++p;
+    }
+    if (!bits) return false;
+    mask = bits;
+    return true;
+}
+
+/**
+ * @brief Request streaming at rate_hz with the given fields.
+ *
+ * The sensor is reconfigured by ProgramMain::stream_tick() on the next main loop
+ * pass (stream_take_request()), which then reports the applied rate via
+ * stream_started(). Counters and the ring are reset.
+ *
+ * @param rate_hz 1..STREAM_MAX_RATE_HZ (the sensor may limit it further).
+ * @param fields  STREAM_F_* bit set.
+ */
+void stream_start(uint16_t rate_hz, uint8_t fields) {
+    s_rate_hz = rate_hz;
+    s_fields = fields;
+    s_head = s_count = 0;
+    s_seq = s_dropped = s_errors = 0;
+    s_active = false;
+    s_request = true;
+}
+
+/**
+ * @brief Stop streaming; queued samples are discarded and a summary line is sent.
+ *
+ * The sensor is returned to forced mode by ProgramMain::stream_tick().
+ */
+void stream_stop() {
+    if (!s_active && !s_request) return;
+    const bool was_active = s_active;
+    s_active = false;
+    s_rate_hz = 0;
+    s_request = true;
+    s_head = s_count = 0;
+    if (was_active) {
+        char line[96];
+        snprintf(line, sizeof(line), "STREAM_OFF seq=%lu dropped=%lu errors=%lu\n",
+                 (unsigned long)s_seq, (unsigned long)s_dropped, (unsigned long)s_errors);
+        com_write_str(line);
+    }
+}
+
+/** @return true while samples are being produced. */
+bool stream_active() { return s_active; }
+
+/**
+ * @brief Fetch a pending start/stop request (consumed by the sensor owner).
+ *
+ * @param on      Receives true for start, false for stop.
+ * @param rate_hz Receives the requested rate when starting.
+ * @return true if a request was pending.
+ */
+bool stream_take_request(bool& on, uint16_t& rate_hz) {
+    if (!s_request) return false;
+    s_request = false;
+    on = s_rate_hz != 0;
+    rate_hz = s_rate_hz;
+    return true;
+}
+
+/**
+ * @brief Begin producing samples after the sensor has been switched to normal mode.
+ *
+ * @param rate_hz Applied sample rate (requested rate clamped to the sensor ODR).
+ * @param odr_us  Sensor conversion cycle (measurement + standby time).
+ */
+void stream_started(uint16_t rate_hz, uint32_t odr_us) {
+    s_rate_hz = rate_hz;
+    s_period_us = 1000000u / rate_hz;
+    const uint64_t now = time_us_64();
+    s_next_us = now + s_period_us;
+    s_next_stat_us = now + 1000000u;
+    s_active = true;
+
+    char names[32];
+    char line[128];
+    format_fields(names, sizeof(names), false);
+    snprintf(line, sizeof(line), "STREAM_ON rate=%u odr_us=%lu fields=%s t0_us=%llu\n",
+             (unsigned)rate_hz, (unsigned long)odr_us, names, (unsigned long long)now);
+    com_write_str(line);
+    format_fields(names, sizeof(names), true);
+    snprintf(line, sizeof(line), "STREAM_FMT seq,t_us,%s\n", names);
+    com_write_str(line);
+}
+
+/**
+ * @brief Check whether the next sample is due and advance the schedule.
+ *
+ * If the loop fell behind by more than one period the schedule restarts from
+ * now instead of producing a burst of back-to-back reads of the same conversion.
+ *
+ * @param now_us time_us_64().
+ * @return true if a sample should be taken now.
+ */
+bool stream_due(uint64_t now_us) {
+    if (!s_active || now_us < s_next_us) return false;
+    s_next_us += s_period_us;
+    if (s_next_us <= now_us) s_next_us = now_us + s_period_us;
+    return true;
+}
+
+/**
+ * @brief Queue one sample; drops (and counts) it if the ring is full.
+ *
+ * @param t_us Read time, microseconds since boot.
+ * @param raw  Raw ADC counts.
+ * @param val  Compensated values.
+ */
+void stream_push(uint64_t t_us, const BME280::Raw_t& raw, const BME280::Fixed_t& val) {
+    const uint32_t seq = s_seq++;
+    if (s_count == STREAM_RING_LEN) {
+        s_dropped++;
+        return;
+    }
+    StreamSample& s = s_ring[(s_head + s_count) % STREAM_RING_LEN];
+    s.seq = seq;
+    s.t_us = t_us;
+    s.raw = raw;
+    s.val = val;
+    s_count++;
+}
+
+/** @brief Count a failed sensor read (the sample slot is skipped). */
+void stream_read_error() {
+    s_seq++;
+    s_errors++;
+}
+
+/**
+ * @brief Format one sample as a "D,..." line.
+ *
+ * @return Line length, or a negative value on a formatting error.
+ */
+static int format_sample(const StreamSample& s, char* out, size_t len) {
+    int used = snprintf(out, len, "D,%lu,%llu", (unsigned long)s.seq, (unsigned long long)s.t_us);
+    const long values[6] = {
+        (long)s.val.temperature_c100, (long)s.val.humidity_q10, (long)s.val.pressure_q8,
+        (long)s.raw.temperature, (long)s.raw.humidity, (long)s.raw.pressure,
+    };
+    for (size_t i = 0; i < 6 && used > 0 && (size_t)used < len; ++i) {
+        if (!(s_fields & s_field_names[i].bit)) continue;
+        used += snprintf(out + used, len - (size_t)used, ",%ld", values[i]);
+    }
+    if (used < 0 || (size_t)used + 1 >= len) return -1;
+    out[used++] = '\n';
+    return used;
+}
+
+/**
+ * @brief Move queued samples into the CDC TX ring while whole lines fit.
+ *
+ * Called from com_poll() before the TX ring is drained. Also emits the
+ * once-per-second STREAM_STAT line.
+ */
+void stream_drain() {
+    if (!s_active) return;
+
+    char line[128];
+    while (s_count > 0) {
+        const int m = format_sample(s_ring[s_head], line, sizeof(line));
+        if (m > 0 && (size_t)m > com_tx_free()) break;
+        if (m > 0) com_write(line, (size_t)m);
+        s_head = (uint16_t)((s_head + 1) % STREAM_RING_LEN);
+        s_count--;
+    }
+
+    const uint64_t now = time_us_64();
+    if (now >= s_next_stat_us) {
+        s_next_stat_us = now + 1000000u;
+        snprintf(line, sizeof(line), "STREAM_STAT seq=%lu dropped=%lu errors=%lu\n",
+                 (unsigned long)s_seq, (unsigned long)s_dropped, (unsigned long)s_errors);
+        com_write_str(line);
+    }
+}
+
+/**
+ * @brief Format the "stream" status reply.
+ *
+ * @param out Output buffer.
+ * @param len Size of out.
+ */
+void stream_status_line(char* out, size_t len) {
+    char names[32];
+    format_fields(names, sizeof(names), false);
+    snprintf(out, len, "STREAM active=%u rate=%u fields=%s seq=%lu dropped=%lu errors=%lu\n",
+             s_active ? 1u : 0u, (unsigned)(s_active ? s_rate_hz : 0), names,
+             (unsigned long)s_seq, (unsigned long)s_dropped, (unsigned long)s_errors);
+}
+
+/** @return Samples dropped because the stream ring was full. */
+uint32_t stream_dropped() { return s_dropped; }
@@ -0,0 +1,66 @@
+/**
+ * @file stream.hpp
+ * @brief High-rate live sample streaming over USB CDC (calibration runs).
+ *
+ * "stream on rate=N fields=..." switches the BME280 to normal mode at an output
+ * data rate close to N Hz and pushes every reading, raw and compensated, to the
+ * host as compact text lines; "stream off" returns the sensor to forced mode.
+ *
+ * Data path:
+ * - ProgramMain::stream_tick() reads the sensor when a sample is due and calls
+ *   stream_push(); this never blocks on USB.
+ * - Samples wait in a STREAM_RING_LEN entry RAM ring. When it is full the new
+ *   sample is dropped and counted; its sequence number is still consumed, so the
+ *   host sees the gap.
+ * - stream_drain() (from com_poll()) formats queued samples into the CDC TX ring
+ *   only while there is room for a whole line, so console output is never cut.
+ *
+ * Output (one line each):
+ * - STREAM_ON rate=<hz> odr_us=<sensor cycle> fields=<list> t0_us=<boot time>
+ * - STREAM_FMT seq,t_us,<column per field>     (column order is fixed, see below)
+ * - D,<seq>,<t_us>,<values...>                  (one per sample)
+ * - STREAM_STAT seq=<n> dropped=<n> errors=<n>  (once per second)
+ * - STREAM_OFF seq=<n> dropped=<n> errors=<n>
+ *
+ * Fields (in column order): t (t_c100, 0.01 °C), h (h_q10, 1/1024 %RH),
+ * p (p_q8, 1/256 Pa), rt / rh / rp (raw ADC counts). All values are integers
+ * so they are exact and short; t_us is microseconds since boot.
+ *
+ * Thread-safety:
+ * - Not thread-safe; use from the main loop only.
+ */
+#pragma once
+#ifndef __STREAM_HPP__
+#define __STREAM_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bme280.hpp"
+
+#define STREAM_RING_LEN         64
+#define STREAM_MAX_RATE_HZ      100
+#define STREAM_DEFAULT_RATE_HZ  10
+
+#define STREAM_F_T      0x01
+#define STREAM_F_H      0x02
+#define STREAM_F_P      0x04
+#define STREAM_F_RT     0x08
+#define STREAM_F_RH     0x10
+#define STREAM_F_RP     0x20
+#define STREAM_F_ALL    0x3F
+
+bool     stream_parse_fields(const char* list, uint8_t& mask);
+void     stream_start(uint16_t rate_hz, uint8_t fields);
+void     stream_stop();
+bool     stream_active();
+bool     stream_take_request(bool& on, uint16_t& rate_hz);
+void     stream_started(uint16_t rate_hz, uint32_t odr_us);
+bool     stream_due(uint64_t now_us);
+void     stream_push(uint64_t t_us, const BME280::Raw_t& raw, const BME280::Fixed_t& val);
+void     stream_read_error();
+void     stream_drain();
+void     stream_status_line(char* out, size_t len);
+uint32_t stream_dropped();
+
+#endif /* __STREAM_HPP__ */
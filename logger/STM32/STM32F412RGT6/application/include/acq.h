@@ -0,0 +1,43 @@
+#ifndef ACQ_H
+#define ACQ_H
+
+#include <stdint.h>
+
+/*
+ * Background SHT40 / BME280 acquisition, once per second without waiting in
+ * the main loop:
+ *   acq_start()     queues the SHT40 single shot on I2C1, sends the BME280
+ *                   forced trigger (SPI; both convert in parallel) and arms
+ *                   a countdown of ACQ_WAIT_TICKS TIM13 periods
+ *   acq_tick_isr()  TIM13 update: counts down, acq_due() turns 1 at zero,
+ *                   i.e. 10..20 ms later, past both conversion times
+ *   acq_finish()    queues the SHT40 read, stored from its I2C1 callback,
+ *                   and reads the BME280 result into the cache
+ * The SHT40 transfers run from the I2C1 IRQs; the rest is the "dead time"
+ * measured with DWT (acq_stats(), reported by 0x0901).
+ *
+ * A request with SENSOR_FRESH runs a blocking conversion instead
+ * (acq_sht40_fresh() / acq_bme280_fresh()). It first lets a background
+ * acquisition in progress finish: the SHT40 NACKs every command while it
+ * converts.
+ *
+ * Results go through acq_store_sht40() / acq_store_bme280(), provided by the
+ * application: e is 0 or an error code, the return value the final code.
+ */
+#define ACQ_WAIT_TICKS  2U
+#define ACQ_TICK_US     10000U
+
+void acq_start(void);
+void acq_tick_isr(void);
+uint8_t acq_due(void);
+void acq_finish(void);
+
+uint8_t acq_sht40_fresh(void);
+uint8_t acq_bme280_fresh(void);
+
+void acq_stats(uint32_t *cycles, uint32_t *dead_last_cyc, uint32_t *dead_max_cyc);
+
+uint8_t acq_store_sht40(uint8_t e, int16_t temp_c_x100, uint16_t rh_x100);
+uint8_t acq_store_bme280(uint8_t e, int32_t temp_c, uint32_t hum_x1024, uint32_t press_q24_8);
+
+#endif // ACQ_H
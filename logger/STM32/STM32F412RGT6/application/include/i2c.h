@@ -4,15 +4,48 @@
 #include <stdint.h>
 #include "stm32f4xx.h"
 
+/*
+ * I2C1 runs as an interrupt driven master: transactions are queued with
+ * i2c1_submit() and executed back to back from the event/error IRQs and the
+ * DMA streams, every one bounded by a TIM14 one-shot timeout in microseconds.
+ * A transaction writes tx (if any), then reads rx (if any) after a repeated
+ * START. Writes of up to I2C1_INLINE_LEN bytes are copied into the queue,
+ * longer tx and every rx buffer must stay valid until completion.
+ * Callbacks run from i2c1_poll() in the main loop and must not block.
+ * Nothing waits for a queue slot: i2c1_submit() returns I2C1_BUSY and the
+ * blocking helpers fail while all I2C1_QUEUE_LEN slots are taken.
+ */
+#define I2C1_QUEUE_LEN     8U
+#define I2C1_INLINE_LEN    4U
+
+#define I2C1_OK            0
+#define I2C1_ERR_NACK      (-1)
+#define I2C1_ERR_BUS       (-2)
+#define I2C1_ERR_TIMEOUT   (-3)
+#define I2C1_ERR_DMA       (-4)
+#define I2C1_BUSY          (-5)
+
+typedef void (*i2c1_cb_t)(int8_t status, void *ctx);
+
 void i2c1_init(void);
+void i2c1_recover(void);
+
+int i2c1_submit(uint8_t dev_addr, const uint8_t *tx, uint16_t tx_len,
+                uint8_t *rx, uint16_t rx_len, i2c1_cb_t cb, void *ctx);
+void i2c1_poll(void);
+uint8_t i2c1_idle(void);
 
-int i2c1_write_raw(uint8_t dev_addr, const uint8_t *data, uint8_t len);
-int i2c1_read_raw(uint8_t dev_addr, uint8_t *data, uint8_t len);
+void i2c1_ev_isr(void);
+void i2c1_er_isr(void);
+void i2c1_dma_tx_complete(uint8_t err);
+void i2c1_dma_rx_complete(uint8_t err);
+void i2c1_timeout_isr(void);
 
+/* Blocking helpers on top of the queue: 1 on success, -1 on error */
 int i2c1_write_raw_dma(uint8_t dev_addr, const uint8_t *data, uint16_t len);
 int i2c1_read_raw_dma(uint8_t dev_addr, uint8_t *data, uint16_t len);
 
 int i2c1_write_u8_u16_dma(uint8_t addr7, uint8_t reg, uint16_t value);
 int i2c1_read_u8_u16_dma (uint8_t addr7, uint8_t reg, uint16_t *value);
 
-#endif // I2C_H
\ No newline at end of file
+#endif // I2C_H
@@ -14,5 +14,41 @@ uint8_t ina226_is_present(void);
 
 int ina226_id(uint16_t *id, uint16_t *cal);
 
+/*
+ * Continuous logging: 16x averaged conversions (1.1 ms bus + 1.1 ms shunt,
+ * 35.2 ms per result) signalled on ALERT (PB5, conversion ready). Each result
+ * is read from the main loop through the I2C1 queue and integrated over the
+ * DWT time since the previous one; a longer stall than INA226_DT_MAX_US
+ * counts as a gap and is integrated as one nominal period. Every
+ * INA226_RING_DECIM results become one ring entry (mean and peak power).
+ */
+#define INA226_CONV_US       35200U
+#define INA226_DT_MAX_US     1000000U
+#define INA226_RING_LEN      512U
+#define INA226_RING_DECIM    8U
+#define INA226_ENTRY_US      (INA226_CONV_US * INA226_RING_DECIM)
 
-#endif // INA_H
\ No newline at end of file
+typedef struct {
+    int64_t  charge_q32;    /* C, Q32.32 */
+    uint64_t energy_q32;    /* J, Q32.32 */
+    int32_t  peak_uA;
+    uint32_t conversions;
+    uint32_t time_ms;       /* integrated time */
+    uint16_t gaps;
+    uint16_t errors;        /* failed result reads */
+} ina226_totals_t;
+
+typedef struct {
+    uint16_t avg_mW;
+    uint16_t peak_mW;
+} ina226_sample_t;
+
+int ina226_start_logging(void);
+void ina226_alert_isr(void);
+void ina226_poll(void);
+void ina226_log_reset(void);
+void ina226_totals(ina226_totals_t *t);
+uint16_t ina226_ring_count(void);
+int ina226_ring_get(uint16_t idx, ina226_sample_t *s);
+
+#endif // INA_H
@@ -0,0 +1,66 @@
+#ifndef PROF_H
+#define PROF_H
+
+#include <stdint.h>
+#include "stm32f4xx.h"
+#include "support.h"
+
+/*
+ * DWT cycle profiling: min/max/mean/count per ISR and main loop section,
+ * the same per command handler, and a log2 histogram of the main loop
+ * period (bucket k counts periods of 2^k..2^(k+1)-1 us, the last one all
+ * longer). ISR times include higher priority IRQs that preempted them.
+ */
+enum {
+    PROF_TIM13 = 0,
+    PROF_TIM14,
+    PROF_USART1,
+    PROF_USART2,
+    PROF_UART1_DMA_RX,
+    PROF_UART2_DMA_RX,
+    PROF_UART1_DMA_TX,
+    PROF_UART2_DMA_TX,
+    PROF_I2C1_EV,
+    PROF_I2C1_ER,
+    PROF_I2C1_DMA_RX,
+    PROF_I2C1_DMA_TX,
+    PROF_SPI1_DMA_RX,
+    PROF_SPI1_DMA_TX,
+    PROF_ADC_DMA,
+    PROF_EXTI0,             /* BTN1 */
+    PROF_EXTI1,             /* BTN2 */
+    PROF_EXTI9_5,           /* INA226 ALERT */
+    PROF_RTC_WKUP,
+    PROF_RTC_ALARM,
+    PROF_RTC_TAMP_STAMP,
+    PROF_SEC_1S,            /* main loop: LCD re-init, acquisition start, RTC read */
+    PROF_SEC_ACQ_FINISH,
+    PROF_SEC_LCD_REFRESH,
+    PROF_PROBE_COUNT
+};
+
+#define PROF_CMD_SLOTS      48U
+#define PROF_HIST_BUCKETS   16U
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+} prof_stat_t;
+
+void prof_add(uint8_t probe, uint32_t cycles);
+void prof_cmd_add(uint16_t cmd_id, uint32_t cycles);
+void prof_loop_add(uint32_t cycles);
+void prof_reset(void);
+
+int prof_probe_get(uint8_t probe, prof_stat_t *stat);
+int prof_cmd_get(uint8_t slot, uint16_t *cmd_id, prof_stat_t *stat);
+uint8_t prof_cmd_used(void);
+uint32_t prof_hist_get(uint8_t bucket);
+uint32_t prof_mean(const prof_stat_t *stat);
+
+#define PROF_BEGIN()        uint32_t prof_t0 = dwt_cycles()
+#define PROF_END(probe)     prof_add((probe), dwt_cycles() - prof_t0)
+
+#endif // PROF_H
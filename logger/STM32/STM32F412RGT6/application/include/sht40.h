@@ -2,10 +2,17 @@
 #define SHT40_H
 
 #include <stdint.h>
+#include "i2c.h"
+
+#define SHT40_DATA_LEN 6U
 
 uint8_t sht40_single_shot_measurement(uint8_t *data);
 uint32_t sht40_read_serial_number(void);
 uint8_t sht40_read_data(float *temp_c, float *rh);
 uint8_t sht40_data_read_int(int16_t *temp_c, uint16_t *rh);
+uint8_t sht40_start_measurement(void);
+int sht40_start_measurement_async(i2c1_cb_t cb, void *ctx);
+int sht40_fetch_async(uint8_t *data, i2c1_cb_t cb, void *ctx);
+uint8_t sht40_decode_int(const uint8_t *data, int16_t *temp_c, uint16_t *rh);
 
 #endif // SHT40_H
\ No newline at end of file
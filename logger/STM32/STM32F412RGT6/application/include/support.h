@@ -2,7 +2,21 @@
 #define SUPPORT_H
 
 #include <stdint.h>
+#include "stm32f4xx.h"
 
 uint8_t crc8_atm(const uint8_t *data, uint32_t len);
 
+void dwt_init(void);
+uint32_t dwt_cycles_to_us(uint32_t cycles);
+
+/* Bus clocks from SystemCoreClock and the RCC->CFGR APB prescalers */
+uint32_t rcc_pclk1_hz(void);
+uint32_t rcc_pclk2_hz(void);
+uint32_t rcc_apb1_timer_hz(void);
+
+static inline uint32_t dwt_cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
 #endif // SUPPORT_H
@@ -9,6 +9,9 @@ void timer2_init(uint32_t prescaler, uint32_t period);
 void timer3_init(uint32_t prescaler, uint32_t period);
 void timer4_init(uint32_t prescaler, uint32_t period);
 void timer13_init_10ms(void);
+void timer14_init_1us(void);
+void timer14_start_us(uint16_t us);
+void timer14_stop(void);
 
 void timer1_pwm_ch1_init(uint32_t prescaler, uint32_t period);
 
@@ -3,8 +3,47 @@
 
 #include <stdint.h>
 #include "stm32f4xx.h"
+#include "uart_link.h"
+
+#define UART_TX_RING_SIZE  1024U
+#define UART_RX_DMA_SIZE   1024U
+#define UART_RX_QUEUE_LEN  4U       /* power of two */
+
+typedef struct {
+    uint32_t t_rx;          /* DWT cycle count when the frame was complete */
+    uint8_t  event;         /* LINK_RX_PACKET, LINK_RX_LEGACY or LINK_RX_NAK */
+    uint8_t  duplicate;     /* LINK_RX_PACKET: already executed, answer with ACK */
+    uint8_t  nak_seq;
+    uint8_t  nak_reason;
+    link_packet_t pkt;      /* LINK_RX_LEGACY: the CRC-checked frame in pkt.payload */
+} uart_rx_frame_t;
 
 void uart1_rxtx_init(void);
 void uart2_rxtx_init(void);
 
+int uart1_tx_enqueue(const uint8_t *data, uint16_t len);
+int uart2_tx_enqueue(const uint8_t *data, uint16_t len);
+void uart1_tx_dma_complete(void);
+void uart2_tx_dma_complete(void);
+uint32_t uart1_tx_dropped(void);
+uint32_t uart2_tx_dropped(void);
+
+void uart1_rx_start(uint8_t legacy_addr, uint16_t legacy_len);
+void uart2_rx_start(uint8_t legacy_addr, uint16_t legacy_len);
+void uart1_rx_isr(void);
+void uart2_rx_isr(void);
+const uart_rx_frame_t *uart1_rx_peek(void);
+const uart_rx_frame_t *uart2_rx_peek(void);
+void uart1_rx_pop(void);
+void uart2_rx_pop(void);
+uint32_t uart1_rx_overflows(void);
+uint32_t uart2_rx_overflows(void);
+
+int uart1_baud_request(uint32_t baud);
+int uart2_baud_request(uint32_t baud);
+void uart1_baud_poll(uint32_t now_ms);
+void uart2_baud_poll(uint32_t now_ms);
+const link_baud_t *uart1_baud(void);
+const link_baud_t *uart2_baud(void);
+
 #endif // UART_H
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include "acq.h"
+#include "sht40.h"
+#include "bme280.h"
+#include "i2c.h"
+#include "systick.h"
+#include "support.h"
+
+enum { ACQ_IDLE = 0, ACQ_PENDING, ACQ_START_FAILED, ACQ_FETCHING };
+
+static uint8_t acq_sht40 = ACQ_IDLE;
+static uint8_t acq_bme280 = ACQ_IDLE;
+static uint8_t acq_sht40_buf[SHT40_DATA_LEN];
+static volatile uint8_t acq_wait = 0;
+static volatile uint8_t acq_ready = 0;
+static uint32_t acq_cycles = 0;
+static uint32_t acq_dead_cyc = 0;
+static uint32_t acq_dead_last_cyc = 0;
+static uint32_t acq_dead_max_cyc = 0;
+
+static void acq_sht40_started(int8_t status, void *ctx)
+{
+    (void)ctx;
+    if (status != I2C1_OK && acq_sht40 == ACQ_PENDING) acq_sht40 = ACQ_START_FAILED;
+}
+
+static void acq_sht40_fetched(int8_t status, void *ctx)
+{
+    (void)ctx;
+    if (acq_sht40 != ACQ_FETCHING) return;  /* a fresh read took over */
+
+    int16_t  temp_c_x100 = 0;
+    uint16_t rh_x100     = 0;
+    uint8_t e = (status == I2C1_OK) ? sht40_decode_int(acq_sht40_buf, &temp_c_x100, &rh_x100) : 3;
+    acq_store_sht40(e, temp_c_x100, rh_x100);
+    acq_sht40 = ACQ_IDLE;
+}
+
+void acq_start(void)
+{
+    uint32_t t0 = dwt_cycles();
+
+    acq_sht40 = ACQ_PENDING;
+    if (sht40_start_measurement_async(acq_sht40_started, 0) < 0) acq_sht40 = ACQ_START_FAILED;
+    acq_bme280 = (bme280_read_id() == 0x60) ? ACQ_PENDING : ACQ_START_FAILED;
+    if (acq_bme280 == ACQ_PENDING) bme280_trigger_forced();
+
+    acq_ready = 0;
+    acq_wait = ACQ_WAIT_TICKS;
+
+    acq_dead_cyc = dwt_cycles() - t0;
+}
+
+/* TIM13 update, every ACQ_TICK_US */
+void acq_tick_isr(void)
+{
+    if (acq_wait && --acq_wait == 0) acq_ready = 1;
+}
+
+/* 1 once per acquisition, when acq_finish() is due */
+uint8_t acq_due(void)
+{
+    if (!acq_ready) return 0;
+    acq_ready = 0;
+    return 1;
+}
+
+void acq_finish(void)
+{
+    uint32_t t0 = dwt_cycles();
+
+    if (acq_sht40 == ACQ_PENDING) {
+        acq_sht40 = ACQ_FETCHING;
+        if (sht40_fetch_async(acq_sht40_buf, acq_sht40_fetched, 0) < 0) {
+            acq_store_sht40(3, 0, 0);
+            acq_sht40 = ACQ_IDLE;
+        }
+    } else if (acq_sht40 == ACQ_START_FAILED) {
+        acq_store_sht40(2, 0, 0);
+        acq_sht40 = ACQ_IDLE;
+    }
+
+    if (acq_bme280 != ACQ_IDLE) {
+        int32_t  temp_c = 0;
+        uint32_t hum_x1024 = 0, press_q24_8 = 0;
+        uint8_t e = 1;
+        if (acq_bme280 == ACQ_PENDING)
+            e = bme280_read_data(&temp_c, &hum_x1024, &press_q24_8) ? 2 : 0;
+        acq_store_bme280(e, temp_c, hum_x1024, press_q24_8);
+        acq_bme280 = ACQ_IDLE;
+    }
+
+    acq_dead_cyc += dwt_cycles() - t0;
+    acq_dead_last_cyc = acq_dead_cyc;
+    if (acq_dead_cyc > acq_dead_max_cyc) acq_dead_max_cyc = acq_dead_cyc;
+    acq_cycles++;
+}
+
+/*
+ * Let a background acquisition in progress end before a blocking conversion:
+ * wait out the TIM13 countdown (one extra tick of slack in case TIM13 is
+ * late) and run acq_finish() here instead of in the main loop. Its SHT40 read
+ * is queued ahead of the caller's transfers, so the bus stays in order.
+ */
+static void acq_settle(void)
+{
+    uint32_t t0 = dwt_cycles();
+    uint32_t n = (ACQ_WAIT_TICKS + 1U) * ACQ_TICK_US * (SystemCoreClock / 1000000U);
+    while (acq_wait && (dwt_cycles() - t0) < n) {}
+
+    if (acq_wait || acq_ready) {
+        acq_wait = 0;
+        acq_ready = 0;
+        acq_finish();
+    }
+}
+
+/* Blocking single shot (~15 ms), only for a request with SENSOR_FRESH */
+uint8_t acq_sht40_fresh(void)
+{
+    acq_settle();
+    acq_sht40 = ACQ_IDLE;   /* this read consumes a pending background result */
+
+    int16_t  temp_c_x100 = 0;
+    uint16_t rh_x100     = 0;
+
+    uint8_t e = sht40_data_read_int(&temp_c_x100, &rh_x100);
+    return acq_store_sht40(e, temp_c_x100, rh_x100);
+}
+
+/* Blocking forced conversion (~10 ms), only for a request with SENSOR_FRESH */
+uint8_t acq_bme280_fresh(void)
+{
+    acq_settle();
+    acq_bme280 = ACQ_IDLE;
+
+    int32_t  temp_c = 0;
+    uint32_t hum_x1024 = 0, press_q24_8 = 0;
+
+    if (bme280_read_id() != 0x60) return acq_store_bme280(1, 0, 0, 0);
+
+    bme280_trigger_forced();
+    systick_delay_ms(10);
+
+    uint8_t e = bme280_read_data(&temp_c, &hum_x1024, &press_q24_8) ? 2 : 0;
+    return acq_store_bme280(e, temp_c, hum_x1024, press_q24_8);
+}
+
+void acq_stats(uint32_t *cycles, uint32_t *dead_last_cyc, uint32_t *dead_max_cyc)
+{
+    *cycles = acq_cycles;
+    *dead_last_cyc = acq_dead_last_cyc;
+    *dead_max_cyc = acq_dead_max_cyc;
+}
@@ -70,10 +70,11 @@ void dma1_uart2_rx_config(uint32_t *dst, uint16_t len)
     DMA1_Stream5->CR |= (0x0U << DMA_SxCR_MSIZE_Pos);
     DMA1_Stream5->CR |= (0x0U << DMA_SxCR_PSIZE_Pos);
 
-    // DMA1_Stream5->CR |= DMA_SxCR_TCIE;
+    DMA1_Stream5->CR |= DMA_SxCR_HTIE | DMA_SxCR_TCIE;
     DMA1_Stream5->FCR = 0;
 
-    // NVIC_EnableIRQ(DMA1_Stream5_IRQn);
+    DMA1->HIFCR = DMA_HIFCR_CTCIF5 | DMA_HIFCR_CHTIF5 | DMA_HIFCR_CTEIF5 | DMA_HIFCR_CDMEIF5 | DMA_HIFCR_CFEIF5;
+    NVIC_EnableIRQ(DMA1_Stream5_IRQn);
 
     DMA1_Stream5->CR |= DMA_SxCR_EN;
 }
@@ -93,7 +94,7 @@ void dma1_uart2_tx_start(uint32_t mem_addr, uint16_t len)
     DMA1_Stream6->CR |= DMA_SxCR_MINC;
     DMA1_Stream6->CR |= (0x0U << DMA_SxCR_MSIZE_Pos);
     DMA1_Stream6->CR |= (0x0U << DMA_SxCR_PSIZE_Pos);
-    DMA1_Stream6->CR |= DMA_SxCR_TCIE;
+    DMA1_Stream6->CR |= DMA_SxCR_TCIE | DMA_SxCR_TEIE;
 
     DMA1_Stream6->FCR = 0;
 
@@ -116,9 +117,13 @@ void dma2_uart1_rx_config(uint32_t *dst, uint16_t len)
     DMA2_Stream5->CR |= (0x0U << DMA_SxCR_DIR_Pos);
     DMA2_Stream5->CR |= DMA_SxCR_MINC;
     DMA2_Stream5->CR |= DMA_SxCR_CIRC;
+    DMA2_Stream5->CR |= DMA_SxCR_HTIE | DMA_SxCR_TCIE;
 
     DMA2_Stream5->FCR = 0;
 
+    DMA2->HIFCR = DMA_HIFCR_CTCIF5 | DMA_HIFCR_CHTIF5 | DMA_HIFCR_CTEIF5 | DMA_HIFCR_CDMEIF5 | DMA_HIFCR_CFEIF5;
+    NVIC_EnableIRQ(DMA2_Stream5_IRQn);
+
     DMA2_Stream5->CR |= DMA_SxCR_EN;
 }
 
@@ -135,7 +140,7 @@ void dma2_uart1_tx_start(uint32_t mem_addr, uint16_t len)
     DMA2_Stream7->CR |= (4U << DMA_SxCR_CHSEL_Pos);
     DMA2_Stream7->CR |= (0x1U << DMA_SxCR_DIR_Pos);
     DMA2_Stream7->CR |= DMA_SxCR_MINC;
-    DMA2_Stream7->CR |= DMA_SxCR_TCIE;
+    DMA2_Stream7->CR |= DMA_SxCR_TCIE | DMA_SxCR_TEIE;
 
     DMA2_Stream7->FCR = 0;
 
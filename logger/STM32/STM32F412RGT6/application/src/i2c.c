@@ -1,68 +1,71 @@
 #include "i2c.h"
 #include "dma.h"
+#include "timer.h"
+#include "support.h"
 
 // PB6: I2C1_SCL, PB7: I2C1_SDA
 #define I2C1_SCL_PIN 6U
 #define I2C1_SDA_PIN 7U
 
-#define PERIPH_CLK_HZ 16U
-#define I2C_100KHZ    80U
-#define SD_MODE_MAX_RISE_TIME 17U
-#define I2C_TIMEOUT   1000U
-
-extern volatile uint8_t i2c1_dma_tx_done;
-extern volatile uint8_t i2c1_dma_rx_done;
-extern volatile uint8_t i2c1_dma_err;
-
-#define I2C_FAIL() do { I2C1->CR1 |= I2C_CR1_STOP; i2c1_recover(); return -1; } while(0)
-#define I2C_DMA_TIMEOUT  2000U
-
-static int i2c1_check_error_and_clear(void)
+// Sm 100 kHz from the running APB1 clock: CCR = PCLK1 / (2 * 100 kHz), TRISE = 1000 ns * PCLK1 + 1
+#define I2C1_SCL_HZ         100000U
+#define I2C1_SM_RISE_NS     1000U
+
+// Same priority for EV, ER, DMA1 stream 0/1 and TIM14, so they never preempt each other
+#define I2C1_IRQ_PRIO       1U
+
+// 9 bit times at 100 kHz per byte, doubled, plus slack for clock stretching
+#define I2C1_BYTE_US        90U
+#define I2C1_SLACK_US       500U
+#define I2C1_STOP_WAIT_US   50U
+#define I2C1_HALF_BIT_US    5U
+
+#define I2C1_ERR_FLAGS (I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_AF | I2C_SR1_OVR | I2C_SR1_TIMEOUT)
+#define I2C1_IT_FLAGS  (I2C_CR2_ITEVTEN | I2C_CR2_ITERREN | I2C_CR2_ITBUFEN | I2C_CR2_DMAEN | I2C_CR2_LAST)
+
+enum { PH_TX = 0, PH_RX };
+
+typedef struct {
+    uint8_t addr;
+    uint8_t inline_tx[I2C1_INLINE_LEN];
+    const uint8_t *tx;
+    uint16_t tx_len;
+    uint8_t *rx;
+    uint16_t rx_len;
+    uint16_t timeout_us;
+    i2c1_cb_t cb;
+    void *ctx;
+    volatile int8_t *result;
+    int8_t status;
+} i2c1_xfer_t;
+
+/*
+ * q_tail .. q_run   finished, callback not yet run (main loop)
+ * q_run             transfer on the bus while xfer_active
+ * q_run .. q_head   waiting
+ */
+static i2c1_xfer_t q[I2C1_QUEUE_LEN];
+static volatile uint8_t q_head = 0;
+static volatile uint8_t q_run = 0;
+static uint8_t q_tail = 0;
+
+static volatile uint8_t xfer_active = 0;
+static uint8_t phase = PH_TX;
+static uint8_t tx_armed = 0;
+
+static inline i2c1_xfer_t *xfer_cur(void)
 {
-    uint32_t sr1 = I2C1->SR1;
-
-    if (sr1 & (I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_AF | I2C_SR1_OVR | I2C_SR1_TIMEOUT)) {
-        I2C1->SR1 &= ~(I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_AF | I2C_SR1_OVR | I2C_SR1_TIMEOUT);
-        return -1;
-    }
-    return 0;
+    return &q[q_run % I2C1_QUEUE_LEN];
 }
 
-static void i2c1_recover(void)
+static void delay_us(uint32_t us)
 {
-    I2C1->CR1 |= I2C_CR1_STOP;
-    I2C1->CR2 &= ~I2C_CR2_DMAEN;
-
-    dma_i2c1_abort();
-
-    I2C1->CR1 |= I2C_CR1_SWRST;
-    for (volatile int i = 0; i < 1000; i++) { __NOP(); }
-    I2C1->CR1 &= ~I2C_CR1_SWRST;
-
-    i2c1_init();
+    uint32_t t0 = dwt_cycles();
+    uint32_t n = us * (SystemCoreClock / 1000000U);
+    while ((dwt_cycles() - t0) < n) {}
 }
 
-static int wait_flag_set(volatile uint32_t *reg, uint32_t mask)
-{
-    uint32_t t = I2C_TIMEOUT;
-    while (((*reg) & mask) == 0U) {
-        if (i2c1_check_error_and_clear() < 0) return -1;
-        if (--t == 0U) return -1;
-    }
-    return 1;
-}
-
-static int wait_flag_clr(volatile uint32_t *reg, uint32_t mask)
-{
-    uint32_t t = I2C_TIMEOUT;
-    while (((*reg) & mask) != 0U) {
-        if (i2c1_check_error_and_clear() < 0) return -1;
-        if (--t == 0U) return -1;
-    }
-    return 1;
-}
-
-void i2c1_init(void)
+static void i2c1_hw_init(void)
 {
     RCC->APB1ENR |= RCC_APB1ENR_I2C1EN;
     (void)RCC->APB1ENR;
@@ -85,191 +88,365 @@ void i2c1_init(void)
     I2C1->CR1 = I2C_CR1_SWRST;
     I2C1->CR1 = 0;
 
-    I2C1->CR2 = 0;
-    I2C1->CR2 |= PERIPH_CLK_HZ;
+    uint32_t pclk1 = rcc_pclk1_hz();
+    uint32_t freq_mhz = pclk1 / 1000000U;
+    uint32_t ccr = pclk1 / (2U * I2C1_SCL_HZ);
+    if (ccr < 4U) ccr = 4U;
 
-    I2C1->CCR = I2C_100KHZ;
-    I2C1->TRISE = SD_MODE_MAX_RISE_TIME;
+    I2C1->CR2 = freq_mhz & I2C_CR2_FREQ;
+
+    I2C1->CCR = ccr;
+    I2C1->TRISE = freq_mhz * I2C1_SM_RISE_NS / 1000U + 1U;
 
     I2C1->CR1 |= I2C_CR1_PE;
 }
 
-int i2c1_write_raw(uint8_t dev_addr, const uint8_t *data, uint8_t len)
+/*
+ * Bus recovery: a slave holding SDA low (reset mid-byte) is clocked out with
+ * up to 9 SCL pulses on the pins as open-drain GPIO, then a STOP is driven
+ * and the peripheral is reset. Takes ~100 us; also used from the IRQs.
+ */
+static void bus_recover(void)
 {
-    if (!data || len == 0) return -1;
+    const uint32_t scl = 1U << I2C1_SCL_PIN;
+    const uint32_t sda = 1U << I2C1_SDA_PIN;
 
-    if (wait_flag_clr(&I2C1->SR2, I2C_SR2_BUSY) < 0) I2C_FAIL();
-
-    I2C1->CR1 |= I2C_CR1_START;
-    if (wait_flag_set(&I2C1->SR1, I2C_SR1_SB) < 0) I2C_FAIL();
-
-    (void)I2C1->SR1;
-    I2C1->DR = (dev_addr << 1) | 0;
-    if (wait_flag_set(&I2C1->SR1, I2C_SR1_ADDR) < 0) I2C_FAIL();
-
-    (void)I2C1->SR1;
-    (void)I2C1->SR2;
+    I2C1->CR2 &= ~I2C1_IT_FLAGS;
+    dma_i2c1_abort();
+    I2C1->CR1 &= ~I2C_CR1_PE;
 
-    for (uint8_t i = 0; i < len; i++) {
-        if (wait_flag_set(&I2C1->SR1, I2C_SR1_TXE) < 0) I2C_FAIL();
-        I2C1->DR = data[i];
+    GPIOB->BSRR = scl | sda;
+    GPIOB->MODER &= ~((3U << (I2C1_SCL_PIN * 2U)) | (3U << (I2C1_SDA_PIN * 2U)));
+    GPIOB->MODER |=  ((1U << (I2C1_SCL_PIN * 2U)) | (1U << (I2C1_SDA_PIN * 2U)));
+    delay_us(I2C1_HALF_BIT_US);
+
+    for (uint8_t i = 0; i < 9U && !(GPIOB->IDR & sda); i++) {
+        GPIOB->BSRR = scl << 16;
+        delay_us(I2C1_HALF_BIT_US);
+        GPIOB->BSRR = scl;
+        delay_us(I2C1_HALF_BIT_US);
     }
 
-    if (wait_flag_set(&I2C1->SR1, I2C_SR1_BTF) < 0) I2C_FAIL();
-    I2C1->CR1 |= I2C_CR1_STOP;
-    return 1;
+    GPIOB->BSRR = scl << 16;
+    delay_us(I2C1_HALF_BIT_US);
+    GPIOB->BSRR = sda << 16;
+    delay_us(I2C1_HALF_BIT_US);
+    GPIOB->BSRR = scl;
+    delay_us(I2C1_HALF_BIT_US);
+    GPIOB->BSRR = sda;
+    delay_us(I2C1_HALF_BIT_US);
+
+    i2c1_hw_init();
 }
 
-int i2c1_read_raw(uint8_t dev_addr, uint8_t *data, uint8_t len)
+static void xfer_start(void)
 {
-    if (!data || len == 0) return -1;
+    i2c1_xfer_t *x = xfer_cur();
+
+    xfer_active = 1;
+    tx_armed = 0;
+    phase = (x->tx_len || !x->rx_len) ? PH_TX : PH_RX;
 
-    if (wait_flag_clr(&I2C1->SR2, I2C_SR2_BUSY) < 0) I2C_FAIL();
+    /* the STOP of the previous transfer may still be on the bus */
+    uint32_t t0 = dwt_cycles();
+    uint32_t n = I2C1_STOP_WAIT_US * (SystemCoreClock / 1000000U);
+    while ((I2C1->CR1 & I2C_CR1_STOP) && (dwt_cycles() - t0) < n) {}
 
+    timer14_start_us(x->timeout_us);
+
+    I2C1->CR2 &= ~I2C1_IT_FLAGS;
+    I2C1->CR2 |= I2C_CR2_ITEVTEN | I2C_CR2_ITERREN;
     I2C1->CR1 |= I2C_CR1_START;
-    if (wait_flag_set(&I2C1->SR1, I2C_SR1_SB) < 0) I2C_FAIL();
+}
 
-    (void)I2C1->SR1;
-    I2C1->DR = (dev_addr << 1) | 1;
-    if (wait_flag_set(&I2C1->SR1, I2C_SR1_ADDR) < 0) I2C_FAIL();
+static void xfer_finish(int8_t status)
+{
+    i2c1_xfer_t *x = xfer_cur();
 
-    if (len == 1) {
-        I2C1->CR1 &= ~I2C_CR1_ACK;
-        __disable_irq();
-        (void)I2C1->SR1;
-        (void)I2C1->SR2;
-        I2C1->CR1 |= I2C_CR1_STOP;
-        __enable_irq();
+    timer14_stop();
+    I2C1->CR2 &= ~I2C1_IT_FLAGS;
 
-        if (wait_flag_set(&I2C1->SR1, I2C_SR1_RXNE) < 0) I2C_FAIL();
-        data[0] = (uint8_t)I2C1->DR;
-        return 1;
-    }
+    x->status = status;
+    if (x->result) *x->result = status;
 
-    I2C1->CR1 |= I2C_CR1_ACK;
-    (void)I2C1->SR1;
-    (void)I2C1->SR2;
+    q_run++;
+    if (q_run != q_head) xfer_start();
+    else                 xfer_active = 0;
+}
 
-    for (uint8_t i = 0; i < len; i++) {
-        if (i == (len - 2)) {
-            I2C1->CR1 &= ~I2C_CR1_ACK;
-        }
-        if (wait_flag_set(&I2C1->SR1, I2C_SR1_RXNE) < 0) I2C_FAIL();
-        data[i] = (uint8_t)I2C1->DR;
-    }
+static void xfer_abort(int8_t status)
+{
+    I2C1->CR2 &= ~I2C1_IT_FLAGS;
+    dma_i2c1_abort();
 
-    I2C1->CR1 |= I2C_CR1_STOP;
-    return 1;
+    /* a NACK leaves the bus sane, everything else gets a full recovery */
+    if (status == I2C1_ERR_NACK) I2C1->CR1 |= I2C_CR1_STOP;
+    else                         bus_recover();
+
+    xfer_finish(status);
 }
 
-static int wait_dma_done(volatile uint8_t *done_flag)
+static void tx_done(void)
 {
-    uint32_t t = I2C_DMA_TIMEOUT;
-    while (!(*done_flag)) {
-        if (--t == 0U) return -1;
+    I2C1->CR2 &= ~I2C_CR2_DMAEN;
+    tx_armed = 0;
+
+    if (xfer_cur()->rx_len) {
+        phase = PH_RX;
+        I2C1->CR1 |= I2C_CR1_START;
+        return;
     }
-    return 1;
+
+    I2C1->CR1 |= I2C_CR1_STOP;
+    xfer_finish(I2C1_OK);
 }
 
-int i2c1_write_raw_dma(uint8_t dev_addr, const uint8_t *data, uint16_t len)
+void i2c1_init(void)
 {
-    if (!data || len == 0) return -1;
+    i2c1_hw_init();
+    timer14_init_1us();
 
-    if (wait_flag_clr(&I2C1->SR2, I2C_SR2_BUSY) < 0) I2C_FAIL();
+    q_head = q_run = q_tail = 0;
+    xfer_active = 0;
 
-    i2c1_dma_tx_done = 0;
-    i2c1_dma_err = 0;
+    NVIC_SetPriority(I2C1_EV_IRQn, I2C1_IRQ_PRIO);
+    NVIC_SetPriority(I2C1_ER_IRQn, I2C1_IRQ_PRIO);
+    NVIC_SetPriority(DMA1_Stream0_IRQn, I2C1_IRQ_PRIO);
+    NVIC_SetPriority(DMA1_Stream1_IRQn, I2C1_IRQ_PRIO);
+    NVIC_SetPriority(TIM8_TRG_COM_TIM14_IRQn, I2C1_IRQ_PRIO);
 
-    I2C1->CR1 |= I2C_CR1_START;
-    if (wait_flag_set(&I2C1->SR1, I2C_SR1_SB) < 0) I2C_FAIL();
+    NVIC_EnableIRQ(I2C1_EV_IRQn);
+    NVIC_EnableIRQ(I2C1_ER_IRQn);
+}
 
-    (void)I2C1->SR1;
-    I2C1->DR = (dev_addr << 1) | 0;
-    if (wait_flag_set(&I2C1->SR1, I2C_SR1_ADDR) < 0) I2C_FAIL();
+/* Recover the bus; a transfer in progress completes with I2C1_ERR_BUS */
+void i2c1_recover(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (xfer_active) xfer_abort(I2C1_ERR_BUS);
+    else             bus_recover();
+    __set_PRIMASK(primask);
+}
 
-    (void)I2C1->SR1;
-    (void)I2C1->SR2;
+static int xfer_queue(uint8_t dev_addr, const uint8_t *tx, uint16_t tx_len,
+                      uint8_t *rx, uint16_t rx_len, i2c1_cb_t cb, void *ctx,
+                      volatile int8_t *result)
+{
+    if ((tx_len && !tx) || (rx_len && !rx)) return -1;
 
-    I2C1->CR2 |= I2C_CR2_DMAEN;
+    uint32_t bytes = (uint32_t)tx_len + rx_len + 2U;
+    uint32_t timeout_us = 2U * bytes * I2C1_BYTE_US + I2C1_SLACK_US;
+    if (timeout_us > 0xFFFFU) return -1;
 
-    dma_i2c1_tx_start((uint32_t)data, len);
+    /* slots are freed by i2c1_poll(), which may be the caller: never wait here */
+    if ((uint8_t)(q_head - q_tail) >= I2C1_QUEUE_LEN) return I2C1_BUSY;
 
-    if (wait_dma_done(&i2c1_dma_tx_done) < 0) {
-        I2C1->CR2 &= ~I2C_CR2_DMAEN;
-        I2C1->CR1 |= I2C_CR1_STOP;
-        i2c1_recover();
-        return -1;
+    i2c1_xfer_t *x = &q[q_head % I2C1_QUEUE_LEN];
+    x->addr = dev_addr;
+    x->tx = tx;
+    if (tx_len && tx_len <= I2C1_INLINE_LEN) {
+        for (uint16_t i = 0; i < tx_len; i++) x->inline_tx[i] = tx[i];
+        x->tx = x->inline_tx;
     }
+    x->tx_len = tx_len;
+    x->rx = rx;
+    x->rx_len = rx_len;
+    x->timeout_us = (uint16_t)timeout_us;
+    x->cb = cb;
+    x->ctx = ctx;
+    x->result = result;
+    x->status = I2C1_BUSY;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    q_head++;
+    if (!xfer_active) xfer_start();
+    __set_PRIMASK(primask);
+    return 0;
+}
 
-    if (i2c1_dma_err) {
-        I2C1->CR2 &= ~I2C_CR2_DMAEN;
-        I2C1->CR1 |= I2C_CR1_STOP;
-        i2c1_recover();
-        return -1;
-    }
+/*
+ * Queue a transaction without waiting. Returns 0, -1 for an empty or oversized
+ * request, or I2C1_BUSY while the queue is full (i2c1_poll() frees slots).
+ */
+int i2c1_submit(uint8_t dev_addr, const uint8_t *tx, uint16_t tx_len,
+                uint8_t *rx, uint16_t rx_len, i2c1_cb_t cb, void *ctx)
+{
+    return xfer_queue(dev_addr, tx, tx_len, rx, rx_len, cb, ctx, 0);
+}
 
-    if (wait_flag_set(&I2C1->SR1, I2C_SR1_BTF) < 0) {
-        I2C1->CR2 &= ~I2C_CR2_DMAEN;
-        I2C1->CR1 |= I2C_CR1_STOP;
-        return -1;
+/* Run the callbacks of finished transactions and free their slots */
+void i2c1_poll(void)
+{
+    static uint8_t in_poll = 0;
+    if (in_poll) return;
+    in_poll = 1;
+
+    while (q_tail != q_run) {
+        i2c1_xfer_t *x = &q[q_tail % I2C1_QUEUE_LEN];
+        i2c1_cb_t cb = x->cb;
+        void *ctx = x->ctx;
+        int8_t status = x->status;
+
+        q_tail++;
+        if (cb) cb(status, ctx);
     }
 
-    I2C1->CR2 &= ~I2C_CR2_DMAEN;
-    I2C1->CR1 |= I2C_CR1_STOP;
-    return 1;
+    in_poll = 0;
 }
 
-int i2c1_read_raw_dma(uint8_t dev_addr, uint8_t *data, uint16_t len)
+uint8_t i2c1_idle(void)
 {
-    if (!data || len == 0) return -1;
-
-    if (wait_flag_clr(&I2C1->SR2, I2C_SR2_BUSY) < 0) I2C_FAIL();
+    return (!xfer_active && q_tail == q_head) ? 1U : 0U;
+}
 
-    i2c1_dma_rx_done = 0;
-    i2c1_dma_err = 0;
+void i2c1_ev_isr(void)
+{
+    uint32_t sr1 = I2C1->SR1;
 
-    if (len == 1) {
-        return i2c1_read_raw(dev_addr, data, 1);
+    if (!xfer_active) {
+        I2C1->CR2 &= ~I2C1_IT_FLAGS;
+        return;
     }
 
-    I2C1->CR1 |= I2C_CR1_ACK;
-    I2C1->CR2 |= I2C_CR2_LAST;
-
-    I2C1->CR1 |= I2C_CR1_START;
-    if (wait_flag_set(&I2C1->SR1, I2C_SR1_SB) < 0) I2C_FAIL();
+    i2c1_xfer_t *x = xfer_cur();
 
-    (void)I2C1->SR1;
-    I2C1->DR = (dev_addr << 1) | 1;
-    if (wait_flag_set(&I2C1->SR1, I2C_SR1_ADDR) < 0) I2C_FAIL();
+    if (sr1 & I2C_SR1_SB) {
+        I2C1->DR = (uint8_t)((x->addr << 1) | (phase == PH_RX ? 1U : 0U));
+        return;
+    }
 
-    (void)I2C1->SR1;
-    (void)I2C1->SR2;
+    if (sr1 & I2C_SR1_ADDR) {
+        if (phase == PH_TX) {
+            if (x->tx_len) {
+                I2C1->CR2 |= I2C_CR2_DMAEN;
+                dma_i2c1_tx_start((uint32_t)x->tx, x->tx_len);
+                tx_armed = 1;
+            }
+            (void)I2C1->SR2;
+            if (!x->tx_len) {
+                /* address probe */
+                I2C1->CR1 |= I2C_CR1_STOP;
+                xfer_finish(I2C1_OK);
+            }
+            return;
+        }
 
-    I2C1->CR2 |= I2C_CR2_DMAEN;
+        if (x->rx_len == 1U) {
+            I2C1->CR1 &= ~I2C_CR1_ACK;
+            __disable_irq();
+            (void)I2C1->SR2;
+            I2C1->CR1 |= I2C_CR1_STOP;
+            __enable_irq();
+            I2C1->CR2 |= I2C_CR2_ITBUFEN;
+            return;
+        }
 
-    dma_i2c1_rx_start((uint32_t)data, len);
+        I2C1->CR1 |= I2C_CR1_ACK;
+        I2C1->CR2 |= I2C_CR2_LAST | I2C_CR2_DMAEN;
+        dma_i2c1_rx_start((uint32_t)x->rx, x->rx_len);
+        (void)I2C1->SR2;
+        return;
+    }
 
-    if (wait_dma_done(&i2c1_dma_rx_done) < 0) {
-        I2C1->CR2 &= ~I2C_CR2_DMAEN;
-        I2C1->CR1 |= I2C_CR1_STOP;
-        i2c1_recover();
-        return -1;
+    if ((sr1 & I2C_SR1_RXNE) && phase == PH_RX && x->rx_len == 1U) {
+        x->rx[0] = (uint8_t)I2C1->DR;
+        xfer_finish(I2C1_OK);
+        return;
     }
 
-    if (i2c1_dma_err) {
-        I2C1->CR2 &= ~I2C_CR2_DMAEN;
-        I2C1->CR1 |= I2C_CR1_STOP;
-        i2c1_recover();
-        return -1;
+    /* last byte shifted out; TC of the stream may be handled before or after */
+    if ((sr1 & I2C_SR1_BTF) && phase == PH_TX && tx_armed && DMA1_Stream1->NDTR == 0U) {
+        tx_done();
     }
+}
+
+void i2c1_er_isr(void)
+{
+    uint32_t err = I2C1->SR1 & I2C1_ERR_FLAGS;
+    if (!err) return;
+    I2C1->SR1 &= ~err;
+
+    if (!xfer_active) return;
+    xfer_abort((err & I2C_SR1_AF) ? I2C1_ERR_NACK : I2C1_ERR_BUS);
+}
 
+void i2c1_dma_tx_complete(uint8_t err)
+{
+    if (!xfer_active || phase != PH_TX) return;
+    if (err) {
+        xfer_abort(I2C1_ERR_DMA);
+        return;
+    }
     I2C1->CR2 &= ~I2C_CR2_DMAEN;
+}
+
+void i2c1_dma_rx_complete(uint8_t err)
+{
+    if (!xfer_active || phase != PH_RX) return;
+    if (err) {
+        xfer_abort(I2C1_ERR_DMA);
+        return;
+    }
+    I2C1->CR2 &= ~(I2C_CR2_DMAEN | I2C_CR2_LAST);
     I2C1->CR1 |= I2C_CR1_STOP;
+    xfer_finish(I2C1_OK);
+}
 
-    I2C1->CR2 &= ~I2C_CR2_LAST;
-    I2C1->CR1 |= I2C_CR1_ACK;
+void i2c1_timeout_isr(void)
+{
+    if (xfer_active) xfer_abort(I2C1_ERR_TIMEOUT);
+}
 
-    return 1;
+/* Time for everything queued to end, each transfer within its TIM14 timeout */
+static uint32_t queue_deadline_us(void)
+{
+    uint32_t us = 0;
+    for (uint8_t i = q_run; i != q_head; i++) {
+        us += q[i % I2C1_QUEUE_LEN].timeout_us + I2C1_SLACK_US;
+    }
+    return us;
+}
+
+/*
+ * Submit and wait for the result; the bus itself still runs from the IRQs.
+ * A full queue fails at once. If the transfers ahead and this one are not
+ * done by the sum of their timeouts, the IRQs are not being served (caller
+ * in an ISR or with them masked): they are aborted here, so nothing touches
+ * the caller's buffers after the return.
+ */
+static int i2c1_transfer(uint8_t dev_addr, const uint8_t *tx, uint16_t tx_len,
+                         uint8_t *rx, uint16_t rx_len)
+{
+    volatile int8_t result = I2C1_BUSY;
+
+    if ((uint8_t)(q_head - q_tail) >= I2C1_QUEUE_LEN) i2c1_poll();
+    if (xfer_queue(dev_addr, tx, tx_len, rx, rx_len, 0, 0, &result) != 0) return -1;
+
+    uint32_t t0 = dwt_cycles();
+    uint32_t n = queue_deadline_us() * (SystemCoreClock / 1000000U);
+    while (result == I2C1_BUSY && (dwt_cycles() - t0) < n) {}
+
+    if (result == I2C1_BUSY) {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        while (result == I2C1_BUSY && xfer_active) xfer_abort(I2C1_ERR_TIMEOUT);
+        __set_PRIMASK(primask);
+    }
+    return (result == I2C1_OK) ? 1 : -1;
+}
+
+int i2c1_write_raw_dma(uint8_t dev_addr, const uint8_t *data, uint16_t len)
+{
+    if (!data || len == 0) return -1;
+    return i2c1_transfer(dev_addr, data, len, 0, 0);
+}
+
+int i2c1_read_raw_dma(uint8_t dev_addr, uint8_t *data, uint16_t len)
+{
+    if (!data || len == 0) return -1;
+    return i2c1_transfer(dev_addr, 0, 0, data, len);
 }
 
 int i2c1_write_u8_u16_dma(uint8_t addr7, uint8_t reg, uint16_t value){
@@ -277,14 +454,14 @@ int i2c1_write_u8_u16_dma(uint8_t addr7, uint8_t reg, uint16_t value){
     buf[0] = reg;
     buf[1] = (uint8_t)((value >> 8) & 0xFF);
     buf[2] = (uint8_t)( value        & 0xFF);
-    return i2c1_write_raw_dma(addr7, buf, 3);
+    return i2c1_transfer(addr7, buf, 3, 0, 0);
 }
 
+/* Register pointer write, repeated START and 2 byte read in one transaction */
 int i2c1_read_u8_u16_dma (uint8_t addr7, uint8_t reg, uint16_t *value)
 {
-    if (i2c1_write_raw_dma(addr7, &reg, 1) < 0) return -1;
     uint8_t buf[2];
-    if (i2c1_read_raw_dma(addr7, buf, 2) < 0) return -1;
+    if (i2c1_transfer(addr7, &reg, 1, buf, 2) < 0) return -1;
     *value = ((uint16_t)buf[0] << 8) | buf[1];
     return 1;
 }
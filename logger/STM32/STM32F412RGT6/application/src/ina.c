@@ -1,5 +1,6 @@
 #include "ina.h"
 #include "i2c.h"
+#include "support.h"
 
 #define INA226_REG_CONFIG        0x00
 #define INA226_REG_SHUNT_VOLT    0x01
@@ -13,6 +14,11 @@
 #define INA226_BUS_LSB_uV        1250
 #define INA226_SHUNT_LSB_uV      2
 
+#define INA226_CONFIG_LOG        0x4527   /* AVG 16, VBUSCT/VSHCT 1.1 ms, shunt+bus continuous */
+#define INA226_MASK_CNVR         0x0400
+
+#define INA226_ALERT_PIN         5U       /* PB5, open drain, active low */
+
 static uint8_t  g_addr;
 static uint32_t g_current_lsb_uA;
 static uint32_t g_rshunt_mOhm;
@@ -104,4 +110,209 @@ uint8_t ina226_is_present(void)
 {
     uint16_t dummy;
     return ina_read_u16(INA226_REG_CONFIG, &dummy) == 0;
-}
\ No newline at end of file
+}
+
+/* ---- continuous logging ---- */
+
+enum { RD_MASK = 0, RD_CURRENT, RD_POWER, RD_COUNT };
+
+static const uint8_t rd_regs[RD_COUNT] = {
+    INA226_REG_MASK_ENABLE, INA226_REG_CURRENT, INA226_REG_POWER
+};
+static uint8_t rd_buf[RD_COUNT][2];
+static uint8_t rd_pending = 0;
+static uint8_t rd_failed = 0;
+static uint8_t rd_fresh = 0;
+static uint32_t rd_cyc = 0;
+
+static volatile uint32_t alert_count = 0;
+static volatile uint32_t alert_cyc = 0;
+static uint32_t alert_seen = 0;
+
+static uint8_t  log_on = 0;
+static uint8_t  have_prev = 0;
+static uint32_t prev_cyc = 0;
+static uint64_t time_us = 0;
+static ina226_totals_t tot;
+
+static ina226_sample_t ring[INA226_RING_LEN];
+static uint16_t ring_head = 0;
+static uint16_t ring_fill = 0;
+static uint32_t dec_sum_uW = 0;
+static uint32_t dec_peak_uW = 0;
+static uint8_t  dec_n = 0;
+
+/* uW*us or uA*us (1e-12 J or C) to Q32.32: x * 2^32 / 10^12 = x * 2^20 / 5^12 */
+static uint64_t pico_to_q32(uint64_t x)
+{
+    const uint64_t d = 244140625ULL;
+    return ((x / d) << 20) + (((x % d) << 20) / d);
+}
+
+static uint16_t uW_to_mW16(uint32_t uW)
+{
+    uW /= 1000U;
+    return (uW > 0xFFFFU) ? 0xFFFFU : (uint16_t)uW;
+}
+
+static void alert_pin_init(void)
+{
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPIOBEN;
+    (void)RCC->AHB1ENR;
+
+    GPIOB->MODER &= ~(3U << (INA226_ALERT_PIN * 2U));
+    GPIOB->PUPDR &= ~(3U << (INA226_ALERT_PIN * 2U));
+    GPIOB->PUPDR |=  (1U << (INA226_ALERT_PIN * 2U));
+
+    RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+    (void)RCC->APB2ENR;
+
+    uint32_t idx = INA226_ALERT_PIN / 4U;
+    uint32_t pos = (INA226_ALERT_PIN % 4U) * 4U;
+    SYSCFG->EXTICR[idx] &= ~(0xFU << pos);
+    SYSCFG->EXTICR[idx] |=  (0x1U << pos);
+
+    EXTI->IMR  &= ~(1U << INA226_ALERT_PIN);
+    EXTI->RTSR &= ~(1U << INA226_ALERT_PIN);
+    EXTI->PR = (1U << INA226_ALERT_PIN);
+    EXTI->FTSR |= (1U << INA226_ALERT_PIN);
+    EXTI->IMR  |= (1U << INA226_ALERT_PIN);
+
+    NVIC_EnableIRQ(EXTI9_5_IRQn);
+}
+
+/* Switch to averaged continuous conversion with ALERT as conversion ready; 0 or -1 */
+int ina226_start_logging(void)
+{
+    if (ina_write_u16(INA226_REG_CONFIG, INA226_CONFIG_LOG) < 0) return -1;
+    if (ina_write_u16(INA226_REG_MASK_ENABLE, INA226_MASK_CNVR) < 0) return -1;
+
+    ina226_log_reset();
+    have_prev = 0;
+    alert_seen = alert_count;
+    alert_pin_init();
+    log_on = 1;
+    return 0;
+}
+
+/* EXTI falling edge on ALERT: only timestamp, the result is read by ina226_poll() */
+void ina226_alert_isr(void)
+{
+    alert_cyc = dwt_cycles();
+    alert_count++;
+}
+
+static void ring_push(uint32_t power_uW)
+{
+    dec_sum_uW += power_uW;
+    if (power_uW > dec_peak_uW) dec_peak_uW = power_uW;
+    if (++dec_n < INA226_RING_DECIM) return;
+
+    ring[ring_head].avg_mW  = uW_to_mW16(dec_sum_uW / dec_n);
+    ring[ring_head].peak_mW = uW_to_mW16(dec_peak_uW);
+    ring_head = (uint16_t)((ring_head + 1U) % INA226_RING_LEN);
+    if (ring_fill < INA226_RING_LEN) ring_fill++;
+
+    dec_sum_uW = 0;
+    dec_peak_uW = 0;
+    dec_n = 0;
+}
+
+static void log_sample(void)
+{
+    int32_t current_uA = (int32_t)(int16_t)((rd_buf[RD_CURRENT][0] << 8) | rd_buf[RD_CURRENT][1])
+                         * (int32_t)g_current_lsb_uA;
+    uint32_t power_uW = (uint32_t)((rd_buf[RD_POWER][0] << 8) | rd_buf[RD_POWER][1])
+                        * (25UL * g_current_lsb_uA);
+
+    if (tot.conversions == 0U || current_uA > tot.peak_uA) tot.peak_uA = current_uA;
+    tot.conversions++;
+    ring_push(power_uW);
+
+    /* Re-read of a stuck ALERT: no new timestamp to integrate over */
+    if (!rd_fresh) return;
+
+    if (have_prev) {
+        uint32_t dt_us = dwt_cycles_to_us(rd_cyc - prev_cyc);
+        if (dt_us > INA226_DT_MAX_US) {
+            tot.gaps++;
+            dt_us = INA226_CONV_US;
+        }
+
+        uint64_t q = (uint64_t)(current_uA < 0 ? -current_uA : current_uA) * dt_us;
+        if (current_uA < 0) tot.charge_q32 -= (int64_t)pico_to_q32(q);
+        else                tot.charge_q32 += (int64_t)pico_to_q32(q);
+        tot.energy_q32 += pico_to_q32((uint64_t)power_uW * dt_us);
+        time_us += dt_us;
+    }
+    prev_cyc = rd_cyc;
+    have_prev = 1;
+}
+
+static void rd_done(int8_t status, void *ctx)
+{
+    (void)ctx;
+    if (status != I2C1_OK) rd_failed = 1;
+    if (--rd_pending) return;
+
+    if (rd_failed) tot.errors++;
+    else log_sample();
+}
+
+/*
+ * Main loop: queue the Mask/Enable (clears ALERT), Current and Power reads
+ * for a new conversion, or again while ALERT is still held low after a
+ * failed read.
+ */
+void ina226_poll(void)
+{
+    if (!log_on || rd_pending) return;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t count = alert_count;
+    uint32_t cyc = alert_cyc;
+    __set_PRIMASK(primask);
+
+    rd_fresh = (count != alert_seen);
+    if (!rd_fresh && (GPIOB->IDR & (1U << INA226_ALERT_PIN))) return;
+
+    alert_seen = count;
+    rd_cyc = cyc;
+    rd_failed = 0;
+    for (uint8_t i = 0; i < RD_COUNT; i++) {
+        if (i2c1_submit(g_addr, &rd_regs[i], 1, rd_buf[i], 2, rd_done, 0) == 0) rd_pending++;
+        else rd_failed = 1;
+    }
+    if (!rd_pending) tot.errors++;
+}
+
+void ina226_log_reset(void)
+{
+    tot = (ina226_totals_t){0};
+    time_us = 0;
+    ring_head = 0;
+    ring_fill = 0;
+    dec_sum_uW = 0;
+    dec_peak_uW = 0;
+    dec_n = 0;
+}
+
+void ina226_totals(ina226_totals_t *t)
+{
+    *t = tot;
+    t->time_ms = (uint32_t)(time_us / 1000U);
+}
+
+uint16_t ina226_ring_count(void)
+{
+    return ring_fill;
+}
+
+/* idx 0 is the oldest entry still in the ring; 0 or -1 */
+int ina226_ring_get(uint16_t idx, ina226_sample_t *s)
+{
+    if (idx >= ring_fill) return -1;
+    *s = ring[(ring_head + INA226_RING_LEN - ring_fill + idx) % INA226_RING_LEN];
+    return 0;
+}
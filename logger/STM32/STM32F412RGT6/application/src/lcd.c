@@ -17,29 +17,72 @@
 #define LCD_DISPLAYON      0x04
 #define LCD_2LINE          0x08
 
+/*
+ * PCF8574 bytes are staged and written as one I2C1 transaction per string or
+ * command, double buffered so the next one fills while the last is on the bus.
+ * One byte takes ~90 us at 100 kHz, longer than the E pulse and the 37 us
+ * instruction time, so no delays are needed between bytes.
+ */
+#define LCD_BUF_LEN 64U
+
 static uint8_t lcd_present = 1;
 static uint8_t lcd_backlight_mask = LCD_BL;
 
-static int8_t lcd_i2c_write(uint8_t data)
+static uint8_t lcd_buf[2][LCD_BUF_LEN];
+static uint8_t lcd_buf_busy[2];
+static uint8_t lcd_buf_sel = 0;
+static uint8_t lcd_buf_len = 0;
+
+static void lcd_xfer_done(int8_t status, void *ctx)
 {
-    if (!lcd_present) return -1;
-    int r = i2c1_write_raw(LCD_I2C_ADDR, &data, 1);
-    if (r != 1) lcd_present = 0;
-    return (int8_t)r;
+    *(uint8_t *)ctx = 0;
+    if (status != I2C1_OK) lcd_present = 0;
 }
 
-static inline void lcd_delay_short(void)
+static void lcd_flush(void)
 {
-    for (volatile int i = 0; i < 200; i++) { __NOP(); }
+    if (lcd_buf_len == 0) return;
+    if (!lcd_present) {
+        lcd_buf_len = 0;
+        return;
+    }
+
+    uint8_t sel = lcd_buf_sel;
+    lcd_buf_busy[sel] = 1;
+    int r;
+    while ((r = i2c1_submit(LCD_I2C_ADDR, lcd_buf[sel], lcd_buf_len, 0, 0,
+                            lcd_xfer_done, &lcd_buf_busy[sel])) == I2C1_BUSY) {
+        i2c1_poll();
+    }
+    if (r < 0) {
+        lcd_buf_busy[sel] = 0;
+        lcd_present = 0;
+    }
+    lcd_buf_len = 0;
+    lcd_buf_sel ^= 1U;
 }
 
-static void lcd_pulse_enable(uint8_t data)
+/* Wait until everything staged so far is on the display */
+static void lcd_sync(void)
+{
+    lcd_flush();
+    while (lcd_buf_busy[0] || lcd_buf_busy[1]) i2c1_poll();
+}
+
+static void lcd_put(uint8_t data)
 {
     if (!lcd_present) return;
-    if (lcd_i2c_write(data | LCD_E) != 1) return;
-    lcd_delay_short();
-    (void)lcd_i2c_write(data & (uint8_t)~LCD_E);
-    lcd_delay_short();
+    if (lcd_buf_len == 0) {
+        while (lcd_buf_busy[lcd_buf_sel]) i2c1_poll();
+    }
+    lcd_buf[lcd_buf_sel][lcd_buf_len++] = data;
+    if (lcd_buf_len == LCD_BUF_LEN) lcd_flush();
+}
+
+static void lcd_pulse_enable(uint8_t data)
+{
+    lcd_put(data | LCD_E);
+    lcd_put(data & (uint8_t)~LCD_E);
 }
 
 static void lcd_write4bits(uint8_t nibble, uint8_t rs)
@@ -60,9 +103,10 @@ static void lcd_command(uint8_t cmd)
 {
     lcd_write8bits(cmd, 0);
     if (cmd == LCD_CLEARDISPLAY || cmd == LCD_RETURNHOME) {
+        lcd_sync();
         systick_delay_ms(2);
     } else {
-        lcd_delay_short();
+        lcd_flush();
     }
 }
 
@@ -78,10 +122,11 @@ void lcd_mark_present(uint8_t present)
 
 void lcd_init(void)
 {
+    lcd_sync();
     lcd_present = 1;
     lcd_backlight_mask = LCD_BL;
 
-    if (lcd_i2c_write(lcd_backlight_mask) != 1) {
+    if (i2c1_write_raw_dma(LCD_I2C_ADDR, &lcd_backlight_mask, 1) != 1) {
         lcd_present = 0;
         return;
     }
@@ -89,15 +134,19 @@ void lcd_init(void)
     systick_delay_ms(50);
 
     lcd_write4bits(0x03, 0);
+    lcd_sync();
     systick_delay_ms(5);
 
     lcd_write4bits(0x03, 0);
+    lcd_sync();
     systick_delay_ms(1);
 
     lcd_write4bits(0x03, 0);
+    lcd_sync();
     systick_delay_ms(1);
 
     lcd_write4bits(0x02, 0);
+    lcd_sync();
     systick_delay_ms(1);
 
     lcd_command(LCD_FUNCTIONSET | LCD_2LINE);
@@ -121,6 +170,7 @@ void lcd_send_string(const char *str)
     while (*str) {
         lcd_write8bits((uint8_t)(*str++), 1);
     }
+    lcd_flush();
 }
 
 void lcd_send_decimal(int32_t num, uint8_t digits)
@@ -235,8 +285,8 @@ void lcd_backlight(uint8_t state)
 {
     if (!lcd_present) return;
     lcd_backlight_mask = state ? LCD_BL : 0x00;
-    uint8_t data = lcd_backlight_mask;
-    lcd_i2c_write(data);
+    lcd_put(lcd_backlight_mask);
+    lcd_flush();
 }
 
 void lcd_clear(void)
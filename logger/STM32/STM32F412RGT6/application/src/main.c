@@ -18,6 +18,9 @@
 #include "spi.h"
 #include "rtc_locale.h"
 #include "ina.h"
+#include "uart_link.h"
+#include "prof.h"
+#include "acq.h"
 
 #define STATUS_OK       0x40
 #define ERROR_RESPONSE  0x7F
@@ -45,13 +48,18 @@ volatile uint8_t backlight_timer = 0;
 struct {
     int16_t temperature;
     uint16_t humidity;
+    uint32_t tick;          /* tick_10ms of the last good sample */
+    uint8_t valid;
 } measurement_sht40;
 
 struct
 {
     int32_t temperature;
     uint32_t humidity;
+    uint32_t humidity_x1024;
     uint32_t pressure;
+    uint32_t tick;
+    uint8_t valid;
 } measurement_bme280;
 
 struct
@@ -94,79 +102,818 @@ static uint8_t rgb_r = 0;
 static uint8_t rgb_g = 0;
 static uint8_t rgb_b = 0;
 
-volatile uint8_t uart2_tx_busy = 0;
-volatile uint8_t uart1_tx_busy = 0;
-
-volatile uint8_t i2c1_dma_tx_done = 0;
-volatile uint8_t i2c1_dma_rx_done = 0;
-volatile uint8_t i2c1_dma_err     = 0;
-
 volatile uint8_t spi1_dma_rx_done = 0;
 volatile uint8_t spi1_dma_tx_done = 0;
 
 #define FRAME_LEN_APP   24
 #define FRAME_PAYLOAD   (FRAME_LEN_APP - 5)
 
+#define CMD_ID(cmd, param)  (((uint16_t)(cmd) << 8) | (param))
+#define CMD_GROUP_COUNT     0x71
+#define CMD_BATCH           0x0800
+#define BATCH_FRAME_MAX     192
+
 #define ADC_BUFFER_SIZE 4
 static uint16_t adc_data_buffer[ADC_BUFFER_SIZE];
 
-#define UART2_RX_BUFFER_SIZE 128
-static uint8_t uart2_rx_buf[UART2_RX_BUFFER_SIZE];
-static uint8_t uart2_tx_frame[FRAME_LEN_APP];
-static volatile uint16_t uart2_rx_old_pos = 0;
+static uint32_t rx_frames = 0;
+static uint32_t rx_latency_max_cyc = 0;
+static uint8_t  cmd_on_uart1 = 0;    /* port of the request being executed */
 
-#define UART2_RX_FRAME_LEN FRAME_LEN_APP
-static uint8_t uart2_frame_acc[UART2_RX_FRAME_LEN];
-static uint8_t uart2_frame_idx = 0;
+typedef uint8_t (*cmd_handler_t)(const uint8_t *arg, uint8_t *out, uint8_t *out_len);
 
-#define UART1_RX_BUFFER_SIZE 128
-static uint8_t uart1_rx_buf[UART1_RX_BUFFER_SIZE];
-static uint8_t uart1_tx_frame[FRAME_LEN_APP];
-static volatile uint16_t uart1_rx_old_pos = 0;
+typedef struct {
+    cmd_handler_t fn;
+    uint8_t arg_len;
+    uint8_t resp_len;
+    uint8_t arg_opt;
+} cmd_desc_t;
 
-#define UART1_RX_FRAME_LEN FRAME_LEN_APP
-static uint8_t uart1_frame_acc[UART1_RX_FRAME_LEN];
-static uint8_t uart1_frame_idx = 0;
+typedef struct {
+    const cmd_desc_t *params;
+    uint8_t count;
+} cmd_group_t;
 
-static int uart2_dma_send(const uint8_t *data, uint16_t len);
-static int uart1_dma_send(const uint8_t *data, uint16_t len);
 static void uart2_process_rx(void);
 static void uart1_process_rx(void);
 
 static void handle_request(const uint8_t *req, uint8_t use_uart1);
+static void handle_batch(const uint8_t *req, uint8_t use_uart1);
 static void handle_response(uint8_t status, uint8_t cmd, uint8_t param,
                             const uint8_t *payload, uint32_t payload_len, uint8_t use_uart1);
 
-static int uart2_dma_send(const uint8_t *data, uint16_t len)
+static uint8_t cmd_ping(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)arg;
+    out[0] = 0xAA; out[1] = 0xAA; out[2] = 0xAA;
+    *out_len = 3;
+    return STATUS_OK;
+}
+
+static uint8_t cmd_serial(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)arg;
+    const device_info_t *info = device_info_get();
+    uint32_t serial = 0;
+    if (info->magic == INFO_MAGIC) serial = info->serial;
+
+    out[0] = (uint8_t)((serial >> 24) & 0xFF);
+    out[1] = (uint8_t)((serial >> 16) & 0xFF);
+    out[2] = (uint8_t)((serial >> 8) & 0xFF);
+    out[3] = (uint8_t)(serial & 0xFF);
+    *out_len = 4;
+    return STATUS_OK;
+}
+
+static uint8_t cmd_version(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)arg;
+    const device_info_t *info = device_info_get();
+    uint8_t hwmaj = 0, hwmin = 0;
+    if (info->magic == INFO_MAGIC) { hwmaj = info->hw_major; hwmin = info->hw_minor; }
+
+    out[0] = FW_VERSION_MAJOR;
+    out[1] = FW_VERSION_MINOR;
+    out[2] = FW_VERSION_PATCH;
+    out[3] = hwmaj;
+    out[4] = hwmin;
+    *out_len = 5;
+    return STATUS_OK;
+}
+
+static uint8_t cmd_build_date(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)arg;
+    memcpy(out, FW_BUILD_DATE, 10);
+    *out_len = 10;
+    return STATUS_OK;
+}
+
+static uint8_t cmd_prod_date(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)arg;
+    const device_info_t *info = device_info_get();
+    memset(out, 0, 10);
+    if (info->magic == INFO_MAGIC) memcpy(out, info->prod_date, 10);
+    *out_len = 10;
+    return STATUS_OK;
+}
+
+static uint8_t cmd_adc(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)arg;
+    uint16_t v0 = adc_data_buffer[0];
+    uint16_t v1 = adc_data_buffer[1];
+    out[0] = (uint8_t)(v0 >> 8); out[1] = (uint8_t)v0;
+    out[2] = (uint8_t)(v1 >> 8); out[3] = (uint8_t)v1;
+    *out_len = 4;
+    return STATUS_OK;
+}
+
+static uint8_t cmd_btn1(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)arg;
+    out[0] = GPIOB->IDR & (1U << 0U) ? 0U : 1U;
+    *out_len = 1;
+    return STATUS_OK;
+}
+
+static uint8_t cmd_btn2(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)arg;
+    out[0] = GPIOB->IDR & (1U << 1U) ? 0U : 1U;
+    *out_len = 1;
+    return STATUS_OK;
+}
+
+static uint8_t cmd_esp32_input(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)arg;
+    out[0] = (GPIOC->IDR & (1U << 5U)) ? 1U : 0U;
+    *out_len = 1;
+    return STATUS_OK;
+}
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+/* Results of the acquisition (acq.c) land here */
+uint8_t acq_store_sht40(uint8_t e, int16_t temp_c_x100, uint16_t rh_x100)
+{
+    if (e != 0) {
+        measurement_sht40.temperature = 0;
+        measurement_sht40.humidity    = 0;
+        measurement_sht40.valid       = 0;
+        sht40_error_flag = 1;
+        return e;
+    }
+
+    sht40_error_flag = 0;
+    measurement_sht40.temperature = temp_c_x100;
+    measurement_sht40.humidity    = rh_x100;
+    measurement_sht40.tick        = tick_10ms;
+    measurement_sht40.valid       = 1;
+    return 0;
+}
+
+/* 0, or 1 no chip, 2 read, 3 range; a failed sample keeps the previous values */
+uint8_t acq_store_bme280(uint8_t e, int32_t temp_c, uint32_t hum_x1024, uint32_t press_q24_8)
+{
+    bme280_error_flag = 1;
+    if (e != 0) return e;
+
+    uint32_t hum_x100 = (hum_x1024 * 100U) / 1024U;
+    if (temp_c < -4000 || temp_c > 8500 || hum_x100 > 10000 || press_q24_8 == 0) return 3;
+
+    measurement_bme280.temperature    = temp_c;
+    measurement_bme280.humidity       = hum_x100;
+    measurement_bme280.humidity_x1024 = hum_x1024;
+    measurement_bme280.pressure       = press_q24_8;
+    measurement_bme280.tick           = tick_10ms;
+    measurement_bme280.valid          = 1;
+    bme280_error_flag = 0;
+    return 0;
+}
+
+static uint32_t loop_max_cyc = 0;
+
+/* Sample age in ms, saturating at 0xFFFF */
+static uint16_t sample_age_ms(uint32_t tick)
+{
+    uint32_t age = (tick_10ms - tick) * 10U;
+    return age > 0xFFFFU ? 0xFFFFU : (uint16_t)age;
+}
+
+/*
+ * SHT40 / BME280 reads are answered from the 1 s background samples.
+ * arg[0] bit 0 (SENSOR_FRESH) runs a conversion first. The sample age in ms
+ * (uint16 BE) follows the values.
+ */
+#define SENSOR_FRESH    0x01
+
+static uint8_t cmd_sht40(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    *out_len = 1;
+
+    if (arg[0] & SENSOR_FRESH) {
+        uint8_t e = acq_sht40_fresh();
+        if (e != 0) {
+            out[0] = e;
+            return ERROR_RESPONSE;
+        }
+    }
+    if (!measurement_sht40.valid || sht40_error_flag) {
+        out[0] = 1;
+        return ERROR_RESPONSE;
+    }
+
+    int16_t  t  = measurement_sht40.temperature;
+    uint16_t rh = measurement_sht40.humidity;
+    uint16_t age = sample_age_ms(measurement_sht40.tick);
+
+    out[0] = (uint8_t)((t >> 8) & 0xFF);
+    out[1] = (uint8_t)( t       & 0xFF);
+    out[2] = (uint8_t)((rh >> 8) & 0xFF);
+    out[3] = (uint8_t)( rh       & 0xFF);
+    out[4] = (uint8_t)(age >> 8);
+    out[5] = (uint8_t)age;
+    *out_len = 6;
+    return STATUS_OK;
+}
+
+static uint8_t cmd_bme280(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    *out_len = 1;
+
+    if (arg[0] & SENSOR_FRESH) {
+        uint8_t e = acq_bme280_fresh();
+        if (e != 0) {
+            out[0] = e;
+            return ERROR_RESPONSE;
+        }
+    }
+    if (!measurement_bme280.valid || bme280_error_flag) {
+        out[0] = 1;
+        return ERROR_RESPONSE;
+    }
+
+    uint16_t age = sample_age_ms(measurement_bme280.tick);
+
+    put_be32(&out[0], (uint32_t)measurement_bme280.temperature);
+    put_be32(&out[4], measurement_bme280.humidity_x1024);
+    put_be32(&out[8], measurement_bme280.pressure);
+    out[12] = (uint8_t)(age >> 8);
+    out[13] = (uint8_t)age;
+    *out_len = 14;
+    return STATUS_OK;
+}
+
+static uint8_t cmd_outputs(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)arg;
+    out[0] = led1_state;
+    out[1] = led2_state;
+    out[2] = rgb_r;
+    out[3] = rgb_g;
+    out[4] = rgb_b;
+    *out_len = 5;
+    return STATUS_OK;
+}
+
+/* Output writes: arg[0] = VALUE, the new state is echoed back */
+static uint8_t write_output(char port, uint8_t pin, volatile uint8_t *state,
+                            const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    uint8_t val = arg[0] ? 1U : 0U;
+    if (val) pin_set_high(port, pin);
+    else     pin_set_low(port, pin);
+    *state = val;
+    out[0] = val;
+    *out_len = 1;
+    return STATUS_OK;
+}
+
+static uint8_t cmd_led1(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    return write_output('B', 14U, &led1_state, arg, out, out_len);
+}
+
+static uint8_t cmd_led2(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    return write_output('B', 15U, &led2_state, arg, out, out_len);
+}
+
+static uint8_t cmd_pb12(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    return write_output('B', 12U, &pb12_state, arg, out, out_len);
+}
+
+static uint8_t cmd_pc0(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    return write_output('C', 0U, &pc0_state, arg, out, out_len);
+}
+
+static uint8_t cmd_pc1(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    return write_output('C', 1U, &pc1_state, arg, out, out_len);
+}
+
+static uint8_t cmd_pc2(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    return write_output('C', 2U, &pc2_state, arg, out, out_len);
+}
+
+static uint8_t cmd_pc3(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    return write_output('C', 3U, &pc3_state, arg, out, out_len);
+}
+
+static uint8_t cmd_esp32(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    return write_output('C', 4U, &esp32_state, arg, out, out_len);
+}
+
+/* PWM duty writes: arg[0] = duty cycle, echoed back */
+static uint8_t cmd_tim1_ch1(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    timer1_pwm_ch1_set_duty(arg[0]);
+    out[0] = arg[0];
+    *out_len = 1;
+    return STATUS_OK;
+}
+
+static uint8_t cmd_tim2_ch3(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    timer2_pwm_ch3_set_duty(arg[0]);
+    out[0] = arg[0];
+    *out_len = 1;
+    return STATUS_OK;
+}
+
+static uint8_t cmd_tim4_ch3(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
 {
-    if (!data || len == 0) return -1;
-    if (len > sizeof(uart2_tx_frame)) len = sizeof(uart2_tx_frame);
+    timer4_pwm_ch3_set_duty(arg[0]);
+    out[0] = arg[0];
+    *out_len = 1;
+    return STATUS_OK;
+}
+
+static uint8_t cmd_tim4_ch4(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    timer4_pwm_ch4_set_duty(arg[0]);
+    out[0] = arg[0];
+    *out_len = 1;
+    return STATUS_OK;
+}
+
+static uint8_t cmd_rgb(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    rgb_r = arg[0];
+    rgb_g = arg[1];
+    rgb_b = arg[2];
+    timer3_pwm_set_color(rgb_r, rgb_g, rgb_b);
+    out[0] = rgb_r; out[1] = rgb_g; out[2] = rgb_b;
+    *out_len = 3;
+    return STATUS_OK;
+}
+
+static uint8_t cmd_buzzer(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    if (arg[0] == 0 && arg[1] == 0) {
+        timer3_pwm_set_buzzer_freq(0, 0);
+        *out_len = 0;
+        return STATUS_OK;
+    }
+    uint16_t freq = ((uint16_t)arg[0] << 8) | arg[1];
+    uint8_t  vol  = arg[2];
+    if (vol > 100U) vol = 100U;
+    timer3_pwm_set_buzzer_freq((uint32_t)freq, (uint32_t)vol);
+    out[0] = arg[0]; out[1] = arg[1]; out[2] = vol;
+    *out_len = 3;
+    return STATUS_OK;
+}
+
+static uint8_t cmd_rtc_read(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)arg;
+    rtc_read_datetime(&out[0], &out[1], &out[2], &out[3], &out[4], &out[5], &out[6]);
+    *out_len = 7;
+    return STATUS_OK;
+}
+
+static uint8_t cmd_rtc_write(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    uint8_t year    = arg[0];
+    uint8_t month   = arg[1];
+    uint8_t day     = arg[2];
+    uint8_t weekday = arg[3];
+    uint8_t hours   = arg[4];
+    uint8_t minutes = arg[5];
+    uint8_t seconds = arg[6];
+
+    *out_len = 0;
+    if (year > 99U ||
+        month < 1U || month > 12U ||
+        day   < 1U || day   > 31U ||
+        weekday < 1U || weekday > 7U ||
+        hours > 23U || minutes > 59U || seconds > 59U) {
+        return ERROR_RESPONSE;
+    }
+
+    __disable_irq();
+    int rc = rtc_set_datetime(year, month, day, weekday, hours, minutes, seconds);
+    __enable_irq();
+
+    if (rc != 0) {
+        out[0] = (uint8_t)(-rc);
+        *out_len = 1;
+        return ERROR_RESPONSE;
+    }
+
+    memcpy(out, arg, 7);
+    *out_len = 7;
+    return STATUS_OK;
+}
+
+static uint8_t cmd_rtc_wakeup(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)out;
+    uint16_t sec = ((uint16_t)arg[0] << 8) | arg[1];
+    *out_len = 0;
+    return rtc_wakeup_start_seconds(sec) != 0 ? ERROR_RESPONSE : STATUS_OK;
+}
 
-    uint32_t t = 2000000U;
-    while (uart2_tx_busy) {
-        if (--t == 0U) return -1;
+static uint8_t cmd_alarm_set(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)out;
+    *out_len = 0;
+    if (rtc_alarmA_set_hms(arg[0], arg[1], arg[2], arg[3] ? 1U : 0U) != 0) {
+        return ERROR_RESPONSE;
     }
+    return STATUS_OK;
+}
 
-    uart2_tx_busy = 1;
-    memcpy(uart2_tx_frame, data, len);
-    dma1_uart2_tx_start((uint32_t)uart2_tx_frame, len);
-    return 1;
+static uint8_t cmd_alarm_off(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)arg; (void)out;
+    rtc_alarmA_disable();
+    *out_len = 0;
+    return STATUS_OK;
 }
 
-static int uart1_dma_send(const uint8_t *data, uint16_t len)
+static uint8_t cmd_timestamp(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
 {
-    if (!data || len == 0) return -1;
-    if (len > sizeof(uart1_tx_frame)) len = sizeof(uart1_tx_frame);
+    (void)arg;
+    *out_len = 0;
+    if (rtc_timestamp_read(&out[1], &out[2], &out[3], &out[4], &out[5], &out[6]) != 0) {
+        return ERROR_RESPONSE;
+    }
+    out[0] = 0xFF;
+    *out_len = 7;
+    return STATUS_OK;
+}
 
-    uint32_t t = 2000000U;
-    while (uart1_tx_busy) {
-        if (--t == 0U) return -1;
+static uint8_t cmd_ina226(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)arg;
+    uint16_t id = 0, cal = 0;
+    int r = ina226_id(&id, &cal);
+    if (r < 0) {
+        out[0] = (uint8_t)(-r);
+        *out_len = 1;
+        return ERROR_RESPONSE;
     }
+    uint32_t bus_uV = ina226_bus_uV();
+    int32_t shunt_uV = ina226_shunt_uV();
+    int32_t current_uA = ina226_current_uA();
+    uint32_t power_uW = ina226_power_uW();
+
+    out[0] = (bus_uV >> 24) & 0xFF;
+    out[1] = (bus_uV >> 16) & 0xFF;
+    out[2] = (bus_uV >> 8) & 0xFF;
+    out[3] = bus_uV & 0xFF;
+    out[4] = (shunt_uV >> 24) & 0xFF;
+    out[5] = (shunt_uV >> 16) & 0xFF;
+    out[6] = (shunt_uV >> 8) & 0xFF;
+    out[7] = shunt_uV & 0xFF;
+    out[8] = (current_uA >> 24) & 0xFF;
+    out[9] = (current_uA >> 16) & 0xFF;
+    out[10] = (current_uA >> 8) & 0xFF;
+    out[11] = current_uA & 0xFF;
+    out[12] = (power_uW >> 24) & 0xFF;
+    out[13] = (power_uW >> 16) & 0xFF;
+    out[14] = (power_uW >> 8) & 0xFF;
+    out[15] = power_uW & 0xFF;
+    out[16] = (id >> 8) & 0xFF;
+    out[17] = id & 0xFF;
+    *out_len = 18;
+    return STATUS_OK;
+}
 
-    uart1_tx_busy = 1;
-    memcpy(uart1_tx_frame, data, len);
-    dma2_uart1_tx_start((uint32_t)uart1_tx_frame, len);
-    return 1;
+/*
+ * INA226 log: arg = first ring index (u16 BE, 0 = oldest)
+ * out = charge C Q32.32 (i64), energy J Q32.32 (u64), peak uA (i32),
+ *       conversions (u32), integrated ms (u32), gaps (u16), read errors (u16),
+ *       entry period us (u32), ring fill (u16), first (u16), n,
+ *       then n x (avg mW, peak mW) u16 pairs, oldest first
+ * Legacy requests get it as a long reply (handle_long_response).
+ */
+#define INA_LOG_HDR     41U
+#define INA_LOG_MAX     ((LINK_PAYLOAD_MAX - INA_LOG_HDR) / 4U)
+
+static uint8_t cmd_ina226_log(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    ina226_totals_t t;
+    ina226_totals(&t);
+
+    uint16_t first = ((uint16_t)arg[0] << 8) | arg[1];
+    uint16_t fill = ina226_ring_count();
+    uint8_t n = 0;
+
+    put_be32(&out[0],  (uint32_t)((uint64_t)t.charge_q32 >> 32));
+    put_be32(&out[4],  (uint32_t)t.charge_q32);
+    put_be32(&out[8],  (uint32_t)(t.energy_q32 >> 32));
+    put_be32(&out[12], (uint32_t)t.energy_q32);
+    put_be32(&out[16], (uint32_t)t.peak_uA);
+    put_be32(&out[20], t.conversions);
+    put_be32(&out[24], t.time_ms);
+    out[28] = (t.gaps >> 8) & 0xFF;
+    out[29] = t.gaps & 0xFF;
+    out[30] = (t.errors >> 8) & 0xFF;
+    out[31] = t.errors & 0xFF;
+    put_be32(&out[32], INA226_ENTRY_US);
+    out[36] = (fill >> 8) & 0xFF;
+    out[37] = fill & 0xFF;
+    out[38] = arg[0];
+    out[39] = arg[1];
+
+    ina226_sample_t e;
+    while (n < INA_LOG_MAX && ina226_ring_get((uint16_t)(first + n), &e) == 0) {
+        uint8_t *p = &out[INA_LOG_HDR + 4U * n];
+        p[0] = (e.avg_mW >> 8) & 0xFF;
+        p[1] = e.avg_mW & 0xFF;
+        p[2] = (e.peak_mW >> 8) & 0xFF;
+        p[3] = e.peak_mW & 0xFF;
+        n++;
+    }
+    out[40] = n;
+    *out_len = (uint8_t)(INA_LOG_HDR + 4U * n);
+    return STATUS_OK;
+}
+
+static uint8_t cmd_ina_log_reset(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)arg;
+    (void)out;
+    ina226_log_reset();
+    *out_len = 0;
+    return STATUS_OK;
+}
+
+/* Link statistics: frames, RX queue overflows, TX ring drops, worst queue wait (us) */
+static uint8_t cmd_link_stats(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)arg;
+    put_be32(&out[0],  rx_frames);
+    put_be32(&out[4],  uart1_rx_overflows() + uart2_rx_overflows());
+    put_be32(&out[8],  uart1_tx_dropped() + uart2_tx_dropped());
+    put_be32(&out[12], dwt_cycles_to_us(rx_latency_max_cyc));
+    *out_len = 16;
+    return STATUS_OK;
+}
+
+/* Acquisition: cycles, dead time last/max (us), longest main loop pass (us) */
+static uint8_t cmd_acq_stats(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)arg;
+    uint32_t cycles, dead_last_cyc, dead_max_cyc;
+    acq_stats(&cycles, &dead_last_cyc, &dead_max_cyc);
+    put_be32(&out[0],  cycles);
+    put_be32(&out[4],  dwt_cycles_to_us(dead_last_cyc));
+    put_be32(&out[8],  dwt_cycles_to_us(dead_max_cyc));
+    put_be32(&out[12], dwt_cycles_to_us(loop_max_cyc));
+    *out_len = 16;
+    return STATUS_OK;
+}
+
+/*
+ * Set baud: arg = rate uint32 BE (LINK_BAUD_DEFAULT..LINK_BAUD_MAX).
+ * Answered at the current rate; the port switches when the answer is out and
+ * falls back to 115200 unless a good frame arrives within the confirm window.
+ * out = rate, confirm window in ms uint16 BE
+ */
+static uint8_t cmd_link_baud_set(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    uint32_t baud = ((uint32_t)arg[0] << 24) | ((uint32_t)arg[1] << 16) |
+                    ((uint32_t)arg[2] << 8) | arg[3];
+    int ok = cmd_on_uart1 ? uart1_baud_request(baud) : uart2_baud_request(baud);
+    if (ok < 0) return ERROR_RESPONSE;
+
+    put_be32(&out[0], baud);
+    out[4] = (uint8_t)(LINK_BAUD_CONFIRM_MS >> 8);
+    out[5] = (uint8_t)LINK_BAUD_CONFIRM_MS;
+    *out_len = 6;
+    return STATUS_OK;
+}
+
+/* Link rate of this port: rate, state (link_baud_state_t), fallbacks */
+static uint8_t cmd_link_baud_get(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)arg;
+    const link_baud_t *lb = cmd_on_uart1 ? uart1_baud() : uart2_baud();
+    put_be32(&out[0], lb->baud);
+    out[4] = lb->state;
+    put_be32(&out[5], lb->fallbacks);
+    *out_len = 9;
+    return STATUS_OK;
+}
+
+/*
+ * Profiling readout (prof.h), all times in DWT cycles; the host converts
+ * with the core clock from 0x0B00. Mean is sum / count.
+ */
+static uint32_t prof_since_tick = 0;
+
+static void put_prof_stat(uint8_t *p, const prof_stat_t *st)
+{
+    put_be32(&p[0],  st->count);
+    put_be32(&p[4],  st->min);
+    put_be32(&p[8],  st->max);
+    put_be32(&p[12], prof_mean(st));
+}
+
+/* Core clock Hz, probes, command slots used, histogram buckets, window ms */
+static uint8_t cmd_prof_info(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)arg;
+    put_be32(&out[0], SystemCoreClock);
+    out[4] = PROF_PROBE_COUNT;
+    out[5] = prof_cmd_used();
+    out[6] = PROF_HIST_BUCKETS;
+    put_be32(&out[7], (tick_10ms - prof_since_tick) * 10U);
+    *out_len = 11;
+    return STATUS_OK;
+}
+
+/* arg = probe (ISR / section): probe, count, min, max, mean */
+static uint8_t cmd_prof_probe(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    prof_stat_t st;
+    if (prof_probe_get(arg[0], &st) < 0) return ERROR_RESPONSE;
+
+    out[0] = arg[0];
+    put_prof_stat(&out[1], &st);
+    *out_len = 17;
+    return STATUS_OK;
+}
+
+/* arg = slot, in order of first use: cmd, param, count, min, max, mean */
+static uint8_t cmd_prof_cmd(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    prof_stat_t st;
+    uint16_t id;
+    if (prof_cmd_get(arg[0], &id, &st) < 0) return ERROR_RESPONSE;
+
+    out[0] = (uint8_t)(id >> 8);
+    out[1] = (uint8_t)id;
+    put_prof_stat(&out[2], &st);
+    *out_len = 18;
+    return STATUS_OK;
+}
+
+/* arg = first bucket: first, n, then n (<= 4) loop period counts uint32 BE */
+static uint8_t cmd_prof_hist(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    uint8_t first = arg[0];
+    if (first >= PROF_HIST_BUCKETS) return ERROR_RESPONSE;
+
+    uint8_t n = (uint8_t)(PROF_HIST_BUCKETS - first);
+    if (n > 4U) n = 4U;
+
+    out[0] = first;
+    out[1] = n;
+    for (uint8_t i = 0; i < n; i++) put_be32(&out[2 + 4U * i], prof_hist_get((uint8_t)(first + i)));
+    *out_len = (uint8_t)(2U + 4U * n);
+    return STATUS_OK;
+}
+
+static uint8_t cmd_prof_reset(const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    (void)arg;
+    (void)out;
+    prof_reset();
+    prof_since_tick = tick_10ms;
+    *out_len = 0;
+    return STATUS_OK;
+}
+
+/*
+ * Command table: cmd_groups[cmd].params[param].
+ * arg_len  - request payload bytes the command reads (req[4..])
+ * resp_len - largest response payload it produces
+ * arg_opt  - trailing arg bytes a v2 request may omit (read as 0); legacy
+ *            frames and batch sub-requests always carry all arg_len bytes
+ */
+static const cmd_desc_t cmd_group_00[] = {
+    [0x00] = { cmd_ping,        0,  3 },  /* Ping */
+};
+
+static const cmd_desc_t cmd_group_01[] = {
+    [0x00] = { cmd_serial,      0,  4 },  /* Read device serial number */
+    [0x01] = { cmd_version,     0,  5 },  /* Read firmware and hardware version */
+    [0x02] = { cmd_build_date,  0, 10 },  /* Read firmware build date */
+    [0x03] = { cmd_prod_date,   0, 10 },  /* Read production date */
+};
+
+static const cmd_desc_t cmd_group_02[] = {
+    [0x00] = { cmd_adc,         0,  4 },  /* Read ADC values */
+    [0x01] = { cmd_btn1,        0,  1 },  /* Read BTN1 input status */
+    [0x02] = { cmd_btn2,        0,  1 },  /* Read BTN2 input status */
+    [0x03] = { cmd_esp32_input, 0,  1 },  /* Read ESP32 input status */
+};
+
+static const cmd_desc_t cmd_group_03[] = {
+    [0x00] = { cmd_sht40,       1,  6, 1 },  /* Read Temperature/Humidity (SHT40), cached */
+    [0x01] = { cmd_bme280,      1, 14, 1 },  /* Read Temperature/Humidity/Pressure (BME280), cached */
+};
+
+static const cmd_desc_t cmd_group_04[] = {
+    [0x00] = { cmd_outputs,     0,  5 },  /* Read output states: LED1, LED2, R, G, B */
+    [0x01] = { cmd_led1,        1,  1 },  /* Write LED1 */
+    [0x02] = { cmd_led2,        1,  1 },  /* Write LED2 */
+    [0x03] = { cmd_pb12,        1,  1 },  /* Write PB12 */
+    [0x04] = { cmd_pc0,         1,  1 },  /* Write PC0 */
+    [0x05] = { cmd_pc1,         1,  1 },  /* Write PC1 */
+    [0x06] = { cmd_pc2,         1,  1 },  /* Write PC2 */
+    [0x07] = { cmd_pc3,         1,  1 },  /* Write PC3 */
+    [0x08] = { cmd_esp32,       1,  1 },  /* Write ESP32 */
+};
+
+static const cmd_desc_t cmd_group_05[] = {
+    [0x01] = { cmd_tim1_ch1,    1,  1 },  /* Set TIM1 CH1 duty cycle */
+    [0x02] = { cmd_tim2_ch3,    1,  1 },  /* Set TIM2 CH3 duty cycle */
+    [0x03] = { cmd_tim4_ch3,    1,  1 },  /* Set TIM4 CH3 duty cycle */
+    [0x04] = { cmd_tim4_ch4,    1,  1 },  /* Set TIM4 CH4 duty cycle */
+    [0x05] = { cmd_rgb,         3,  3 },  /* Set RGB color: R G B */
+    [0x06] = { cmd_buzzer,      3,  3 },  /* Set buzzer: freq BE, volume 0-100 */
+};
+
+static const cmd_desc_t cmd_group_06[] = {
+    [0x00] = { cmd_rtc_read,    0,  7 },  /* Read RTC: YY MM DD WD hh mm ss */
+    [0x01] = { cmd_rtc_write,   7,  7 },  /* Write RTC: YY MM DD WD hh mm ss */
+    [0x02] = { cmd_rtc_wakeup,  2,  0 },  /* Set wakeup seconds, uint16 BE */
+    [0x03] = { cmd_alarm_set,   4,  0 },  /* Alarm A set: hh mm ss daily */
+    [0x04] = { cmd_alarm_off,   0,  0 },  /* Alarm A off */
+    [0x05] = { cmd_timestamp,   0,  7 },  /* Get timestamp (YY=0xFF) */
+};
+
+static const cmd_desc_t cmd_group_09[] = {
+    [0x00] = { cmd_link_stats,  0, 16 },  /* Link statistics */
+    [0x01] = { cmd_acq_stats,   0, 16 },  /* Sensor acquisition dead time */
+};
+
+static const cmd_desc_t cmd_group_0a[] = {
+    [0x00] = { cmd_link_baud_set, 4, 6 },  /* Set link baud rate */
+    [0x01] = { cmd_link_baud_get, 0, 9 },  /* Read link baud rate */
+};
+
+static const cmd_desc_t cmd_group_0b[] = {
+    [0x00] = { cmd_prof_info,   0, 11 },  /* Profiling: clock, sizes, window */
+    [0x01] = { cmd_prof_probe,  1, 17 },  /* Profiling: ISR / main loop section */
+    [0x02] = { cmd_prof_cmd,    1, 18 },  /* Profiling: command handler */
+    [0x03] = { cmd_prof_hist,   1, 18 },  /* Profiling: main loop period histogram */
+    [0x04] = { cmd_prof_reset,  0,  0 },  /* Profiling: reset */
+};
+
+static const cmd_desc_t cmd_group_70[] = {
+    [0x00] = { cmd_ina226,      0,  18 },     /* INA226 read */
+    [0x01] = { cmd_ina226_log,  2, 253, 2 },  /* INA226 totals and power ring */
+    [0x02] = { cmd_ina_log_reset, 0, 0 },     /* INA226 log reset */
+};
+
+#define CMD_GROUP(tbl) { (tbl), (uint8_t)(sizeof(tbl) / sizeof((tbl)[0])) }
+
+static const cmd_group_t cmd_groups[CMD_GROUP_COUNT] = {
+    [0x00] = CMD_GROUP(cmd_group_00),
+    [0x01] = CMD_GROUP(cmd_group_01),
+    [0x02] = CMD_GROUP(cmd_group_02),
+    [0x03] = CMD_GROUP(cmd_group_03),
+    [0x04] = CMD_GROUP(cmd_group_04),
+    [0x05] = CMD_GROUP(cmd_group_05),
+    [0x06] = CMD_GROUP(cmd_group_06),
+    [0x09] = CMD_GROUP(cmd_group_09),
+    [0x0A] = CMD_GROUP(cmd_group_0a),
+    [0x0B] = CMD_GROUP(cmd_group_0b),
+    [0x70] = CMD_GROUP(cmd_group_70),
+};
+
+static const cmd_desc_t *cmd_lookup(uint8_t cmd, uint8_t param)
+{
+    if (cmd >= CMD_GROUP_COUNT) return NULL;
+    const cmd_group_t *g = &cmd_groups[cmd];
+    if (param >= g->count) return NULL;
+    const cmd_desc_t *d = &g->params[param];
+    return d->fn ? d : NULL;
+}
+
+/* Run a handler and charge its DWT cycles to the command */
+static uint8_t cmd_call(const cmd_desc_t *d, uint8_t cmd, uint8_t param,
+                        const uint8_t *arg, uint8_t *out, uint8_t *out_len)
+{
+    uint32_t t0 = dwt_cycles();
+    uint8_t status = d->fn(arg, out, out_len);
+    prof_cmd_add(CMD_ID(cmd, param), dwt_cycles() - t0);
+    return status;
+}
+
+static int uart_send(const uint8_t *data, uint16_t len, uint8_t use_uart1)
+{
+    return use_uart1 ? uart1_tx_enqueue(data, len) : uart2_tx_enqueue(data, len);
 }
 
 static void handle_response(uint8_t status, uint8_t cmd, uint8_t param,
@@ -187,487 +934,212 @@ static void handle_response(uint8_t status, uint8_t cmd, uint8_t param,
 
     resp[FRAME_LEN_APP - 1] = crc8_atm(resp, FRAME_LEN_APP - 1);
 
-    if (use_uart1) uart1_dma_send(resp, FRAME_LEN_APP);
-    else           uart2_dma_send(resp, FRAME_LEN_APP);
+    uart_send(resp, FRAME_LEN_APP, use_uart1);
 }
 
-static void handle_request(const uint8_t *req, uint8_t use_uart1)
+/*
+ * Legacy reply longer than a frame, same layout as the batch reply:
+ *   DEV_ADDR, status, cmd, param, L, payload[L], crc8
+ */
+static void handle_long_response(uint8_t status, uint8_t cmd, uint8_t param,
+                                 const uint8_t *payload, uint8_t payload_len, uint8_t use_uart1)
 {
-    uint8_t addr  = req[0];
-    uint8_t cmd   = req[2];
-    uint8_t param_addr = req[3];
-    uint16_t cmd_combined = ((uint16_t)cmd << 8) | param_addr;
-
-    if (addr != DEV_ADDR) return;
-
-    switch (cmd_combined) {
-        case 0x0000: /* Ping */
-        {
-            uint8_t data[3] = {0xAA, 0xAA, 0xAA};
-            handle_response(STATUS_OK, cmd, param_addr, data, sizeof(data), use_uart1);
-            break;
-        }
-
-        case 0x0100: /* Read device serial number */
-        {
-            const device_info_t *info = device_info_get();
-            uint32_t serial = 0;
-            if (info->magic == INFO_MAGIC) serial = info->serial;
-
-            uint8_t serial_bytes[4] = {
-                (uint8_t)((serial >> 24) & 0xFF),
-                (uint8_t)((serial >> 16) & 0xFF),
-                (uint8_t)((serial >> 8) & 0xFF),
-                (uint8_t)(serial & 0xFF)
-            };
-            handle_response(STATUS_OK, cmd, param_addr, serial_bytes, 4, use_uart1);
-            break;
-        }
+    static uint8_t resp[LINK_PAYLOAD_MAX + 6U];
 
-        case 0x0101: /* Read firmware and hardware version */
-        {
-            const device_info_t *info = device_info_get();
-            uint8_t hwmaj = 0, hwmin = 0;
-            if (info->magic == INFO_MAGIC) { hwmaj = info->hw_major; hwmin = info->hw_minor; }
-
-            uint8_t payload[5] = {
-                FW_VERSION_MAJOR, FW_VERSION_MINOR, FW_VERSION_PATCH, hwmaj, hwmin
-            };
-            handle_response(STATUS_OK, cmd, param_addr, payload, 5, use_uart1);
-            break;
-        }
-
-        case 0x0102: /* Read firmware build date */
-        {
-            uint8_t payload[10] = {0};
-            memcpy(payload, FW_BUILD_DATE, 10);
-            handle_response(STATUS_OK, cmd, param_addr, payload, 10, use_uart1);
-            break;
-        }
+    resp[0] = DEV_ADDR;
+    resp[1] = status;
+    resp[2] = cmd;
+    resp[3] = param;
+    resp[4] = payload_len;
+    memcpy(&resp[5], payload, payload_len);
+    resp[5U + payload_len] = crc8_atm(resp, 5U + payload_len);
 
-        case 0x0103: /* Read production date */
-        {
-            const device_info_t *info = device_info_get();
-            uint8_t payload[10] = {0};
-            if (info->magic == INFO_MAGIC) memcpy(payload, info->prod_date, 10);
-            handle_response(STATUS_OK, cmd, param_addr, payload, 10, use_uart1);
-            break;
-        }
+    uart_send(resp, 6U + payload_len, use_uart1);
+}
 
-        case 0x0200: /* Read ADC values */
-        {
-            uint16_t v0 = adc_data_buffer[0];
-            uint16_t v1 = adc_data_buffer[1];
-            uint8_t data[4] = {(uint8_t)(v0 >> 8), (uint8_t)v0, (uint8_t)(v1 >> 8), (uint8_t)v1};
-            handle_response(STATUS_OK, cmd, param_addr, data, 4, use_uart1);
-            break;
-        }
-        case 0x0201: /* Read BTN1 input status */
-        {
-            uint8_t btn_pressed = GPIOB->IDR & (1U << 0U) ? 0U : 1U;
-            uint8_t data[1] = { btn_pressed ? 1U : 0U };
-            handle_response(STATUS_OK, cmd, param_addr, data, 1, use_uart1);
-            break;
-        }
-        case 0x0202: /* Read BTN2 input status */
-        {
-            uint8_t btn_pressed = GPIOB->IDR & (1U << 1U) ? 0U : 1U;
-            uint8_t data[1] = { btn_pressed ? 1U : 0U };
-            handle_response(STATUS_OK, cmd, param_addr, data, 1, use_uart1);
-            break;
-        }
-        case 0x0203: /* Read ESP32 input status */
-        {
-            uint8_t esp32_input = (GPIOC->IDR & (1U << 5U)) ? 1U : 0U;
-            uint8_t data[1] = { esp32_input ? 1U : 0U };
-            handle_response(STATUS_OK, cmd, param_addr, data, 1, use_uart1);
+/*
+ * Batch 0x0800: in[0] = N, then N sub-requests packed as cmd, param, arg[arg_len].
+ *
+ * out = done, then per executed sub-request: status, cmd, param, len, payload[len]
+ *
+ * Sub-requests run in order. Parsing stops at an unknown command (answered with
+ * ERROR_RESPONSE and len 0), a truncated argument list, a nested batch, or when the
+ * next reply would not fit; "done" tells the gateway how far it got, and the
+ * returned status is ERROR_RESPONSE if fewer than N were executed.
+ */
+static uint8_t batch_run(const uint8_t *in, uint16_t in_len,
+                         uint8_t *out, uint16_t out_max, uint16_t *out_len)
+{
+    const uint8_t *p   = &in[1];
+    const uint8_t *end = &in[in_len];
+    uint8_t count = in[0];
+    uint8_t done = 0;
+    uint16_t n = 1;
+
+    while (done < count && (end - p) >= 2) {
+        uint8_t sub_cmd   = p[0];
+        uint8_t sub_param = p[1];
+        const cmd_desc_t *d = cmd_lookup(sub_cmd, sub_param);
+        uint8_t *hdr = &out[n];
+
+        if (!d) {
+            if (n + 4U > out_max) break;
+            hdr[0] = ERROR_RESPONSE; hdr[1] = sub_cmd; hdr[2] = sub_param; hdr[3] = 0;
+            n += 4U;
+            done++;
             break;
         }
-        case 0x0300: /* Read Temperature/Humidity (SHT40) */
-        {
-            int16_t temp_c_x100 = 0;
-            uint16_t rh_x100 = 0;
-
-            uint8_t e = sht40_data_read_int(&temp_c_x100, &rh_x100);
-            if (e != 0) {
-                uint8_t err = e;
-                handle_response(ERROR_RESPONSE, cmd, param_addr, &err, 1, use_uart1);
-                break;
-            }
-
-            uint8_t data[4];
-            data[0] = (uint8_t)((temp_c_x100 >> 8) & 0xFF);
-            data[1] = (uint8_t)( temp_c_x100       & 0xFF);
-            data[2] = (uint8_t)((rh_x100 >> 8) & 0xFF);
-            data[3] = (uint8_t)( rh_x100       & 0xFF);
+        if ((end - p) < 2 + d->arg_len) break;
+        if (n + 4U + d->resp_len > out_max) break;
+
+        uint8_t len = 0;
+        hdr[0] = cmd_call(d, sub_cmd, sub_param, &p[2], &hdr[4], &len);
+        hdr[1] = sub_cmd;
+        hdr[2] = sub_param;
+        hdr[3] = len;
+        n += 4U + len;
+        p += 2 + d->arg_len;
+        done++;
+    }
 
-            handle_response(STATUS_OK, cmd, param_addr, data, 4, use_uart1);
-            break;
-        }
-        case 0x0301: /* Read Temperature/Humidity/Pressure (BME280) */
-        {
-            uint8_t id = bme280_read_id();
-            if (id != 0x60) {
-                uint8_t err = 1;
-                handle_response(ERROR_RESPONSE, cmd, param_addr, &err, 1, use_uart1);
-                break;
-            }
+    out[0] = done;
+    *out_len = n;
+    return (done == count) ? STATUS_OK : ERROR_RESPONSE;
+}
 
-            bme280_trigger_forced();
-            systick_delay_ms(10);
+/*
+ * Legacy batch reply (variable length, not a 24-byte frame):
+ *   DEV_ADDR, status, 0x08, 0x00, L, body[L], crc8
+ */
+static void handle_batch(const uint8_t *req, uint8_t use_uart1)
+{
+    static uint8_t resp[BATCH_FRAME_MAX];
+    uint16_t n = 0;
+    uint32_t t0 = dwt_cycles();
 
-            int32_t temp_c;
-            uint32_t hum_pct, press_q24_8;
+    resp[0] = DEV_ADDR;
+    resp[1] = batch_run(&req[4], FRAME_PAYLOAD, &resp[5], BATCH_FRAME_MAX - 6U, &n);
+    prof_cmd_add(CMD_BATCH, dwt_cycles() - t0);
+    resp[2] = req[2];
+    resp[3] = req[3];
+    resp[4] = (uint8_t)n;
+    resp[5 + n] = crc8_atm(resp, 5U + n);
+
+    uart_send(resp, 6U + n, use_uart1);
+}
 
-            if (bme280_read_data(&temp_c, &hum_pct, &press_q24_8) != 0) {
-                uint8_t err = 2;
-                handle_response(ERROR_RESPONSE, cmd, param_addr, &err, 1, use_uart1);
-                break;
-            }
+static void handle_request(const uint8_t *req, uint8_t use_uart1)
+{
+    uint8_t addr  = req[0];
+    uint8_t cmd   = req[2];
+    uint8_t param_addr = req[3];
 
-            if (temp_c < -4000 || temp_c > 8500 || hum_pct > 102400U || press_q24_8 == 0) {
-                uint8_t err = 3;
-                handle_response(ERROR_RESPONSE, cmd, param_addr, &err, 1, use_uart1);
-                break;
-            }
+    if (addr != DEV_ADDR) return;
 
-            uint8_t data[12];
-            data[0]  = (uint8_t)((temp_c >> 24) & 0xFF);
-            data[1]  = (uint8_t)((temp_c >> 16) & 0xFF);
-            data[2]  = (uint8_t)((temp_c >> 8) & 0xFF);
-            data[3]  = (uint8_t)(temp_c & 0xFF);
+    if (CMD_ID(cmd, param_addr) == CMD_BATCH) {
+        handle_batch(req, use_uart1);
+        return;
+    }
 
-            data[4]  = (uint8_t)((hum_pct >> 24) & 0xFF);
-            data[5]  = (uint8_t)((hum_pct >> 16) & 0xFF);
-            data[6]  = (uint8_t)((hum_pct >> 8) & 0xFF);
-            data[7]  = (uint8_t)(hum_pct & 0xFF);
+    const cmd_desc_t *d = cmd_lookup(cmd, param_addr);
+    if (!d) {
+        handle_response(ERROR_RESPONSE, cmd, param_addr, NULL, 0, use_uart1);
+        return;
+    }
 
-            data[8]  = (uint8_t)((press_q24_8 >> 24) & 0xFF);
-            data[9]  = (uint8_t)((press_q24_8 >> 16) & 0xFF);
-            data[10] = (uint8_t)((press_q24_8 >> 8) & 0xFF);
-            data[11] = (uint8_t)(press_q24_8 & 0xFF);
+    static uint8_t data[LINK_PAYLOAD_MAX];
+    uint8_t len = 0;
+    uint8_t status = cmd_call(d, cmd, param_addr, &req[4], data, &len);
+    if (len > FRAME_PAYLOAD) {
+        handle_long_response(status, cmd, param_addr, data, len, use_uart1);
+        return;
+    }
+    handle_response(status, cmd, param_addr, data, len, use_uart1);
+}
 
-            handle_response(STATUS_OK, cmd, param_addr, data, 12, use_uart1);
-            break;
-        }
-        case 0x0400: /* Read output states: LED1, LED2, R, G, B */
-        {
-            uint8_t data[5] = { led1_state, led2_state, rgb_r, rgb_g, rgb_b };
-            handle_response(STATUS_OK, cmd, param_addr, data, 5, use_uart1);
-            break;
-        }
-        case 0x0401: /* Write LED1: req[4] = VALUE */
-        {
-            uint8_t val = req[4] ? 1U : 0U;
-            if (val) pin_set_high('B', 14U);
-            else     pin_set_low('B', 14U);
-            led1_state = val;
-            uint8_t data[1] = { led1_state };
-            handle_response(STATUS_OK, cmd, param_addr, data, 1, use_uart1);
-            break;
-        }
-        case 0x0402: /* Write LED2: req[4] = VALUE */
-        {
-            uint8_t val = req[4] ? 1U : 0U;
-            if (val) pin_set_high('B', 15U);
-            else     pin_set_low('B', 15U);
-            led2_state = val;
-            uint8_t data[1] = { led2_state };
-            handle_response(STATUS_OK, cmd, param_addr, data, 1, use_uart1);
-            break;
-        }
-        case 0x0403: /* Write PB12: req[4] = VALUE */
-        {
-            uint8_t val = req[4] ? 1U : 0U;
-            if (val) pin_set_high('B', 12U);
-            else     pin_set_low('B', 12U);
-            pb12_state = val;
-            uint8_t data[1] = { pb12_state };
-            handle_response(STATUS_OK, cmd, param_addr, data, 1, use_uart1);
-            break;
-        }
-        case 0x0404: /* Write PC0: req[4] = VALUE */
-        {
-            uint8_t val = req[4] ? 1U : 0U;
-            if (val) pin_set_high('C', 0U);
-            else     pin_set_low('C', 0U);
-            pc0_state = val;
-            uint8_t data[1] = { pc0_state };
-            handle_response(STATUS_OK, cmd, param_addr, data, 1, use_uart1);
-            break;
-        }
-        case 0x0405: /* Write PC1: req[4] = VALUE */
-        {
-            uint8_t val = req[4] ? 1U : 0U;
-            if (val) pin_set_high('C', 1U);
-            else     pin_set_low('C', 1U);
-            pc1_state = val;
-            uint8_t data[1] = { pc1_state };
-            handle_response(STATUS_OK, cmd, param_addr, data, 1, use_uart1);
-            break;
-        }
-        case 0x0406: /* Write PC2: req[4] = VALUE */
-        {
-            uint8_t val = req[4] ? 1U : 0U;
-            if (val) pin_set_high('C', 2U);
-            else     pin_set_low('C', 2U);
-            pc2_state = val;
-            uint8_t data[1] = { pc2_state };
-            handle_response(STATUS_OK, cmd, param_addr, data, 1, use_uart1);
-            break;
-        }
-        case 0x0407: /* Write PC3: req[4] = VALUE */
-        {
-            uint8_t val = req[4] ? 1U : 0U;
-            if (val) pin_set_high('C', 3U);
-            else     pin_set_low('C', 3U);
-            pc3_state = val;
-            uint8_t data[1] = { pc3_state };
-            handle_response(STATUS_OK, cmd, param_addr, data, 1, use_uart1);
-            break;
-        }
-        case 0x0408: /* Write ESP32: req[4] = VALUE */
-        {
-            uint8_t val = req[4] ? 1U : 0U;
-            if (val) pin_set_high('C', 4U);
-            else     pin_set_low('C', 4U);
-            esp32_state = val;
-            uint8_t data[1] = { esp32_state };
-            handle_response(STATUS_OK, cmd, param_addr, data, 1, use_uart1);
-            break;
-        }
-        case 0x0501: /* Set TIM1 CH1 req[4]=duty cycle*/
-        {
-            uint8_t duty = req[4];
-            timer1_pwm_ch1_set_duty(duty);
-            uint8_t data[1] = { duty };
-            handle_response(STATUS_OK, cmd, param_addr, data, 1, use_uart1);
-            break;
-        }
-        case 0x0502: /* Set TIM2 CH3 req[4]=duty cycle*/
-        {
-            uint8_t duty = req[4];
-            timer2_pwm_ch3_set_duty(duty);
-            uint8_t data[1] = { duty };
-            handle_response(STATUS_OK, cmd, param_addr, data, 1, use_uart1);
-            break;
-        }
-        case 0x0503: /* Set TIM4 CH3 req[4]=duty cycle*/
-        {
-            uint8_t duty = req[4];
-            timer4_pwm_ch3_set_duty(duty);
-            uint8_t data[1] = { duty };
-            handle_response(STATUS_OK, cmd, param_addr, data, 1, use_uart1);
-            break;
-        }
-        case 0x0504: /* Set TIM4 CH4 req[4]=duty cycle*/
-        {
-            uint8_t duty = req[4];
-            timer4_pwm_ch4_set_duty(duty);
-            uint8_t data[1] = { duty };
-            handle_response(STATUS_OK, cmd, param_addr, data, 1, use_uart1);
-            break;
-        }
-        case 0x0505: /* Set RGB color: req[4]=R, req[5]=G, req[6]=B */
-        {
-            rgb_r = req[4];
-            rgb_g = req[5];
-            rgb_b = req[6];
-            timer3_pwm_set_color(rgb_r, rgb_g, rgb_b);
-            uint8_t data[3] = { rgb_r, rgb_g, rgb_b };
-            handle_response(STATUS_OK, cmd, param_addr, data, 3, use_uart1);
-            break;
-        }
-        case 0x0506: /* Set buzzer: req[4..5]=freq BE, req[6]=volume 0-100 */
-        {
-            if (req[4] == 0 && req[5] == 0) {
-                timer3_pwm_set_buzzer_freq(0, 0);
-                handle_response(STATUS_OK, cmd, param_addr, NULL, 0, use_uart1);
-                break;
+/* v2 request: same table, payloads up to LINK_PAYLOAD_MAX, reply as RESP/ACK */
+static void handle_link_request(const link_packet_t *pkt, uint8_t duplicate, uint8_t use_uart1)
+{
+    static uint8_t out[LINK_PAYLOAD_MAX];
+    static uint8_t wire[LINK_WIRE_MAX];
+    uint8_t type = LINK_RESP;
+    uint8_t status;
+    uint16_t len = 0;
+
+    if (duplicate) {
+        type = LINK_ACK;
+        status = STATUS_OK;
+    } else if (CMD_ID(pkt->cmd, pkt->param) == CMD_BATCH) {
+        uint32_t t0 = dwt_cycles();
+        status = pkt->len ? batch_run(pkt->payload, pkt->len, out, sizeof(out), &len)
+                          : ERROR_RESPONSE;
+        prof_cmd_add(CMD_BATCH, dwt_cycles() - t0);
+    } else {
+        const cmd_desc_t *d = cmd_lookup(pkt->cmd, pkt->param);
+        if (!d || pkt->len < d->arg_len - d->arg_opt) {
+            status = ERROR_RESPONSE;
+        } else {
+            uint8_t arg[FRAME_PAYLOAD] = {0};
+            const uint8_t *a = pkt->payload;
+            if (pkt->len < d->arg_len) {
+                memcpy(arg, pkt->payload, pkt->len);
+                a = arg;
             }
-            uint16_t freq = ((uint16_t)req[4] << 8) | req[5];
-            uint8_t  vol  = req[6];
-            if (vol > 100U) vol = 100U;
-            timer3_pwm_set_buzzer_freq((uint32_t)freq, (uint32_t)vol);
-            uint8_t data[3] = { req[4], req[5], vol };
-            handle_response(STATUS_OK, cmd, param_addr, data, 3, use_uart1);
-            break;
+            uint8_t l = 0;
+            status = cmd_call(d, pkt->cmd, pkt->param, a, out, &l);
+            len = l;
         }
-        case 0x0600: /* Read RTC Date and Time -> payload[0..6] = YY MM DD WD hh mm ss */
-        {
-            uint8_t year, month, day, weekday;
-            uint8_t hours, minutes, seconds;
-
-            rtc_read_datetime(&year, &month, &day, &weekday, &hours, &minutes, &seconds);
-
-            uint8_t data[7];
-            data[0] = year;
-            data[1] = month;
-            data[2] = day;
-            data[3] = weekday;
-            data[4] = hours;
-            data[5] = minutes;
-            data[6] = seconds;
-
-            handle_response(STATUS_OK, cmd, param_addr, data, 7, use_uart1);
-            break;
-        }
-        case 0x0601: /* Write RTC Date and Time (req[4..10] = YY MM DD WD hh mm ss) */
-        {
-            uint8_t year    = req[4];
-            uint8_t month   = req[5];
-            uint8_t day     = req[6];
-            uint8_t weekday = req[7];
-            uint8_t hours   = req[8];
-            uint8_t minutes = req[9];
-            uint8_t seconds = req[10];
-
-            if (year > 99U ||
-                month < 1U || month > 12U ||
-                day   < 1U || day   > 31U ||
-                weekday < 1U || weekday > 7U ||
-                hours > 23U || minutes > 59U || seconds > 59U) {
-                handle_response(ERROR_RESPONSE, cmd, param_addr, NULL, 0, use_uart1);
-                break;
-            }
-
-            __disable_irq();
-            int rc = rtc_set_datetime(year, month, day, weekday, hours, minutes, seconds);
-            __enable_irq();
+    }
 
-            if (rc != 0) {
-                uint8_t err = (uint8_t)(-rc);
-                handle_response(ERROR_RESPONSE, cmd, param_addr, &err, 1, use_uart1);
-                break;
-            }
+    uint16_t n = link_encode(type, DEV_ADDR, pkt->seq, pkt->cmd, pkt->param, status,
+                             out, (uint8_t)len, wire, sizeof(wire));
+    uart_send(wire, n, use_uart1);
+}
 
-            uint8_t data[7] = { year, month, day, weekday, hours, minutes, seconds };
-            handle_response(STATUS_OK, cmd, param_addr, data, 7, use_uart1);
-            break;
-        }
-        case 0x0602: /* SET wakeup seconds: payload[0..1] = seconds uint16 BE */
-        {
-            uint16_t sec = ((uint16_t)req[4] << 8) | req[5];
-            if (rtc_wakeup_start_seconds(sec) != 0) {
-                handle_response(ERROR_RESPONSE, cmd, param_addr, NULL, 0, use_uart1);
-                break;
-            }
-            handle_response(STATUS_OK, cmd, param_addr, NULL, 0, use_uart1);
-            break;
-        }
-        case 0x0603: /* ALARM A set: payload = hh mm ss + daily(0/1) */
-        {
-            uint8_t hh = req[4];
-            uint8_t mm = req[5];
-            uint8_t ss = req[6];
-            uint8_t daily = req[7];
-
-            if (rtc_alarmA_set_hms(hh, mm, ss, daily ? 1U : 0U) != 0) {
-                handle_response(ERROR_RESPONSE, cmd, param_addr, NULL, 0, use_uart1);
-                break;
-            }
-            handle_response(STATUS_OK, cmd, param_addr, NULL, 0, use_uart1);
+static void uart_dispatch(const uart_rx_frame_t *f, uint8_t use_uart1)
+{
+    uint32_t wait = dwt_cycles() - f->t_rx;
+    if (wait > rx_latency_max_cyc) rx_latency_max_cyc = wait;
+    rx_frames++;
+    cmd_on_uart1 = use_uart1;
+
+    switch (f->event) {
+        case LINK_RX_LEGACY:
+            handle_request(f->pkt.payload, use_uart1);
             break;
-        }
-        case 0x0604: /* ALARM A off */
-        {
-            rtc_alarmA_disable();
-            handle_response(STATUS_OK, cmd, param_addr, NULL, 0, use_uart1);
+        case LINK_RX_PACKET:
+            handle_link_request(&f->pkt, f->duplicate, use_uart1);
             break;
-        }
-        case 0x0605: /* GET timestamp -> 7 bytes: YY MM DD WD hh mm ss (YY=0xFF) */
+        case LINK_RX_NAK:
         {
-            uint8_t mo, dd, wd, hh, mi, ss;
-            int r = rtc_timestamp_read(&mo, &dd, &wd, &hh, &mi, &ss);
-            if (r != 0) {
-                handle_response(ERROR_RESPONSE, cmd, param_addr, NULL, 0, use_uart1);
-                break;
-            }
-            uint8_t data[7] = { 0xFF, mo, dd, wd, hh, mi, ss };
-            handle_response(STATUS_OK, cmd, param_addr, data, 7, use_uart1);
-            break;
-        }
-        case 0x7000: /* INA226 read */
-        {
-            uint16_t id = 0, cal = 0;
-            int r = ina226_id(&id, &cal);
-            if (r < 0) {
-                uint8_t err = (uint8_t)(-r);
-                handle_response(ERROR_RESPONSE, cmd, param_addr, &err, 1, use_uart1);
-                break;
-            }
-            uint32_t bus_uV = ina226_bus_uV();
-            int32_t shunt_uV = ina226_shunt_uV();
-            int32_t current_uA = ina226_current_uA();
-            uint32_t power_uW = ina226_power_uW();
-
-            uint8_t data[18];
-            data[0] = (bus_uV >> 24) & 0xFF;
-            data[1] = (bus_uV >> 16) & 0xFF;
-            data[2] = (bus_uV >> 8) & 0xFF;
-            data[3] = bus_uV & 0xFF;
-            data[4] = (shunt_uV >> 24) & 0xFF;
-            data[5] = (shunt_uV >> 16) & 0xFF;
-            data[6] = (shunt_uV >> 8) & 0xFF;
-            data[7] = shunt_uV & 0xFF;
-            data[8] = (current_uA >> 24) & 0xFF;
-            data[9] = (current_uA >> 16) & 0xFF;
-            data[10] = (current_uA >> 8) & 0xFF;
-            data[11] = current_uA & 0xFF;
-            data[12] = (power_uW >> 24) & 0xFF;
-            data[13] = (power_uW >> 16) & 0xFF;
-            data[14] = (power_uW >> 8) & 0xFF;
-            data[15] = power_uW & 0xFF;
-            data[16] = (id >> 8) & 0xFF;
-            data[17] = id & 0xFF;
-
-            handle_response(STATUS_OK, cmd, param_addr, data, 18, use_uart1);
+            uint8_t nak[16];
+            uint16_t n = link_encode(LINK_NAK, DEV_ADDR, f->nak_seq, 0, 0, f->nak_reason,
+                                     NULL, 0, nak, sizeof(nak));
+            uart_send(nak, n, use_uart1);
             break;
         }
         default:
-            handle_response(ERROR_RESPONSE, cmd, param_addr, NULL, 0, use_uart1);
             break;
     }
 }
 
 static void uart2_process_rx(void)
 {
-    uint16_t pos = (uint16_t)(UART2_RX_BUFFER_SIZE - DMA1_Stream5->NDTR);
-
-    while (uart2_rx_old_pos != pos) {
-        uint8_t b = uart2_rx_buf[uart2_rx_old_pos++];
-        if (uart2_rx_old_pos >= UART2_RX_BUFFER_SIZE) uart2_rx_old_pos = 0;
+    const uart_rx_frame_t *f;
 
-        if (uart2_frame_idx == 0 && b != DEV_ADDR) continue;
-
-        uart2_frame_acc[uart2_frame_idx++] = b;
-        if (uart2_frame_idx == UART2_RX_FRAME_LEN) {
-            if (crc8_atm(uart2_frame_acc, FRAME_LEN_APP - 1) == uart2_frame_acc[FRAME_LEN_APP - 1]) {
-                handle_request(uart2_frame_acc, 0);
-            }
-            uart2_frame_idx = 0;
-        }
+    while ((f = uart2_rx_peek()) != NULL) {
+        uart_dispatch(f, 0);
+        uart2_rx_pop();
     }
 }
 
 static void uart1_process_rx(void)
 {
-    uint16_t pos = (uint16_t)(UART1_RX_BUFFER_SIZE - DMA2_Stream5->NDTR);
+    const uart_rx_frame_t *f;
 
-    while (uart1_rx_old_pos != pos) {
-        uint8_t b = uart1_rx_buf[uart1_rx_old_pos++];
-        if (uart1_rx_old_pos >= UART1_RX_BUFFER_SIZE) uart1_rx_old_pos = 0;
-
-        if (uart1_frame_idx == 0 && b != DEV_ADDR) continue;
-
-        uart1_frame_acc[uart1_frame_idx++] = b;
-        if (uart1_frame_idx == UART1_RX_FRAME_LEN) {
-            if (crc8_atm(uart1_frame_acc, FRAME_LEN_APP - 1) ==
-                uart1_frame_acc[FRAME_LEN_APP - 1]) {
-                handle_request(uart1_frame_acc, 1);
-            }
-            uart1_frame_idx = 0;
-        }
+    while ((f = uart1_rx_peek()) != NULL) {
+        uart_dispatch(f, 1);
+        uart1_rx_pop();
     }
 }
 
@@ -678,6 +1150,8 @@ int main(void)
     SCB->VTOR = 0x08008000U;
     __DSB(); __ISB();
 
+    dwt_init();
+
     portc_init();
     portb_init();
 
@@ -704,17 +1178,13 @@ int main(void)
     uart1_rxtx_init();
     uart2_rxtx_init();
 
-    dma1_uart2_rx_config((uint32_t *)uart2_rx_buf, UART2_RX_BUFFER_SIZE);
-    dma2_uart1_rx_config((uint32_t *)uart1_rx_buf, UART1_RX_BUFFER_SIZE);
+    uart2_rx_start(DEV_ADDR, FRAME_LEN_APP);
+    uart1_rx_start(DEV_ADDR, FRAME_LEN_APP);
 
     i2c1_init();
     dma_i2c1_rx_init();
     dma_i2c1_tx_init();
 
-    lcd_init();
-    lcd_set_cursor(0, 0);
-    lcd_send_string("Initializing...");
-
     rtc_init();
 
     spi1_init();
@@ -723,18 +1193,36 @@ int main(void)
 
     __enable_irq();
 
+    /* I2C1 transfers complete from the IRQs */
+    lcd_init();
+    lcd_set_cursor(0, 0);
+    lcd_send_string("Initializing...");
+
     bme280_init();
 
     ina226_init(0x40, 500, 2000);
+    ina226_start_logging();
+
+    uint32_t loop_prev = dwt_cycles();
 
     while (1) {
+        uint32_t loop_now = dwt_cycles();
+        if (loop_now - loop_prev > loop_max_cyc) loop_max_cyc = loop_now - loop_prev;
+        prof_loop_add(loop_now - loop_prev);
+        loop_prev = loop_now;
+
         if (btn1_pressed) { btn1_pressed = 0; btn1_handler(); }
         if (btn2_pressed) { btn2_pressed = 0; btn2_handler(); }
 
         uart2_process_rx();
         uart1_process_rx();
+        i2c1_poll();
+        ina226_poll();
+        uart2_baud_poll(tick_10ms * 10U);
+        uart1_baud_poll(tick_10ms * 10U);
 
         if(measure_flag_1s){
+            PROF_BEGIN();
             measure_flag_1s = 0;
 
             if (lcd_reinit_5s_flag) {
@@ -751,52 +1239,20 @@ int main(void)
                 }
             }
 
-            int16_t  temp_c_x100 = 0;
-            uint16_t rh_x100     = 0;
-
-            uint8_t e = sht40_data_read_int(&temp_c_x100, &rh_x100);
-            if (e != 0) {
-                measurement_sht40.temperature = 0;
-                measurement_sht40.humidity    = 0;
-                sht40_error_flag = 1;
-
-            } else {
-                sht40_error_flag = 0;
-                measurement_sht40.temperature = temp_c_x100;
-                measurement_sht40.humidity    = rh_x100;
-            }
+            acq_start();
 
             rtc_read_datetime(&datetime.year, &datetime.month, &datetime.day, &datetime.weekday,
                 &datetime.hours, &datetime.minutes, &datetime.seconds);
 
             rtc_utc_to_warsaw(&datetime.year, &datetime.month, &datetime.day, &datetime.weekday,
                 &datetime.hours, &datetime.minutes, &datetime.seconds);
+            PROF_END(PROF_SEC_1S);
+        }
 
-
-            int32_t  temp_c;
-            uint32_t hum_x1024, press_q24_8;
-
-            bme280_error_flag = 1;
-
-            uint8_t id = bme280_read_id();
-            if (id == 0x60) {
-
-                bme280_trigger_forced();
-                systick_delay_ms(10);
-
-                if (bme280_read_data(&temp_c, &hum_x1024, &press_q24_8) == 0) {
-
-                    uint32_t hum_x100 = (hum_x1024 * 100U) / 1024U;
-
-                    if (!(temp_c < -4000 || temp_c > 8500 || hum_x100 > 10000 || press_q24_8 == 0)) {
-                        measurement_bme280.temperature = temp_c;
-                        measurement_bme280.humidity    = hum_x100;
-                        measurement_bme280.pressure    = press_q24_8;
-                        bme280_error_flag = 0;
-                    }
-                }
-            }
-
+        if (acq_due()) {
+            PROF_BEGIN();
+            acq_finish();
+            PROF_END(PROF_SEC_ACQ_FINISH);
         }
 
         if (backlight_toggle_flag) {
@@ -805,6 +1261,7 @@ int main(void)
         }
 
         if (lcd_refresh_flag && lcd_is_present()) {
+            PROF_BEGIN();
             lcd_refresh_flag = 0;
             if (second_marker) second_marker = 0;
             else                second_marker = 1;
@@ -857,6 +1314,7 @@ int main(void)
             //     lcd_send_hum_1dp_from_x100((uint16_t)measurement_bme280.humidity);
             //     lcd_send_string(" ");
             // }
+            PROF_END(PROF_SEC_LCD_REFRESH);
         }
 
         if (measure_flag_10min) {
@@ -890,72 +1348,155 @@ void btn2_handler(void)
 
 void EXTI0_IRQHandler(void)
 {
+    PROF_BEGIN();
     if (EXTI->PR & EXTI_PR_PR0) { EXTI->PR = EXTI_PR_PR0; btn1_pressed = 1; }
+    PROF_END(PROF_EXTI0);
 }
 
 void EXTI1_IRQHandler(void)
 {
+    PROF_BEGIN();
     if (EXTI->PR & EXTI_PR_PR1) { EXTI->PR = EXTI_PR_PR1; btn2_pressed = 1; }
+    PROF_END(PROF_EXTI1);
+}
+
+void EXTI9_5_IRQHandler(void)
+{
+    PROF_BEGIN();
+    if (EXTI->PR & EXTI_PR_PR5) { EXTI->PR = EXTI_PR_PR5; ina226_alert_isr(); }
+    PROF_END(PROF_EXTI9_5);
 }
 
 void DMA2_Stream0_IRQHandler(void)
 {
+    PROF_BEGIN();
     if (DMA2->LISR & DMA_LISR_TCIF0) {
         DMA2->LIFCR = DMA_LIFCR_CTCIF0;
     }
+    PROF_END(PROF_ADC_DMA);
+}
+
+void USART2_IRQHandler(void)
+{
+    PROF_BEGIN();
+    if (USART2->SR & USART_SR_IDLE) {
+        (void)USART2->DR;
+        uart2_rx_isr();
+    }
+    PROF_END(PROF_USART2);
+}
+
+void USART1_IRQHandler(void)
+{
+    PROF_BEGIN();
+    if (USART1->SR & USART_SR_IDLE) {
+        (void)USART1->DR;
+        uart1_rx_isr();
+    }
+    PROF_END(PROF_USART1);
+}
+
+void DMA1_Stream5_IRQHandler(void)
+{
+    PROF_BEGIN();
+    if (DMA1->HISR & (DMA_HISR_HTIF5 | DMA_HISR_TCIF5)) {
+        DMA1->HIFCR = DMA_HIFCR_CHTIF5 | DMA_HIFCR_CTCIF5;
+        uart2_rx_isr();
+    }
+    PROF_END(PROF_UART2_DMA_RX);
+}
+
+void DMA2_Stream5_IRQHandler(void)
+{
+    PROF_BEGIN();
+    if (DMA2->HISR & (DMA_HISR_HTIF5 | DMA_HISR_TCIF5)) {
+        DMA2->HIFCR = DMA_HIFCR_CHTIF5 | DMA_HIFCR_CTCIF5;
+        uart1_rx_isr();
+    }
+    PROF_END(PROF_UART1_DMA_RX);
 }
 
 void DMA1_Stream6_IRQHandler(void)
 {
-    if (DMA1->HISR & DMA_HISR_TCIF6) {
-        DMA1->HIFCR = DMA_HIFCR_CTCIF6;
-        uart2_tx_busy = 0;
+    PROF_BEGIN();
+    if (DMA1->HISR & (DMA_HISR_TCIF6 | DMA_HISR_TEIF6)) {
+        DMA1->HIFCR = DMA_HIFCR_CTCIF6 | DMA_HIFCR_CTEIF6 | DMA_HIFCR_CFEIF6 | DMA_HIFCR_CDMEIF6;
+        uart2_tx_dma_complete();
     }
+    PROF_END(PROF_UART2_DMA_TX);
 }
 
 void DMA2_Stream7_IRQHandler(void)
 {
-    if (DMA2->HISR & DMA_HISR_TCIF7) {
-        DMA2->HIFCR = DMA_HIFCR_CTCIF7;
-        uart1_tx_busy = 0;
+    PROF_BEGIN();
+    if (DMA2->HISR & (DMA_HISR_TCIF7 | DMA_HISR_TEIF7)) {
+        DMA2->HIFCR = DMA_HIFCR_CTCIF7 | DMA_HIFCR_CTEIF7 | DMA_HIFCR_CFEIF7 | DMA_HIFCR_CDMEIF7;
+        uart1_tx_dma_complete();
     }
+    PROF_END(PROF_UART1_DMA_TX);
 }
 
 void DMA1_Stream0_IRQHandler(void)
 {
+    PROF_BEGIN();
     if (DMA1->LISR & DMA_LISR_TEIF0) {
         DMA1->LIFCR = DMA_LIFCR_CTEIF0 | DMA_LIFCR_CTCIF0 | DMA_LIFCR_CHTIF0 | DMA_LIFCR_CDMEIF0 | DMA_LIFCR_CFEIF0;
-        i2c1_dma_err = 1;
-        i2c1_dma_rx_done = 1;
-        return;
-    }
-    if (DMA1->LISR & DMA_LISR_TCIF0) {
+        i2c1_dma_rx_complete(1);
+    } else if (DMA1->LISR & DMA_LISR_TCIF0) {
         DMA1->LIFCR = DMA_LIFCR_CTCIF0;
-        i2c1_dma_rx_done = 1;
+        i2c1_dma_rx_complete(0);
     }
+    PROF_END(PROF_I2C1_DMA_RX);
 }
 
 void DMA1_Stream1_IRQHandler(void)
 {
+    PROF_BEGIN();
     if (DMA1->LISR & DMA_LISR_TEIF1) {
         DMA1->LIFCR = DMA_LIFCR_CTEIF1 | DMA_LIFCR_CTCIF1 | DMA_LIFCR_CHTIF1 | DMA_LIFCR_CDMEIF1 | DMA_LIFCR_CFEIF1;
-        i2c1_dma_err = 1;
-        i2c1_dma_tx_done = 1;
-        return;
-    }
-    if (DMA1->LISR & DMA_LISR_TCIF1) {
+        i2c1_dma_tx_complete(1);
+    } else if (DMA1->LISR & DMA_LISR_TCIF1) {
         DMA1->LIFCR = DMA_LIFCR_CTCIF1;
-        i2c1_dma_tx_done = 1;
+        i2c1_dma_tx_complete(0);
+    }
+    PROF_END(PROF_I2C1_DMA_TX);
+}
+
+void I2C1_EV_IRQHandler(void)
+{
+    PROF_BEGIN();
+    i2c1_ev_isr();
+    PROF_END(PROF_I2C1_EV);
+}
+
+void I2C1_ER_IRQHandler(void)
+{
+    PROF_BEGIN();
+    i2c1_er_isr();
+    PROF_END(PROF_I2C1_ER);
+}
+
+void TIM8_TRG_COM_TIM14_IRQHandler(void)
+{
+    PROF_BEGIN();
+    if (TIM14->SR & TIM_SR_UIF) {
+        TIM14->SR &= ~TIM_SR_UIF;
+        i2c1_timeout_isr();
     }
+    PROF_END(PROF_TIM14);
 }
 
 void TIM8_UP_TIM13_IRQHandler(void)
 {
+    PROF_BEGIN();
     if (TIM13->SR & TIM_SR_UIF) {
         TIM13->SR &= ~TIM_SR_UIF;
 
         tick_10ms++;
         tick_10ms_5s++;
+
+        acq_tick_isr();
+
         if (tick_10ms_5s >= 500U) {
             tick_10ms_5s = 0;
             lcd_reinit_5s_flag = 1;
@@ -993,10 +1534,12 @@ void TIM8_UP_TIM13_IRQHandler(void)
             measure_flag_10min = 1;
         }
     }
+    PROF_END(PROF_TIM13);
 }
 
 void RTC_WKUP_IRQHandler(void)
 {
+    PROF_BEGIN();
     if (RTC->ISR & RTC_ISR_WUTF) {
         rtc_write_protect_disable();
         RTC->ISR &= ~RTC_ISR_WUTF;
@@ -1005,10 +1548,12 @@ void RTC_WKUP_IRQHandler(void)
         rtc_exti_clear(20U);
         rtc_wakeup_flag = 1;
     }
+    PROF_END(PROF_RTC_WKUP);
 }
 
 void RTC_Alarm_IRQHandler(void)
 {
+    PROF_BEGIN();
     if (RTC->ISR & RTC_ISR_ALRAF) {
         rtc_write_protect_disable();
         RTC->ISR &= ~RTC_ISR_ALRAF;
@@ -1017,16 +1562,20 @@ void RTC_Alarm_IRQHandler(void)
         rtc_exti_clear(18U);
         rtc_alarm_flag = 1;
     }
+    PROF_END(PROF_RTC_ALARM);
 }
 
 void TAMP_STAMP_IRQHandler(void)
 {
+    PROF_BEGIN();
     rtc_exti_clear(19U);
     rtc_tampstamp_flag = 1;
+    PROF_END(PROF_RTC_TAMP_STAMP);
 }
 
 void DMA2_Stream2_IRQHandler(void)
 {
+    PROF_BEGIN();
     if (DMA2->LISR & DMA_LISR_TCIF2) {
         spi1_dma_rx_done = 1;
         DMA2->LIFCR = DMA_LIFCR_CTCIF2;
@@ -1034,10 +1583,12 @@ void DMA2_Stream2_IRQHandler(void)
     if (DMA2->LISR & DMA_LISR_TEIF2) {
         DMA2->LIFCR = DMA_LIFCR_CTEIF2;
     }
+    PROF_END(PROF_SPI1_DMA_RX);
 }
 
 void DMA2_Stream3_IRQHandler(void)
 {
+    PROF_BEGIN();
     if (DMA2->LISR & DMA_LISR_TCIF3) {
         spi1_dma_tx_done = 1;
         DMA2->LIFCR = DMA_LIFCR_CTCIF3;
@@ -1045,4 +1596,5 @@ void DMA2_Stream3_IRQHandler(void)
     if (DMA2->LISR & DMA_LISR_TEIF3) {
         DMA2->LIFCR = DMA_LIFCR_CTEIF3;
     }
-}
\ No newline at end of file
+    PROF_END(PROF_SPI1_DMA_TX);
+}
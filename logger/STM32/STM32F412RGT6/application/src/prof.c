@@ -0,0 +1,90 @@
+#include "prof.h"
+
+static prof_stat_t probes[PROF_PROBE_COUNT];
+static prof_stat_t cmds[PROF_CMD_SLOTS];
+static uint16_t cmd_ids[PROF_CMD_SLOTS];
+static uint8_t cmd_used = 0;
+static uint32_t hist[PROF_HIST_BUCKETS];
+
+static void stat_add(prof_stat_t *s, uint32_t cycles)
+{
+    if (s->count == 0U || cycles < s->min) s->min = cycles;
+    if (cycles > s->max) s->max = cycles;
+    s->sum += cycles;
+    s->count++;
+}
+
+/* From ISRs; a probe is only ever updated from one priority level */
+void prof_add(uint8_t probe, uint32_t cycles)
+{
+    if (probe >= PROF_PROBE_COUNT) return;
+    stat_add(&probes[probe], cycles);
+}
+
+/* Main loop only; commands get a slot on first use, in order */
+void prof_cmd_add(uint16_t cmd_id, uint32_t cycles)
+{
+    uint8_t i = 0;
+    while (i < cmd_used && cmd_ids[i] != cmd_id) i++;
+
+    if (i == cmd_used) {
+        if (cmd_used >= PROF_CMD_SLOTS) return;
+        cmd_ids[i] = cmd_id;
+        cmd_used++;
+    }
+    stat_add(&cmds[i], cycles);
+}
+
+void prof_loop_add(uint32_t cycles)
+{
+    uint32_t us = dwt_cycles_to_us(cycles);
+    uint32_t b = us ? (31U - __CLZ(us)) : 0U;
+    if (b >= PROF_HIST_BUCKETS) b = PROF_HIST_BUCKETS - 1U;
+    hist[b]++;
+}
+
+void prof_reset(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint8_t i = 0; i < PROF_PROBE_COUNT; i++) probes[i] = (prof_stat_t){0};
+    for (uint8_t i = 0; i < PROF_CMD_SLOTS; i++) cmds[i] = (prof_stat_t){0};
+    for (uint8_t i = 0; i < PROF_HIST_BUCKETS; i++) hist[i] = 0;
+    cmd_used = 0;
+    __set_PRIMASK(primask);
+}
+
+/* Consistent copy of a probe the ISRs may be updating */
+int prof_probe_get(uint8_t probe, prof_stat_t *stat)
+{
+    if (probe >= PROF_PROBE_COUNT) return -1;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *stat = probes[probe];
+    __set_PRIMASK(primask);
+    return 0;
+}
+
+int prof_cmd_get(uint8_t slot, uint16_t *cmd_id, prof_stat_t *stat)
+{
+    if (slot >= cmd_used) return -1;
+    *cmd_id = cmd_ids[slot];
+    *stat = cmds[slot];
+    return 0;
+}
+
+uint8_t prof_cmd_used(void)
+{
+    return cmd_used;
+}
+
+uint32_t prof_hist_get(uint8_t bucket)
+{
+    return (bucket < PROF_HIST_BUCKETS) ? hist[bucket] : 0U;
+}
+
+uint32_t prof_mean(const prof_stat_t *stat)
+{
+    return stat->count ? (uint32_t)(stat->sum / stat->count) : 0U;
+}
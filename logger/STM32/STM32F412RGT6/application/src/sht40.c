@@ -38,19 +38,31 @@ uint32_t sht40_read_serial_number(void)
     return serial;
 }
 
-static uint8_t sht40_read_raw(uint16_t *rawT, uint16_t *rawRH)
+/* Start a high-repeatability single shot; the result is ready after 8.3 ms max */
+uint8_t sht40_start_measurement(void)
 {
-    if (!rawT || !rawRH) return 1;
-
     uint8_t cmd = SHT40_CMD_SINGLE_SHOT_HIGHREP;
     if (i2c1_write_raw_dma(SHT40_ADDR, &cmd, 1) != 1) {
         return 2;
     }
-    systick_delay_ms(15);
-    uint8_t data[6];
-    if (i2c1_read_raw_dma(SHT40_ADDR, data, 6) != 1) {
-        return 3;
-    }
+    return 0;
+}
+
+/* Same single shot, queued on I2C1; cb gets the command's bus status */
+int sht40_start_measurement_async(i2c1_cb_t cb, void *ctx)
+{
+    uint8_t cmd = SHT40_CMD_SINGLE_SHOT_HIGHREP;
+    return i2c1_submit(SHT40_ADDR, &cmd, 1, 0, 0, cb, ctx);
+}
+
+/* Queue the 6 byte result read into data (kept valid until cb); decode with sht40_decode_int() */
+int sht40_fetch_async(uint8_t *data, i2c1_cb_t cb, void *ctx)
+{
+    return i2c1_submit(SHT40_ADDR, 0, 0, data, SHT40_DATA_LEN, cb, ctx);
+}
+
+static uint8_t sht40_unpack_raw(const uint8_t *data, uint16_t *rawT, uint16_t *rawRH)
+{
     if (data[2] != sht_crc8(data, 2) || data[5] != sht_crc8(&data[3], 2)) {
         return 4;
     }
@@ -59,6 +71,43 @@ static uint8_t sht40_read_raw(uint16_t *rawT, uint16_t *rawRH)
     return 0;
 }
 
+static uint8_t sht40_fetch_raw(uint16_t *rawT, uint16_t *rawRH)
+{
+    uint8_t data[SHT40_DATA_LEN];
+    if (i2c1_read_raw_dma(SHT40_ADDR, data, SHT40_DATA_LEN) != 1) {
+        return 3;
+    }
+    return sht40_unpack_raw(data, rawT, rawRH);
+}
+
+static uint8_t sht40_read_raw(uint16_t *rawT, uint16_t *rawRH)
+{
+    if (!rawT || !rawRH) return 1;
+
+    uint8_t e = sht40_start_measurement();
+    if (e) return e;
+    systick_delay_ms(15);
+    return sht40_fetch_raw(rawT, rawRH);
+}
+
+static void sht40_convert_int(uint16_t rawT, uint16_t rawRH, int16_t *temp_c, uint16_t *rh)
+{
+    int32_t tx100 = -4500;
+    tx100 += (int32_t)((17500UL * (uint32_t)rawT + 32767UL) / 65535UL);
+
+    int32_t hx100 = -600;
+    hx100 += (int32_t)((12500UL * (uint32_t)rawRH + 32767UL) / 65535UL);
+
+    if (tx100 < -32768) tx100 = -32768;
+    if (tx100 >  32767) tx100 =  32767;
+
+    if (hx100 < 0) hx100 = 0;
+    if (hx100 > 10000) hx100 = 10000;
+
+    *temp_c = (int16_t)tx100;
+    *rh     = (uint16_t)hx100;
+}
+
 uint8_t sht40_single_shot_measurement(uint8_t *data)
 {
     uint8_t cmd = SHT40_CMD_SINGLE_SHOT_HIGHREP;
@@ -94,20 +143,18 @@ uint8_t sht40_data_read_int(int16_t *temp_c, uint16_t *rh)
     uint8_t e = sht40_read_raw(&rawT, &rawRH);
     if (e) return e;
 
-    int32_t tx100 = -4500;
-    tx100 += (int32_t)((17500UL * (uint32_t)rawT + 32767UL) / 65535UL);
-
-    int32_t hx100 = -600;
-    hx100 += (int32_t)((12500UL * (uint32_t)rawRH + 32767UL) / 65535UL);
+    sht40_convert_int(rawT, rawRH, temp_c, rh);
+    return 0;
+}
 
-    if (tx100 < -32768) tx100 = -32768;
-    if (tx100 >  32767) tx100 =  32767;
+uint8_t sht40_decode_int(const uint8_t *data, int16_t *temp_c, uint16_t *rh)
+{
+    if (!data || !temp_c || !rh) return 1;
 
-    if (hx100 < 0) hx100 = 0;
-    if (hx100 > 10000) hx100 = 10000;
+    uint16_t rawT, rawRH;
+    uint8_t e = sht40_unpack_raw(data, &rawT, &rawRH);
+    if (e) return e;
 
-    *temp_c = (int16_t)tx100;
-    *rh     = (uint16_t)hx100;
+    sht40_convert_int(rawT, rawRH, temp_c, rh);
     return 0;
 }
-
@@ -14,4 +14,40 @@ uint8_t crc8_atm(const uint8_t *data, uint32_t len)
         }
     }
     return crc;
-}
\ No newline at end of file
+}
+
+void dwt_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+uint32_t dwt_cycles_to_us(uint32_t cycles)
+{
+    uint32_t per_us = SystemCoreClock / 1000000U;
+    return per_us ? cycles / per_us : cycles;
+}
+
+/* APB prescaler field of RCC->CFGR: 0xx = 1, 100 = 2 .. 111 = 16 */
+static uint32_t apb_div(uint32_t ppre)
+{
+    return (ppre >= 4U) ? (1U << (ppre - 3U)) : 1U;
+}
+
+uint32_t rcc_pclk1_hz(void)
+{
+    return SystemCoreClock / apb_div((RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos);
+}
+
+uint32_t rcc_pclk2_hz(void)
+{
+    return SystemCoreClock / apb_div((RCC->CFGR & RCC_CFGR_PPRE2) >> RCC_CFGR_PPRE2_Pos);
+}
+
+/* Timers on APB1 run at 2x PCLK1 whenever the APB1 prescaler is not 1 */
+uint32_t rcc_apb1_timer_hz(void)
+{
+    uint32_t div = apb_div((RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos);
+    return (div == 1U) ? SystemCoreClock : 2U * (SystemCoreClock / div);
+}
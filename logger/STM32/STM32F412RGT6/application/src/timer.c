@@ -1,4 +1,5 @@
 #include "timer.h"
+#include "support.h"
 
 // TIM1 CH1: PA8
 
@@ -13,7 +14,7 @@
 // TIM4 CH4: PB9
 
 // TIM13 - TIMER FOR CYCLIC LCD REFRESH AND SHT40 MEASUREMENT 1s, NOT USED FOR PWM
-// TIM14 - TIMER FOR CYCLIC SHT40 MEASUREMENT - 10min, NOT USED FOR PWM
+// TIM14 - I2C1 TRANSACTION TIMEOUT, 1us ONE-SHOT, NOT USED FOR PWM
 
 #define TIM1_CH1_PIN 8U
 
@@ -127,6 +128,39 @@ void timer13_init_10ms(void)
     TIM13->CR1 |= TIM_CR1_CEN;
 }
 
+void timer14_init_1us(void)
+{
+    RCC->APB1ENR |= RCC_APB1ENR_TIM14EN;
+    (void)RCC->APB1ENR;
+
+    TIM14->CR1 = TIM_CR1_OPM | TIM_CR1_URS;
+    TIM14->CR2 = 0;
+
+    TIM14->PSC = rcc_apb1_timer_hz() / 1000000U - 1U;   /* 1 MHz count */
+    TIM14->ARR = 0xFFFFU;
+
+    TIM14->EGR = TIM_EGR_UG;
+    TIM14->SR = 0;
+
+    TIM14->DIER |= TIM_DIER_UIE;
+    NVIC_EnableIRQ(TIM8_TRG_COM_TIM14_IRQn);
+}
+
+void timer14_start_us(uint16_t us)
+{
+    TIM14->CR1 &= ~TIM_CR1_CEN;
+    TIM14->CNT = 0;
+    TIM14->ARR = us ? us : 1U;
+    TIM14->SR = 0;
+    TIM14->CR1 |= TIM_CR1_CEN;
+}
+
+void timer14_stop(void)
+{
+    TIM14->CR1 &= ~TIM_CR1_CEN;
+    TIM14->SR = 0;
+}
+
 void timer1_pwm_ch1_init(uint32_t prescaler, uint32_t period){
     RCC->APB2ENR |= RCC_APB2ENR_TIM1EN;
     (void)RCC->APB2ENR;
@@ -1,4 +1,8 @@
+#include <stddef.h>
+#include <string.h>
 #include "uart.h"
+#include "dma.h"
+#include "support.h"
 
 // PA2: USART2_TX
 // PA3: USART2_RX
@@ -13,37 +17,79 @@
 #define PA10 10U
 #define UART_BAUDRATE 115200U
 
-static uint32_t get_pclk1_hz(void)
+/*
+ * TX ring per UART. The main loop appends whole frames, the DMA sends the
+ * contiguous part [tail, head) or [tail, end) and its transfer-complete IRQ
+ * chains the next part, so a wrapped frame goes out as two back-to-back
+ * transfers and nothing ever waits for the line.
+ */
+typedef struct {
+    uint8_t buf[UART_TX_RING_SIZE];
+    volatile uint16_t head;      /* written by the main loop only */
+    volatile uint16_t tail;      /* written by the DMA IRQ (or under PRIMASK) */
+    volatile uint16_t inflight;  /* bytes in the running transfer, 0 = idle */
+    volatile uint32_t dropped;   /* frames refused for lack of room */
+} uart_tx_ring_t;
+
+static uart_tx_ring_t uart1_tx;
+static uart_tx_ring_t uart2_tx;
+
+/*
+ * RX: the DMA stream writes a circular buffer without CPU help. The USART
+ * IDLE-line interrupt (end of a burst) and the stream's half/full transfer
+ * interrupts (long bursts, wrap) run the new bytes through the link parser;
+ * every complete frame is timestamped and put on a single-producer,
+ * single-consumer queue that the main loop drains. The USART and its DMA
+ * stream share one NVIC priority so the producer side never nests.
+ */
+typedef struct {
+    uint8_t dma_buf[UART_RX_DMA_SIZE];
+    uint16_t old_pos;
+    uint16_t legacy_len;
+    link_rx_t link;
+    uart_rx_frame_t q[UART_RX_QUEUE_LEN];
+    volatile uint8_t q_head;     /* written by the ISR only */
+    volatile uint8_t q_tail;     /* written by the main loop only */
+    volatile uint32_t overflows; /* frames lost because the queue was full */
+    link_baud_t baud;            /* rate negotiation, see uart_link.h */
+} uart_rx_t;
+
+static uart_rx_t uart1_rx;
+static uart_rx_t uart2_rx;
+
+static uint32_t compute_uart_div(uint32_t clk, uint32_t baud)
 {
-    uint32_t hclk = SystemCoreClock;
-    uint32_t ppre1 = (RCC->CFGR >> 8) & 0x7;
-    uint32_t div = 1;
-    if (ppre1 >= 4) {
-        div = 1U << (ppre1 - 3U);
-    }
-    return hclk / div;
+    return (clk + (baud / 2U)) / baud;
 }
 
-static uint32_t get_pclk2_hz(void)
+static void uart_set_baudrate(USART_TypeDef *USARTx, uint32_t pclk, uint32_t baud)
 {
-    uint32_t hclk = SystemCoreClock;
-    uint32_t ppre2 = (RCC->CFGR >> 11) & 0x7;
-    uint32_t div = 1;
-    if (ppre2 >= 4) {
-        div = 1U << (ppre2 - 3U);
-    }
-    return hclk / div;
+    USARTx->BRR = compute_uart_div(pclk, baud);
 }
 
-
-static uint32_t compute_uart_div(uint32_t clk, uint32_t baud)
+/*
+ * Runtime rate change. 16x oversampling tops out at pclk/16 (2.6 Mbaud on
+ * APB1), so faster rates use 8x: the divider is then 8*USARTDIV and its three
+ * fraction bits sit in BRR[2:0].
+ */
+static void uart_apply_baudrate(USART_TypeDef *USARTx, uint32_t pclk, uint32_t baud)
 {
-    return (clk + (baud / 2U)) / baud;
+    uint32_t div = compute_uart_div(pclk, baud);
+
+    USARTx->CR1 &= ~USART_CR1_UE;
+    if (div >= 16U) {
+        USARTx->CR1 &= ~USART_CR1_OVER8;
+        USARTx->BRR = div;
+    } else {
+        USARTx->CR1 |= USART_CR1_OVER8;
+        USARTx->BRR = ((div >> 3) << 4) | (div & 7U);
+    }
+    USARTx->CR1 |= USART_CR1_UE;
 }
 
-static void uart_set_baudrate(USART_TypeDef *USARTx, uint32_t pclk, uint32_t baud)
+static uint8_t baud_supported(uint32_t pclk, uint32_t baud)
 {
-    USARTx->BRR = compute_uart_div(pclk, baud);
+    return link_baud_valid(pclk, baud, 16U) || link_baud_valid(pclk, baud, 8U);
 }
 
 void uart2_rxtx_init(void)
@@ -63,7 +109,7 @@ void uart2_rxtx_init(void)
     RCC->APB1ENR |= RCC_APB1ENR_USART2EN;
     (void)RCC->APB1ENR;
 
-    uint32_t pclk1 = get_pclk1_hz();
+    uint32_t pclk1 = rcc_pclk1_hz();
     uart_set_baudrate(USART2, pclk1, UART_BAUDRATE);
 
     USART2->CR3 |= USART_CR3_DMAR | USART_CR3_DMAT;
@@ -97,7 +143,7 @@ void uart1_rxtx_init(void)
     RCC->APB2ENR |= RCC_APB2ENR_USART1EN;
     (void)RCC->APB2ENR;
 
-    uint32_t pclk2 = get_pclk2_hz();
+    uint32_t pclk2 = rcc_pclk2_hz();
     uart_set_baudrate(USART1, pclk2, UART_BAUDRATE);
 
     USART1->CR3 |= USART_CR3_DMAR | USART_CR3_DMAT;
@@ -112,4 +158,273 @@ void uart1_rxtx_init(void)
     USART1->CR1 |= USART_CR1_UE;
 
     // NVIC_EnableIRQ(USART1_IRQn);
-}
\ No newline at end of file
+}
+
+/* Start the next contiguous segment if the DMA is idle. Call with IRQs masked. */
+static void tx_kick(uart_tx_ring_t *r, void (*start)(uint32_t, uint16_t))
+{
+    uint16_t head = r->head;
+    uint16_t tail = r->tail;
+
+    if (r->inflight || head == tail) return;
+
+    uint16_t len = (head > tail) ? (uint16_t)(head - tail) : (uint16_t)(UART_TX_RING_SIZE - tail);
+    r->inflight = len;
+    start((uint32_t)&r->buf[tail], len);
+}
+
+/* Copies the whole frame or nothing; returns 1, or -1 if the ring is full. */
+static int tx_enqueue(uart_tx_ring_t *r, void (*start)(uint32_t, uint16_t),
+                      const uint8_t *data, uint16_t len)
+{
+    if (!data || len == 0) return -1;
+
+    uint16_t head = r->head;
+    uint16_t used = (uint16_t)((head + UART_TX_RING_SIZE - r->tail) % UART_TX_RING_SIZE);
+    if (len > UART_TX_RING_SIZE - 1U - used) {
+        r->dropped++;
+        return -1;
+    }
+
+    uint16_t first = (uint16_t)(UART_TX_RING_SIZE - head);
+    if (first > len) first = len;
+    memcpy(&r->buf[head], data, first);
+    memcpy(&r->buf[0], data + first, len - first);
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    r->head = (uint16_t)((head + len) % UART_TX_RING_SIZE);
+    tx_kick(r, start);
+    __set_PRIMASK(primask);
+    return 1;
+}
+
+static void tx_complete(uart_tx_ring_t *r, void (*start)(uint32_t, uint16_t))
+{
+    r->tail = (uint16_t)((r->tail + r->inflight) % UART_TX_RING_SIZE);
+    r->inflight = 0;
+    tx_kick(r, start);
+}
+
+int uart2_tx_enqueue(const uint8_t *data, uint16_t len)
+{
+    return tx_enqueue(&uart2_tx, dma1_uart2_tx_start, data, len);
+}
+
+int uart1_tx_enqueue(const uint8_t *data, uint16_t len)
+{
+    return tx_enqueue(&uart1_tx, dma2_uart1_tx_start, data, len);
+}
+
+/* Called from the TX DMA stream IRQ on transfer complete or error */
+void uart2_tx_dma_complete(void)
+{
+    tx_complete(&uart2_tx, dma1_uart2_tx_start);
+}
+
+void uart1_tx_dma_complete(void)
+{
+    tx_complete(&uart1_tx, dma2_uart1_tx_start);
+}
+
+uint32_t uart2_tx_dropped(void)
+{
+    return uart2_tx.dropped;
+}
+
+uint32_t uart1_tx_dropped(void)
+{
+    return uart1_tx.dropped;
+}
+
+static void rx_frame_done(uart_rx_t *r, link_rx_event_t ev, const link_packet_t *pkt,
+                          const uint8_t *legacy)
+{
+    if (ev == LINK_RX_LEGACY &&
+        crc8_atm(legacy, r->legacy_len - 1U) != legacy[r->legacy_len - 1U]) {
+        return;
+    }
+    if (ev != LINK_RX_NAK) link_baud_rx_good(&r->baud);
+
+    uint8_t head = r->q_head;
+    if ((uint8_t)(head - r->q_tail) >= UART_RX_QUEUE_LEN) {
+        r->overflows++;
+        return;
+    }
+
+    uart_rx_frame_t *f = &r->q[head & (UART_RX_QUEUE_LEN - 1U)];
+    f->t_rx = dwt_cycles();
+    f->event = (uint8_t)ev;
+    f->duplicate = 0;
+
+    switch (ev) {
+        case LINK_RX_LEGACY:
+            memcpy(f->pkt.payload, legacy, r->legacy_len);
+            break;
+        case LINK_RX_PACKET:
+            memcpy(&f->pkt, pkt, offsetof(link_packet_t, payload) + pkt->len);
+            f->duplicate = link_rx_is_duplicate(&r->link, pkt);
+            break;
+        default:
+            f->nak_seq = r->link.nak_seq;
+            f->nak_reason = r->link.nak_reason;
+            break;
+    }
+
+    __DMB();
+    r->q_head = (uint8_t)(head + 1U);
+}
+
+static void rx_scan(uart_rx_t *r, uint16_t ndtr)
+{
+    static link_packet_t pkt;
+    uint16_t pos = (uint16_t)(UART_RX_DMA_SIZE - ndtr);
+    if (pos >= UART_RX_DMA_SIZE) pos = 0;
+
+    while (r->old_pos != pos) {
+        const uint8_t *legacy = NULL;
+        uint8_t b = r->dma_buf[r->old_pos++];
+        if (r->old_pos >= UART_RX_DMA_SIZE) r->old_pos = 0;
+
+        link_rx_event_t ev = link_rx_push(&r->link, b, &pkt, &legacy);
+        if (ev != LINK_RX_NONE) rx_frame_done(r, ev, &pkt, legacy);
+    }
+}
+
+static const uart_rx_frame_t *rx_peek(uart_rx_t *r)
+{
+    if (r->q_tail == r->q_head) return NULL;
+    __DMB();
+    return &r->q[r->q_tail & (UART_RX_QUEUE_LEN - 1U)];
+}
+
+static void rx_pop(uart_rx_t *r)
+{
+    __DMB();
+    r->q_tail = (uint8_t)(r->q_tail + 1U);
+}
+
+void uart2_rx_start(uint8_t legacy_addr, uint16_t legacy_len)
+{
+    link_rx_init(&uart2_rx.link, legacy_addr, legacy_len);
+    link_baud_init(&uart2_rx.baud);
+    uart2_rx.legacy_len = legacy_len;
+    uart2_rx.old_pos = 0;
+
+    dma1_uart2_rx_config((uint32_t *)uart2_rx.dma_buf, UART_RX_DMA_SIZE);
+
+    (void)USART2->SR;
+    (void)USART2->DR;
+    USART2->CR1 |= USART_CR1_IDLEIE;
+    NVIC_EnableIRQ(USART2_IRQn);
+}
+
+void uart1_rx_start(uint8_t legacy_addr, uint16_t legacy_len)
+{
+    link_rx_init(&uart1_rx.link, legacy_addr, legacy_len);
+    link_baud_init(&uart1_rx.baud);
+    uart1_rx.legacy_len = legacy_len;
+    uart1_rx.old_pos = 0;
+
+    dma2_uart1_rx_config((uint32_t *)uart1_rx.dma_buf, UART_RX_DMA_SIZE);
+
+    (void)USART1->SR;
+    (void)USART1->DR;
+    USART1->CR1 |= USART_CR1_IDLEIE;
+    NVIC_EnableIRQ(USART1_IRQn);
+}
+
+/* Called from the USART IRQ (IDLE) and from the RX DMA stream IRQ (HT/TC) */
+void uart2_rx_isr(void)
+{
+    rx_scan(&uart2_rx, (uint16_t)DMA1_Stream5->NDTR);
+}
+
+void uart1_rx_isr(void)
+{
+    rx_scan(&uart1_rx, (uint16_t)DMA2_Stream5->NDTR);
+}
+
+const uart_rx_frame_t *uart2_rx_peek(void)
+{
+    return rx_peek(&uart2_rx);
+}
+
+const uart_rx_frame_t *uart1_rx_peek(void)
+{
+    return rx_peek(&uart1_rx);
+}
+
+void uart2_rx_pop(void)
+{
+    rx_pop(&uart2_rx);
+}
+
+void uart1_rx_pop(void)
+{
+    rx_pop(&uart1_rx);
+}
+
+uint32_t uart2_rx_overflows(void)
+{
+    return uart2_rx.overflows;
+}
+
+uint32_t uart1_rx_overflows(void)
+{
+    return uart1_rx.overflows;
+}
+
+/* Returns 1 and switches once the pending answer is out, or -1 if the USART can't do the rate */
+int uart2_baud_request(uint32_t baud)
+{
+    if (!baud_supported(rcc_pclk1_hz(), baud)) return -1;
+    link_baud_request(&uart2_rx.baud, baud);
+    return 1;
+}
+
+int uart1_baud_request(uint32_t baud)
+{
+    if (!baud_supported(rcc_pclk2_hz(), baud)) return -1;
+    link_baud_request(&uart1_rx.baud, baud);
+    return 1;
+}
+
+static uint8_t tx_idle(const uart_tx_ring_t *r, const USART_TypeDef *USARTx)
+{
+    return r->inflight == 0 && r->head == r->tail && (USARTx->SR & USART_SR_TC);
+}
+
+/* Bytes caught mid-switch are garbage; the parser starts over at the new rate. */
+static void baud_poll(uart_rx_t *r, const uart_tx_ring_t *t, USART_TypeDef *USARTx,
+                      uint32_t pclk, uint32_t now_ms)
+{
+    uint32_t baud = link_baud_poll(&r->baud, now_ms, tx_idle(t, USARTx));
+    if (!baud) return;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uart_apply_baudrate(USARTx, pclk, baud);
+    link_rx_reset(&r->link);
+    __set_PRIMASK(primask);
+}
+
+void uart2_baud_poll(uint32_t now_ms)
+{
+    baud_poll(&uart2_rx, &uart2_tx, USART2, rcc_pclk1_hz(), now_ms);
+}
+
+void uart1_baud_poll(uint32_t now_ms)
+{
+    baud_poll(&uart1_rx, &uart1_tx, USART1, rcc_pclk2_hz(), now_ms);
+}
+
+const link_baud_t *uart2_baud(void)
+{
+    return &uart2_rx.baud;
+}
+
+const link_baud_t *uart1_baud(void)
+{
+    return &uart1_rx.baud;
+}
@@ -0,0 +1,9 @@
+/* Host stand-in for the CMSIS device header, enough for acq.c */
+#ifndef STM32F4XX_H
+#define STM32F4XX_H
+
+#include <stdint.h>
+
+extern uint32_t SystemCoreClock;
+
+#endif // STM32F4XX_H
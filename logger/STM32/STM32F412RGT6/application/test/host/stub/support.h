@@ -0,0 +1,10 @@
+/* Host stand-in for support.h: the test drives the DWT counter */
+#ifndef SUPPORT_H
+#define SUPPORT_H
+
+#include <stdint.h>
+#include "stm32f4xx.h"
+
+uint32_t dwt_cycles(void);
+
+#endif // SUPPORT_H
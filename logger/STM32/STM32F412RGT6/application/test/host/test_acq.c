@@ -0,0 +1,241 @@
+/*
+ * Host test for the sensor acquisition: make -C test/host
+ *
+ * Simulated time (1 DWT cycle = 1 us, TIM13 every ACQ_TICK_US) and sensors:
+ * the SHT40 NACKs every command while it converts, as the real one does.
+ * Covers the background cycle and SENSOR_FRESH reads issued while a
+ * background acquisition is still pending.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "acq.h"
+#include "sht40.h"
+#include "bme280.h"
+#include "systick.h"
+#include "support.h"
+
+#define SHT40_CONV_US   9000U
+#define BME280_CONV_US  8000U
+
+static int failed = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failed++; } } while (0)
+
+uint32_t SystemCoreClock = 1000000U;
+
+static uint32_t now_us = 0;
+static uint32_t sht_busy_until = 0;
+static uint32_t bme_busy_until = 0;
+
+static void advance(uint32_t us)
+{
+    while (us--) {
+        now_us++;
+        if ((now_us % ACQ_TICK_US) == 0U) acq_tick_isr();
+    }
+}
+
+uint32_t dwt_cycles(void)
+{
+    advance(1);
+    return now_us;
+}
+
+void systick_delay_ms(uint32_t ms)
+{
+    advance(ms * 1000U);
+}
+
+/* Completed I2C1 transfers, run by run_callbacks() like i2c1_poll() */
+static struct { i2c1_cb_t cb; void *ctx; int8_t status; } done[8];
+static uint8_t done_n = 0;
+
+static void run_callbacks(void)
+{
+    for (uint8_t i = 0; i < done_n; i++) done[i].cb(done[i].status, done[i].ctx);
+    done_n = 0;
+}
+
+static int8_t sht_command(void)
+{
+    return (now_us < sht_busy_until) ? I2C1_ERR_NACK : I2C1_OK;
+}
+
+int sht40_start_measurement_async(i2c1_cb_t cb, void *ctx)
+{
+    int8_t status = sht_command();
+    if (status == I2C1_OK) sht_busy_until = now_us + SHT40_CONV_US;
+    done[done_n].cb = cb;
+    done[done_n].ctx = ctx;
+    done[done_n].status = status;
+    done_n++;
+    return 0;
+}
+
+int sht40_fetch_async(uint8_t *data, i2c1_cb_t cb, void *ctx)
+{
+    memset(data, 0, SHT40_DATA_LEN);
+    done[done_n].cb = cb;
+    done[done_n].ctx = ctx;
+    done[done_n].status = sht_command();
+    done_n++;
+    return 0;
+}
+
+uint8_t sht40_decode_int(const uint8_t *data, int16_t *temp_c, uint16_t *rh)
+{
+    (void)data;
+    *temp_c = 2150;
+    *rh = 4500;
+    return 0;
+}
+
+/* Blocking single shot: command, conversion, read */
+uint8_t sht40_data_read_int(int16_t *temp_c, uint16_t *rh)
+{
+    if (sht_command() != I2C1_OK) return 2;
+    advance(SHT40_CONV_US);
+    *temp_c = 2200;
+    *rh = 4600;
+    return 0;
+}
+
+uint8_t bme280_read_id(void)
+{
+    return 0x60;
+}
+
+void bme280_trigger_forced(void)
+{
+    bme_busy_until = now_us + BME280_CONV_US;
+}
+
+uint8_t bme280_read_data(int32_t *temp_c, uint32_t *hum_pct, uint32_t *press_hPa)
+{
+    if (now_us < bme_busy_until) return 1;
+    *temp_c = 2150;
+    *hum_pct = 45U * 1024U;
+    *press_hPa = 101325U * 256U;
+    return 0;
+}
+
+static uint8_t sht_e = 0xFF, bme_e = 0xFF;
+static uint16_t sht_stores = 0, bme_stores = 0;
+static int16_t sht_temp = 0;
+
+uint8_t acq_store_sht40(uint8_t e, int16_t temp_c_x100, uint16_t rh_x100)
+{
+    (void)rh_x100;
+    sht_e = e;
+    sht_temp = temp_c_x100;
+    sht_stores++;
+    return e;
+}
+
+uint8_t acq_store_bme280(uint8_t e, int32_t temp_c, uint32_t hum_x1024, uint32_t press_q24_8)
+{
+    (void)temp_c;
+    (void)hum_x1024;
+    (void)press_q24_8;
+    bme_e = e;
+    bme_stores++;
+    return e;
+}
+
+/* Main loop until the background acquisition is finished */
+static void main_loop_until_done(void)
+{
+    for (uint32_t i = 0; i < 10U * ACQ_TICK_US && !acq_due(); i++) advance(1);
+    acq_finish();
+    run_callbacks();
+}
+
+static void reset_stores(void)
+{
+    sht_e = bme_e = 0xFF;
+    sht_stores = bme_stores = 0;
+}
+
+static void test_background(void)
+{
+    reset_stores();
+    acq_start();
+    run_callbacks();
+    CHECK(acq_due() == 0);
+
+    main_loop_until_done();
+    CHECK(sht_stores == 1 && sht_e == 0 && sht_temp == 2150);
+    CHECK(bme_stores == 1 && bme_e == 0);
+
+    uint32_t cycles, dead_last, dead_max;
+    acq_stats(&cycles, &dead_last, &dead_max);
+    CHECK(cycles >= 1U && dead_max >= dead_last);
+}
+
+static void test_fresh_idle(void)
+{
+    advance(ACQ_TICK_US * 50U);
+    reset_stores();
+
+    uint32_t t0 = now_us;
+    CHECK(acq_sht40_fresh() == 0);
+    CHECK(sht_stores == 1 && sht_temp == 2200);
+    CHECK(now_us - t0 < SHT40_CONV_US + 100U);  /* nothing to wait for */
+
+    CHECK(acq_bme280_fresh() == 0);
+    CHECK(bme_stores == 1 && bme_e == 0);
+}
+
+/* The SHT40 is still converting the background shot when the request comes */
+static void test_fresh_sht40_while_pending(void)
+{
+    advance(ACQ_TICK_US * 50U);
+    reset_stores();
+
+    acq_start();
+    run_callbacks();
+
+    CHECK(acq_sht40_fresh() == 0);
+    CHECK(sht_e == 0 && sht_temp == 2200);
+    CHECK(bme_stores == 1 && bme_e == 0);   /* the background BME280 result is kept */
+
+    /* the background fetch is superseded, and the main loop has nothing left */
+    run_callbacks();
+    CHECK(sht_temp == 2200);
+    advance(ACQ_TICK_US * (ACQ_WAIT_TICKS + 1U));
+    CHECK(acq_due() == 0);
+}
+
+static void test_fresh_bme280_while_pending(void)
+{
+    advance(ACQ_TICK_US * 50U);
+    reset_stores();
+
+    acq_start();
+    run_callbacks();
+
+    CHECK(acq_bme280_fresh() == 0);
+    CHECK(bme_e == 0);
+
+    /* the background SHT40 read still completes */
+    run_callbacks();
+    CHECK(sht_stores == 1 && sht_e == 0 && sht_temp == 2150);
+    advance(ACQ_TICK_US * (ACQ_WAIT_TICKS + 1U));
+    CHECK(acq_due() == 0);
+}
+
+int main(void)
+{
+    test_background();
+    test_fresh_idle();
+    test_fresh_sht40_while_pending();
+    test_fresh_bme280_while_pending();
+
+    if (failed) {
+        printf("%d check(s) failed\n", failed);
+        return 1;
+    }
+    printf("acq: all checks passed\n");
+    return 0;
+}
@@ -4,10 +4,13 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "stm32f4xx.h"
+#include "uart_link.h"
 
 void uart2_rxtx_init(void);
 void uart2_send(const uint8_t *buf, uint32_t len);
 bool uart2_rx_pop(uint8_t *out);
+bool uart2_baud_supported(uint32_t baud);
+void uart2_set_baud(uint32_t baud);
 
 uint8_t crc8_atm(const uint8_t *data, uint32_t len);
 
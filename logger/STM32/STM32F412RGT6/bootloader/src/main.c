@@ -5,6 +5,7 @@
 #include "systick.h"
 #include "uart.h"
 #include "version.h"
+#include "uart_link.h"
 
 #define APP_ADDR        0x08008000U
 #define INFO_ADDR       0x080FF800U
@@ -18,6 +19,26 @@
 
 typedef void (*func_ptr)(void);
 
+static link_rx_t link_rx;
+static uint8_t   link_reply;    /* current request came in as v2, answer in v2 */
+static uint8_t   link_seq;
+static uint8_t   link_param;
+static link_baud_t link_baud;
+
+/* Milliseconds from the DWT cycle counter; call at least once per CYCCNT wrap (~50 s). */
+static uint32_t millis(void)
+{
+    static uint32_t last, rem, ms;
+    uint32_t now = DWT->CYCCNT;
+    uint32_t per_ms = SystemCoreClock / 1000U;
+
+    rem += now - last;
+    last = now;
+    ms  += rem / per_ms;
+    rem %= per_ms;
+    return ms;
+}
+
 static void bootloader_init(void){
     RCC->AHB1ENR |= RCC_AHB1ENR_GPIOBEN;
     (void)RCC->AHB1ENR;
@@ -28,7 +49,13 @@ static void bootloader_init(void){
     GPIOB->OSPEEDR |= (2U << (14U * 2U));
     GPIOB->PUPDR &= ~(3U << (14U * 2U));
 
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
     uart2_rxtx_init();
+    link_rx_init(&link_rx, DEV_ADDR, FRAME_LEN);
+    link_baud_init(&link_baud);
     systick_delay_ms(100);
 }
 
@@ -92,32 +119,60 @@ static void jump_to_app(void)
     app_entry();
 }
 
+static void send_link(uint8_t type, uint8_t seq, uint8_t cmd, uint8_t param, uint8_t status,
+                      const uint8_t *payload, uint8_t len)
+{
+    static uint8_t wire[LINK_WIRE_MAX];
+    uint16_t n = link_encode(type, DEV_ADDR, seq, cmd, param, status, payload, len, wire, sizeof(wire));
+    if (n) uart2_send(wire, n);
+}
+
+/* Legacy frames are returned as received, v2 requests in the same layout. */
 static bool uart_read_frame(uint8_t *frame)
 {
-    static uint8_t tmp[FRAME_LEN];
-    static uint8_t idx = 0;
+    static link_packet_t pkt;
+    const uint8_t *legacy;
     uint8_t b;
     while (uart2_rx_pop(&b))
     {
-        if (idx == 0)
-        {
-            if (b != 0xB2) continue;
-            tmp[idx++] = b;
-        }
-        else
+        switch (link_rx_push(&link_rx, b, &pkt, &legacy))
         {
-            tmp[idx++] = b;
-            if (idx == FRAME_LEN)
-            {
-                uint8_t calc = crc8_atm(tmp, FRAME_LEN - 1);
-                uint8_t rxcrc = tmp[FRAME_LEN - 1];
-                idx = 0;
-
-                if (calc != rxcrc) return false;
+            case LINK_RX_LEGACY:
+                if (crc8_atm(legacy, FRAME_LEN - 1) != legacy[FRAME_LEN - 1]) return false;
+                link_baud_rx_good(&link_baud);
+                memcpy(frame, legacy, FRAME_LEN);
+                link_reply = 0;
+                return true;
 
-                memcpy(frame, tmp, FRAME_LEN);
+            case LINK_RX_PACKET:
+                link_baud_rx_good(&link_baud);
+                /* Requests are served in the legacy frame layout; refuse what does not fit */
+                if (pkt.len > FRAME_LEN - 5)
+                {
+                    send_link(LINK_NAK, pkt.seq, pkt.cmd, pkt.param, LINK_NAK_LEN, NULL, 0);
+                    return false;
+                }
+                if (link_rx_is_duplicate(&link_rx, &pkt))
+                {
+                    send_link(LINK_ACK, pkt.seq, pkt.cmd, pkt.param, STATUS_OK, NULL, 0);
+                    return false;
+                }
+                memset(frame, 0, FRAME_LEN);
+                frame[0] = pkt.addr;
+                frame[2] = pkt.cmd;
+                frame[3] = pkt.param;
+                memcpy(&frame[4], pkt.payload, pkt.len);
+                link_reply = 1;
+                link_seq   = pkt.seq;
+                link_param = pkt.param;
                 return true;
-            }
+
+            case LINK_RX_NAK:
+                send_link(LINK_NAK, link_rx.nak_seq, 0, 0, link_rx.nak_reason, NULL, 0);
+                return false;
+
+            default:
+                break;
         }
     }
     return false;
@@ -125,6 +180,11 @@ static bool uart_read_frame(uint8_t *frame)
 
 static void send_response(uint8_t status, uint8_t cmd, const uint8_t *payload, uint8_t len)
 {
+    if (link_reply) {
+        send_link(LINK_RESP, link_seq, cmd, link_param, status, payload, len);
+        return;
+    }
+
     uint8_t resp[FRAME_LEN] = {DEV_ADDR, status, cmd, 0};
 
     if (payload && len) {
@@ -140,6 +200,12 @@ static void bootloader_loop(void)
 {
     while (1)
     {
+        /* uart2_send blocks until TC, so the set-baud answer is always out here */
+        uint32_t baud = link_baud_poll(&link_baud, millis(), 1);
+        if (baud) {
+            uart2_set_baud(baud);
+            link_rx_reset(&link_rx);
+        }
 
         uint8_t req[64];
         if (!uart_read_frame(req)) continue;
@@ -178,6 +244,28 @@ static void bootloader_loop(void)
                 break;
             }
 
+            case 0x30: { /* set baud: req[4..7] rate BE; switch after this answer */
+                uint32_t rate = ((uint32_t)req[4] << 24) | ((uint32_t)req[5] << 16) |
+                                ((uint32_t)req[6] << 8) | req[7];
+                if (!uart2_baud_supported(rate)) {
+                    send_response(STATUS_ERR, cmd, NULL, 0);
+                    break;
+                }
+                link_baud_request(&link_baud, rate);
+                uint8_t out[6] = {req[4], req[5], req[6], req[7],
+                                  (uint8_t)(LINK_BAUD_CONFIRM_MS >> 8), (uint8_t)LINK_BAUD_CONFIRM_MS};
+                send_response(STATUS_OK, cmd, out, sizeof(out));
+                break;
+            }
+
+            case 0x31: { /* read baud: rate BE, state */
+                uint8_t out[5] = {(uint8_t)(link_baud.baud >> 24), (uint8_t)(link_baud.baud >> 16),
+                                  (uint8_t)(link_baud.baud >> 8), (uint8_t)link_baud.baud,
+                                  link_baud.state};
+                send_response(STATUS_OK, cmd, out, sizeof(out));
+                break;
+            }
+
             default:
                 send_response(STATUS_ERR, cmd, NULL, 0);
                 GPIOB->ODR ^= (1U << 14U);
@@ -56,6 +56,28 @@ static void uart_set_baudrate(USART_TypeDef *USARTx, uint32_t pclk, uint32_t bau
     USARTx->BRR = compute_uart_div(pclk, baud);
 }
 
+bool uart2_baud_supported(uint32_t baud)
+{
+    uint32_t pclk1 = get_pclk1_hz();
+    return link_baud_valid(pclk1, baud, 16U) || link_baud_valid(pclk1, baud, 8U);
+}
+
+/* Above pclk/16 the USART needs 8x oversampling: BRR[2:0] then holds 3 fraction bits. */
+void uart2_set_baud(uint32_t baud)
+{
+    uint32_t div = compute_uart_div(get_pclk1_hz(), baud);
+
+    USART2->CR1 &= ~USART_CR1_UE;
+    if (div >= 16U) {
+        USART2->CR1 &= ~USART_CR1_OVER8;
+        USART2->BRR = div;
+    } else {
+        USART2->CR1 |= USART_CR1_OVER8;
+        USART2->BRR = ((div >> 3) << 4) | (div & 7U);
+    }
+    USART2->CR1 |= USART_CR1_UE;
+}
+
 void uart2_rxtx_init(void)
 {
     RCC->AHB1ENR |= RCC_AHB1ENR_GPIOAEN;
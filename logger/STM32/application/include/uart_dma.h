@@ -3,8 +3,14 @@
 
 #include <stdint.h>
 #include "stm32l4xx.h"
+#include "uart_link.h"
 
 void uart1_rxtx_init(void);
 void uart2_rxtx_init(void);
 
+uint8_t uart1_baud_supported(uint32_t baud);
+uint8_t uart2_baud_supported(uint32_t baud);
+void uart1_set_baud(uint32_t baud);
+void uart2_set_baud(uint32_t baud);
+
 #endif // UART_DMA_H
\ No newline at end of file
@@ -16,6 +16,7 @@
 #include "pcf8563t_dma.h"
 #include "support.h"
 #include "version.h"
+#include "uart_link.h"
 
 #define STATUS_OK       0x40
 #define ERROR_RESPONSE  0x7F
@@ -42,23 +43,26 @@ volatile uint8_t i2c1_dma_err     = 0;
 static uint16_t adc_data_buffer[ADC_BUFFER_SIZE];
 static volatile uint16_t last_adc_value = 0;
 
-#define UART2_RX_BUFFER_SIZE 128
+#define FRAME_LEN_APP 16
+
+#define UART2_RX_BUFFER_SIZE 1024
 static uint8_t uart2_rx_buf[UART2_RX_BUFFER_SIZE];
-static uint8_t uart2_tx_frame[16];
+static uint8_t uart2_tx_frame[LINK_WIRE_MAX];
 static volatile uint16_t uart2_rx_old_pos = 0;
+static link_rx_t uart2_link;
 
-#define UART2_RX_FRAME_LEN 16
-static uint8_t uart2_frame_acc[UART2_RX_FRAME_LEN];
-static uint8_t uart2_frame_idx = 0;
-
-#define UART1_RX_BUFFER_SIZE 128
+#define UART1_RX_BUFFER_SIZE 1024
 static uint8_t uart1_rx_buf[UART1_RX_BUFFER_SIZE];
-static uint8_t uart1_tx_frame[16];
+static uint8_t uart1_tx_frame[LINK_WIRE_MAX];
 static volatile uint16_t uart1_rx_old_pos = 0;
+static link_rx_t uart1_link;
 
-#define UART1_RX_FRAME_LEN 16
-static uint8_t uart1_frame_acc[UART1_RX_FRAME_LEN];
-static uint8_t uart1_frame_idx = 0;
+/* Set while a v2 request is being handled: handle_response() answers in v2 */
+static uint8_t link_reply = 0;
+static uint8_t link_seq = 0;
+
+static link_baud_t uart2_baud;
+static link_baud_t uart1_baud;
 
 static volatile uint32_t adc_seq = 0;
 
@@ -75,6 +79,20 @@ static void handle_request(const uint8_t *req, uint8_t use_uart1);
 static void handle_response(uint8_t status, uint8_t cmd, uint8_t param_addr,
                             const uint8_t *payload, uint32_t payload_len, uint8_t use_uart1);
 
+/* Milliseconds from the DWT cycle counter; call at least once per CYCCNT wrap. */
+static uint32_t millis(void)
+{
+    static uint32_t last, rem, ms;
+    uint32_t now = DWT->CYCCNT;
+    uint32_t per_ms = SystemCoreClock / 1000U;
+
+    rem += now - last;
+    last = now;
+    ms  += rem / per_ms;
+    rem %= per_ms;
+    return ms;
+}
+
 static inline void led_off(uint8_t pin)
 {
     GPIOA->BSRR = (1U << (pin + 16U));
@@ -112,6 +130,15 @@ static void uart1_dma_send(const uint8_t *data, uint16_t len)
 static void handle_response(uint8_t status, uint8_t cmd, uint8_t param,
                             const uint8_t *payload, uint32_t payload_len, uint8_t use_uart1)
 {
+    if (link_reply) {
+        static uint8_t wire[LINK_WIRE_MAX];
+        uint16_t n = link_encode(LINK_RESP, DEV_ADDR, link_seq, cmd, param, status,
+                                 payload, (uint8_t)payload_len, wire, sizeof(wire));
+        if (use_uart1) uart1_dma_send(wire, n);
+        else           uart2_dma_send(wire, n);
+        return;
+    }
+
     static uint8_t resp[16];
     memset(resp, 0, sizeof(resp));
 
@@ -157,6 +184,34 @@ static void handle_request(const uint8_t *req, uint8_t use_uart1)
             GPIOA->ODR ^= (1U << 5U);
             break;
         }
+        case 0x0A00: /* Set link baud rate: req[4..7] uint32 BE, switch after this answer */
+        {
+            uint32_t baud = ((uint32_t)req[4] << 24) | ((uint32_t)req[5] << 16) |
+                            ((uint32_t)req[6] << 8) | req[7];
+            uint8_t ok = use_uart1 ? uart1_baud_supported(baud) : uart2_baud_supported(baud);
+            if (!ok) {
+                handle_response(ERROR_RESPONSE, cmd, param_addr, NULL, 0, use_uart1);
+                break;
+            }
+            link_baud_request(use_uart1 ? &uart1_baud : &uart2_baud, baud);
+            uint8_t data[6] = {req[4], req[5], req[6], req[7],
+                               (uint8_t)(LINK_BAUD_CONFIRM_MS >> 8), (uint8_t)LINK_BAUD_CONFIRM_MS};
+            handle_response(STATUS_OK, cmd, param_addr, data, sizeof(data), use_uart1);
+            break;
+        }
+        case 0x0A01: /* Read link baud rate: rate BE, state, fallbacks BE */
+        {
+            const link_baud_t *lb = use_uart1 ? &uart1_baud : &uart2_baud;
+            uint8_t data[9] = {
+                (uint8_t)(lb->baud >> 24), (uint8_t)(lb->baud >> 16),
+                (uint8_t)(lb->baud >> 8),  (uint8_t)lb->baud,
+                lb->state,
+                (uint8_t)(lb->fallbacks >> 24), (uint8_t)(lb->fallbacks >> 16),
+                (uint8_t)(lb->fallbacks >> 8),  (uint8_t)lb->fallbacks,
+            };
+            handle_response(STATUS_OK, cmd, param_addr, data, sizeof(data), use_uart1);
+            break;
+        }
         case 0x0100: /* Read serial number */
         {
             const device_info_t *info = device_info_get();
@@ -487,6 +542,87 @@ static void handle_request(const uint8_t *req, uint8_t use_uart1)
     }
 }
 
+static void link_rx_byte(link_rx_t *rx, uint8_t b, uint8_t use_uart1)
+{
+    static link_packet_t pkt;
+    static uint8_t req[FRAME_LEN_APP];
+    const uint8_t *legacy = NULL;
+
+    switch (link_rx_push(rx, b, &pkt, &legacy)) {
+        case LINK_RX_LEGACY:
+            if (crc8_atm(legacy, FRAME_LEN_APP - 1) == legacy[FRAME_LEN_APP - 1]) {
+                link_baud_rx_good(use_uart1 ? &uart1_baud : &uart2_baud);
+                handle_request(legacy, use_uart1);
+            }
+            break;
+
+        case LINK_RX_PACKET:
+            link_baud_rx_good(use_uart1 ? &uart1_baud : &uart2_baud);
+            /* handle_request() takes the legacy frame layout; refuse what does not fit */
+            if (pkt.len > FRAME_LEN_APP - 5) {
+                static uint8_t nak[16];
+                uint16_t n = link_encode(LINK_NAK, DEV_ADDR, pkt.seq, pkt.cmd, pkt.param,
+                                         LINK_NAK_LEN, NULL, 0, nak, sizeof(nak));
+                if (use_uart1) uart1_dma_send(nak, n);
+                else           uart2_dma_send(nak, n);
+                break;
+            }
+            if (link_rx_is_duplicate(rx, &pkt)) {
+                static uint8_t ack[16];
+                uint16_t n = link_encode(LINK_ACK, DEV_ADDR, pkt.seq, pkt.cmd, pkt.param,
+                                         STATUS_OK, NULL, 0, ack, sizeof(ack));
+                if (use_uart1) uart1_dma_send(ack, n);
+                else           uart2_dma_send(ack, n);
+                break;
+            }
+            /* Same layout as a legacy frame, so handle_request() serves both */
+            memset(req, 0, sizeof(req));
+            req[0] = pkt.addr;
+            req[2] = pkt.cmd;
+            req[3] = pkt.param;
+            memcpy(&req[4], pkt.payload, pkt.len);
+
+            link_reply = 1;
+            link_seq = pkt.seq;
+            handle_request(req, use_uart1);
+            link_reply = 0;
+            break;
+
+        case LINK_RX_NAK:
+        {
+            static uint8_t nak[16];
+            uint16_t n = link_encode_nak(rx, DEV_ADDR, nak, sizeof(nak));
+            if (use_uart1) uart1_dma_send(nak, n);
+            else           uart2_dma_send(nak, n);
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+/* The set-baud answer is out once the TX DMA is done and TC is set; then switch. */
+static void uart2_baud_poll(uint32_t now_ms)
+{
+    uint8_t idle = !uart2_tx_busy && (USART2->ISR & USART_ISR_TC);
+    uint32_t baud = link_baud_poll(&uart2_baud, now_ms, idle);
+    if (!baud) return;
+
+    uart2_set_baud(baud);
+    link_rx_reset(&uart2_link);
+}
+
+static void uart1_baud_poll(uint32_t now_ms)
+{
+    uint8_t idle = !uart1_tx_busy && (USART1->ISR & USART_ISR_TC);
+    uint32_t baud = link_baud_poll(&uart1_baud, now_ms, idle);
+    if (!baud) return;
+
+    uart1_set_baud(baud);
+    link_rx_reset(&uart1_link);
+}
+
 static void uart2_process_rx(void)
 {
     uint16_t pos = (uint16_t)(UART2_RX_BUFFER_SIZE - DMA1_Channel6->CNDTR);
@@ -496,17 +632,7 @@ static void uart2_process_rx(void)
         uart2_rx_old_pos++;
         if (uart2_rx_old_pos >= UART2_RX_BUFFER_SIZE) uart2_rx_old_pos = 0;
 
-        if (uart2_frame_idx == 0 && b != DEV_ADDR) {
-            continue;
-        }
-
-        uart2_frame_acc[uart2_frame_idx++] = b;
-        if (uart2_frame_idx == UART2_RX_FRAME_LEN) {
-            if (crc8_atm(uart2_frame_acc, 15) == uart2_frame_acc[15]) {
-                handle_request(uart2_frame_acc, 0);
-            }
-            uart2_frame_idx = 0;
-        }
+        link_rx_byte(&uart2_link, b, 0);
     }
 }
 
@@ -519,17 +645,7 @@ static void uart1_process_rx(void)
         uart1_rx_old_pos++;
         if (uart1_rx_old_pos >= UART1_RX_BUFFER_SIZE) uart1_rx_old_pos = 0;
 
-        if (uart1_frame_idx == 0 && b != DEV_ADDR) {
-            continue;
-        }
-
-        uart1_frame_acc[uart1_frame_idx++] = b;
-        if (uart1_frame_idx == UART1_RX_FRAME_LEN) {
-            if (crc8_atm(uart1_frame_acc, 15) == uart1_frame_acc[15]) {
-                handle_request(uart1_frame_acc, 1);
-            }
-            uart1_frame_idx = 0;
-        }
+        link_rx_byte(&uart1_link, b, 1);
     }
 }
 
@@ -544,6 +660,10 @@ int main(void)
     GPIOA->OTYPER &= ~(1U << 5U);
     GPIOA->PUPDR &= ~(3U << (5U * 2U));
 
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
     uart2_rxtx_init();
     dma1_uart2_rx_config((uint32_t)uart2_rx_buf, UART2_RX_BUFFER_SIZE);
     dma1_uart2_tx_init();
@@ -552,6 +672,11 @@ int main(void)
     dma1_uart1_rx_config((uint32_t)uart1_rx_buf, UART1_RX_BUFFER_SIZE);
     dma1_uart1_tx_init();
 
+    link_rx_init(&uart2_link, DEV_ADDR, FRAME_LEN_APP);
+    link_rx_init(&uart1_link, DEV_ADDR, FRAME_LEN_APP);
+    link_baud_init(&uart2_baud);
+    link_baud_init(&uart1_baud);
+
     adc_dma_init(2, adc_data_buffer, ADC_BUFFER_SIZE);
     tim1_init(4000, 1000);
 
@@ -589,6 +714,10 @@ int main(void)
             uart1_process_rx();
         }
 
+        uint32_t now_ms = millis();
+        uart2_baud_poll(now_ms);
+        uart1_baud_poll(now_ms);
+
         if (spi1_dma_rx_done && spi1_dma_tx_done) {
             spi1_dma_rx_done = 0;
             spi1_dma_tx_done = 0;
@@ -39,6 +39,51 @@ static void uart_set_baudrate(USART_TypeDef *USARTx, uint32_t pclk, uint32_t bau
     USARTx->BRR = compute_uart_div(pclk, baud);
 }
 
+/*
+ * Runtime rate change. With 8x oversampling USARTDIV = 2*pclk/baud and
+ * BRR[2:0] holds USARTDIV[3:0] >> 1 (BRR[3] must stay 0).
+ */
+static void uart_apply_baudrate(USART_TypeDef *USARTx, uint32_t pclk, uint32_t baud)
+{
+    uint32_t div = compute_uart_div(pclk, baud);
+
+    USARTx->CR1 &= ~USART_CR1_UE;
+    if (div >= 16U) {
+        USARTx->CR1 &= ~USART_CR1_OVER8;
+        USARTx->BRR = div;
+    } else {
+        uint32_t div8 = compute_uart_div(2U * pclk, baud);
+        USARTx->CR1 |= USART_CR1_OVER8;
+        USARTx->BRR = (div8 & ~0xFU) | ((div8 & 0xFU) >> 1);
+    }
+    USARTx->CR1 |= USART_CR1_UE;
+}
+
+static uint8_t baud_supported(uint32_t pclk, uint32_t baud)
+{
+    return link_baud_valid(pclk, baud, 16U) || link_baud_valid(pclk, baud, 8U);
+}
+
+uint8_t uart2_baud_supported(uint32_t baud)
+{
+    return baud_supported(get_pclk1_hz(), baud);
+}
+
+uint8_t uart1_baud_supported(uint32_t baud)
+{
+    return baud_supported(get_pclk2_hz(), baud);
+}
+
+void uart2_set_baud(uint32_t baud)
+{
+    uart_apply_baudrate(USART2, get_pclk1_hz(), baud);
+}
+
+void uart1_set_baud(uint32_t baud)
+{
+    uart_apply_baudrate(USART1, get_pclk2_hz(), baud);
+}
+
 void uart2_rxtx_init(void)
 {
     RCC->AHB2ENR |= RCC_AHB2ENR_GPIOAEN;
@@ -5,6 +5,7 @@
 #include "uart.h"
 #include "systick.h"
 #include "version.h"
+#include "uart_link.h"
 
 #define APP_ADDR        0x08008000U
 #define INFO_ADDR       0x080FF800U
@@ -18,6 +19,11 @@
 
 typedef void (*func_ptr)(void);
 
+static link_rx_t link_rx;
+static uint8_t   link_reply;    /* current request came in as v2, answer in v2 */
+static uint8_t   link_seq;
+static uint8_t   link_param;
+
 static void bootloader_init(void)
 {
     RCC->AHB2ENR |= RCC_AHB2ENR_GPIOAEN;
@@ -30,6 +36,7 @@ static void bootloader_init(void)
     GPIOA->PUPDR &= ~(3U << (5U * 2U));
 
     uart2_rxtx_init();
+    link_rx_init(&link_rx, DEV_ADDR, FRAME_LEN);
     systick_delay_ms(100);
 }
 
@@ -94,32 +101,58 @@ static void jump_to_app(void)
     app_entry();
 }
 
+static void send_link(uint8_t type, uint8_t seq, uint8_t cmd, uint8_t param, uint8_t status,
+                      const uint8_t *payload, uint8_t len)
+{
+    static uint8_t wire[LINK_WIRE_MAX];
+    uint16_t n = link_encode(type, DEV_ADDR, seq, cmd, param, status, payload, len, wire, sizeof(wire));
+    if (n) uart2_send(wire, n);
+}
+
+/* Legacy frames are returned as received, v2 requests in the same layout. */
 static bool uart_read_frame(uint8_t *frame)
 {
-    static uint8_t tmp[FRAME_LEN];
-    static uint8_t idx = 0;
+    static link_packet_t pkt;
+    const uint8_t *legacy;
     uint8_t b;
     while (uart2_rx_pop(&b))
     {
-        if (idx == 0)
+        switch (link_rx_push(&link_rx, b, &pkt, &legacy))
         {
-            if (b != 0xB2) continue;
-            tmp[idx++] = b;
-        }
-        else
-        {
-            tmp[idx++] = b;
-            if (idx == FRAME_LEN)
-            {
-                uint8_t calc = crc8_atm(tmp, FRAME_LEN - 1);
-                uint8_t rxcrc = tmp[FRAME_LEN - 1];
-                idx = 0;
-
-                if (calc != rxcrc) return false;
+            case LINK_RX_LEGACY:
+                if (crc8_atm(legacy, FRAME_LEN - 1) != legacy[FRAME_LEN - 1]) return false;
+                memcpy(frame, legacy, FRAME_LEN);
+                link_reply = 0;
+                return true;
 
-                memcpy(frame, tmp, FRAME_LEN);
+            case LINK_RX_PACKET:
+                /* Requests are served in the legacy frame layout; refuse what does not fit */
+                if (pkt.len > FRAME_LEN - 5)
+                {
+                    send_link(LINK_NAK, pkt.seq, pkt.cmd, pkt.param, LINK_NAK_LEN, NULL, 0);
+                    return false;
+                }
+                if (link_rx_is_duplicate(&link_rx, &pkt))
+                {
+                    send_link(LINK_ACK, pkt.seq, pkt.cmd, pkt.param, STATUS_OK, NULL, 0);
+                    return false;
+                }
+                memset(frame, 0, FRAME_LEN);
+                frame[0] = pkt.addr;
+                frame[2] = pkt.cmd;
+                frame[3] = pkt.param;
+                memcpy(&frame[4], pkt.payload, pkt.len);
+                link_reply = 1;
+                link_seq   = pkt.seq;
+                link_param = pkt.param;
                 return true;
-            }
+
+            case LINK_RX_NAK:
+                send_link(LINK_NAK, link_rx.nak_seq, 0, 0, link_rx.nak_reason, NULL, 0);
+                return false;
+
+            default:
+                break;
         }
     }
     return false;
@@ -127,6 +160,11 @@ static bool uart_read_frame(uint8_t *frame)
 
 static void send_response(uint8_t status, uint8_t cmd, const uint8_t *payload, uint8_t len)
 {
+    if (link_reply) {
+        send_link(LINK_RESP, link_seq, cmd, link_param, status, payload, len);
+        return;
+    }
+
     uint8_t resp[FRAME_LEN] = {DEV_ADDR, status, cmd, 0};
 
     if (payload && len) {
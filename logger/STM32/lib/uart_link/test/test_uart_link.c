@@ -0,0 +1,251 @@
+/*
+ * Host test for the link layer: make -C test
+ *
+ * COBS round trip for every length 0..255, receiver resync after corrupted,
+ * oversized and undelimited frames, the duplicate window and link_baud_poll()
+ * timing.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "uart_link.h"
+
+#define ADDR        0xB2
+#define LEGACY_LEN  24
+
+static int failed = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failed++; } } while (0)
+
+static uint32_t rng = 1;
+static uint8_t rand8(void)
+{
+    rng = rng * 1103515245U + 12345U;
+    return (uint8_t)(rng >> 16);
+}
+
+static void test_cobs(void)
+{
+    uint8_t in[LINK_PAYLOAD_MAX], enc[LINK_PAYLOAD_MAX + 4], dec[LINK_PAYLOAD_MAX];
+
+    for (int pattern = 0; pattern < 4; pattern++) {
+        for (uint16_t len = 0; len <= LINK_PAYLOAD_MAX; len++) {
+            for (uint16_t i = 0; i < len; i++) {
+                switch (pattern) {
+                    case 0:  in[i] = 0x00; break;
+                    case 1:  in[i] = (uint8_t)(i % 255U + 1U); break;
+                    case 2:  in[i] = (i % 7U) ? rand8() : 0x00; break;
+                    default: in[i] = rand8(); break;
+                }
+            }
+
+            uint16_t n = link_cobs_encode(in, len, enc);
+            CHECK(n >= len + 1U && n <= len + 1U + len / 254U + 1U);
+            CHECK(memchr(enc, 0, n) == NULL);
+
+            int32_t d = link_cobs_decode(enc, n, dec, sizeof(dec));
+            CHECK(d == len);
+            CHECK(d != len || memcmp(in, dec, len) == 0);
+
+            /* In place, as rx_packet() does it */
+            d = link_cobs_decode(enc, n, enc, sizeof(enc));
+            CHECK(d == len);
+            CHECK(d != len || memcmp(in, enc, len) == 0);
+        }
+    }
+
+    /* A zero inside the encoded data is never valid */
+    const uint8_t bad[] = { 0x03, 0x11, 0x00 };
+    CHECK(link_cobs_decode(bad, sizeof(bad), dec, sizeof(dec)) < 0);
+}
+
+static uint16_t make_req(uint8_t seq, uint8_t cmd, uint8_t len, uint8_t *wire)
+{
+    uint8_t payload[LINK_PAYLOAD_MAX];
+    for (uint16_t i = 0; i < len; i++) payload[i] = (uint8_t)(i + seq);
+    return link_encode(LINK_REQ, ADDR, seq, cmd, 0x01, 0, payload, len, wire, LINK_WIRE_MAX);
+}
+
+/* Push bytes, return the last event that is not LINK_RX_NONE */
+static link_rx_event_t push(link_rx_t *rx, const uint8_t *b, uint16_t n, link_packet_t *pkt)
+{
+    const uint8_t *legacy = NULL;
+    link_rx_event_t last = LINK_RX_NONE;
+    for (uint16_t i = 0; i < n; i++) {
+        link_rx_event_t ev = link_rx_push(rx, b[i], pkt, &legacy);
+        if (ev != LINK_RX_NONE) last = ev;
+    }
+    return last;
+}
+
+static void test_rx(void)
+{
+    static link_rx_t rx;
+    static link_packet_t pkt;
+    uint8_t wire[LINK_WIRE_MAX];
+    uint16_t n;
+
+    link_rx_init(&rx, ADDR, LEGACY_LEN);
+
+    /* Every payload length goes through encode/receive unchanged */
+    for (uint16_t len = 0; len <= LINK_PAYLOAD_MAX; len++) {
+        n = make_req((uint8_t)len, 0x03, (uint8_t)len, wire);
+        CHECK(n > 0 && n <= LINK_WIRE_MAX);
+        CHECK(push(&rx, wire, n, &pkt) == LINK_RX_PACKET);
+        CHECK(pkt.seq == (uint8_t)len && pkt.cmd == 0x03 && pkt.len == len);
+        CHECK(len == 0 || pkt.payload[len - 1] == (uint8_t)(len - 1 + len));
+    }
+
+    /* Corrupted byte: CRC NAK with seq 0, the next frame decodes again */
+    n = make_req(7, 0x01, 20, wire);
+    wire[n / 2] ^= 0x5A;
+    if (wire[n / 2] == 0x00) wire[n / 2] = 0x01;
+    CHECK(push(&rx, wire, n, &pkt) == LINK_RX_NAK);
+    CHECK(rx.nak_reason == LINK_NAK_CRC && rx.nak_seq == 0);
+
+    n = make_req(8, 0x01, 20, wire);
+    CHECK(push(&rx, wire, n, &pkt) == LINK_RX_PACKET && pkt.seq == 8);
+
+    /* Lost tail: the next delimiter ends the broken frame, the one after decodes */
+    n = make_req(9, 0x01, 20, wire);
+    CHECK(push(&rx, wire, (uint16_t)(n - 5), &pkt) == LINK_RX_NONE);
+    const uint8_t delim = 0x00;
+    CHECK(push(&rx, &delim, 1, &pkt) == LINK_RX_NAK && rx.nak_reason == LINK_NAK_CRC);
+    n = make_req(10, 0x01, 20, wire);
+    CHECK(push(&rx, wire, n, &pkt) == LINK_RX_PACKET && pkt.seq == 10);
+
+    /* Lost leading delimiter: the previous packet's closing 0x00 opens this one */
+    n = make_req(13, 0x01, 20, wire);
+    CHECK(push(&rx, &wire[1], (uint16_t)(n - 1), &pkt) == LINK_RX_PACKET && pkt.seq == 13);
+
+    /* Line noise between frames is ignored */
+    const uint8_t noise[] = { 0x13, 0xFF, 0x7E, 0x01 };
+    CHECK(push(&rx, noise, sizeof(noise), &pkt) == LINK_RX_NONE);
+    n = make_req(12, 0x01, 2, wire);
+    CHECK(push(&rx, wire, n, &pkt) == LINK_RX_PACKET && pkt.seq == 12);
+
+    /* Oversize: more than a wire buffer without a delimiter, RX_SKIP then a LEN NAK */
+    uint8_t junk[LINK_WIRE_MAX + 40];
+    junk[0] = 0x00;
+    memset(&junk[1], 0x55, sizeof(junk) - 2);
+    junk[sizeof(junk) - 1] = 0x00;
+    CHECK(push(&rx, junk, sizeof(junk), &pkt) == LINK_RX_NAK);
+    CHECK(rx.nak_reason == LINK_NAK_LEN && rx.nak_seq == 0);
+
+    uint8_t nak[LINK_WIRE_MAX];
+    n = link_encode_nak(&rx, ADDR, nak, sizeof(nak));
+    CHECK(n > 0);
+    int32_t d = link_cobs_decode(&nak[1], (uint16_t)(n - 2), nak, sizeof(nak));
+    CHECK(d == LINK_HDR_LEN + 2);
+    CHECK((nak[0] & 0x0F) == LINK_NAK && nak[5] == LINK_NAK_LEN);
+
+    n = make_req(11, 0x01, 4, wire);
+    CHECK(push(&rx, wire, n, &pkt) == LINK_RX_PACKET && pkt.seq == 11);
+
+    /* Legacy frame outside a delimiter */
+    uint8_t legacy[LEGACY_LEN] = { ADDR, 0, 0x01, 0x00 };
+    const uint8_t *lp = NULL;
+    link_rx_event_t ev = LINK_RX_NONE;
+    for (uint16_t i = 0; i < LEGACY_LEN; i++) ev = link_rx_push(&rx, legacy[i], &pkt, &lp);
+    CHECK(ev == LINK_RX_LEGACY && lp && lp[2] == 0x01);
+}
+
+static void test_duplicates(void)
+{
+    static link_rx_t rx;
+    static link_packet_t pkt[LINK_WINDOW + 1];
+    uint8_t wire[LINK_WIRE_MAX];
+
+    link_rx_init(&rx, ADDR, LEGACY_LEN);
+    for (uint8_t i = 0; i <= LINK_WINDOW; i++) {
+        uint16_t n = make_req((uint8_t)(i + 1), 0x02, 3, wire);
+        CHECK(push(&rx, wire, n, &pkt[i]) == LINK_RX_PACKET);
+    }
+
+    for (uint8_t i = 0; i < LINK_WINDOW; i++) {
+        CHECK(link_rx_is_duplicate(&rx, &pkt[i]) == 0);
+        CHECK(link_rx_is_duplicate(&rx, &pkt[i]) == 1);
+    }
+
+    /* The fifth request evicts the oldest (seq 1) */
+    CHECK(link_rx_is_duplicate(&rx, &pkt[LINK_WINDOW]) == 0);
+    CHECK(link_rx_is_duplicate(&rx, &pkt[LINK_WINDOW]) == 1);
+    CHECK(link_rx_is_duplicate(&rx, &pkt[LINK_WINDOW - 1]) == 1);
+    CHECK(link_rx_is_duplicate(&rx, &pkt[0]) == 0);
+
+    /* Same seq with a different CRC is a new request */
+    link_packet_t other = pkt[LINK_WINDOW];
+    other.crc ^= 1;
+    CHECK(link_rx_is_duplicate(&rx, &other) == 0);
+}
+
+static void test_baud(void)
+{
+    link_baud_t lb;
+    uint32_t t = 5000;
+
+    link_baud_init(&lb);
+    CHECK(lb.baud == LINK_BAUD_DEFAULT);
+    CHECK(link_baud_poll(&lb, t + LINK_BAUD_IDLE_MS * 2U, 1) == 0);
+
+    /* Drain: nothing changes until TX is idle */
+    link_baud_request(&lb, 921600UL);
+    CHECK(link_baud_poll(&lb, t, 0) == 0);
+    CHECK(link_baud_poll(&lb, t + 20, 0) == 0);
+    CHECK(lb.baud == LINK_BAUD_DEFAULT);
+    t += 30;
+    CHECK(link_baud_poll(&lb, t, 1) == 921600UL);
+    CHECK(lb.state == LINK_BAUD_CONFIRM);
+
+    /* No confirm: fall back exactly at LINK_BAUD_CONFIRM_MS */
+    CHECK(link_baud_poll(&lb, t + LINK_BAUD_CONFIRM_MS - 1U, 1) == 0);
+    CHECK(link_baud_poll(&lb, t + LINK_BAUD_CONFIRM_MS, 1) == LINK_BAUD_DEFAULT);
+    CHECK(lb.fallbacks == 1 && lb.state == LINK_BAUD_STEADY);
+
+    /* Confirmed: stays up while frames arrive, falls back after LINK_BAUD_IDLE_MS */
+    t += 2000;
+    link_baud_request(&lb, 2000000UL);
+    CHECK(link_baud_poll(&lb, t, 1) == 2000000UL);
+    link_baud_rx_good(&lb);
+    t += 100;
+    CHECK(link_baud_poll(&lb, t, 1) == 0);
+    CHECK(lb.state == LINK_BAUD_STEADY && lb.baud == 2000000UL);
+
+    CHECK(link_baud_poll(&lb, t + LINK_BAUD_CONFIRM_MS * 2U, 1) == 0);
+    CHECK(link_baud_poll(&lb, t + LINK_BAUD_IDLE_MS - 1U, 1) == 0);
+    link_baud_rx_good(&lb);
+    t += LINK_BAUD_IDLE_MS - 1U;
+    CHECK(link_baud_poll(&lb, t, 1) == 0);
+    CHECK(link_baud_poll(&lb, t + LINK_BAUD_IDLE_MS - 1U, 1) == 0);
+    CHECK(link_baud_poll(&lb, t + LINK_BAUD_IDLE_MS, 1) == LINK_BAUD_DEFAULT);
+    CHECK(lb.fallbacks == 2 && lb.baud == LINK_BAUD_DEFAULT);
+
+    /* Timing survives the millisecond counter wrapping */
+    link_baud_init(&lb);
+    t = 0xFFFFFF00UL;
+    link_baud_request(&lb, 921600UL);
+    CHECK(link_baud_poll(&lb, t, 1) == 921600UL);
+    CHECK(link_baud_poll(&lb, t + LINK_BAUD_CONFIRM_MS - 1U, 1) == 0);
+    CHECK(link_baud_poll(&lb, t + LINK_BAUD_CONFIRM_MS, 1) == LINK_BAUD_DEFAULT);
+
+    /* 42 MHz APB1: 3 Mbaud needs 8x oversampling, below 115200 is never offered */
+    CHECK(link_baud_valid(42000000UL, 3000000UL, 16) == 0);
+    CHECK(link_baud_valid(42000000UL, 3000000UL, 8) == 1);
+    CHECK(link_baud_valid(42000000UL, 921600UL, 16) == 1);
+    CHECK(link_baud_valid(42000000UL, 9600UL, 16) == 0);
+}
+
+int main(void)
+{
+    test_cobs();
+    test_rx();
+    test_duplicates();
+    test_baud();
+
+    if (failed) {
+        printf("%d check(s) failed\n", failed);
+        return 1;
+    }
+    printf("uart_link: all checks passed\n");
+    return 0;
+}
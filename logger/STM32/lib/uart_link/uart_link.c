@@ -0,0 +1,312 @@
+#include <string.h>
+#include "uart_link.h"
+
+enum {
+    RX_IDLE = 0,
+    RX_COBS,
+    RX_LEGACY,
+    RX_SKIP,
+};
+
+uint16_t link_crc16(const uint8_t *data, uint32_t len)
+{
+    uint16_t crc = 0xFFFF;
+
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t b = 0; b < 8; b++) {
+            if (crc & 0x8000)
+                crc = (uint16_t)((crc << 1) ^ 0x1021);
+            else
+                crc <<= 1;
+        }
+    }
+    return crc;
+}
+
+uint16_t link_cobs_encode(const uint8_t *in, uint16_t len, uint8_t *out)
+{
+    uint16_t code_idx = 0;
+    uint16_t o = 1;
+    uint8_t code = 1;
+
+    for (uint16_t i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[code_idx] = code;
+            code_idx = o++;
+            code = 1;
+            continue;
+        }
+        out[o++] = in[i];
+        if (++code == 0xFF) {
+            out[code_idx] = code;
+            code_idx = o++;
+            code = 1;
+        }
+    }
+    out[code_idx] = code;
+    return o;
+}
+
+/* Safe in place (out == in): the write index never passes the read index. */
+int32_t link_cobs_decode(const uint8_t *in, uint16_t len, uint8_t *out, uint16_t out_size)
+{
+    uint16_t i = 0;
+    uint16_t o = 0;
+
+    while (i < len) {
+        uint8_t code = in[i++];
+        if (code == 0) return -1;
+
+        for (uint8_t k = 1; k < code; k++) {
+            if (i >= len || in[i] == 0 || o >= out_size) return -1;
+            out[o++] = in[i++];
+        }
+        if (code != 0xFF && i < len) {
+            if (o >= out_size) return -1;
+            out[o++] = 0;
+        }
+    }
+    return o;
+}
+
+void link_rx_init(link_rx_t *rx, uint8_t legacy_addr, uint16_t legacy_len)
+{
+    memset(rx, 0, sizeof(*rx));
+    rx->legacy_addr = legacy_addr;
+    rx->legacy_len = legacy_len;
+}
+
+/* Drop a partial frame (e.g. bytes received while the baud rate changed); keeps the seen window. */
+void link_rx_reset(link_rx_t *rx)
+{
+    rx->state = RX_IDLE;
+    rx->idx = 0;
+}
+
+static link_rx_event_t rx_nak(link_rx_t *rx, uint8_t seq, uint8_t reason)
+{
+    rx->nak_seq = seq;
+    rx->nak_reason = reason;
+    return LINK_RX_NAK;
+}
+
+static link_rx_event_t rx_packet(link_rx_t *rx, uint16_t wire_len, link_packet_t *pkt)
+{
+    int32_t n = link_cobs_decode(rx->buf, wire_len, rx->buf, sizeof(rx->buf));
+    const uint8_t *p = rx->buf;
+
+    if (n < LINK_HDR_LEN + 2) return rx_nak(rx, 0, LINK_NAK_CRC);
+
+    uint16_t crc = (uint16_t)(((uint16_t)p[n - 2] << 8) | p[n - 1]);
+    if (link_crc16(p, (uint32_t)(n - 2)) != crc) return rx_nak(rx, 0, LINK_NAK_CRC);
+
+    /* CRC is good from here on, so the seq can be echoed */
+    if ((p[0] >> 4) != LINK_VERSION) return rx_nak(rx, p[2], LINK_NAK_VERSION);
+    if (p[1] != rx->legacy_addr) return LINK_RX_NONE;
+    if (n != LINK_HDR_LEN + p[6] + 2) return rx_nak(rx, p[2], LINK_NAK_LEN);
+    if ((p[0] & 0x0F) != LINK_REQ) return rx_nak(rx, p[2], LINK_NAK_TYPE);
+
+    pkt->type   = p[0] & 0x0F;
+    pkt->addr   = p[1];
+    pkt->seq    = p[2];
+    pkt->cmd    = p[3];
+    pkt->param  = p[4];
+    pkt->status = p[5];
+    pkt->len    = p[6];
+    pkt->crc    = crc;
+    memcpy(pkt->payload, &p[LINK_HDR_LEN], pkt->len);
+    return LINK_RX_PACKET;
+}
+
+/*
+ * Feed one received byte. Returns an event when a packet or legacy frame is
+ * complete; the buffers behind *pkt / *legacy stay valid until the next call.
+ */
+link_rx_event_t link_rx_push(link_rx_t *rx, uint8_t b, link_packet_t *pkt,
+                             const uint8_t **legacy)
+{
+    uint16_t wire_len;
+
+    switch (rx->state) {
+        case RX_IDLE:
+            if (b == 0x00) {
+                rx->state = RX_COBS;
+                rx->idx = 0;
+            } else if (b == rx->legacy_addr && rx->legacy_len) {
+                rx->state = RX_LEGACY;
+                rx->buf[0] = b;
+                rx->idx = 1;
+            }
+            return LINK_RX_NONE;
+
+        case RX_COBS:
+            if (b == 0x00) {
+                if (rx->idx == 0) return LINK_RX_NONE;  /* repeated delimiter */
+                /* The closing delimiter also opens the next packet, so a lost
+                 * leading 0x00 does not cost the packet after this one */
+                wire_len = rx->idx;
+                rx->idx = 0;
+                return rx_packet(rx, wire_len, pkt);
+            }
+            /* A request starts with a COBS code <= LINK_HDR_LEN (status is 0),
+             * so the device address here can only be a legacy frame */
+            if (rx->idx == 0 && b == rx->legacy_addr && rx->legacy_len) {
+                rx->state = RX_LEGACY;
+                rx->buf[0] = b;
+                rx->idx = 1;
+                return LINK_RX_NONE;
+            }
+            if (rx->idx >= sizeof(rx->buf)) {
+                rx->state = RX_SKIP;
+                return LINK_RX_NONE;
+            }
+            rx->buf[rx->idx++] = b;
+            return LINK_RX_NONE;
+
+        case RX_LEGACY:
+            rx->buf[rx->idx++] = b;
+            if (rx->idx < rx->legacy_len) return LINK_RX_NONE;
+            rx->state = RX_IDLE;
+            *legacy = rx->buf;
+            return LINK_RX_LEGACY;
+
+        case RX_SKIP:
+        default:
+            if (b == 0x00) {
+                rx->state = RX_COBS;
+                rx->idx = 0;
+                return rx_nak(rx, 0, LINK_NAK_LEN);
+            }
+            return LINK_RX_NONE;
+    }
+}
+
+/*
+ * Returns 1 if the same request (seq and CRC) ran recently, otherwise records it
+ * and returns 0. Call once per LINK_RX_PACKET, before executing it.
+ */
+uint8_t link_rx_is_duplicate(link_rx_t *rx, const link_packet_t *pkt)
+{
+    for (uint8_t i = 0; i < LINK_WINDOW; i++) {
+        if ((rx->seen_valid & (1U << i)) &&
+            rx->seen_seq[i] == pkt->seq && rx->seen_crc[i] == pkt->crc) {
+            return 1;
+        }
+    }
+
+    rx->seen_seq[rx->seen_next] = pkt->seq;
+    rx->seen_crc[rx->seen_next] = pkt->crc;
+    rx->seen_valid |= (uint8_t)(1U << rx->seen_next);
+    rx->seen_next = (uint8_t)((rx->seen_next + 1U) % LINK_WINDOW);
+    return 0;
+}
+
+/* Build 0x00, COBS(packet), 0x00 into out. Returns the wire length, 0 if out is too small. */
+uint16_t link_encode(uint8_t type, uint8_t addr, uint8_t seq, uint8_t cmd, uint8_t param,
+                     uint8_t status, const uint8_t *payload, uint8_t len,
+                     uint8_t *out, uint16_t out_size)
+{
+    uint8_t pkt[LINK_PKT_MAX];
+    uint16_t n = 0;
+
+    if (out_size < (uint16_t)(LINK_HDR_LEN + len + 2 + (LINK_HDR_LEN + len + 2) / 254 + 3)) return 0;
+
+    pkt[n++] = (uint8_t)((LINK_VERSION << 4) | (type & 0x0F));
+    pkt[n++] = addr;
+    pkt[n++] = seq;
+    pkt[n++] = cmd;
+    pkt[n++] = param;
+    pkt[n++] = status;
+    pkt[n++] = len;
+    if (payload && len) memcpy(&pkt[n], payload, len);
+    n += len;
+
+    uint16_t crc = link_crc16(pkt, n);
+    pkt[n++] = (uint8_t)(crc >> 8);
+    pkt[n++] = (uint8_t)crc;
+
+    out[0] = 0x00;
+    uint16_t w = link_cobs_encode(pkt, n, &out[1]);
+    out[1 + w] = 0x00;
+    return (uint16_t)(w + 2U);
+}
+
+uint16_t link_encode_nak(const link_rx_t *rx, uint8_t addr, uint8_t *out, uint16_t out_size)
+{
+    return link_encode(LINK_NAK, addr, rx->nak_seq, 0, 0, rx->nak_reason, NULL, 0, out, out_size);
+}
+
+void link_baud_init(link_baud_t *lb)
+{
+    memset(lb, 0, sizeof(*lb));
+    lb->baud = LINK_BAUD_DEFAULT;
+}
+
+/*
+ * 1 if a USART clocked at clk can run baud with a divider of at least min_div
+ * (16 or 8, the oversampling) and an error within LINK_BAUD_TOLERANCE.
+ */
+uint8_t link_baud_valid(uint32_t clk, uint32_t baud, uint32_t min_div)
+{
+    if (baud < LINK_BAUD_DEFAULT || baud > LINK_BAUD_MAX) return 0;
+
+    uint32_t div = (clk + baud / 2U) / baud;
+    if (div < min_div) return 0;
+
+    uint32_t actual = clk / div;
+    uint32_t err = (actual > baud) ? actual - baud : baud - actual;
+    return err <= baud / LINK_BAUD_TOLERANCE;
+}
+
+/* Call after the rate was checked and before the answer is queued. */
+void link_baud_request(link_baud_t *lb, uint32_t baud)
+{
+    lb->next = baud;
+    lb->state = LINK_BAUD_DRAIN;
+}
+
+/* A frame passed its CRC at the current rate. Safe from an ISR. */
+void link_baud_rx_good(link_baud_t *lb)
+{
+    lb->rx_good = 1;
+}
+
+/*
+ * Run from the main loop. tx_idle: nothing queued and the last stop bit is out.
+ * Returns the rate to program into the USART now, or 0 to leave it alone.
+ */
+uint32_t link_baud_poll(link_baud_t *lb, uint32_t now_ms, uint8_t tx_idle)
+{
+    if (lb->rx_good) {
+        lb->rx_good = 0;
+        lb->since_ms = now_ms;
+        if (lb->state == LINK_BAUD_CONFIRM) lb->state = LINK_BAUD_STEADY;
+    }
+
+    switch (lb->state) {
+        case LINK_BAUD_DRAIN:
+            if (!tx_idle) return 0;
+            lb->baud = lb->next;
+            lb->since_ms = now_ms;
+            lb->rx_good = 0;
+            lb->state = LINK_BAUD_CONFIRM;
+            return lb->baud;
+
+        case LINK_BAUD_CONFIRM:
+            if (now_ms - lb->since_ms < LINK_BAUD_CONFIRM_MS) return 0;
+            break;
+
+        case LINK_BAUD_STEADY:
+        default:
+            if (lb->baud == LINK_BAUD_DEFAULT) return 0;
+            if (now_ms - lb->since_ms < LINK_BAUD_IDLE_MS) return 0;
+            break;
+    }
+
+    lb->baud = LINK_BAUD_DEFAULT;
+    lb->state = LINK_BAUD_STEADY;
+    lb->since_ms = now_ms;
+    lb->fallbacks++;
+    return lb->baud;
+}
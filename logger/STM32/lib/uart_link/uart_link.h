@@ -0,0 +1,153 @@
+#ifndef UART_LINK_H
+#define UART_LINK_H
+
+#include <stdint.h>
+
+/*
+ * Link layer v2 for the controller UARTs.
+ *
+ * Wire format: 0x00, COBS(packet), 0x00. The zero delimiters make resync trivial:
+ * a lost or corrupted byte costs exactly one packet, the next 0x00 starts over.
+ * The closing 0x00 of one packet also opens the next one, so a lost leading
+ * delimiter costs nothing.
+ *
+ * Packet (before COBS):
+ *   [0] ver_type  LINK_VERSION << 4 | link_type_t
+ *   [1] addr      DEV_ADDR
+ *   [2] seq       chosen by the host, echoed in RESP/ACK/NAK
+ *   [3] cmd
+ *   [4] param
+ *   [5] status    0 in requests, STATUS_OK/ERROR_RESPONSE in responses,
+ *                 link_nak_t in NAKs
+ *   [6] len       payload length, 0..255
+ *   [7..]         payload
+ *   [7+len..]     CRC-16/CCITT-FALSE over bytes 0..6+len, big endian
+ *
+ * The host may keep up to LINK_WINDOW requests with distinct seq outstanding;
+ * the device answers them in arrival order:
+ *   RESP  the command ran, status/payload are its result
+ *   ACK   seq+CRC match a request that already ran (a retransmission);
+ *         it is not executed again
+ *   NAK   the packet was rejected; status says why. A NAK with LINK_NAK_CRC
+ *         carries seq 0 since the seq itself is not trustworthy; the host
+ *         retransmits everything still outstanding.
+ *
+ * Legacy fixed-length frames (first byte DEV_ADDR, CRC8 last) are still
+ * recognised by the same receiver, also right after a packet: a request never
+ * starts with DEV_ADDR once COBS-encoded.
+ *
+ * No target headers are used here: the same file builds for the F412 and L4
+ * applications, both bootloaders and a host (test/, run with make -C test).
+ */
+
+#define LINK_VERSION        2
+#define LINK_HDR_LEN        7
+#define LINK_PAYLOAD_MAX    255
+#define LINK_PKT_MAX        (LINK_HDR_LEN + LINK_PAYLOAD_MAX + 2)
+/* COBS adds one byte per 254, plus the two delimiters */
+#define LINK_WIRE_MAX       (LINK_PKT_MAX + (LINK_PKT_MAX / 254) + 1 + 2)
+#define LINK_WINDOW         4
+
+typedef enum {
+    LINK_REQ  = 0,
+    LINK_RESP = 1,
+    LINK_ACK  = 2,
+    LINK_NAK  = 3,
+} link_type_t;
+
+typedef enum {
+    LINK_NAK_CRC     = 1,
+    LINK_NAK_LEN     = 2,
+    LINK_NAK_VERSION = 3,
+    LINK_NAK_TYPE    = 4,
+} link_nak_t;
+
+typedef struct {
+    uint8_t  type;
+    uint8_t  addr;
+    uint8_t  seq;
+    uint8_t  cmd;
+    uint8_t  param;
+    uint8_t  status;
+    uint8_t  len;
+    uint16_t crc;
+    uint8_t  payload[LINK_PAYLOAD_MAX];
+} link_packet_t;
+
+typedef enum {
+    LINK_RX_NONE = 0,
+    LINK_RX_PACKET,     /* *pkt holds a v2 packet of our version and address */
+    LINK_RX_LEGACY,     /* *legacy points at legacy_len bytes, CRC8 not checked */
+    LINK_RX_NAK,        /* delimited but rejected; answer with link_encode_nak() */
+} link_rx_event_t;
+
+typedef struct {
+    uint8_t  buf[LINK_WIRE_MAX];
+    uint16_t idx;
+    uint8_t  state;
+    uint8_t  legacy_addr;
+    uint16_t legacy_len;
+    uint8_t  nak_seq;
+    uint8_t  nak_reason;
+    uint16_t seen_crc[LINK_WINDOW];
+    uint8_t  seen_seq[LINK_WINDOW];
+    uint8_t  seen_valid;
+    uint8_t  seen_next;
+} link_rx_t;
+
+void link_rx_init(link_rx_t *rx, uint8_t legacy_addr, uint16_t legacy_len);
+link_rx_event_t link_rx_push(link_rx_t *rx, uint8_t b, link_packet_t *pkt,
+                             const uint8_t **legacy);
+uint8_t link_rx_is_duplicate(link_rx_t *rx, const link_packet_t *pkt);
+
+uint16_t link_encode(uint8_t type, uint8_t addr, uint8_t seq, uint8_t cmd, uint8_t param,
+                     uint8_t status, const uint8_t *payload, uint8_t len,
+                     uint8_t *out, uint16_t out_size);
+uint16_t link_encode_nak(const link_rx_t *rx, uint8_t addr, uint8_t *out, uint16_t out_size);
+
+uint16_t link_cobs_encode(const uint8_t *in, uint16_t len, uint8_t *out);
+int32_t  link_cobs_decode(const uint8_t *in, uint16_t len, uint8_t *out, uint16_t out_size);
+uint16_t link_crc16(const uint8_t *data, uint32_t len);
+
+/*
+ * Baud rate negotiation, the same on every port:
+ *   1. host sends set-baud at the current rate; the device checks that its
+ *      USART can hit the rate and answers at the current rate
+ *   2. once that answer has left the shift register the device switches
+ *      (link_baud_poll returns the new rate) and opens a confirm window
+ *   3. the host switches after reading the answer and sends any request;
+ *      the first frame with a good CRC confirms the new rate
+ *   4. no good frame within LINK_BAUD_CONFIRM_MS, or none for LINK_BAUD_IDLE_MS
+ *      while above LINK_BAUD_DEFAULT: back to LINK_BAUD_DEFAULT. A host that
+ *      loses the device does the same, so both ends meet again at 115200.
+ * Only the timing lives here; programming the USART is up to the caller.
+ */
+#define LINK_BAUD_DEFAULT       115200UL
+#define LINK_BAUD_MAX           3000000UL
+#define LINK_BAUD_CONFIRM_MS    1000UL
+#define LINK_BAUD_IDLE_MS       30000UL
+#define LINK_BAUD_TOLERANCE     50UL        /* divider error at most 1/50 = 2 % */
+
+typedef enum {
+    LINK_BAUD_STEADY = 0,
+    LINK_BAUD_DRAIN,        /* answer to set-baud still going out at the old rate */
+    LINK_BAUD_CONFIRM,      /* switched, waiting for the first good frame */
+} link_baud_state_t;
+
+typedef struct {
+    uint32_t baud;              /* rate the USART runs at */
+    uint32_t next;              /* requested rate, applied after DRAIN */
+    uint32_t since_ms;          /* start of CONFIRM / last good frame */
+    uint32_t fallbacks;
+    uint8_t  state;
+    volatile uint8_t rx_good;   /* set from the RX path, consumed by link_baud_poll */
+} link_baud_t;
+
+void     link_rx_reset(link_rx_t *rx);
+void     link_baud_init(link_baud_t *lb);
+uint8_t  link_baud_valid(uint32_t clk, uint32_t baud, uint32_t min_div);
+void     link_baud_request(link_baud_t *lb, uint32_t baud);
+void     link_baud_rx_good(link_baud_t *lb);
+uint32_t link_baud_poll(link_baud_t *lb, uint32_t now_ms, uint8_t tx_idle);
+
+#endif // UART_LINK_H
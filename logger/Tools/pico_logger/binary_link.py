@@ -0,0 +1,186 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+
+import struct
+import time
+from dataclasses import dataclass
+from typing import Dict, List, Optional, Tuple
+
+try:
+    import serial
+except Exception as e:
+    serial = None
+
+
+PREAMBLE = b"\x02PLB1"
+SOF = 0xA5
+MAX_PAYLOAD = 2048
+
+HELLO = 0x01
+PING = 0x02
+BYE = 0x03
+ACK = 0x04
+NAK = 0x05
+CONFIG_READ = 0x10
+CONFIG_DATA = 0x11
+CONFIG_WRITE = 0x12
+STREAM_CTL = 0x20
+SAMPLE = 0x21
+HISTORY_READ = 0x30
+HISTORY_DATA = 0x31
+
+FIELD_SET_RESULTS = {0: "OK", 1: "READ_ONLY", 2: "BAD_VALUE", 3: "OUT_OF_RANGE"}
+
+
+def crc16(data: bytes, crc: int = 0xFFFF) -> int:
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+@dataclass
+class Sample:
+    epoch: int
+    temperature: float
+    humidity: float
+    pressure: float
+
+    @staticmethod
+    def unpack(data: bytes) -> "Sample":
+        return Sample(*struct.unpack("<qfff", data[:20]))
+
+
+class BinaryLinkError(RuntimeError):
+    pass
+
+
+class BinaryLink:
+    """Client for the framed binary protocol (see firmware binary_link.hpp)."""
+
+    def __init__(self, ser: "serial.Serial"):  # type: ignore
+        self.ser = ser
+        self.seq = 0
+        self.hello: Optional[Dict[str, int]] = None
+        self._buf = bytearray()
+
+    def enter(self, timeout: float = 2.0) -> Dict[str, int]:
+        self.ser.reset_input_buffer()
+        self.ser.write(PREAMBLE)
+        ftype, _, payload = self._read_frame(timeout, want=HELLO)
+        ver, max_payload, cfg_ver, logger_id, sensor_id = struct.unpack(
+            "<BHHII", payload[:13]
+        )
+        self.hello = {
+            "version": ver,
+            "max_payload": max_payload,
+            "config_version": cfg_ver,
+            "logger_id": logger_id,
+            "sensor_id": sensor_id,
+        }
+        return self.hello
+
+    def leave(self) -> None:
+        self._request(BYE)
+
+    def ping(self, data: bytes = b"") -> bytes:
+        return self._request(PING, data)[1]
+
+    def read_config(self) -> Dict[str, str]:
+        ftype, payload = self._request(CONFIG_READ)
+        out: Dict[str, str] = {}
+        for line in payload.decode("utf-8", errors="replace").splitlines():
+            if "=" in line:
+                k, v = line.split("=", 1)
+                out[k.strip()] = v.strip()
+        return out
+
+    def write_config(self, values: Dict[str, str], save: bool = True) -> None:
+        body = "".join(f"{k}={v}\n" for k, v in values.items()).encode("utf-8")
+        _, payload = self._request(CONFIG_WRITE, bytes([1 if save else 0]) + body)
+        status, line = struct.unpack("<BH", payload[:3])
+        if status != 0:
+            key = list(values.keys())[line] if line < len(values) else "?"
+            raise BinaryLinkError(
+                f"config write rejected at '{key}': {FIELD_SET_RESULTS.get(status, status)}"
+            )
+
+    def read_history(self, timeout: float = 3.0) -> List[Sample]:
+        seq = self._send(HISTORY_READ)
+        samples: List[Sample] = []
+        while True:
+            _, _, payload = self._read_frame(timeout, want=HISTORY_DATA, seq=seq)
+            total, first = struct.unpack("<HH", payload[:4])
+            for off in range(4, len(payload) - 19, 20):
+                samples.append(Sample.unpack(payload[off : off + 20]))
+            if len(samples) >= total or len(payload) <= 4:
+                return samples
+
+    def set_streaming(self, enable: bool) -> None:
+        self._request(STREAM_CTL, bytes([1 if enable else 0]))
+
+    def next_sample(self, timeout: float = 5.0) -> Optional[Sample]:
+        try:
+            _, _, payload = self._read_frame(timeout, want=SAMPLE)
+        except TimeoutError:
+            return None
+        return Sample.unpack(payload)
+
+    def _send(self, ftype: int, payload: bytes = b"") -> int:
+        self.seq = (self.seq + 1) & 0xFF or 1
+        body = struct.pack("<BBH", ftype, self.seq, len(payload)) + payload
+        self.ser.write(bytes([SOF]) + body + struct.pack("<H", crc16(body)))
+        return self.seq
+
+    def _request(
+        self, ftype: int, payload: bytes = b"", timeout: float = 2.0
+    ) -> Tuple[int, bytes]:
+        seq = self._send(ftype, payload)
+        rtype, _, data = self._read_frame(timeout, seq=seq)
+        if rtype == NAK:
+            raise BinaryLinkError(f"request 0x{ftype:02x} rejected (reason {data[0]})")
+        return rtype, data
+
+    def _read_frame(
+        self, timeout: float, want: Optional[int] = None, seq: Optional[int] = None
+    ) -> Tuple[int, int, bytes]:
+        deadline = time.time() + timeout
+        while time.time() < deadline:
+            frame = self._parse()
+            if frame is None:
+                chunk = self.ser.read(self.ser.in_waiting or 1)
+                if chunk:
+                    self._buf.extend(chunk)
+                continue
+            ftype, fseq, payload = frame
+            if seq is not None and fseq != seq and ftype != NAK:
+                continue
+            if want is not None and ftype not in (want, NAK):
+                continue
+            return frame
+        raise TimeoutError("no reply from device")
+
+    def _parse(self) -> Optional[Tuple[int, int, bytes]]:
+        while True:
+            start = self._buf.find(bytes([SOF]))
+            if start < 0:
+                self._buf.clear()
+                return None
+            del self._buf[:start]
+            if len(self._buf) < 5:
+                return None
+            length = self._buf[3] | (self._buf[4] << 8)
+            if length > MAX_PAYLOAD:
+                del self._buf[:1]
+                continue
+            if len(self._buf) < 7 + length:
+                return None
+            body = bytes(self._buf[1 : 5 + length])
+            crc = self._buf[5 + length] | (self._buf[6 + length] << 8)
+            if crc != crc16(body):
+                del self._buf[:1]
+                continue
+            del self._buf[: 7 + length]
+            return body[0], body[1], body[4:]
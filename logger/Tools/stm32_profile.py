@@ -0,0 +1,253 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+Read and pretty-print the DWT profiling counters of the STM32F412 application
+(commands 0x0B00..0x0B04).
+
+Speaks the 24-byte application frame protocol straight to USART1/USART2 through
+a USB-UART adapter:
+
+    python3 stm32_profile.py /dev/ttyUSB0
+    python3 stm32_profile.py COM5 --baud 115200 --reset
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+try:
+    import serial
+except Exception:
+    serial = None
+
+DEV_ADDR = 0xB2
+FRAME_LEN_APP = 24
+STATUS_OK = 0x40
+
+CMD_PROF = 0x0B
+PROF_INFO = 0x00
+PROF_PROBE = 0x01
+PROF_CMD = 0x02
+PROF_HIST = 0x03
+PROF_RESET = 0x04
+
+# Same order as the PROF_* enum in include/prof.h
+PROBE_NAMES = [
+    "TIM13 tick ISR",
+    "TIM14 I2C timeout ISR",
+    "USART1 ISR",
+    "USART2 ISR",
+    "UART1 DMA RX ISR",
+    "UART2 DMA RX ISR",
+    "UART1 DMA TX ISR",
+    "UART2 DMA TX ISR",
+    "I2C1 EV ISR",
+    "I2C1 ER ISR",
+    "I2C1 DMA RX ISR",
+    "I2C1 DMA TX ISR",
+    "SPI1 DMA RX ISR",
+    "SPI1 DMA TX ISR",
+    "ADC DMA ISR",
+    "EXTI0 ISR (BTN1)",
+    "EXTI1 ISR (BTN2)",
+    "EXTI9_5 ISR (INA226)",
+    "RTC wakeup ISR",
+    "RTC alarm ISR",
+    "RTC tamper/stamp ISR",
+    "1 s block",
+    "acq_finish",
+    "LCD refresh",
+]
+
+CMD_NAMES = {
+    0x0000: "ping",
+    0x0100: "serial",
+    0x0101: "version",
+    0x0102: "build date",
+    0x0103: "production date",
+    0x0200: "adc",
+    0x0201: "btn1",
+    0x0202: "btn2",
+    0x0203: "esp32 input",
+    0x0300: "sht40",
+    0x0301: "bme280",
+    0x0400: "outputs",
+    0x0401: "led1",
+    0x0402: "led2",
+    0x0403: "pb12",
+    0x0404: "pc0",
+    0x0405: "pc1",
+    0x0406: "pc2",
+    0x0407: "pc3",
+    0x0408: "esp32",
+    0x0501: "tim1 ch1",
+    0x0502: "tim2 ch3",
+    0x0503: "tim4 ch3",
+    0x0504: "tim4 ch4",
+    0x0505: "rgb",
+    0x0506: "buzzer",
+    0x0600: "rtc read",
+    0x0601: "rtc write",
+    0x0602: "rtc wakeup",
+    0x0603: "alarm set",
+    0x0604: "alarm off",
+    0x0605: "timestamp",
+    0x0800: "batch",
+    0x0900: "link stats",
+    0x0901: "acq stats",
+    0x0A00: "link baud set",
+    0x0A01: "link baud get",
+    0x0B00: "prof info",
+    0x0B01: "prof probe",
+    0x0B02: "prof cmd",
+    0x0B03: "prof hist",
+    0x0B04: "prof reset",
+    0x7000: "ina226",
+    0x7001: "ina226 log",
+    0x7002: "ina226 log reset",
+}
+
+
+def crc8_atm(data: bytes) -> int:
+    crc = 0x00
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            if crc & 0x80:
+                crc = ((crc << 1) ^ 0x07) & 0xFF
+            else:
+                crc = (crc << 1) & 0xFF
+    return crc
+
+
+class Link:
+    def __init__(self, port: str, baud: int):
+        if serial is None:
+            raise RuntimeError(
+                "No serial module available. Please install pyserial package."
+            )
+        self.ser = serial.Serial(port=port, baudrate=baud, timeout=0.5)
+        time.sleep(0.1)
+        self.ser.reset_input_buffer()
+
+    def close(self) -> None:
+        self.ser.close()
+
+    def request(self, cmd: int, param: int, payload: bytes = b"") -> tuple[int, bytes]:
+        frame = bytearray(FRAME_LEN_APP)
+        frame[0] = DEV_ADDR
+        frame[2] = cmd & 0xFF
+        frame[3] = param & 0xFF
+        frame[4 : 4 + len(payload)] = payload
+        frame[FRAME_LEN_APP - 1] = crc8_atm(frame[: FRAME_LEN_APP - 1])
+
+        self.ser.reset_input_buffer()
+        self.ser.write(frame)
+
+        deadline = time.time() + 1.5
+        while time.time() < deadline:
+            b = self.ser.read(1)
+            if not b or b[0] != DEV_ADDR:
+                continue
+            rest = self.ser.read(FRAME_LEN_APP - 1)
+            resp = b + rest
+            if len(resp) != FRAME_LEN_APP:
+                break
+            if crc8_atm(resp[: FRAME_LEN_APP - 1]) != resp[FRAME_LEN_APP - 1]:
+                continue
+            if resp[2] != cmd or resp[3] != param:
+                continue
+            return resp[1], resp[4 : FRAME_LEN_APP - 1]
+        raise TimeoutError(f"no answer to 0x{cmd:02X}{param:02X}")
+
+
+def decode_stat(p: bytes) -> dict:
+    count, cmin, cmax, mean = struct.unpack(">IIII", p[:16])
+    return {"count": count, "min": cmin, "max": cmax, "mean": mean}
+
+
+def us(cycles: int, clock_hz: int) -> str:
+    return f"{cycles * 1e6 / clock_hz:10.2f}"
+
+
+def print_table(title: str, rows: list, clock_hz: int) -> None:
+    print(f"\n{title}")
+    print(f"{'':28}{'count':>10}{'min us':>11}{'mean us':>11}{'max us':>11}")
+    for name, st in rows:
+        if st["count"] == 0:
+            print(f"{name:28}{0:>10}{'-':>11}{'-':>11}{'-':>11}")
+            continue
+        print(
+            f"{name:28}{st['count']:>10} {us(st['min'], clock_hz)} "
+            f"{us(st['mean'], clock_hz)} {us(st['max'], clock_hz)}"
+        )
+
+
+def print_hist(counts: list) -> None:
+    print("\nMain loop period")
+    total = sum(counts) or 1
+    peak = max(counts) or 1
+    last = len(counts) - 1
+    for k, n in enumerate(counts):
+        lo = 1 << k if k else 0
+        label = f">= {lo} us" if k == last else f"{lo}..{(1 << (k + 1)) - 1} us"
+        bar = "#" * round(40 * n / peak)
+        print(f"{label:>18} {n:>10} {100.0 * n / total:6.2f}%  {bar}")
+
+
+def main() -> int:
+    ap = argparse.ArgumentParser(description="STM32F412 DWT profiling readout")
+    ap.add_argument("port")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--reset", action="store_true", help="clear the counters after reading")
+    args = ap.parse_args()
+
+    link = Link(args.port, args.baud)
+    try:
+        status, p = link.request(CMD_PROF, PROF_INFO)
+        if status != STATUS_OK:
+            print("profiling not supported by this firmware", file=sys.stderr)
+            return 1
+        clock_hz, n_probes, n_cmds, n_buckets, window_ms = struct.unpack(">IBBBI", p[:11])
+        print(f"core clock {clock_hz / 1e6:.1f} MHz, window {window_ms / 1000.0:.1f} s")
+
+        rows = []
+        for i in range(n_probes):
+            status, p = link.request(CMD_PROF, PROF_PROBE, bytes([i]))
+            if status != STATUS_OK:
+                continue
+            name = PROBE_NAMES[i] if i < len(PROBE_NAMES) else f"probe {i}"
+            rows.append((name, decode_stat(p[1:])))
+        print_table("ISRs and main loop sections", rows, clock_hz)
+
+        rows = []
+        for slot in range(n_cmds):
+            status, p = link.request(CMD_PROF, PROF_CMD, bytes([slot]))
+            if status != STATUS_OK:
+                continue
+            cmd_id = (p[0] << 8) | p[1]
+            name = f"0x{cmd_id:04X} {CMD_NAMES.get(cmd_id, '')}"
+            rows.append((name, decode_stat(p[2:])))
+        rows.sort(key=lambda r: r[0])
+        print_table("Command handlers", rows, clock_hz)
+
+        counts = []
+        while len(counts) < n_buckets:
+            status, p = link.request(CMD_PROF, PROF_HIST, bytes([len(counts)]))
+            if status != STATUS_OK:
+                break
+            n = p[1]
+            counts.extend(struct.unpack(f">{n}I", p[2 : 2 + 4 * n]))
+        print_hist(counts)
+
+        if args.reset:
+            link.request(CMD_PROF, PROF_RESET)
+            print("\ncounters reset")
+    finally:
+        link.close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
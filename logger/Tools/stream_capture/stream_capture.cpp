@@ -0,0 +1,222 @@
+/**
+ * @file stream_capture.cpp
+ * @brief Capture the logger's USB live stream into a CSV file.
+ *
+ * Usage:
+ *   stream_capture <port> <out.csv> [rate=N] [fields=t,h,p,rt,rh,rp|all] [seconds=S]
+ *
+ * Opens the CDC port (e.g. /dev/ttyACM0 or COM5), sends "stream on ...", and writes
+ * one CSV row per "D,..." line using the column names announced by STREAM_FMT.
+ * Each row also gets the host receive time (host_us, microseconds since capture
+ * start) so device and host clocks can be compared. Sequence gaps (samples dropped
+ * on the device or lost on the link) are counted and reported at the end, together
+ * with the device's own STREAM_STAT counters. Ctrl+C or the optional time limit
+ * sends "stream off" and closes the file.
+ */
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <poll.h>
+#endif
+
+static std::atomic<bool> g_stop{false};
+
+static void on_signal(int) { g_stop = true; }
+
+/**
+ * @brief Minimal blocking serial port with a read timeout.
+ */
+class SerialPort {
+public:
+    ~SerialPort() { close(); }
+
+    bool open(const std::string& name) {
+#ifdef _WIN32
+        const std::string path = "\\\\.\\" + name;
+        h_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+        if (h_ == INVALID_HANDLE_VALUE) return false;
+        DCB dcb{};
+        dcb.DCBlength = sizeof(dcb);
+        GetCommState(h_, &dcb);
+        dcb.BaudRate = CBR_115200;
+        dcb.ByteSize = 8;
+        dcb.Parity = NOPARITY;
+        dcb.StopBits = ONESTOPBIT;
+        dcb.fDtrControl = DTR_CONTROL_ENABLE;
+        SetCommState(h_, &dcb);
+        COMMTIMEOUTS t{};
+        t.ReadIntervalTimeout = MAXDWORD;
+        t.ReadTotalTimeoutMultiplier = MAXDWORD;
+        t.ReadTotalTimeoutConstant = 100;
+        t.WriteTotalTimeoutConstant = 1000;
+        SetCommTimeouts(h_, &t);
+        return true;
+#else
+        fd_ = ::open(name.c_str(), O_RDWR | O_NOCTTY);
+        if (fd_ < 0) return false;
+        termios tio{};
+        if (tcgetattr(fd_, &tio) != 0) return false;
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, B115200);
+        cfsetospeed(&tio, B115200);
+        tio.c_cflag |= CLOCAL | CREAD;
+        tcsetattr(fd_, TCSANOW, &tio);
+        tcflush(fd_, TCIOFLUSH);
+        return true;
+#endif
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (h_ != INVALID_HANDLE_VALUE) CloseHandle(h_);
+        h_ = INVALID_HANDLE_VALUE;
+#else
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+#endif
+    }
+
+    bool write(const std::string& s) {
+#ifdef _WIN32
+        DWORD n = 0;
+        return WriteFile(h_, s.data(), (DWORD)s.size(), &n, nullptr) && n == s.size();
+#else
+        return ::write(fd_, s.data(), s.size()) == (ssize_t)s.size();
+#endif
+    }
+
+    /** @return Bytes read (0 on timeout), or -1 on error. */
+    long read(char* buf, size_t len) {
+#ifdef _WIN32
+        DWORD n = 0;
+        if (!ReadFile(h_, buf, (DWORD)len, &n, nullptr)) return -1;
+        return (long)n;
+#else
+        pollfd p{fd_, POLLIN, 0};
+        const int r = ::poll(&p, 1, 100);
+        if (r < 0) return g_stop ? 0 : -1;
+        if (r == 0) return 0;
+        return (long)::read(fd_, buf, len);
+#endif
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE h_ = INVALID_HANDLE_VALUE;
+#else
+    int fd_ = -1;
+#endif
+};
+
+static void usage() {
+    std::cerr << "usage: stream_capture <port> <out.csv> [rate=N] [fields=t,h,p,rt,rh,rp|all] [seconds=S]\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        usage();
+        return 2;
+    }
+    const std::string port = argv[1];
+    const std::string out_path = argv[2];
+    std::string cmd = "stream on";
+    double seconds = 0;
+    for (int i = 3; i < argc; ++i) {
+        const std::string a = argv[i];
+        if (a.rfind("rate=", 0) == 0 || a.rfind("fields=", 0) == 0) {
+            cmd += " " + a;
+        } else if (a.rfind("seconds=", 0) == 0) {
+            seconds = std::atof(a.c_str() + 8);
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    SerialPort ser;
+    if (!ser.open(port)) {
+        std::cerr << "cannot open " << port << "\n";
+        return 1;
+    }
+    std::ofstream out(out_path);
+    if (!out) {
+        std::cerr << "cannot write " << out_path << "\n";
+        return 1;
+    }
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    if (!ser.write("stream off\n" + cmd + "\n")) {
+        std::cerr << "write failed\n";
+        return 1;
+    }
+
+    using clock = std::chrono::steady_clock;
+    const auto t0 = clock::now();
+    bool header = false;
+    bool have_seq = false;
+    uint32_t last_seq = 0;
+    uint64_t rows = 0, gaps = 0;
+    std::string last_stat;
+    std::string line;
+    char buf[4096];
+
+    while (!g_stop) {
+        if (seconds > 0 && std::chrono::duration<double>(clock::now() - t0).count() >= seconds) break;
+        const long n = ser.read(buf, sizeof(buf));
+        if (n < 0) {
+            std::cerr << "read failed\n";
+            break;
+        }
+        const uint64_t host_us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - t0).count();
+        for (long i = 0; i < n; ++i) {
+            const char c = buf[i];
+            if (c == '\r') continue;
+            if (c != '\n') {
+                line.push_back(c);
+                continue;
+            }
+            if (line.rfind("D,", 0) == 0 && header) {
+                const uint32_t seq = (uint32_t)std::strtoul(line.c_str() + 2, nullptr, 10);
+                if (have_seq && seq != last_seq + 1) gaps += seq - last_seq - 1;
+                have_seq = true;
+                last_seq = seq;
+                out << line.substr(2) << ',' << host_us << '\n';
+                ++rows;
+            } else if (line.rfind("STREAM_FMT ", 0) == 0) {
+                if (!header) out << line.substr(11) << ",host_us\n";
+                header = true;
+            } else if (line.rfind("STREAM_ON ", 0) == 0) {
+                std::cerr << line << "\n";
+            } else if (line.rfind("STREAM_STAT ", 0) == 0) {
+                last_stat = line;
+            } else if (line.rfind("ERR", 0) == 0) {
+                std::cerr << "device: " << line << "\n";
+                g_stop = true;
+            }
+            line.clear();
+        }
+    }
+
+    ser.write("stream off\n");
+    out.flush();
+    std::cerr << "rows=" << rows << " seq_gaps=" << gaps;
+    if (!last_stat.empty()) std::cerr << " last: " << last_stat;
+    std::cerr << "\n";
+    return rows ? 0 : 1;
+}